@@ -331,6 +331,8 @@ void ArgumentParser::processReg()
 		("fini,F", po::value<std::string>(), "fini command line with arguments")
 		("health_check,l", po::value<std::string>(), "health check script command (e.g., sh -x 'curl host:port/health', return 0 is health)")
 		("docker_image,d", po::value<std::string>(), "docker image which used to run command line (this will enable docker)")
+		("stop_signal", po::value<int>(), "signal to stop process, SIGKILL is sent if not exit in stop_timeout (default 15)")
+		("stop_timeout", po::value<int>(), "seconds wait process exit after stop signal (default 10)")
 		("workdir,w", po::value<std::string>(), "working directory")
 		("status,s", po::value<bool>()->default_value(true), "application status status (start is true, stop is false)")
 		("start_time,t", po::value<std::string>(), "start date time for app (ISO8601 time format, e.g., '2020-10-11T09:22:05')")
@@ -391,6 +393,10 @@ void ArgumentParser::processReg()
 		jsonObj[JSON_KEY_APP_fini_command] = web::json::value::string(m_commandLineVariables["fini"].as<std::string>());
 	if (m_commandLineVariables.count("health_check"))
 		jsonObj[JSON_KEY_APP_health_check_cmd] = web::json::value::string(m_commandLineVariables["health_check"].as<std::string>());
+	if (m_commandLineVariables.count("stop_signal"))
+		jsonObj[JSON_KEY_APP_stop_signal] = web::json::value::number(m_commandLineVariables["stop_signal"].as<int>());
+	if (m_commandLineVariables.count("stop_timeout"))
+		jsonObj[JSON_KEY_APP_stop_timeout] = web::json::value::number(m_commandLineVariables["stop_timeout"].as<int>());
 	if (m_commandLineVariables.count("perm"))
 		jsonObj[JSON_KEY_APP_owner_permission] = web::json::value::number(m_commandLineVariables["perm"].as<int>());
 	if (m_commandLineVariables.count("workdir"))
@@ -528,7 +534,9 @@ void ArgumentParser::processView()
 		("name,n", po::value<std::string>(), "view application by name.")
 		("long,l", "display the complete information without reduce")
 		("output,o", "view the application output")
-		("stdout_index,O", po::value<int>(), "application output index");
+		("stdout_index,O", po::value<int>(), "application output index")
+		("tail,t", po::value<int>(), "view the last N lines of application output")
+		("follow,f", "follow the application output");
 
 	shiftCommandLineArgs(desc);
 	HELP_ARG_CHECK_WITH_RETURN;
@@ -556,6 +564,27 @@ void ArgumentParser::processView()
 			std::map<std::string, std::string> query;
 			query["keep_history"] = std::to_string(keepHis);
 			query["stdout_index"] = std::to_string(index);
+			if (m_commandLineVariables.count("tail"))
+			{
+				query[HTTP_QUERY_KEY_output_tail] = std::to_string(m_commandLineVariables["tail"].as<int>());
+			}
+			if (m_commandLineVariables.count("follow"))
+			{
+				// read from the position of last response, only new output is transferred
+				std::uint64_t offset = 0;
+				while (true)
+				{
+					query[HTTP_QUERY_KEY_output_offset] = std::to_string(offset);
+					auto response = requestHttp(true, methods::GET, restPath, query);
+					std::cout << response.extract_utf8string(true).get() << std::flush;
+					if (response.headers().has(HTTP_HEADER_KEY_output_offset))
+					{
+						offset = std::stoull(GET_STD_STRING(response.headers().find(HTTP_HEADER_KEY_output_offset)->second));
+					}
+					query.erase(HTTP_QUERY_KEY_output_tail);
+					std::this_thread::sleep_for(std::chrono::seconds(1));
+				}
+			}
 			auto response = requestHttp(true, methods::GET, restPath, query);
 			auto bodyStr = response.extract_utf8string(true).get();
 			std::cout << bodyStr;
@@ -730,6 +759,8 @@ void ArgumentParser::processRun()
 			restPath = std::string("/appmesh/app/").append(appName).append("/run/output");
 			query.clear();
 			query[HTTP_QUERY_KEY_process_uuid] = process_uuid;
+			// server hold the request until new output or process exit
+			query[HTTP_QUERY_KEY_output_wait] = std::to_string(DEFAULT_RUN_OUTPUT_WAIT_SECONDS);
 			response = requestHttp(false, methods::GET, restPath, query);
 			std::cout << GET_STD_STRING(response.extract_utf8string(true).get());
 			// check continues failure
@@ -744,7 +775,6 @@ void ArgumentParser::processRun()
 				break;
 			}
 			continueFailure = 0;
-			std::this_thread::sleep_for(std::chrono::milliseconds(800));
 		}
 	}
 }
@@ -885,11 +915,11 @@ void ArgumentParser::processExec()
 				break;
 			}
 		}
-		std::this_thread::sleep_for(std::chrono::milliseconds(150));
 		// Process Read
 		if (!process_uuid.empty())
 		{
-			std::map<std::string, std::string> query = {{HTTP_QUERY_KEY_process_uuid, process_uuid}};
+			// server hold the request until new output or process exit
+			std::map<std::string, std::string> query = {{HTTP_QUERY_KEY_process_uuid, process_uuid}, {HTTP_QUERY_KEY_output_wait, std::to_string(DEFAULT_RUN_OUTPUT_WAIT_SECONDS)}};
 			auto restPath = Utility::stringFormat("/appmesh/app/%s/run/output", APPC_EXEC_APP_NAME.c_str());
 			auto response = requestHttp(false, methods::GET, restPath, query);
 			std::cout << response.extract_utf8string(true).get();
@@ -903,7 +933,10 @@ void ArgumentParser::processExec()
 				}
 			}
 		}
-		std::this_thread::sleep_for(std::chrono::milliseconds(150));
+		else
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(150));
+		}
 	}
 }
 
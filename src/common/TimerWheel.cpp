@@ -0,0 +1,274 @@
+#include <algorithm>
+#include <climits>
+
+#include "TimerWheel.h"
+#include "Utility.h"
+
+#define TIMER_WHEEL_LEVELS 4
+#define TIMER_WHEEL_LEVEL0_BITS 8
+#define TIMER_WHEEL_LEVELN_BITS 6
+// bit shift for the slot index of each level
+#define TIMER_WHEEL_SHIFT(level) ((level) == 0 ? 0 : TIMER_WHEEL_LEVEL0_BITS + TIMER_WHEEL_LEVELN_BITS * ((level)-1))
+#define TIMER_WHEEL_SLOTS(level) ((level) == 0 ? (1 << TIMER_WHEEL_LEVEL0_BITS) : (1 << TIMER_WHEEL_LEVELN_BITS))
+// max ticks covered by the wheel
+#define TIMER_WHEEL_MAX_TICKS (1ULL << (TIMER_WHEEL_LEVEL0_BITS + TIMER_WHEEL_LEVELN_BITS * (TIMER_WHEEL_LEVELS - 1)))
+
+TimerWheel::TimerNode::TimerNode()
+	: m_id(0), m_expireTick(0), m_intervalTicks(0), m_prev(nullptr), m_next(nullptr)
+{
+}
+
+TimerWheel::TimerWheel(std::size_t tickMillisecond)
+	: m_tickMillisecond(tickMillisecond > 0 ? tickMillisecond : 1), m_startTime(std::chrono::steady_clock::now()), m_currentTick(0), m_lastId(0)
+{
+	m_wheels.resize(TIMER_WHEEL_LEVELS);
+	for (int level = 0; level < TIMER_WHEEL_LEVELS; level++)
+	{
+		// slot vector is never resized after here, sentinel address is stable
+		m_wheels[level].resize(TIMER_WHEEL_SLOTS(level));
+		for (auto &head : m_wheels[level])
+		{
+			head.m_prev = head.m_next = &head;
+		}
+	}
+}
+
+TimerWheel::~TimerWheel()
+{
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	for (auto &node : m_nodes)
+	{
+		delete node.second;
+	}
+	m_nodes.clear();
+}
+
+int TimerWheel::add(long int delayMillisecond, long int intervalMillisecond, const Callback &callback)
+{
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	auto node = new TimerNode();
+	node->m_id = nextId();
+	node->m_expireTick = std::max(m_currentTick, nowTick()) + toTicks(delayMillisecond);
+	node->m_intervalTicks = intervalMillisecond > 0 ? std::max(toTicks(intervalMillisecond), (uint64_t)1) : 0;
+	node->m_callback = std::make_shared<Callback>(callback);
+	m_nodes[node->m_id] = node;
+	insertNode(node);
+	return node->m_id;
+}
+
+bool TimerWheel::cancel(int timerId)
+{
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	auto iter = m_nodes.find(timerId);
+	if (iter == m_nodes.end())
+	{
+		return false;
+	}
+	unlinkNode(iter->second);
+	delete iter->second;
+	m_nodes.erase(iter);
+	return true;
+}
+
+std::size_t TimerWheel::advance()
+{
+	return advanceTo(nowTick());
+}
+
+std::size_t TimerWheel::advanceTo(uint64_t tick)
+{
+	const static char fname[] = "TimerWheel::advanceTo() ";
+
+	std::vector<std::pair<int, std::shared_ptr<Callback>>> expired;
+	{
+		std::lock_guard<std::recursive_mutex> guard(m_mutex);
+		if (m_nodes.empty() && tick >= m_currentTick)
+		{
+			// nothing to trigger, skip idle ticks
+			m_currentTick = tick + 1;
+			return 0;
+		}
+		while (m_currentTick <= tick)
+		{
+			// cascade upper levels when lower level wrapped
+			for (int level = 1; level < TIMER_WHEEL_LEVELS; level++)
+			{
+				if ((m_currentTick & ((1ULL << TIMER_WHEEL_SHIFT(level)) - 1)) != 0)
+					break;
+				cascade(level, (m_currentTick >> TIMER_WHEEL_SHIFT(level)) & (TIMER_WHEEL_SLOTS(level) - 1));
+			}
+
+			auto &head = m_wheels[0][m_currentTick & (TIMER_WHEEL_SLOTS(0) - 1)];
+			while (head.m_next != &head)
+			{
+				auto node = head.m_next;
+				unlinkNode(node);
+				expired.emplace_back(node->m_id, node->m_callback);
+				if (node->m_intervalTicks)
+				{
+					node->m_expireTick = m_currentTick + node->m_intervalTicks;
+					insertNode(node);
+				}
+			}
+			m_currentTick++;
+		}
+	}
+
+	std::size_t triggered = 0;
+	for (const auto &timer : expired)
+	{
+		{
+			std::lock_guard<std::recursive_mutex> guard(m_mutex);
+			auto iter = m_nodes.find(timer.first);
+			if (iter == m_nodes.end())
+			{
+				// cancelled before trigger
+				continue;
+			}
+			if (iter->second->m_intervalTicks == 0)
+			{
+				// one-time timer is removed before trigger
+				delete iter->second;
+				m_nodes.erase(iter);
+			}
+		}
+		try
+		{
+			(*timer.second)(timer.first);
+		}
+		catch (const std::exception &ex)
+		{
+			LOG_WAR << fname << "timer <" << timer.first << "> got exception: " << ex.what();
+		}
+		catch (...)
+		{
+			LOG_WAR << fname << "timer <" << timer.first << "> exception";
+		}
+		triggered++;
+	}
+	return triggered;
+}
+
+uint64_t TimerWheel::nowTick() const
+{
+	auto duration = std::chrono::steady_clock::now() - m_startTime;
+	return std::chrono::duration_cast<std::chrono::milliseconds>(duration).count() / m_tickMillisecond;
+}
+
+uint64_t TimerWheel::currentTick() const
+{
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	return m_currentTick;
+}
+
+uint64_t TimerWheel::nextExpireTick() const
+{
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	uint64_t next = UINT64_MAX;
+	if (m_nodes.empty())
+		return next;
+	// level 0 holds timers expire in [current, current + slots)
+	for (uint64_t tick = m_currentTick; tick < m_currentTick + TIMER_WHEEL_SLOTS(0); tick++)
+	{
+		const auto &head = m_wheels[0][tick & (TIMER_WHEEL_SLOTS(0) - 1)];
+		if (head.m_next != &head)
+		{
+			next = tick;
+			break;
+		}
+	}
+	// upper level slot is cascaded when tick reach its boundary
+	for (int level = 1; level < TIMER_WHEEL_LEVELS; level++)
+	{
+		const uint64_t first = (m_currentTick + (1ULL << TIMER_WHEEL_SHIFT(level)) - 1) >> TIMER_WHEEL_SHIFT(level);
+		for (uint64_t index = first; index < first + TIMER_WHEEL_SLOTS(level); index++)
+		{
+			const uint64_t tick = index << TIMER_WHEEL_SHIFT(level);
+			if (tick >= next)
+				break;
+			const auto &head = m_wheels[level][index & (TIMER_WHEEL_SLOTS(level) - 1)];
+			if (head.m_next != &head)
+			{
+				next = tick;
+				break;
+			}
+		}
+	}
+	return next;
+}
+
+std::size_t TimerWheel::tickMillisecond() const
+{
+	return m_tickMillisecond;
+}
+
+std::size_t TimerWheel::size() const
+{
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	return m_nodes.size();
+}
+
+void TimerWheel::insertNode(TimerNode *node)
+{
+	auto expire = std::max(node->m_expireTick, m_currentTick);
+	auto delta = expire - m_currentTick;
+	int level = 0;
+	while (level < TIMER_WHEEL_LEVELS - 1 && delta >= (1ULL << TIMER_WHEEL_SHIFT(level + 1)))
+	{
+		level++;
+	}
+	if (delta >= TIMER_WHEEL_MAX_TICKS)
+	{
+		// out of wheel range, park in top level and re-cascade later
+		expire = m_currentTick + TIMER_WHEEL_MAX_TICKS - 1;
+	}
+	auto &head = m_wheels[level][(expire >> TIMER_WHEEL_SHIFT(level)) & (TIMER_WHEEL_SLOTS(level) - 1)];
+	node->m_prev = head.m_prev;
+	node->m_next = &head;
+	head.m_prev->m_next = node;
+	head.m_prev = node;
+}
+
+void TimerWheel::unlinkNode(TimerNode *node)
+{
+	if (node->m_next)
+	{
+		node->m_prev->m_next = node->m_next;
+		node->m_next->m_prev = node->m_prev;
+		node->m_prev = node->m_next = nullptr;
+	}
+}
+
+void TimerWheel::cascade(int level, std::size_t index)
+{
+	auto &head = m_wheels[level][index];
+	if (head.m_next == &head)
+		return;
+	// detach the whole slot list first, re-insert may go back to same slot for parked timer
+	auto node = head.m_next;
+	head.m_prev->m_next = nullptr;
+	head.m_prev = head.m_next = &head;
+	while (node != nullptr)
+	{
+		auto next = node->m_next;
+		node->m_prev = node->m_next = nullptr;
+		insertNode(node);
+		node = next;
+	}
+}
+
+uint64_t TimerWheel::toTicks(long int millisecond) const
+{
+	if (millisecond <= 0)
+		return 0;
+	return (millisecond + m_tickMillisecond - 1) / m_tickMillisecond;
+}
+
+int TimerWheel::nextId()
+{
+	do
+	{
+		m_lastId = (m_lastId == INT_MAX) ? 1 : m_lastId + 1;
+	} while (m_nodes.count(m_lastId));
+	return m_lastId;
+}
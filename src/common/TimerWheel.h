@@ -0,0 +1,101 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+//////////////////////////////////////////////////////////////////////////
+/// Hierarchical timing wheel
+/// Level 0 has 256 slots of one tick, upper 3 levels have 64 slots each,
+/// covering 2^26 ticks, longer timer is re-cascaded from the top level.
+/// Insert, cancel and fire are O(1), callback is invoked without lock.
+//////////////////////////////////////////////////////////////////////////
+class TimerWheel
+{
+public:
+	typedef std::function<void(int)> Callback;
+
+	explicit TimerWheel(std::size_t tickMillisecond);
+	virtual ~TimerWheel();
+
+	/// <summary>
+	/// Add a timer
+	/// </summary>
+	/// <param name="delayMillisecond">first expire after delay milliseconds</param>
+	/// <param name="intervalMillisecond">interval for repeat timer, 0 means one-time timer</param>
+	/// <param name="callback">expire callback, parameter is timer id</param>
+	/// <returns>timer id, always greater than 0</returns>
+	int add(long int delayMillisecond, long int intervalMillisecond, const Callback &callback);
+	/// <summary>
+	/// Cancel a timer
+	/// </summary>
+	/// <param name="timerId">timer id</param>
+	/// <returns>true if the timer was pending and will not be triggered</returns>
+	bool cancel(int timerId);
+
+	/// <summary>
+	/// Process all ticks up to current time and trigger expired timers
+	/// </summary>
+	/// <returns>number of triggered timers</returns>
+	std::size_t advance();
+	/// <summary>
+	/// Process all ticks up to the specified tick and trigger expired timers
+	/// </summary>
+	/// <param name="tick">target tick (included)</param>
+	/// <returns>number of triggered timers</returns>
+	std::size_t advanceTo(uint64_t tick);
+
+	/// <summary>
+	/// Tick of current steady clock
+	/// </summary>
+	uint64_t nowTick() const;
+	/// <summary>
+	/// Next tick to be processed
+	/// </summary>
+	uint64_t currentTick() const;
+	/// <summary>
+	/// Earliest tick which triggers a timer or cascades a non-empty upper slot,
+	/// ticks before it have nothing to do and can be skipped
+	/// </summary>
+	/// <returns>UINT64_MAX when no pending timer</returns>
+	uint64_t nextExpireTick() const;
+	std::size_t tickMillisecond() const;
+	/// <summary>
+	/// Number of pending timers
+	/// </summary>
+	std::size_t size() const;
+
+private:
+	struct TimerNode
+	{
+		TimerNode();
+		int m_id;
+		uint64_t m_expireTick;
+		uint64_t m_intervalTicks;
+		std::shared_ptr<Callback> m_callback;
+		// intrusive double linked list in slot, nullptr when not in wheel
+		TimerNode *m_prev;
+		TimerNode *m_next;
+	};
+
+	void insertNode(TimerNode *node);
+	void unlinkNode(TimerNode *node);
+	void cascade(int level, std::size_t index);
+	uint64_t toTicks(long int millisecond) const;
+	int nextId();
+
+private:
+	const std::size_t m_tickMillisecond;
+	const std::chrono::steady_clock::time_point m_startTime;
+	uint64_t m_currentTick;
+	int m_lastId;
+	// slot head is a sentinel node of circular list
+	std::vector<std::vector<TimerNode>> m_wheels;
+	// key: timer id, value: timer node owned by wheel
+	std::unordered_map<int, TimerNode *> m_nodes;
+	mutable std::recursive_mutex m_mutex;
+};
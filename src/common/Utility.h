@@ -77,6 +77,15 @@ namespace std
 #define DEFAULT_REST_LISTEN_PORT 6060
 #define DEFAULT_TCP_REST_LISTEN_PORT 6059
 #define DEFAULT_SCHEDULE_INTERVAL 2
+#define DEFAULT_TIMER_THREAD_POOL_SIZE 2
+#define DEFAULT_PROCESS_SPAWN_MODE "fork"
+#define DEFAULT_STDOUT_CAPTURE_MODE "file"
+#define DEFAULT_STDOUT_BUFFER_SIZE_KB 256
+#define DEFAULT_STDOUT_ROTATE_SIZE_MB 0
+#define DEFAULT_STDOUT_ROTATE_INTERVAL_SECONDS 0
+#define DEFAULT_STDOUT_DISK_BUDGET_MB 0
+#define DEFAULT_RESTART_RATE_LIMIT 10
+#define DEFAULT_RESTART_BURST 20
 #define DEFAULT_HTTP_THREAD_POOL_SIZE 6
 
 #define JWT_USER_KEY "User123"
@@ -84,7 +93,21 @@ namespace std
 #define JWT_ADMIN_NAME "admin"
 #define APPMESH_PASSWD_MIN_LENGTH 3
 #define DEFAULT_RUN_APP_RETENTION_DURATION 10
-#define DEFAULT_HEALTH_CHECK_INTERVAL 10
+#define DEFAULT_HEALTH_CHECK_TIMEOUT 10
+#define DEFAULT_HEALTH_CHECK_CONCURRENCY 8
+#define DEFAULT_APP_STOP_SIGNAL 15 // SIGTERM
+#define DEFAULT_APP_STOP_TIMEOUT 10
+// crash loop: exit within stable seconds is a failure, restart delay is doubled for each continuous failure
+#define DEFAULT_RESTART_BACKOFF_SECONDS 1
+#define DEFAULT_RESTART_BACKOFF_MAX_SECONDS 300
+#define DEFAULT_RESTART_STABLE_SECONDS 60
+// crash loop: restarts after failures are limited in a sliding window
+#define DEFAULT_RESTART_WINDOW_SECONDS 600
+#define DEFAULT_RESTART_WINDOW_MAX 10
+#define DEFAULT_OUTPUT_SEARCH_MAX_COUNT 1000
+#define DEFAULT_OUTPUT_SEARCH_TIMEOUT_SECONDS 5
+#define DEFAULT_RUN_OUTPUT_WAIT_SECONDS 30
+#define MAX_RUN_OUTPUT_WAIT_SECONDS 60
 #define MAX_COMMAND_LINE_LENGTH 2048
 
 #define DEFAULT_LABEL_HOST_NAME "HOST_NAME"
@@ -153,6 +176,10 @@ public:
 #define ENV_APP_MANAGER_LAUNCH_TIME "APP_MANAGER_LAUNCH_TIME"
 #define ENV_APP_MANAGER_DOCKER_PARAMS "APP_DOCKER_OPTS"						  // used to pass docker extra parameters to docker startup cmd
 #define ENV_APP_MANAGER_DOCKER_IMG_PULL_TIMEOUT "APP_DOCKER_IMG_PULL_TIMEOUT" // app manager pull docker image timeout seconds
+#define DOCKER_SOCKET_FILE "/var/run/docker.sock"								  // Docker Engine API, overwrite by DOCKER_HOST=unix://<path>
+#define DOCKER_API_TIMEOUT_SECONDS 5
+#define DEFAULT_DOCKER_IMG_PULL_TIMEOUT 5 * 60
+#define DEFAULT_DOCKER_IMG_PULL_PARALLEL 2 // concurrent image pull number
 #define ENV_APPMESH_PREFIX "APPMESH_"
 #define DATE_TIME_FORMAT "%Y-%m-%dT%H:%M:%S"
 #define DEFAULT_TOKEN_EXPIRE_SECONDS 7 * (60 * 60 * 24) // default 7 days
@@ -176,6 +203,18 @@ public:
 #define JSON_KEY_PrometheusExporterListenPort "PrometheusExporterListenPort"
 
 #define JSON_KEY_ScheduleIntervalSeconds "ScheduleIntervalSeconds"
+#define JSON_KEY_TimerThreadPoolSize "TimerThreadPoolSize"
+#define JSON_KEY_ProcessSpawnMode "ProcessSpawnMode"
+#define JSON_KEY_StdoutCaptureMode "StdoutCaptureMode"
+#define JSON_KEY_StdoutBufferSizeKB "StdoutBufferSizeKB"
+#define JSON_KEY_StdoutRotateSizeMB "StdoutRotateSizeMB"
+#define JSON_KEY_StdoutRotateIntervalSeconds "StdoutRotateIntervalSeconds"
+#define JSON_KEY_StdoutCompress "StdoutCompress"
+#define JSON_KEY_StdoutDiskBudgetMB "StdoutDiskBudgetMB"
+#define JSON_KEY_RestartRateLimit "RestartRateLimit"
+#define JSON_KEY_RestartBurst "RestartBurst"
+#define JSON_KEY_RestartWindowSeconds "RestartWindowSeconds"
+#define JSON_KEY_RestartWindowMax "RestartWindowMax"
 #define JSON_KEY_LogLevel "LogLevel"
 #define JSON_KEY_TimeFormatPosixZone "TimeFormatPosixZone"
 
@@ -216,6 +255,11 @@ public:
 #define JSON_KEY_APP_initial_application_only "initial_application_only"
 #define JSON_KEY_APP_onetime_application_only "onetime_application_only"
 #define JSON_KEY_APP_health_check_cmd "health_check_cmd"
+#define JSON_KEY_APP_health_check_interval "health_check_interval"
+#define JSON_KEY_APP_health_check_timeout "health_check_timeout"
+#define JSON_KEY_APP_health_check_http_status "health_check_http_status"
+#define JSON_KEY_APP_stop_signal "stop_signal"
+#define JSON_KEY_APP_stop_timeout "stop_timeout"
 #define JSON_KEY_APP_working_dir "working_dir"
 #define JSON_KEY_APP_REG_TIME "register_time"
 #define JSON_KEY_APP_status "status"
@@ -231,12 +275,29 @@ public:
 #define JSON_KEY_APP_return "return"
 #define JSON_KEY_APP_id "id"
 #define JSON_KEY_APP_memory "memory"
+#define JSON_KEY_APP_cgroup_memory "cgroup_memory"
+#define JSON_KEY_APP_cgroup_cpu "cgroup_cpu_seconds"
 #define JSON_KEY_APP_last_start "last_start_time"
 #define JSON_KEY_APP_container_id "container_id"
+#define JSON_KEY_APP_docker_image_pull "docker_image_pull"
 #define JSON_KEY_APP_health "health"
 #define JSON_KEY_APP_version "version"
 #define JSON_KEY_APP_CLOUD_APP "cloud-app"
 
+#define JSON_KEY_DOCKER_PULL_state "state"
+#define JSON_KEY_DOCKER_PULL_progress "progress"
+#define JSON_KEY_DOCKER_PULL_status "status"
+#define JSON_KEY_DOCKER_PULL_error "error"
+#define JSON_KEY_DOCKER_PULL_waiters "waiters"
+#define JSON_KEY_DOCKER_PULL_request_time "request_time"
+#define JSON_KEY_DOCKER_PULL_start_time "start_time"
+#define JSON_KEY_DOCKER_PULL_finish_time "finish_time"
+
+#define JSON_KEY_APP_restart_backoff "restart_backoff"
+#define JSON_KEY_RESTART_BACKOFF_continue_fails "continue_fails"
+#define JSON_KEY_RESTART_BACKOFF_next_restart "next_restart"
+#define JSON_KEY_RESTART_BACKOFF_window_restarts "window_restarts"
+
 #define JSON_KEY_PERIOD_APP_keep_running "keep_running"
 
 #define JSON_KEY_SHORT_APP_start_interval_seconds "start_interval_seconds"
@@ -251,6 +312,9 @@ public:
 #define JSON_KEY_RESOURCE_LIMITATION_memory_mb "memory_mb"
 #define JSON_KEY_RESOURCE_LIMITATION_memory_virt_mb "memory_virt_mb"
 #define JSON_KEY_RESOURCE_LIMITATION_cpu_shares "cpu_shares"
+#define JSON_KEY_RESOURCE_LIMITATION_cpu_quota_percent "cpu_quota_percent"
+#define JSON_KEY_RESOURCE_LIMITATION_pids_max "pids_max"
+#define JSON_KEY_RESOURCE_LIMITATION_io_max "io_max"
 
 #define JSON_KEY_USER_key "key"
 #define JSON_KEY_USER_group "group"
@@ -276,10 +340,20 @@ public:
 #define HTTP_HEADER_KEY_file_mode "FileMode"
 #define HTTP_HEADER_KEY_file_user "FileUser"
 #define HTTP_HEADER_KEY_file_group "FileGroup"
+#define HTTP_HEADER_KEY_output_offset "OutputOffset"
+#define HTTP_HEADER_KEY_search_truncated "SearchTruncated"
 
 #define HTTP_QUERY_KEY_keep_history "keep_history"
 #define HTTP_QUERY_KEY_stdout_index "stdout_index"
+#define HTTP_QUERY_KEY_output_offset "offset"
+#define HTTP_QUERY_KEY_output_length "length"
+#define HTTP_QUERY_KEY_output_tail "tail"
+#define HTTP_QUERY_KEY_output_from_line "from_line"
+#define HTTP_QUERY_KEY_search_pattern "pattern"
+#define HTTP_QUERY_KEY_search_regex "regex"
+#define HTTP_QUERY_KEY_search_max_count "max_count"
 #define HTTP_QUERY_KEY_process_uuid "process_uuid"
+#define HTTP_QUERY_KEY_output_wait "wait" // for async run output, hold the request until output or exit
 #define HTTP_QUERY_KEY_timeout "timeout"
 #define HTTP_QUERY_KEY_action_start "enable"
 #define HTTP_QUERY_KEY_action_stop "disable"
@@ -0,0 +1,202 @@
+#pragma once
+
+#include <sys/types.h> // For pid_t.
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../../common/Utility.h"
+#include "linux.hpp"
+
+namespace os
+{
+
+	// One process read from /proc/[pid]/stat, cmdline is optional.
+	struct ProcessEntry
+	{
+		pid_t pid;
+		pid_t parent;
+		// Resident Set Size
+		uint64_t rss_bytes;
+		bool zombie;
+		std::string command;
+		// index of first child and next sibling in snapshot, -1 for none
+		int firstChild;
+		int nextSibling;
+	};
+
+	// Process table read from /proc in one scan, indexed by pid and by parent
+	// so subtree queries cost O(subtree) instead of a scan of all processes.
+	// A snapshot is immutable once created and can be shared between threads.
+	class ProcessSnapshot
+	{
+	public:
+		// Scan /proc once, read /proc/[pid]/cmdline only when withCmdline is true.
+		static std::shared_ptr<ProcessSnapshot> scan(bool withCmdline = false)
+		{
+			const static char fname[] = "ProcessSnapshot::scan() ";
+
+			auto snapshot = std::shared_ptr<ProcessSnapshot>(new ProcessSnapshot());
+			DIR *dir = ::opendir("/proc");
+			if (dir == nullptr)
+			{
+				LOG_ERR << fname << "Failed to open /proc with error: " << std::strerror(errno);
+				return nullptr;
+			}
+			static const uint64_t pageSize = os::pagesize();
+			struct dirent *entry;
+			while ((entry = ::readdir(dir)) != nullptr)
+			{
+				if (entry->d_name[0] < '0' || entry->d_name[0] > '9')
+				{
+					continue;
+				}
+				ProcessEntry process;
+				if (readStat(entry->d_name, pageSize, process))
+				{
+					if (withCmdline)
+					{
+						auto cmd = os::cmdline(process.pid);
+						if (cmd.length())
+							process.command = cmd;
+					}
+					snapshot->m_index[process.pid] = snapshot->m_processes.size();
+					snapshot->m_processes.push_back(std::move(process));
+				}
+			}
+			::closedir(dir);
+
+			// link each process to its parent, O(n)
+			for (std::size_t i = 0; i < snapshot->m_processes.size(); i++)
+			{
+				auto &process = snapshot->m_processes[i];
+				auto parent = snapshot->m_index.find(process.parent);
+				if (parent != snapshot->m_index.end() && parent->second != i)
+				{
+					auto &parentProcess = snapshot->m_processes[parent->second];
+					process.nextSibling = parentProcess.firstChild;
+					parentProcess.firstChild = static_cast<int>(i);
+				}
+			}
+			return snapshot;
+		}
+
+		// Returns the process with the specified pid, or nullptr if not exist.
+		const ProcessEntry *find(pid_t pid) const
+		{
+			auto iter = m_index.find(pid);
+			if (iter != m_index.end())
+			{
+				return &m_processes[iter->second];
+			}
+			return nullptr;
+		}
+
+		// Count the total RES memory of the process tree rooted at pid.
+		uint64_t totalRSS(pid_t pid) const
+		{
+			uint64_t result = 0;
+			for (auto index : subtree(pid))
+			{
+				result += m_processes[index].rss_bytes;
+			}
+			return result;
+		}
+
+		// Returns all the pids in the process tree rooted at pid (include pid).
+		std::vector<pid_t> pids(pid_t pid) const
+		{
+			std::vector<pid_t> result;
+			for (auto index : subtree(pid))
+			{
+				result.push_back(m_processes[index].pid);
+			}
+			return result;
+		}
+
+		std::size_t size() const { return m_processes.size(); }
+		const std::chrono::steady_clock::time_point &time() const { return m_time; }
+
+	private:
+		ProcessSnapshot() : m_time(std::chrono::steady_clock::now()) {}
+
+		// iterative walk, process trees can be deep
+		std::vector<int> subtree(pid_t pid) const
+		{
+			std::vector<int> result;
+			auto iter = m_index.find(pid);
+			if (iter == m_index.end())
+			{
+				return result;
+			}
+			result.push_back(static_cast<int>(iter->second));
+			for (std::size_t i = 0; i < result.size(); i++)
+			{
+				for (int child = m_processes[result[i]].firstChild; child >= 0; child = m_processes[child].nextSibling)
+				{
+					result.push_back(child);
+				}
+			}
+			return result;
+		}
+
+		// Parse /proc/[pid]/stat, comm may contain spaces and ')', so fields are read after the last ')'.
+		static bool readStat(const char *pid, uint64_t pageSize, ProcessEntry &process)
+		{
+			char path[64];
+			std::snprintf(path, sizeof(path), "/proc/%s/stat", pid);
+			int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+			if (fd < 0)
+			{
+				// process exit between readdir and open
+				return false;
+			}
+			char buffer[1024];
+			auto size = ::read(fd, buffer, sizeof(buffer) - 1);
+			::close(fd);
+			if (size <= 0)
+			{
+				return false;
+			}
+			buffer[size] = '\0';
+
+			char *commStart = std::strchr(buffer, '(');
+			char *commEnd = std::strrchr(buffer, ')');
+			if (commStart == nullptr || commEnd == nullptr || commEnd < commStart)
+			{
+				return false;
+			}
+			char state;
+			int ppid;
+			long rss;
+			// state ppid pgrp session tty_nr tpgid flags minflt cminflt majflt cmajflt utime stime
+			// cutime cstime priority nice num_threads itrealvalue starttime vsize rss
+			if (std::sscanf(commEnd + 1,
+							" %c %d %*d %*d %*d %*d %*u %*u %*u %*u %*u %*u %*u %*d %*d %*d %*d %*d %*d %*u %*u %ld",
+							&state, &ppid, &rss) != 3)
+			{
+				return false;
+			}
+			process.pid = std::atoi(pid);
+			process.parent = ppid;
+			process.rss_bytes = rss > 0 ? rss * pageSize : 0;
+			process.zombie = (state == 'Z');
+			process.command.assign(commStart + 1, commEnd);
+			process.firstChild = -1;
+			process.nextSibling = -1;
+			return true;
+		}
+
+		std::vector<ProcessEntry> m_processes;
+		std::unordered_map<pid_t, std::size_t> m_index;
+		const std::chrono::steady_clock::time_point m_time;
+	};
+
+} // namespace os
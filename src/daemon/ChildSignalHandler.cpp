@@ -0,0 +1,134 @@
+#include <signal.h>
+#include <sys/signalfd.h>
+
+#include <ace/OS.h>
+
+#include "../common/PerfLog.h"
+#include "../common/Utility.h"
+#include "ChildSignalHandler.h"
+#include "Configuration.h"
+#include "HealthCheckTask.h"
+#include "TimerDispatcher.h"
+#include "application/Application.h"
+#include "process/ProcessReaper.h"
+
+ChildSignalHandler::ChildSignalHandler()
+	: m_signalFd(ACE_INVALID_HANDLE)
+{
+}
+
+ChildSignalHandler::~ChildSignalHandler()
+{
+	if (m_signalFd != ACE_INVALID_HANDLE)
+	{
+		ACE_OS::close(m_signalFd);
+		m_signalFd = ACE_INVALID_HANDLE;
+	}
+}
+
+std::shared_ptr<ChildSignalHandler> &ChildSignalHandler::instance()
+{
+	static auto singleton = std::make_shared<ChildSignalHandler>();
+	return singleton;
+}
+
+void ChildSignalHandler::blockSignal()
+{
+	sigset_t mask;
+	sigemptyset(&mask);
+	sigaddset(&mask, SIGCHLD);
+	pthread_sigmask(SIG_BLOCK, &mask, nullptr);
+}
+
+void ChildSignalHandler::unblockSignal()
+{
+	sigset_t mask;
+	sigemptyset(&mask);
+	sigaddset(&mask, SIGCHLD);
+	pthread_sigmask(SIG_UNBLOCK, &mask, nullptr);
+}
+
+bool ChildSignalHandler::open(ACE_Reactor *reactor)
+{
+	const static char fname[] = "ChildSignalHandler::open() ";
+
+	sigset_t mask;
+	sigemptyset(&mask);
+	sigaddset(&mask, SIGCHLD);
+	m_signalFd = ::signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+	if (m_signalFd == ACE_INVALID_HANDLE)
+	{
+		LOG_ERR << fname << "signalfd failed with error: " << std::strerror(errno);
+		unblockSignal();
+		return false;
+	}
+	this->reactor(reactor);
+	if (reactor->register_handler(this, ACE_Event_Handler::READ_MASK) < 0)
+	{
+		LOG_ERR << fname << "register signalfd to reactor failed with error: " << std::strerror(errno);
+		ACE_OS::close(m_signalFd);
+		m_signalFd = ACE_INVALID_HANDLE;
+		unblockSignal();
+		return false;
+	}
+	LOG_INF << fname << "child exit event enabled";
+	return true;
+}
+
+bool ChildSignalHandler::enabled() const
+{
+	return m_signalFd != ACE_INVALID_HANDLE;
+}
+
+ACE_HANDLE ChildSignalHandler::get_handle(void) const
+{
+	return m_signalFd;
+}
+
+int ChildSignalHandler::handle_input(ACE_HANDLE fd)
+{
+	const static char fname[] = "ChildSignalHandler::handle_input() ";
+
+	// SIGCHLD is not queued, drain all pending siginfo then scan once
+	struct signalfd_siginfo info;
+	bool signaled = false;
+	while (ACE_OS::read(m_signalFd, &info, sizeof(info)) == sizeof(info))
+	{
+		LOG_DBG << fname << "SIGCHLD from pid <" << info.ssi_pid << ">";
+		signaled = true;
+	}
+	if (signaled)
+	{
+		ProcessReaper::instance()->reap();
+		dispatchExited(ProcessReaper::instance()->fetchExited());
+	}
+	// keep handler registered
+	return 0;
+}
+
+void ChildSignalHandler::dispatchExited(const std::set<pid_t> &exitedPids)
+{
+	if (exitedPids.empty())
+		return;
+	notifyExitedApps(exitedPids);
+	// collect health check result
+	auto healthCheck = HealthCheckTask::instance();
+	TimerDispatcher::instance()->dispatch(static_cast<TimerHandler *>(healthCheck.get()), [healthCheck, exitedPids]() { healthCheck->onProcessExitEvent(exitedPids); });
+}
+
+void ChildSignalHandler::notifyExitedApps(const std::set<pid_t> &exitedPids)
+{
+	const static char fname[] = "ChildSignalHandler::notifyExitedApps() ";
+	PerfLog perf(fname);
+
+	auto apps = Configuration::instance()->getApps();
+	for (const auto &app : apps)
+	{
+		auto pid = app->getpid();
+		if (pid <= 0 || exitedPids.count(pid) == 0)
+			continue;
+		LOG_DBG << fname << "application <" << app->getName() << "> process <" << pid << "> exited";
+		// serialize with application timer events
+		TimerDispatcher::instance()->dispatch(static_cast<TimerHandler *>(app.get()), [app]() { app->onProcessExitEvent(); });
+	}
+}
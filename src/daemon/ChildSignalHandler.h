@@ -0,0 +1,62 @@
+#pragma once
+
+#include <memory>
+#include <set>
+
+#include <ace/Event_Handler.h>
+#include <ace/Reactor.h>
+
+//////////////////////////////////////////////////////////////////////////
+/// Deliver SIGCHLD to ACE_Reactor through signalfd, so the supervisor
+/// can react to child exit immediately instead of waiting for next
+/// ScheduleIntervalSeconds tick.
+//////////////////////////////////////////////////////////////////////////
+class ChildSignalHandler : public ACE_Event_Handler
+{
+public:
+	ChildSignalHandler();
+	virtual ~ChildSignalHandler();
+	static std::shared_ptr<ChildSignalHandler> &instance();
+
+	/// <summary>
+	/// Block SIGCHLD for the calling thread, must be called before any thread created,
+	/// so that all threads inherit the mask and SIGCHLD only be consumed by signalfd
+	/// </summary>
+	static void blockSignal();
+	/// <summary>
+	/// Restore SIGCHLD mask, used in child process before exec
+	/// </summary>
+	static void unblockSignal();
+
+	/// <summary>
+	/// Create signalfd and register to reactor
+	/// </summary>
+	/// <returns>true if event mode enabled</returns>
+	bool open(ACE_Reactor *reactor);
+	/// <summary>
+	/// Event mode enabled or not
+	/// </summary>
+	bool enabled() const;
+
+	virtual ACE_HANDLE get_handle(void) const override;
+	/// <summary>
+	/// Read signalfd and notify exited applications, override from ACE
+	/// </summary>
+	virtual int handle_input(ACE_HANDLE fd = ACE_INVALID_HANDLE) override;
+	/// <summary>
+	/// Dispatch exit events of collected children to applications and health check,
+	/// used by signalfd event and the schedule tick sweep
+	/// </summary>
+	/// <param name="exitedPids">exited process id list from ProcessReaper::fetchExited()</param>
+	void dispatchExited(const std::set<pid_t> &exitedPids);
+
+private:
+	/// <summary>
+	/// Trigger applications which have exited child
+	/// </summary>
+	/// <param name="exitedPids">exited process id list</param>
+	void notifyExitedApps(const std::set<pid_t> &exitedPids);
+
+private:
+	ACE_HANDLE m_signalFd;
+};
@@ -6,10 +6,12 @@
 #include "Configuration.h"
 #include "Label.h"
 #include "ResourceCollection.h"
+#include "TimerDispatcher.h"
 #include "application/Application.h"
 #include "application/ApplicationInitialize.h"
 #include "application/ApplicationPeriodRun.h"
 #include "application/ApplicationUnInitia.h"
+#include "process/AppProcess.h"
 #include "rest/ConsulConnection.h"
 #include "rest/PrometheusRest.h"
 #include "rest/RestHandler.h"
@@ -23,7 +25,12 @@ extern char **environ; // unistd.h
 
 std::shared_ptr<Configuration> Configuration::m_instance = nullptr;
 Configuration::Configuration()
-	: m_scheduleInterval(DEFAULT_SCHEDULE_INTERVAL)
+	: m_scheduleInterval(DEFAULT_SCHEDULE_INTERVAL), m_timerThreadPoolSize(DEFAULT_TIMER_THREAD_POOL_SIZE), m_processSpawnMode(DEFAULT_PROCESS_SPAWN_MODE),
+	  m_stdoutCaptureMode(DEFAULT_STDOUT_CAPTURE_MODE), m_stdoutBufferSizeKB(DEFAULT_STDOUT_BUFFER_SIZE_KB),
+	  m_stdoutRotateSizeMB(DEFAULT_STDOUT_ROTATE_SIZE_MB), m_stdoutRotateIntervalSeconds(DEFAULT_STDOUT_ROTATE_INTERVAL_SECONDS),
+	  m_stdoutCompress(false), m_stdoutDiskBudgetMB(DEFAULT_STDOUT_DISK_BUDGET_MB),
+	  m_restartRateLimit(DEFAULT_RESTART_RATE_LIMIT), m_restartBurst(DEFAULT_RESTART_BURST),
+	  m_restartWindowSeconds(DEFAULT_RESTART_WINDOW_SECONDS), m_restartWindowMax(DEFAULT_RESTART_WINDOW_MAX)
 {
 	m_jsonFilePath = Utility::getSelfFullPath() + ".json";
 	m_label = std::make_unique<Label>();
@@ -76,6 +83,22 @@ std::shared_ptr<Configuration> Configuration::FromJson(const std::string &str, b
 	config->m_defaultExecUser = GET_JSON_STR_VALUE(jsonValue, JSON_KEY_DefaultExecUser);
 	config->m_defaultWorkDir = GET_JSON_STR_VALUE(jsonValue, JSON_KEY_WorkingDirectory);
 	config->m_scheduleInterval = GET_JSON_INT_VALUE(jsonValue, JSON_KEY_ScheduleIntervalSeconds);
+	config->m_timerThreadPoolSize = GET_JSON_INT_VALUE(jsonValue, JSON_KEY_TimerThreadPoolSize);
+	config->m_processSpawnMode = GET_JSON_STR_VALUE(jsonValue, JSON_KEY_ProcessSpawnMode);
+	config->m_stdoutCaptureMode = GET_JSON_STR_VALUE(jsonValue, JSON_KEY_StdoutCaptureMode);
+	config->m_stdoutBufferSizeKB = GET_JSON_INT_VALUE(jsonValue, JSON_KEY_StdoutBufferSizeKB);
+	config->m_stdoutRotateSizeMB = GET_JSON_INT_VALUE(jsonValue, JSON_KEY_StdoutRotateSizeMB);
+	config->m_stdoutRotateIntervalSeconds = GET_JSON_INT_VALUE(jsonValue, JSON_KEY_StdoutRotateIntervalSeconds);
+	config->m_stdoutCompress = GET_JSON_BOOL_VALUE(jsonValue, JSON_KEY_StdoutCompress);
+	config->m_stdoutDiskBudgetMB = GET_JSON_INT_VALUE(jsonValue, JSON_KEY_StdoutDiskBudgetMB);
+	if (HAS_JSON_FIELD(jsonValue, JSON_KEY_RestartRateLimit))
+		config->m_restartRateLimit = GET_JSON_INT_VALUE(jsonValue, JSON_KEY_RestartRateLimit);
+	if (HAS_JSON_FIELD(jsonValue, JSON_KEY_RestartBurst))
+		config->m_restartBurst = GET_JSON_INT_VALUE(jsonValue, JSON_KEY_RestartBurst);
+	if (HAS_JSON_FIELD(jsonValue, JSON_KEY_RestartWindowSeconds))
+		config->m_restartWindowSeconds = GET_JSON_INT_VALUE(jsonValue, JSON_KEY_RestartWindowSeconds);
+	if (HAS_JSON_FIELD(jsonValue, JSON_KEY_RestartWindowMax))
+		config->m_restartWindowMax = GET_JSON_INT_VALUE(jsonValue, JSON_KEY_RestartWindowMax);
 	config->m_logLevel = GET_JSON_STR_VALUE(jsonValue, JSON_KEY_LogLevel);
 	config->m_formatPosixZone = GET_JSON_STR_VALUE(jsonValue, JSON_KEY_TimeFormatPosixZone);
 	DateTime::setTimeFormatPosixZone(config->m_formatPosixZone);
@@ -93,6 +116,72 @@ std::shared_ptr<Configuration> Configuration::FromJson(const std::string &str, b
 		config->m_scheduleInterval = DEFAULT_SCHEDULE_INTERVAL;
 		LOG_INF << "Default value <" << config->m_scheduleInterval << "> will by used for ScheduleIntervalSec";
 	}
+	if (config->m_timerThreadPoolSize < 1 || config->m_timerThreadPoolSize > 64)
+	{
+		// Use default value instead
+		config->m_timerThreadPoolSize = DEFAULT_TIMER_THREAD_POOL_SIZE;
+		LOG_INF << "Default value <" << config->m_timerThreadPoolSize << "> will by used for TimerThreadPoolSize";
+	}
+	if (config->m_processSpawnMode != "vfork" && config->m_processSpawnMode != "fork" && config->m_processSpawnMode != "zygote")
+	{
+		// Use default value instead
+		config->m_processSpawnMode = DEFAULT_PROCESS_SPAWN_MODE;
+		LOG_INF << "Default value <" << config->m_processSpawnMode << "> will by used for ProcessSpawnMode";
+	}
+	if (config->m_stdoutCaptureMode != "file" && config->m_stdoutCaptureMode != "pipe" && config->m_stdoutCaptureMode != "memory")
+	{
+		// Use default value instead
+		config->m_stdoutCaptureMode = DEFAULT_STDOUT_CAPTURE_MODE;
+		LOG_INF << "Default value <" << config->m_stdoutCaptureMode << "> will by used for StdoutCaptureMode";
+	}
+	if (config->m_stdoutBufferSizeKB < 4 || config->m_stdoutBufferSizeKB > 64 * 1024)
+	{
+		// Use default value instead
+		config->m_stdoutBufferSizeKB = DEFAULT_STDOUT_BUFFER_SIZE_KB;
+		LOG_INF << "Default value <" << config->m_stdoutBufferSizeKB << "> will by used for StdoutBufferSizeKB";
+	}
+	if (config->m_stdoutRotateSizeMB < 0 || config->m_stdoutRotateSizeMB > 100 * 1024)
+	{
+		// Use default value instead
+		config->m_stdoutRotateSizeMB = DEFAULT_STDOUT_ROTATE_SIZE_MB;
+		LOG_INF << "Default value <" << config->m_stdoutRotateSizeMB << "> will by used for StdoutRotateSizeMB";
+	}
+	if (config->m_stdoutRotateIntervalSeconds < 0)
+	{
+		// Use default value instead
+		config->m_stdoutRotateIntervalSeconds = DEFAULT_STDOUT_ROTATE_INTERVAL_SECONDS;
+		LOG_INF << "Default value <" << config->m_stdoutRotateIntervalSeconds << "> will by used for StdoutRotateIntervalSeconds";
+	}
+	if (config->m_stdoutDiskBudgetMB < 0)
+	{
+		// Use default value instead
+		config->m_stdoutDiskBudgetMB = DEFAULT_STDOUT_DISK_BUDGET_MB;
+		LOG_INF << "Default value <" << config->m_stdoutDiskBudgetMB << "> will by used for StdoutDiskBudgetMB";
+	}
+	if (config->m_restartRateLimit < 0)
+	{
+		// Use default value instead
+		config->m_restartRateLimit = DEFAULT_RESTART_RATE_LIMIT;
+		LOG_INF << "Default value <" << config->m_restartRateLimit << "> will by used for RestartRateLimit";
+	}
+	if (config->m_restartBurst <= 0)
+	{
+		// Use default value instead
+		config->m_restartBurst = DEFAULT_RESTART_BURST;
+		LOG_INF << "Default value <" << config->m_restartBurst << "> will by used for RestartBurst";
+	}
+	if (config->m_restartWindowSeconds <= 0)
+	{
+		// Use default value instead
+		config->m_restartWindowSeconds = DEFAULT_RESTART_WINDOW_SECONDS;
+		LOG_INF << "Default value <" << config->m_restartWindowSeconds << "> will by used for RestartWindowSeconds";
+	}
+	if (config->m_restartWindowMax < 0)
+	{
+		// Use default value instead
+		config->m_restartWindowMax = DEFAULT_RESTART_WINDOW_MAX;
+		LOG_INF << "Default value <" << config->m_restartWindowMax << "> will by used for RestartWindowMax";
+	}
 
 	// REST
 	if (HAS_JSON_FIELD(jsonValue, JSON_KEY_REST))
@@ -181,6 +270,18 @@ web::json::value Configuration::AsJson(bool returnRuntimeInfo, const std::string
 	result[JSON_KEY_DefaultExecUser] = web::json::value::string(m_defaultExecUser);
 	result[JSON_KEY_WorkingDirectory] = web::json::value::string(m_defaultWorkDir);
 	result[JSON_KEY_ScheduleIntervalSeconds] = web::json::value::number(m_scheduleInterval);
+	result[JSON_KEY_TimerThreadPoolSize] = web::json::value::number(m_timerThreadPoolSize);
+	result[JSON_KEY_ProcessSpawnMode] = web::json::value::string(m_processSpawnMode);
+	result[JSON_KEY_StdoutCaptureMode] = web::json::value::string(m_stdoutCaptureMode);
+	result[JSON_KEY_StdoutBufferSizeKB] = web::json::value::number(m_stdoutBufferSizeKB);
+	result[JSON_KEY_StdoutRotateSizeMB] = web::json::value::number(m_stdoutRotateSizeMB);
+	result[JSON_KEY_StdoutRotateIntervalSeconds] = web::json::value::number(m_stdoutRotateIntervalSeconds);
+	result[JSON_KEY_StdoutCompress] = web::json::value::boolean(m_stdoutCompress);
+	result[JSON_KEY_StdoutDiskBudgetMB] = web::json::value::number(m_stdoutDiskBudgetMB);
+	result[JSON_KEY_RestartRateLimit] = web::json::value::number(m_restartRateLimit);
+	result[JSON_KEY_RestartBurst] = web::json::value::number(m_restartBurst);
+	result[JSON_KEY_RestartWindowSeconds] = web::json::value::number(m_restartWindowSeconds);
+	result[JSON_KEY_RestartWindowMax] = web::json::value::number(m_restartWindowMax);
 	result[JSON_KEY_LogLevel] = web::json::value::string(m_logLevel);
 	result[JSON_KEY_TimeFormatPosixZone] = web::json::value::string(m_formatPosixZone);
 
@@ -230,6 +331,78 @@ int Configuration::getScheduleInterval()
 	return m_scheduleInterval;
 }
 
+std::size_t Configuration::getTimerThreadPoolSize() const
+{
+	std::lock_guard<std::recursive_mutex> guard(m_hotupdateMutex);
+	return m_timerThreadPoolSize;
+}
+
+const std::string Configuration::getProcessSpawnMode() const
+{
+	std::lock_guard<std::recursive_mutex> guard(m_hotupdateMutex);
+	return m_processSpawnMode;
+}
+
+const std::string Configuration::getStdoutCaptureMode() const
+{
+	std::lock_guard<std::recursive_mutex> guard(m_hotupdateMutex);
+	return m_stdoutCaptureMode;
+}
+
+std::size_t Configuration::getStdoutBufferSize() const
+{
+	std::lock_guard<std::recursive_mutex> guard(m_hotupdateMutex);
+	return static_cast<std::size_t>(m_stdoutBufferSizeKB) * 1024;
+}
+
+std::uint64_t Configuration::getStdoutRotateSize() const
+{
+	std::lock_guard<std::recursive_mutex> guard(m_hotupdateMutex);
+	return static_cast<std::uint64_t>(m_stdoutRotateSizeMB) * 1024 * 1024;
+}
+
+int Configuration::getStdoutRotateInterval() const
+{
+	std::lock_guard<std::recursive_mutex> guard(m_hotupdateMutex);
+	return m_stdoutRotateIntervalSeconds;
+}
+
+bool Configuration::getStdoutCompress() const
+{
+	std::lock_guard<std::recursive_mutex> guard(m_hotupdateMutex);
+	return m_stdoutCompress;
+}
+
+std::uint64_t Configuration::getStdoutDiskBudget() const
+{
+	std::lock_guard<std::recursive_mutex> guard(m_hotupdateMutex);
+	return static_cast<std::uint64_t>(m_stdoutDiskBudgetMB) * 1024 * 1024;
+}
+
+int Configuration::getRestartRateLimit() const
+{
+	std::lock_guard<std::recursive_mutex> guard(m_hotupdateMutex);
+	return m_restartRateLimit;
+}
+
+int Configuration::getRestartBurst() const
+{
+	std::lock_guard<std::recursive_mutex> guard(m_hotupdateMutex);
+	return m_restartBurst;
+}
+
+int Configuration::getRestartWindowSeconds() const
+{
+	std::lock_guard<std::recursive_mutex> guard(m_hotupdateMutex);
+	return m_restartWindowSeconds;
+}
+
+int Configuration::getRestartWindowMax() const
+{
+	std::lock_guard<std::recursive_mutex> guard(m_hotupdateMutex);
+	return m_restartWindowMax;
+}
+
 int Configuration::getRestListenPort()
 {
 	std::lock_guard<std::recursive_mutex> guard(m_hotupdateMutex);
@@ -505,16 +678,27 @@ std::shared_ptr<Application> Configuration::addApp(const web::json::value &jsonA
 	auto app = parseApp(jsonApp);
 	bool update = false;
 	std::lock_guard<std::recursive_mutex> guard(m_appMutex);
-	std::for_each(m_apps.begin(), m_apps.end(), [&app, &update](std::shared_ptr<Application> &mapApp) {
+	// stop is graceful and not wait, new process start after the previous one exit
+	std::shared_ptr<AppProcess> predecessor;
+	auto stopping = m_stoppingProcesses.find(app->getName());
+	if (stopping != m_stoppingProcesses.end())
+	{
+		predecessor = stopping->second;
+		m_stoppingProcesses.erase(stopping);
+	}
+	std::for_each(m_apps.begin(), m_apps.end(), [&app, &update, &predecessor](std::shared_ptr<Application> &mapApp) {
 		if (mapApp->getName() == app->getName())
 		{
 			// Stop existing app and replace
 			mapApp->disable();
+			predecessor = mapApp->stoppingProcess();
 			mapApp = app;
 			update = true;
 			return;
 		}
 	});
+	if (predecessor != nullptr)
+		app->waitPredecessor(predecessor);
 
 	if (!update)
 	{
@@ -541,6 +725,13 @@ void Configuration::removeApp(const std::string &appName)
 	std::shared_ptr<Application> app;
 	{
 		std::lock_guard<std::recursive_mutex> guard(m_appMutex);
+		for (auto iter = m_stoppingProcesses.begin(); iter != m_stoppingProcesses.end();)
+		{
+			if (iter->second->running())
+				iter++;
+			else
+				iter = m_stoppingProcesses.erase(iter);
+		}
 		// Update in-memory app
 		for (auto iterA = m_apps.begin(); iterA != m_apps.end();)
 		{
@@ -548,6 +739,10 @@ void Configuration::removeApp(const std::string &appName)
 			{
 				app = (*iterA);
 				bool needPersist = app->isWorkingState();
+				// record before destroy(), fini command app is added with the same name
+				auto process = app->stoppingProcess();
+				if (process != nullptr)
+					m_stoppingProcesses[appName] = process;
 				iterA = m_apps.erase(iterA);
 				// Write to disk
 				if (needPersist)
@@ -631,6 +826,36 @@ void Configuration::hotUpdate(const web::json::value &jsonValue)
 		}
 		if (HAS_JSON_FIELD(jsonValue, JSON_KEY_ScheduleIntervalSeconds))
 			SET_COMPARE(this->m_scheduleInterval, newConfig->m_scheduleInterval);
+		if (HAS_JSON_FIELD(jsonValue, JSON_KEY_TimerThreadPoolSize))
+		{
+			if (this->m_timerThreadPoolSize != newConfig->m_timerThreadPoolSize)
+			{
+				SET_COMPARE(this->m_timerThreadPoolSize, newConfig->m_timerThreadPoolSize);
+				TimerDispatcher::instance()->resize(newConfig->m_timerThreadPoolSize);
+			}
+		}
+		if (HAS_JSON_FIELD(jsonValue, JSON_KEY_ProcessSpawnMode))
+			SET_COMPARE(this->m_processSpawnMode, newConfig->m_processSpawnMode);
+		if (HAS_JSON_FIELD(jsonValue, JSON_KEY_StdoutCaptureMode))
+			SET_COMPARE(this->m_stdoutCaptureMode, newConfig->m_stdoutCaptureMode);
+		if (HAS_JSON_FIELD(jsonValue, JSON_KEY_StdoutBufferSizeKB))
+			SET_COMPARE(this->m_stdoutBufferSizeKB, newConfig->m_stdoutBufferSizeKB);
+		if (HAS_JSON_FIELD(jsonValue, JSON_KEY_StdoutRotateSizeMB))
+			SET_COMPARE(this->m_stdoutRotateSizeMB, newConfig->m_stdoutRotateSizeMB);
+		if (HAS_JSON_FIELD(jsonValue, JSON_KEY_StdoutRotateIntervalSeconds))
+			SET_COMPARE(this->m_stdoutRotateIntervalSeconds, newConfig->m_stdoutRotateIntervalSeconds);
+		if (HAS_JSON_FIELD(jsonValue, JSON_KEY_StdoutCompress))
+			SET_COMPARE(this->m_stdoutCompress, newConfig->m_stdoutCompress);
+		if (HAS_JSON_FIELD(jsonValue, JSON_KEY_StdoutDiskBudgetMB))
+			SET_COMPARE(this->m_stdoutDiskBudgetMB, newConfig->m_stdoutDiskBudgetMB);
+		if (HAS_JSON_FIELD(jsonValue, JSON_KEY_RestartRateLimit))
+			SET_COMPARE(this->m_restartRateLimit, newConfig->m_restartRateLimit);
+		if (HAS_JSON_FIELD(jsonValue, JSON_KEY_RestartBurst))
+			SET_COMPARE(this->m_restartBurst, newConfig->m_restartBurst);
+		if (HAS_JSON_FIELD(jsonValue, JSON_KEY_RestartWindowSeconds))
+			SET_COMPARE(this->m_restartWindowSeconds, newConfig->m_restartWindowSeconds);
+		if (HAS_JSON_FIELD(jsonValue, JSON_KEY_RestartWindowMax))
+			SET_COMPARE(this->m_restartWindowMax, newConfig->m_restartWindowMax);
 		if (HAS_JSON_FIELD(jsonValue, JSON_KEY_DefaultExecUser))
 			SET_COMPARE(this->m_defaultExecUser, newConfig->m_defaultExecUser);
 		if (HAS_JSON_FIELD(jsonValue, JSON_KEY_WorkingDirectory))
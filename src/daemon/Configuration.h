@@ -1,5 +1,6 @@
 #pragma once
 
+#include <map>
 #include <string>
 #include <memory>
 #include <vector>
@@ -13,6 +14,7 @@ class Users;
 class User;
 class Label;
 class Application;
+class AppProcess;
 
 /// <summary>
 /// Configuration file <appsvc.json> parse/update
@@ -99,6 +101,26 @@ public:
 	std::shared_ptr<Application> parseApp(const web::json::value &jsonApp);
 
 	int getScheduleInterval();
+	std::size_t getTimerThreadPoolSize() const;
+	// "vfork", "fork" or "zygote"
+	const std::string getProcessSpawnMode() const;
+	// "file": child write to file, "pipe": ring buffer and file, "memory": ring buffer only
+	const std::string getStdoutCaptureMode() const;
+	// ring buffer size in bytes for "pipe" and "memory" capture mode
+	std::size_t getStdoutBufferSize() const;
+	// rotate stdout file of running process by size (bytes) and age, 0 for disabled, only for "pipe" capture mode
+	std::uint64_t getStdoutRotateSize() const;
+	int getStdoutRotateInterval() const;
+	// compress rotated stdout files
+	bool getStdoutCompress() const;
+	// total bytes of rotated stdout files of all applications, 0 for unlimited
+	std::uint64_t getStdoutDiskBudget() const;
+	// host wide application restart token bucket, restarts per second and burst, 0 for unlimited
+	int getRestartRateLimit() const;
+	int getRestartBurst() const;
+	// per application restarts after failures in a sliding window, 0 max for unlimited
+	int getRestartWindowSeconds() const;
+	int getRestartWindowMax() const;
 	int getRestListenPort();
 	int getPromListenPort();
 	std::string getRestListenAddress();
@@ -141,10 +163,24 @@ private:
 
 private:
 	std::vector<std::shared_ptr<Application>> m_apps;
+	// processes of removed apps in stop grace period, app added later with the same name wait them exit
+	std::map<std::string, std::shared_ptr<AppProcess>> m_stoppingProcesses;
 	std::string m_hostDescription;
 	std::string m_defaultExecUser;
 	std::string m_defaultWorkDir;
 	int m_scheduleInterval;
+	int m_timerThreadPoolSize;
+	std::string m_processSpawnMode;
+	std::string m_stdoutCaptureMode;
+	int m_stdoutBufferSizeKB;
+	int m_stdoutRotateSizeMB;
+	int m_stdoutRotateIntervalSeconds;
+	bool m_stdoutCompress;
+	int m_stdoutDiskBudgetMB;
+	int m_restartRateLimit;
+	int m_restartBurst;
+	int m_restartWindowSeconds;
+	int m_restartWindowMax;
 	std::shared_ptr<JsonRest> m_rest;
 	std::shared_ptr<JsonSecurity> m_security;
 	std::shared_ptr<JsonConsul> m_consul;
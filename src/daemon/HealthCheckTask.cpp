@@ -1,48 +1,145 @@
-#include "HealthCheckTask.h"
+#include <algorithm>
+
 #include "../common/PerfLog.h"
 #include "../common/Utility.h"
 #include "Configuration.h"
+#include "HealthCheckTask.h"
+#include "HealthProbe.h"
+#include "TimerDispatcher.h"
 #include "application/Application.h"
 #include "process/AppProcess.h"
 
 HealthCheckTask::HealthCheckTask()
+	: m_runningChecks(0), m_timerId(0)
 {
 }
 
 HealthCheckTask::~HealthCheckTask()
 {
+	this->cancelTimer(m_timerId);
+}
+
+std::shared_ptr<HealthCheckTask> &HealthCheckTask::instance()
+{
+	static auto singleton = std::make_shared<HealthCheckTask>();
+	return singleton;
+}
+
+void HealthCheckTask::initTimer()
+{
+	const static char fname[] = "HealthCheckTask::initTimer() ";
+
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	if (m_timerId == 0)
+	{
+		// health check interval and timeout are seconds precision
+		m_timerId = this->registerTimer(1000L, 1, std::bind(&HealthCheckTask::onScheduleEvent, this, std::placeholders::_1), fname);
+	}
+}
+
+void HealthCheckTask::onProcessExitEvent(const std::set<pid_t> &exitedPids)
+{
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	const auto now = std::chrono::steady_clock::now();
+	for (auto &check : m_checks)
+	{
+		auto &state = check.second;
+		if (state.m_process && exitedPids.count(state.m_process->getpid()))
+		{
+			collectResult(state, now);
+		}
+	}
+}
+
+void HealthCheckTask::onProbeResult(const std::string &appName, const HealthProbe *probe, bool success, const std::chrono::steady_clock::time_point &finishTime)
+{
+	const static char fname[] = "HealthCheckTask::onProbeResult() ";
+
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	auto iter = m_checks.find(appName);
+	// probe may be cancelled by timeout or replaced
+	if (iter != m_checks.end() && iter->second.m_probe.get() == probe)
+	{
+		LOG_DBG << fname << appName << " health probe :" << iter->second.m_app->getHealthCheck() << ", result " << success;
+		finishCheck(iter->second, success, finishTime);
+	}
 }
 
-void HealthCheckTask::doHealthCheck()
+void HealthCheckTask::onScheduleEvent(int timerId)
 {
-	const static char fname[] = "HealthCheckTask::doHealthCheck() ";
+	const static char fname[] = "HealthCheckTask::onScheduleEvent() ";
 	PerfLog perf(fname);
-	auto apps = Configuration::instance()->getApps();
-	for (auto &app : apps)
+
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	const auto now = std::chrono::steady_clock::now();
+	const auto apps = Configuration::instance()->getApps();
+
+	// 1. clean removed or replaced applications
+	for (auto it = m_checks.begin(); it != m_checks.end();)
+	{
+		auto &state = it->second;
+		if (std::find(apps.begin(), apps.end(), state.m_app) == apps.end() || state.m_app->getHealthCheck().empty())
+		{
+			if (state.m_process)
+			{
+				state.m_process->killgroup();
+				m_runningChecks--;
+			}
+			if (state.m_probe)
+			{
+				state.m_probe->cancel();
+			}
+			it = m_checks.erase(it);
+		}
+		else
+		{
+			++it;
+		}
+	}
+
+	// 2. collect exited and timeout checks, exit event may lost when event mode not enabled
+	for (auto &check : m_checks)
+	{
+		if (check.second.m_process || check.second.m_probe)
+		{
+			collectResult(check.second, now);
+		}
+	}
+
+	// 3. start due checks within concurrency limit
+	for (const auto &app : apps)
 	{
 		if (app->getHealthCheck().empty())
 			continue;
+		auto &state = m_checks[app->getName()];
+		if (state.m_app != app)
+		{
+			// new application
+			state.m_app = app;
+			state.m_nextTime = now;
+		}
+		if (state.m_process || state.m_probe || now < state.m_nextTime)
+			continue;
 		try
 		{
-			if (app->available())
+			if (!app->available())
+			{
+				app->setHealth(false);
+				state.m_nextTime = now + std::chrono::seconds(app->getHealthCheckInterval());
+			}
+			else if (HealthProbe::isNativeProbe(app->getHealthCheck()))
 			{
-				auto proc = std::make_shared<AppProcess>();
-				proc->spawnProcess(app->getHealthCheck(), "", "", {}, nullptr);
-				proc->delayKill(DEFAULT_HEALTH_CHECK_INTERVAL, fname);
-				ACE_exitcode exitCode;
-				proc->wait(&exitCode);
-				app->setHealth(0 == exitCode);
-				// proc->killgroup();
-				LOG_DBG << fname << app->getName() << " health check :" << app->getHealthCheck() << ", return " << exitCode << ", last error: " << proc->startError();
+				// native probe is cheap, not limited by concurrency
+				startProbe(state, now);
 			}
-			else
+			else if (m_runningChecks < DEFAULT_HEALTH_CHECK_CONCURRENCY)
 			{
-				app->setHealth(false);
+				startCheck(state, now);
 			}
 		}
 		catch (const std::exception &ex)
 		{
-			LOG_WAR << fname << app->getName() << "check got exception: " << ex.what();
+			LOG_WAR << fname << app->getName() << " check got exception: " << ex.what();
 		}
 		catch (...)
 		{
@@ -51,8 +148,85 @@ void HealthCheckTask::doHealthCheck()
 	}
 }
 
-std::shared_ptr<HealthCheckTask> &HealthCheckTask::instance()
+bool HealthCheckTask::collectResult(HealthCheckState &state, const std::chrono::steady_clock::time_point &now)
 {
-	static auto singleton = std::make_shared<HealthCheckTask>();
-	return singleton;
+	const static char fname[] = "HealthCheckTask::collectResult() ";
+
+	ACE_exitcode exitCode = 0;
+	if (state.m_process && state.m_process->waitExit(ACE_Time_Value::zero, &exitCode) > 0)
+	{
+		LOG_DBG << fname << state.m_app->getName() << " health check :" << state.m_app->getHealthCheck() << ", return " << exitCode << ", last error: " << state.m_process->startError();
+		// exit time is set when collected, fall back to now for safety
+		const auto exitTime = state.m_process->exitTime();
+		finishCheck(state, 0 == exitCode, exitTime.time_since_epoch().count() ? exitTime : std::chrono::steady_clock::now());
+		return true;
+	}
+	if (now - state.m_startTime >= std::chrono::seconds(state.m_app->getHealthCheckTimeout()))
+	{
+		LOG_WAR << fname << state.m_app->getName() << " health check timeout after <" << state.m_app->getHealthCheckTimeout() << "> seconds";
+		if (state.m_process)
+			state.m_process->killgroup();
+		finishCheck(state, false, std::chrono::steady_clock::now());
+		return true;
+	}
+	return false;
+}
+
+bool HealthCheckTask::startCheck(HealthCheckState &state, const std::chrono::steady_clock::time_point &now)
+{
+	const static char fname[] = "HealthCheckTask::startCheck() ";
+
+	state.m_nextTime = now + std::chrono::seconds(state.m_app->getHealthCheckInterval());
+	auto process = std::make_shared<AppProcess>();
+	if (process->spawnProcess(state.m_app->getHealthCheck(), "", "", {}, nullptr) > 0)
+	{
+		state.m_process = process;
+		state.m_startTime = now;
+		m_runningChecks++;
+		return true;
+	}
+	LOG_WAR << fname << state.m_app->getName() << " start health check failed: " << process->startError();
+	state.m_startTime = now;
+	finishCheck(state, false, std::chrono::steady_clock::now());
+	return false;
+}
+
+bool HealthCheckTask::startProbe(HealthCheckState &state, const std::chrono::steady_clock::time_point &now)
+{
+	const static char fname[] = "HealthCheckTask::startProbe() ";
+
+	state.m_nextTime = now + std::chrono::seconds(state.m_app->getHealthCheckInterval());
+	auto self = std::dynamic_pointer_cast<HealthCheckTask>(this->shared_from_this());
+	auto appName = state.m_app->getName();
+	// result is reported from reactor thread, switch to health check serialized context
+	auto probe = std::make_shared<HealthProbe>(state.m_app->getHealthCheck(), state.m_app->getHealthCheckHttpStatus(), [self, appName](const HealthProbe *probe, bool success) {
+		const auto finishTime = std::chrono::steady_clock::now();
+		TimerDispatcher::instance()->dispatch(static_cast<TimerHandler *>(self.get()), [self, appName, probe, success, finishTime]() { self->onProbeResult(appName, probe, success, finishTime); });
+	});
+	if (probe->start(ACE_Reactor::instance()))
+	{
+		state.m_probe = probe;
+		state.m_startTime = now;
+		return true;
+	}
+	LOG_DBG << fname << appName << " health probe failed: " << state.m_app->getHealthCheck();
+	state.m_startTime = now;
+	finishCheck(state, false, std::chrono::steady_clock::now());
+	return false;
+}
+
+void HealthCheckTask::finishCheck(HealthCheckState &state, bool health, const std::chrono::steady_clock::time_point &finishTime)
+{
+	auto cost = std::chrono::duration_cast<std::chrono::duration<double>>(finishTime - state.m_startTime).count();
+	state.m_app->setHealthCheckResult(health, cost);
+	if (state.m_process)
+	{
+		state.m_process = nullptr;
+		m_runningChecks--;
+	}
+	if (state.m_probe)
+	{
+		state.m_probe->cancel();
+		state.m_probe = nullptr;
+	}
 }
@@ -1,14 +1,84 @@
 #pragma once
 
+#include <chrono>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+
+#include "TimerHandler.h"
+
+class Application;
+class AppProcess;
+class HealthProbe;
 //////////////////////////////////////////////////////////////////////////
 /// Do health check for applications
+/// Health check processes run asynchronously with bounded concurrency,
+/// completion is collected by process exit event and schedule timer.
+/// tcp:// http:// unix:// health check run as native probe in reactor.
 //////////////////////////////////////////////////////////////////////////
-class HealthCheckTask
+class HealthCheckTask : public TimerHandler
 {
+	struct HealthCheckState
+	{
+		std::shared_ptr<Application> m_app;
+		// running health check process, nullptr when idle
+		std::shared_ptr<AppProcess> m_process;
+		// running native probe, nullptr when idle
+		std::shared_ptr<HealthProbe> m_probe;
+		std::chrono::steady_clock::time_point m_startTime;
+		std::chrono::steady_clock::time_point m_nextTime;
+	};
+
 public:
 	HealthCheckTask();
 	virtual ~HealthCheckTask();
 	static std::shared_ptr<HealthCheckTask> &instance();
-	void doHealthCheck();
+
+	/// <summary>
+	/// Start health check schedule timer
+	/// </summary>
+	void initTimer();
+	/// <summary>
+	/// Collect health check result for exited processes
+	/// </summary>
+	/// <param name="exitedPids">exited process id list</param>
+	void onProcessExitEvent(const std::set<pid_t> &exitedPids);
+	/// <summary>
+	/// Native probe result
+	/// </summary>
+	/// <param name="appName">application name</param>
+	/// <param name="probe">probe object, only used to identify the probe</param>
+	/// <param name="success">probe result</param>
+	/// <param name="finishTime">time the probe completed in reactor</param>
+	void onProbeResult(const std::string &appName, const HealthProbe *probe, bool success, const std::chrono::steady_clock::time_point &finishTime);
+
+private:
+	/// <summary>
+	/// Schedule timer, collect timeout checks and start due checks
+	/// </summary>
+	void onScheduleEvent(int timerId = 0);
+	/// <summary>
+	/// Collect exited or timeout health check process
+	/// </summary>
+	/// <returns>true if the check is finished</returns>
+	bool collectResult(HealthCheckState &state, const std::chrono::steady_clock::time_point &now);
+	/// <summary>
+	/// Start a health check process or native probe
+	/// </summary>
+	/// <returns>true if the check is started</returns>
+	bool startCheck(HealthCheckState &state, const std::chrono::steady_clock::time_point &now);
+	bool startProbe(HealthCheckState &state, const std::chrono::steady_clock::time_point &now);
+	/// <summary>
+	/// Report result, duration is counted to the time the check actually completed
+	/// </summary>
+	void finishCheck(HealthCheckState &state, bool health, const std::chrono::steady_clock::time_point &finishTime);
+
+private:
+	// key: application name
+	std::map<std::string, HealthCheckState> m_checks;
+	std::size_t m_runningChecks;
+	int m_timerId;
+	mutable std::recursive_mutex m_mutex;
 };
@@ -0,0 +1,520 @@
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+
+#include <ace/OS.h>
+
+#include "../common/Utility.h"
+#include "HealthProbe.h"
+
+#define PROBE_SCHEMA_TCP "tcp://"
+#define PROBE_SCHEMA_HTTP "http://"
+#define PROBE_SCHEMA_UNIX "unix://"
+// only status line is needed
+#define PROBE_HTTP_RESPONSE_MAX_LENGTH 1024
+// resolved address is reused by probes of the same host:port
+#define PROBE_DNS_CACHE_SECONDS 30
+// getaddrinfo may block for seconds, run by a small fixed pool
+#define PROBE_DNS_RESOLVE_THREADS 2
+
+namespace
+{
+	struct CachedAddress
+	{
+		std::vector<struct sockaddr_storage> m_addrs;
+		std::vector<socklen_t> m_lengths;
+		std::chrono::steady_clock::time_point m_expire;
+	};
+	std::mutex dnsCacheMutex;
+	// key: host:port
+	std::map<std::string, CachedAddress> dnsCache;
+
+	// resolve host:port to dnsCache by PROBE_DNS_RESOLVE_THREADS threads (started on demand),
+	// probes of one host:port wait for the same lookup
+	class ProbeResolver
+	{
+	public:
+		ProbeResolver()
+			: m_stopped(false)
+		{
+		}
+		~ProbeResolver()
+		{
+			stop();
+		}
+
+		// callback is called in resolve thread after dnsCache updated (not updated for failure),
+		// false when resolver is stopped
+		bool resolve(const std::string &host, const std::string &port, const std::function<void()> &callback)
+		{
+			const auto key = host + ":" + port;
+			std::lock_guard<std::mutex> guard(m_mutex);
+			if (m_stopped)
+				return false;
+			auto &waiters = m_waiters[key];
+			waiters.push_back(callback);
+			if (waiters.size() == 1)
+			{
+				m_pending.push_back(std::make_pair(host, port));
+				if (m_threads.size() < PROBE_DNS_RESOLVE_THREADS)
+					m_threads.push_back(std::thread(&ProbeResolver::run, this));
+				m_condition.notify_one();
+			}
+			return true;
+		}
+
+		// join resolve threads, pending lookups are dropped
+		void stop()
+		{
+			std::vector<std::thread> threads;
+			{
+				std::lock_guard<std::mutex> guard(m_mutex);
+				m_stopped = true;
+				m_pending.clear();
+				m_waiters.clear();
+				threads.swap(m_threads);
+			}
+			m_condition.notify_all();
+			for (auto &thread : threads)
+				thread.join();
+		}
+
+	private:
+		void run()
+		{
+			const static char fname[] = "ProbeResolver::run() ";
+
+			while (true)
+			{
+				std::pair<std::string, std::string> hostPort;
+				{
+					std::unique_lock<std::mutex> lock(m_mutex);
+					m_condition.wait(lock, [this]() { return m_stopped || m_pending.size(); });
+					if (m_stopped)
+						return;
+					hostPort = m_pending.front();
+					m_pending.pop_front();
+				}
+				const auto key = hostPort.first + ":" + hostPort.second;
+				struct addrinfo hints;
+				std::memset(&hints, 0, sizeof(hints));
+				hints.ai_family = AF_UNSPEC;
+				hints.ai_socktype = SOCK_STREAM;
+				struct addrinfo *result = nullptr;
+				auto error = ::getaddrinfo(hostPort.first.c_str(), hostPort.second.c_str(), &hints, &result);
+				if (error != 0 || result == nullptr)
+				{
+					LOG_WAR << fname << "resolve <" << key << "> failed with error: " << gai_strerror(error);
+				}
+				else
+				{
+					CachedAddress cache;
+					for (auto info = result; info; info = info->ai_next)
+					{
+						struct sockaddr_storage addr;
+						std::memcpy(&addr, info->ai_addr, info->ai_addrlen);
+						cache.m_addrs.push_back(addr);
+						cache.m_lengths.push_back(info->ai_addrlen);
+					}
+					::freeaddrinfo(result);
+					cache.m_expire = std::chrono::steady_clock::now() + std::chrono::seconds(PROBE_DNS_CACHE_SECONDS);
+					std::lock_guard<std::mutex> guard(dnsCacheMutex);
+					dnsCache[key] = cache;
+				}
+				std::vector<std::function<void()>> waiters;
+				{
+					std::lock_guard<std::mutex> guard(m_mutex);
+					waiters.swap(m_waiters[key]);
+					m_waiters.erase(key);
+				}
+				for (const auto &waiter : waiters)
+					waiter();
+			}
+		}
+
+	private:
+		std::mutex m_mutex;
+		std::condition_variable m_condition;
+		std::deque<std::pair<std::string, std::string>> m_pending;
+		// key: host:port, value: callbacks of probes waiting the lookup
+		std::map<std::string, std::vector<std::function<void()>>> m_waiters;
+		std::vector<std::thread> m_threads;
+		bool m_stopped;
+	};
+	ProbeResolver dnsResolver;
+} // namespace
+
+HealthProbe::HealthProbe(const std::string &url, int expectStatus, const std::function<void(const HealthProbe *, bool)> &callback)
+	: m_url(url), m_expectStatus(expectStatus), m_callback(callback), m_type(ProbeType::TCP), m_socket(ACE_INVALID_HANDLE), m_addressIndex(0), m_finished(false)
+{
+}
+
+HealthProbe::~HealthProbe()
+{
+	closeSocket();
+}
+
+bool HealthProbe::isNativeProbe(const std::string &healthCheck)
+{
+	return Utility::startWith(healthCheck, PROBE_SCHEMA_TCP) ||
+		   Utility::startWith(healthCheck, PROBE_SCHEMA_HTTP) ||
+		   Utility::startWith(healthCheck, PROBE_SCHEMA_UNIX);
+}
+
+bool HealthProbe::start(ACE_Reactor *reactor)
+{
+	const static char fname[] = "HealthProbe::start() ";
+
+	if (!parseUrl())
+	{
+		return false;
+	}
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	this->reactor(reactor);
+	if (m_type != ProbeType::UNIX && !lookupAddress())
+	{
+		// getaddrinfo may block for seconds, never run it in timer or reactor thread
+		return resolveAsync();
+	}
+	if (!connect())
+	{
+		return false;
+	}
+	if (reactor->register_handler(this, ACE_Event_Handler::WRITE_MASK) < 0)
+	{
+		LOG_WAR << fname << "register probe <" << m_url << "> failed with error: " << std::strerror(errno);
+		return false;
+	}
+	return true;
+}
+
+void HealthProbe::cancel()
+{
+	ACE_HANDLE socket = ACE_INVALID_HANDLE;
+	{
+		// wait for running dispatch or callback
+		std::lock_guard<std::recursive_mutex> guard(m_mutex);
+		m_finished = true;
+		socket = m_socket;
+	}
+	// always remove, handler may be registered by finished dispatch
+	if (this->reactor() && socket != ACE_INVALID_HANDLE)
+	{
+		this->reactor()->remove_handler(this, ACE_Event_Handler::ALL_EVENTS_MASK | ACE_Event_Handler::DONT_CALL);
+	}
+}
+
+ACE_HANDLE HealthProbe::get_handle(void) const
+{
+	return m_socket;
+}
+
+int HealthProbe::handle_output(ACE_HANDLE fd)
+{
+	const static char fname[] = "HealthProbe::handle_output() ";
+
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	if (m_finished)
+	{
+		return 0;
+	}
+	int error = 0;
+	socklen_t length = sizeof(error);
+	if (::getsockopt(m_socket, SOL_SOCKET, SO_ERROR, &error, &length) < 0 || error != 0)
+	{
+		LOG_DBG << fname << "probe <" << m_url << "> connect failed with error: " << std::strerror(error ? error : errno);
+		// try the other resolved addresses
+		if (!connectNext())
+		{
+			finish(false);
+		}
+		return 0;
+	}
+	if (m_type != ProbeType::HTTP)
+	{
+		finish(true);
+		return 0;
+	}
+
+	// request is small enough for one send on a new connection
+	const auto request = Utility::stringFormat("GET %s HTTP/1.0\r\nHost: %s\r\nConnection: close\r\n\r\n", m_path.c_str(), m_host.c_str());
+	if (ACE_OS::send(m_socket, request.c_str(), request.length()) != (ssize_t)request.length())
+	{
+		LOG_DBG << fname << "probe <" << m_url << "> send failed with error: " << std::strerror(errno);
+		finish(false);
+		return 0;
+	}
+	this->reactor()->mask_ops(this, ACE_Event_Handler::READ_MASK, ACE_Reactor::SET_MASK);
+	return 0;
+}
+
+int HealthProbe::handle_input(ACE_HANDLE fd)
+{
+	const static char fname[] = "HealthProbe::handle_input() ";
+
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	if (m_finished)
+	{
+		return 0;
+	}
+	char buffer[PROBE_HTTP_RESPONSE_MAX_LENGTH];
+	auto size = ACE_OS::recv(m_socket, buffer, sizeof(buffer));
+	if (size < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+	{
+		return 0;
+	}
+	if (size > 0)
+	{
+		m_response.append(buffer, size);
+	}
+	auto lineEnd = m_response.find("\r\n");
+	if (lineEnd == std::string::npos)
+	{
+		if (size <= 0 || m_response.length() >= PROBE_HTTP_RESPONSE_MAX_LENGTH)
+		{
+			LOG_DBG << fname << "probe <" << m_url << "> invalid response";
+			finish(false);
+		}
+		return 0;
+	}
+
+	// status line: HTTP/1.1 200 OK
+	int status = 0;
+	auto statusLine = m_response.substr(0, lineEnd);
+	auto blank = statusLine.find(' ');
+	if (blank != std::string::npos)
+	{
+		status = std::atoi(statusLine.c_str() + blank + 1);
+	}
+	LOG_DBG << fname << "probe <" << m_url << "> response status <" << status << ">";
+	if (m_expectStatus)
+	{
+		finish(status == m_expectStatus);
+	}
+	else
+	{
+		finish(status >= 200 && status < 400);
+	}
+	return 0;
+}
+
+bool HealthProbe::parseUrl()
+{
+	const static char fname[] = "HealthProbe::parseUrl() ";
+
+	std::string address;
+	if (Utility::startWith(m_url, PROBE_SCHEMA_UNIX))
+	{
+		m_type = ProbeType::UNIX;
+		m_path = m_url.substr(std::strlen(PROBE_SCHEMA_UNIX));
+		return m_path.length() > 0 && m_path.length() < sizeof(sockaddr_un::sun_path);
+	}
+	else if (Utility::startWith(m_url, PROBE_SCHEMA_HTTP))
+	{
+		m_type = ProbeType::HTTP;
+		address = m_url.substr(std::strlen(PROBE_SCHEMA_HTTP));
+		auto slash = address.find('/');
+		m_path = (slash == std::string::npos) ? "/" : address.substr(slash);
+		address = address.substr(0, slash);
+	}
+	else if (Utility::startWith(m_url, PROBE_SCHEMA_TCP))
+	{
+		m_type = ProbeType::TCP;
+		address = m_url.substr(std::strlen(PROBE_SCHEMA_TCP));
+	}
+
+	// host:port or [ipv6]:port
+	auto colon = address.rfind(':');
+	if (colon == std::string::npos)
+	{
+		if (m_type != ProbeType::HTTP)
+		{
+			LOG_WAR << fname << "no port specified in probe <" << m_url << ">";
+			return false;
+		}
+		m_host = address;
+		m_port = "80";
+	}
+	else
+	{
+		m_host = address.substr(0, colon);
+		m_port = address.substr(colon + 1);
+	}
+	if (m_host.length() > 1 && m_host.front() == '[' && m_host.back() == ']')
+	{
+		m_host = m_host.substr(1, m_host.length() - 2);
+	}
+	return m_host.length() && m_port.length();
+}
+
+bool HealthProbe::lookupAddress()
+{
+	const auto key = m_host + ":" + m_port;
+	{
+		std::lock_guard<std::mutex> guard(dnsCacheMutex);
+		auto iter = dnsCache.find(key);
+		if (iter != dnsCache.end() && iter->second.m_expire > std::chrono::steady_clock::now())
+		{
+			m_addresses.clear();
+			for (std::size_t i = 0; i < iter->second.m_addrs.size(); i++)
+				m_addresses.push_back(Address{iter->second.m_addrs[i], iter->second.m_lengths[i]});
+			return true;
+		}
+	}
+
+	// numeric address does not query DNS
+	struct addrinfo hints;
+	std::memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	hints.ai_flags = AI_NUMERICHOST;
+	struct addrinfo *result = nullptr;
+	if (::getaddrinfo(m_host.c_str(), m_port.c_str(), &hints, &result) != 0 || result == nullptr)
+	{
+		return false;
+	}
+	m_addresses.clear();
+	for (auto info = result; info; info = info->ai_next)
+	{
+		Address address;
+		std::memcpy(&address.m_addr, info->ai_addr, info->ai_addrlen);
+		address.m_length = info->ai_addrlen;
+		m_addresses.push_back(address);
+	}
+	::freeaddrinfo(result);
+	return true;
+}
+
+bool HealthProbe::resolveAsync()
+{
+	const static char fname[] = "HealthProbe::resolveAsync() ";
+
+	std::weak_ptr<HealthProbe> weakSelf = this->shared_from_this();
+	if (!dnsResolver.resolve(m_host, m_port, [weakSelf]() {
+			// probe may be cancelled and released during resolve
+			auto self = weakSelf.lock();
+			if (self)
+				self->onResolved();
+		}))
+	{
+		LOG_WAR << fname << "resolver stopped, probe <" << m_url << "> not started";
+		return false;
+	}
+	return true;
+}
+
+void HealthProbe::stopResolver()
+{
+	dnsResolver.stop();
+}
+
+void HealthProbe::onResolved()
+{
+	const static char fname[] = "HealthProbe::onResolved() ";
+
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	if (m_finished)
+	{
+		return;
+	}
+	// resolve failure is not cached, no address to connect
+	if (!lookupAddress())
+	{
+		LOG_WAR << fname << "resolve probe <" << m_url << "> failed";
+		m_addresses.clear();
+	}
+	m_addressIndex = 0;
+	if (!connect())
+	{
+		finish(false);
+		return;
+	}
+	if (this->reactor()->register_handler(this, ACE_Event_Handler::WRITE_MASK) < 0)
+	{
+		LOG_WAR << fname << "register probe <" << m_url << "> failed with error: " << std::strerror(errno);
+		finish(false);
+	}
+}
+
+bool HealthProbe::connect()
+{
+	const static char fname[] = "HealthProbe::connect() ";
+
+	int ret = -1;
+	if (m_type == ProbeType::UNIX)
+	{
+		struct sockaddr_un addr;
+		std::memset(&addr, 0, sizeof(addr));
+		addr.sun_family = AF_UNIX;
+		std::strncpy(addr.sun_path, m_path.c_str(), sizeof(addr.sun_path) - 1);
+		m_socket = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+		if (m_socket != ACE_INVALID_HANDLE)
+		{
+			ret = ::connect(m_socket, (struct sockaddr *)&addr, sizeof(addr));
+		}
+		if (m_socket == ACE_INVALID_HANDLE || (ret < 0 && errno != EINPROGRESS))
+		{
+			LOG_DBG << fname << "probe <" << m_url << "> connect failed with error: " << std::strerror(errno);
+			closeSocket();
+			return false;
+		}
+		return true;
+	}
+
+	// connect refused immediately fall through to next address
+	for (; m_addressIndex < m_addresses.size(); m_addressIndex++)
+	{
+		const auto &address = m_addresses[m_addressIndex];
+		m_socket = ::socket(address.m_addr.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+		if (m_socket != ACE_INVALID_HANDLE)
+		{
+			ret = ::connect(m_socket, (const struct sockaddr *)&address.m_addr, address.m_length);
+			if (ret == 0 || errno == EINPROGRESS)
+			{
+				return true;
+			}
+		}
+		LOG_DBG << fname << "probe <" << m_url << "> connect failed with error: " << std::strerror(errno);
+		closeSocket();
+	}
+	return false;
+}
+
+bool HealthProbe::connectNext()
+{
+	if (m_type == ProbeType::UNIX || m_addressIndex + 1 >= m_addresses.size())
+	{
+		return false;
+	}
+	// socket of handler is changed, re-register
+	this->reactor()->remove_handler(this, ACE_Event_Handler::ALL_EVENTS_MASK | ACE_Event_Handler::DONT_CALL);
+	closeSocket();
+	m_addressIndex++;
+	return connect() && this->reactor()->register_handler(this, ACE_Event_Handler::WRITE_MASK) == 0;
+}
+
+void HealthProbe::closeSocket()
+{
+	if (m_socket != ACE_INVALID_HANDLE)
+	{
+		ACE_OS::close(m_socket);
+		m_socket = ACE_INVALID_HANDLE;
+	}
+}
+
+void HealthProbe::finish(bool success)
+{
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	if (!m_finished)
+	{
+		m_finished = true;
+		if (m_socket != ACE_INVALID_HANDLE)
+			this->reactor()->remove_handler(this, ACE_Event_Handler::ALL_EVENTS_MASK | ACE_Event_Handler::DONT_CALL);
+		m_callback(this, success);
+	}
+}
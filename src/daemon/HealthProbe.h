@@ -0,0 +1,109 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <sys/socket.h>
+
+#include <ace/Event_Handler.h>
+#include <ace/Reactor.h>
+
+//////////////////////////////////////////////////////////////////////////
+/// Native health probe run inside reactor without fork process
+/// Support:
+///  1. tcp://host:port          TCP connect
+///  2. http://host:port/path    HTTP GET and check response status
+///  3. unix:///path/to/socket   Unix domain socket connect
+/// Host name is resolved by a small fixed thread pool and cached for
+/// PROBE_DNS_CACHE_SECONDS, probes of one host:port share the lookup in flight,
+/// all resolved addresses are tried in order.
+/// Must be created by std::make_shared.
+//////////////////////////////////////////////////////////////////////////
+class HealthProbe : public ACE_Event_Handler, public std::enable_shared_from_this<HealthProbe>
+{
+	enum class ProbeType
+	{
+		TCP,
+		HTTP,
+		UNIX
+	};
+	struct Address
+	{
+		struct sockaddr_storage m_addr;
+		socklen_t m_length;
+	};
+
+public:
+	/// <summary>
+	/// Create a probe
+	/// </summary>
+	/// <param name="url">probe url</param>
+	/// <param name="expectStatus">expected HTTP status, 0 means any of 2xx and 3xx</param>
+	/// <param name="callback">result callback with probe object and result, called once in reactor thread</param>
+	explicit HealthProbe(const std::string &url, int expectStatus, const std::function<void(const HealthProbe *, bool)> &callback);
+	virtual ~HealthProbe();
+
+	/// <summary>
+	/// Health check is a native probe url or a script command
+	/// </summary>
+	static bool isNativeProbe(const std::string &healthCheck);
+
+	/// <summary>
+	/// Start non-blocking connect and register to reactor,
+	/// host name not in cache is resolved in background and connect is started after resolved
+	/// </summary>
+	/// <returns>false if failed to start or connect refused immediately, callback will not be called</returns>
+	bool start(ACE_Reactor *reactor);
+	/// <summary>
+	/// Stop probe, wait running dispatch finished, callback will not be called after return
+	/// </summary>
+	void cancel();
+	/// <summary>
+	/// Stop and join DNS resolve threads at shutdown, probes need resolve fail to start after return
+	/// </summary>
+	static void stopResolver();
+
+	virtual ACE_HANDLE get_handle(void) const override;
+	/// <summary>
+	/// Connect finished, override from ACE
+	/// </summary>
+	virtual int handle_output(ACE_HANDLE fd = ACE_INVALID_HANDLE) override;
+	/// <summary>
+	/// HTTP response received, override from ACE
+	/// </summary>
+	virtual int handle_input(ACE_HANDLE fd = ACE_INVALID_HANDLE) override;
+
+private:
+	bool parseUrl();
+	// cached or numeric address, false when need resolve by DNS
+	bool lookupAddress();
+	// false when resolver is stopped
+	bool resolveAsync();
+	// address is read from cache
+	void onResolved();
+	// connect to next address, unix socket has one address
+	bool connect();
+	// close current socket and connect next address after connect failure
+	bool connectNext();
+	void closeSocket();
+	void finish(bool success);
+
+private:
+	const std::string m_url;
+	const int m_expectStatus;
+	std::function<void(const HealthProbe *, bool)> m_callback;
+	ProbeType m_type;
+	std::string m_host;
+	std::string m_port;
+	std::string m_path;
+	ACE_HANDLE m_socket;
+	std::vector<Address> m_addresses;
+	std::size_t m_addressIndex;
+	std::string m_response;
+	// protect dispatch, finish and cancel
+	mutable std::recursive_mutex m_mutex;
+	bool m_finished;
+};
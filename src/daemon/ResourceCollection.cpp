@@ -5,7 +5,7 @@
 #include "../common/DateTime.h"
 #include "../common/Utility.h"
 #include "../common/os/net.hpp"
-#include "../common/os/pstree.hpp"
+#include "../common/os/pssnapshot.hpp"
 #include "Configuration.h"
 #include "ResourceCollection.h"
 
@@ -97,20 +97,39 @@ uint64_t ResourceCollection::getRssMemory(pid_t pid)
 	const static char fname[] = "ResourceCollection::getRssMemory() ";
 	if (pid > 0)
 	{
-		auto tree = os::pstree(pid);
-		if (nullptr != tree)
+		auto snapshot = getProcessSnapshot();
+		if (nullptr != snapshot && nullptr != snapshot->find(pid))
 		{
-			return tree->totalRSS();
+			return snapshot->totalRSS(pid);
 		}
 		else
 		{
-			LOG_WAR << fname << " Failed to find process: " << pid;
+			LOG_DBG << fname << " Failed to find process: " << pid;
 			return 0;
 		}
 	}
 	return 0;
 }
 
+std::shared_ptr<os::ProcessSnapshot> ResourceCollection::getProcessSnapshot()
+{
+	const static char fname[] = "ResourceCollection::getProcessSnapshot() ";
+
+	// concurrent callers wait for the running scan and share the result
+	std::lock_guard<std::mutex> guard(m_processSnapshotMutex);
+	const auto maxAge = std::chrono::seconds(Configuration::instance()->getScheduleInterval());
+	if (m_processSnapshot == nullptr || std::chrono::steady_clock::now() - m_processSnapshot->time() >= maxAge)
+	{
+		auto snapshot = os::ProcessSnapshot::scan();
+		if (snapshot)
+		{
+			m_processSnapshot = snapshot;
+			LOG_DBG << fname << "scanned processes: " << snapshot->size();
+		}
+	}
+	return m_processSnapshot;
+}
+
 void ResourceCollection::dump()
 {
 	const static char fname[] = "ResourceCollection::dump() ";
@@ -159,10 +178,10 @@ web::json::value ResourceCollection::AsJson()
 	result[GET_STRING_T("mem_free_bytes")] = web::json::value::number(m_resources.m_free_bytes);
 	result[GET_STRING_T("mem_totalSwap_bytes")] = web::json::value::number(m_resources.m_totalSwap_bytes);
 	result[GET_STRING_T("mem_freeSwap_bytes")] = web::json::value::number(m_resources.m_freeSwap_bytes);
-	auto allAppMem = os::pstree();
-	if (nullptr != allAppMem)
+	auto snapshot = getProcessSnapshot();
+	if (nullptr != snapshot)
 	{
-		result[GET_STRING_T("mem_applications")] = web::json::value::number(allAppMem->totalRSS());
+		result[GET_STRING_T("mem_applications")] = web::json::value::number(snapshot->totalRSS(getPid()));
 	}
 	// Load
 	auto load = os::loadavg();
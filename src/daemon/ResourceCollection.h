@@ -9,6 +9,11 @@
 
 #include <cpprest/json.h>
 
+namespace os
+{
+	class ProcessSnapshot;
+}
+
 struct HostNetInterface
 {
 	std::string name;
@@ -53,6 +58,11 @@ public:
 	pid_t getPid();
 
 	uint64_t getRssMemory(pid_t pid = getpid());
+	/// <summary>
+	/// Get process table snapshot, /proc is scanned at most once per schedule interval
+	/// and the snapshot is shared by all consumers.
+	/// </summary>
+	std::shared_ptr<os::ProcessSnapshot> getProcessSnapshot();
 
 	void dump();
 
@@ -62,5 +72,7 @@ public:
 private:
 	HostResource m_resources;
 	std::recursive_mutex m_mutex;
+	std::shared_ptr<os::ProcessSnapshot> m_processSnapshot;
+	std::mutex m_processSnapshotMutex;
 	const std::chrono::system_clock::time_point m_appmeshStartTime;
 };
@@ -2,7 +2,7 @@
 #include "../common/Utility.h"
 
 ResourceLimitation::ResourceLimitation()
-	: m_memoryMb(0), m_memoryVirtMb(0), m_cpuShares(0), m_index(0)
+	: m_memoryMb(0), m_memoryVirtMb(0), m_cpuShares(0), m_cpuQuotaPercent(0), m_pidsMax(0), m_reuseIndex(true)
 {
 }
 
@@ -17,6 +17,9 @@ bool ResourceLimitation::operator==(const std::shared_ptr<ResourceLimitation> &o
 	return (m_cpuShares == obj->m_cpuShares &&
 			m_memoryMb == obj->m_memoryMb &&
 			m_memoryVirtMb == obj->m_memoryVirtMb &&
+			m_cpuQuotaPercent == obj->m_cpuQuotaPercent &&
+			m_pidsMax == obj->m_pidsMax &&
+			m_ioMax == obj->m_ioMax &&
 			m_name == obj->m_name);
 }
 
@@ -27,6 +30,9 @@ void ResourceLimitation::dump()
 	LOG_DBG << fname << "m_memoryMb:" << m_memoryMb;
 	LOG_DBG << fname << "m_memoryVirtMb:" << m_memoryVirtMb;
 	LOG_DBG << fname << "m_cpuShares:" << m_cpuShares;
+	LOG_DBG << fname << "m_cpuQuotaPercent:" << m_cpuQuotaPercent;
+	LOG_DBG << fname << "m_pidsMax:" << m_pidsMax;
+	LOG_DBG << fname << "m_ioMax:" << m_ioMax;
 }
 
 web::json::value ResourceLimitation::AsJson()
@@ -36,6 +42,12 @@ web::json::value ResourceLimitation::AsJson()
 	result[JSON_KEY_RESOURCE_LIMITATION_memory_mb] = web::json::value::number(m_memoryMb);
 	result[JSON_KEY_RESOURCE_LIMITATION_memory_virt_mb] = web::json::value::number(m_memoryVirtMb);
 	result[JSON_KEY_RESOURCE_LIMITATION_cpu_shares] = web::json::value::number(m_cpuShares);
+	if (m_cpuQuotaPercent)
+		result[JSON_KEY_RESOURCE_LIMITATION_cpu_quota_percent] = web::json::value::number(m_cpuQuotaPercent);
+	if (m_pidsMax)
+		result[JSON_KEY_RESOURCE_LIMITATION_pids_max] = web::json::value::number(m_pidsMax);
+	if (m_ioMax.length())
+		result[JSON_KEY_RESOURCE_LIMITATION_io_max] = web::json::value::string(m_ioMax);
 	return result;
 }
 
@@ -48,10 +60,16 @@ std::shared_ptr<ResourceLimitation> ResourceLimitation::FromJson(const web::json
 		result->m_memoryMb = GET_JSON_INT_VALUE(jsonObj, JSON_KEY_RESOURCE_LIMITATION_memory_mb);
 		result->m_memoryVirtMb = GET_JSON_INT_VALUE(jsonObj, JSON_KEY_RESOURCE_LIMITATION_memory_virt_mb);
 		result->m_cpuShares = GET_JSON_INT_VALUE(jsonObj, JSON_KEY_RESOURCE_LIMITATION_cpu_shares);
+		result->m_cpuQuotaPercent = GET_JSON_INT_VALUE(jsonObj, JSON_KEY_RESOURCE_LIMITATION_cpu_quota_percent);
+		result->m_pidsMax = GET_JSON_INT_VALUE(jsonObj, JSON_KEY_RESOURCE_LIMITATION_pids_max);
+		result->m_ioMax = GET_JSON_STR_VALUE(jsonObj, JSON_KEY_RESOURCE_LIMITATION_io_max);
 		result->m_name = appName;
 		if (0 == result->m_memoryMb &&
 			0 == result->m_memoryVirtMb &&
-			0 == result->m_cpuShares)
+			0 == result->m_cpuShares &&
+			0 == result->m_cpuQuotaPercent &&
+			0 == result->m_pidsMax &&
+			result->m_ioMax.empty())
 		{
 			return nullptr;
 		}
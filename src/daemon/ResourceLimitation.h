@@ -21,8 +21,14 @@ public:
 	int m_memoryMb;
 	int m_memoryVirtMb;
 	int m_cpuShares;
+	// hard CPU limit, 100 means one core
+	int m_cpuQuotaPercent;
+	int m_pidsMax;
+	// cgroup v2 io.max lines, "MAJ:MIN rbps=N wbps=N riops=N wiops=N", separated by ';'
+	std::string m_ioMax;
 
 	// runtime info
 	std::string m_name;
-	int m_index;
+	// run once application remove its cgroup instance directory after process exit
+	bool m_reuseIndex;
 };
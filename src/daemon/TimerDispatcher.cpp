@@ -0,0 +1,220 @@
+#include <algorithm>
+
+#include "../common/Utility.h"
+#include "../prom_exporter/gauge.h"
+#include "TimerDispatcher.h"
+#include "rest/PrometheusRest.h"
+
+TimerDispatcher::TimerDispatcher()
+	: m_threadCount(0), m_queueDepth(0), m_retireCount(0), m_stopped(false)
+{
+}
+
+TimerDispatcher::~TimerDispatcher()
+{
+	stop();
+}
+
+std::shared_ptr<TimerDispatcher> &TimerDispatcher::instance()
+{
+	static auto singleton = std::make_shared<TimerDispatcher>();
+	return singleton;
+}
+
+void TimerDispatcher::start(std::size_t threadCount)
+{
+	const static char fname[] = "TimerDispatcher::start() ";
+
+	std::lock_guard<std::mutex> guard(m_mutex);
+	if (m_threadCount > 0 || threadCount == 0 || m_stopped)
+		return;
+	if (PrometheusRest::instance())
+	{
+		m_metricQueueDepth = PrometheusRest::instance()->createPromGauge(
+			PROM_METRIC_NAME_appmesh_timer_dispatch_queue_depth, PROM_METRIC_HELP_appmesh_timer_dispatch_queue_depth, {});
+		m_metricDispatchLag = PrometheusRest::instance()->createPromGauge(
+			PROM_METRIC_NAME_appmesh_timer_dispatch_lag_milliseconds, PROM_METRIC_HELP_appmesh_timer_dispatch_lag_milliseconds, {});
+	}
+	m_threadCount = threadCount;
+	for (std::size_t i = 0; i < threadCount; i++)
+	{
+		m_threads.emplace_back(&TimerDispatcher::runWorker, this);
+	}
+	LOG_INF << fname << "dispatch thread number: " << threadCount;
+}
+
+void TimerDispatcher::resize(std::size_t threadCount)
+{
+	const static char fname[] = "TimerDispatcher::resize() ";
+
+	std::lock_guard<std::mutex> guard(m_mutex);
+	// not started yet, start() will use the new size
+	if (m_threadCount == 0 || threadCount == 0 || threadCount == m_threadCount)
+		return;
+	joinRetired();
+	if (threadCount < m_threadCount)
+	{
+		m_retireCount += m_threadCount - threadCount;
+		m_condition.notify_all();
+	}
+	else
+	{
+		// cancel pending retire first, then start new threads
+		auto add = threadCount - m_threadCount;
+		auto cancelled = std::min(add, m_retireCount);
+		m_retireCount -= cancelled;
+		for (std::size_t i = cancelled; i < add; i++)
+		{
+			m_threads.emplace_back(&TimerDispatcher::runWorker, this);
+		}
+	}
+	LOG_INF << fname << "dispatch thread number: " << m_threadCount << " -> " << threadCount;
+	m_threadCount = threadCount;
+}
+
+void TimerDispatcher::stop()
+{
+	const static char fname[] = "TimerDispatcher::stop() ";
+
+	std::vector<std::thread> threads;
+	{
+		std::lock_guard<std::mutex> guard(m_mutex);
+		if (m_threadCount == 0)
+			return;
+		m_stopped = true;
+		m_threadCount = 0;
+		m_condition.notify_all();
+		threads.swap(m_threads);
+	}
+	for (auto &thread : threads)
+	{
+		// stopped from a dispatched event
+		if (thread.get_id() == std::this_thread::get_id())
+			thread.detach();
+		else
+			thread.join();
+	}
+	std::lock_guard<std::mutex> guard(m_mutex);
+	m_ownerTasks.clear();
+	m_readyOwners.clear();
+	m_queueDepth = 0;
+	LOG_INF << fname << "dispatch threads stopped";
+}
+
+void TimerDispatcher::joinRetired()
+{
+	for (const auto &id : m_retiredThreads)
+	{
+		auto iter = std::find_if(m_threads.begin(), m_threads.end(), [&id](const std::thread &thread) { return thread.get_id() == id; });
+		if (iter != m_threads.end())
+		{
+			// already out of worker loop and not hold any lock
+			iter->join();
+			m_threads.erase(iter);
+		}
+	}
+	m_retiredThreads.clear();
+}
+
+void TimerDispatcher::dispatch(const void *owner, const std::function<void()> &task)
+{
+	DispatchTask dispatchTask{task, std::chrono::steady_clock::now()};
+	{
+		std::lock_guard<std::mutex> guard(m_mutex);
+		if (m_threadCount > 0)
+		{
+			auto iter = m_ownerTasks.find(owner);
+			if (iter == m_ownerTasks.end())
+			{
+				// owner is idle, queue it
+				m_ownerTasks[owner].push_back(dispatchTask);
+				m_readyOwners.push_back(owner);
+				m_condition.notify_one();
+			}
+			else
+			{
+				// owner is queued or running, will be picked up after current one
+				iter->second.push_back(dispatchTask);
+			}
+			if (m_metricQueueDepth)
+				m_metricQueueDepth->metric().Set(++m_queueDepth);
+			else
+				++m_queueDepth;
+			return;
+		}
+	}
+	// not started, run in caller thread
+	runTask(dispatchTask);
+}
+
+std::size_t TimerDispatcher::queueDepth() const
+{
+	std::lock_guard<std::mutex> guard(m_mutex);
+	return m_queueDepth;
+}
+
+void TimerDispatcher::runWorker()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (true)
+	{
+		m_condition.wait(lock, [this]() { return !m_readyOwners.empty() || m_retireCount > 0 || m_stopped; });
+		if (m_stopped)
+			return;
+		if (m_retireCount > 0)
+		{
+			m_retireCount--;
+			m_retiredThreads.push_back(std::this_thread::get_id());
+			return;
+		}
+		auto owner = m_readyOwners.front();
+		m_readyOwners.pop_front();
+		auto &tasks = m_ownerTasks[owner];
+		auto task = tasks.front();
+		tasks.pop_front();
+		--m_queueDepth;
+		if (m_metricQueueDepth)
+			m_metricQueueDepth->metric().Set(m_queueDepth);
+
+		lock.unlock();
+		runTask(task);
+		lock.lock();
+		if (m_stopped)
+			return;
+
+		// element reference is not stable after unlock
+		auto iter = m_ownerTasks.find(owner);
+		if (iter->second.empty())
+		{
+			m_ownerTasks.erase(iter);
+		}
+		else
+		{
+			m_readyOwners.push_back(owner);
+			m_condition.notify_one();
+		}
+	}
+}
+
+void TimerDispatcher::runTask(const DispatchTask &task)
+{
+	const static char fname[] = "TimerDispatcher::runTask() ";
+
+	if (m_metricDispatchLag)
+	{
+		auto lag = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - task.m_enqueueTime).count();
+		m_metricDispatchLag->metric().Set(lag);
+	}
+	try
+	{
+		task.m_task();
+	}
+	catch (const std::exception &ex)
+	{
+		LOG_WAR << fname << "got exception: " << ex.what();
+	}
+	catch (...)
+	{
+		LOG_WAR << fname << "exception";
+	}
+}
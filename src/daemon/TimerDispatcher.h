@@ -0,0 +1,84 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+class GaugeMetric;
+//////////////////////////////////////////////////////////////////////////
+/// Dispatch timer and process events to a thread pool
+/// Events are keyed by owner object (TimerHandler), events of one owner
+/// never run concurrently, different owners run in parallel.
+//////////////////////////////////////////////////////////////////////////
+class TimerDispatcher
+{
+	struct DispatchTask
+	{
+		std::function<void()> m_task;
+		std::chrono::steady_clock::time_point m_enqueueTime;
+	};
+
+public:
+	TimerDispatcher();
+	virtual ~TimerDispatcher();
+	static std::shared_ptr<TimerDispatcher> &instance();
+
+	/// <summary>
+	/// Start dispatch threads, events run in caller thread before started
+	/// </summary>
+	/// <param name="threadCount">dispatch thread number</param>
+	void start(std::size_t threadCount);
+	/// <summary>
+	/// Change dispatch thread number (TimerThreadPoolSize hot update),
+	/// extra threads exit after current event, not block caller
+	/// </summary>
+	/// <param name="threadCount">dispatch thread number</param>
+	void resize(std::size_t threadCount);
+	/// <summary>
+	/// Stop and join dispatch threads, pending events are dropped,
+	/// events run in caller thread after stopped
+	/// </summary>
+	void stop();
+	/// <summary>
+	/// Dispatch an event
+	/// </summary>
+	/// <param name="owner">owner object, events with same owner are serialized</param>
+	/// <param name="task">event function</param>
+	void dispatch(const void *owner, const std::function<void()> &task);
+	/// <summary>
+	/// Pending event number
+	/// </summary>
+	std::size_t queueDepth() const;
+
+private:
+	void runWorker();
+	void runTask(const DispatchTask &task);
+	// join threads already exited by resize, with m_mutex held
+	void joinRetired();
+
+private:
+	std::size_t m_threadCount;
+	std::size_t m_queueDepth;
+	std::vector<std::thread> m_threads;
+	// threads should exit for shrink
+	std::size_t m_retireCount;
+	// threads exited for shrink, to be joined
+	std::vector<std::thread::id> m_retiredThreads;
+	bool m_stopped;
+	// key: owner, value: pending events, key exists when the owner is queued or running
+	std::unordered_map<const void *, std::deque<DispatchTask>> m_ownerTasks;
+	// owners have pending events and not running
+	std::deque<const void *> m_readyOwners;
+	mutable std::mutex m_mutex;
+	std::condition_variable m_condition;
+
+	// Prometheus
+	std::shared_ptr<GaugeMetric> m_metricQueueDepth;
+	std::shared_ptr<GaugeMetric> m_metricDispatchLag;
+};
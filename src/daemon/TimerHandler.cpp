@@ -1,74 +1,114 @@
+#include <atomic>
+#include <cstdint>
+#include <cstring>
 
 #include <ace/OS.h>
 #include <ace/Reactor.h>
 #include <ace/Time_Value.h>
-#include <assert.h>
 
+#include "../common/TimerWheel.h"
 #include "../common/Utility.h"
+#include "TimerDispatcher.h"
 #include "TimerHandler.h"
 
-TimerHandler::TimerHandler()
-	: m_reactor(ACE_Reactor::instance())
-{
-}
-
-TimerHandler::~TimerHandler()
+// timing wheel resolution
+#define TIMER_WHEEL_TICK_MILLISECONDS 10
+
+//////////////////////////////////////////////////////////////////////////
+/// Drive timing wheel from ACE_Reactor one-shot timer,
+/// the timer is scheduled at the next tick which has work (TimerWheel::nextExpireTick),
+/// so reactor does not wake per tick when the nearest timer is far away.
+/// An earlier timer added later schedules another wakeup, the superseded one
+/// only advances the wheel (no lock shared with reactor thread, schedule_timer may wait reactor token).
+//////////////////////////////////////////////////////////////////////////
+class TimerWheelTicker : public ACE_Event_Handler
 {
-}
-
-int TimerHandler::handle_timeout(const ACE_Time_Value &current_time, const void *act)
-{
-	const static char fname[] = "TimerHandler::handle_timeout() ";
-
-	const int *timerIdPtr = static_cast<const int *>(act);
-	std::map<const int *, std::shared_ptr<TimerDefinition>> timers;
+public:
+	TimerWheelTicker(std::shared_ptr<TimerWheel> wheel, ACE_Reactor *reactor) : m_wheel(wheel), m_reactor(reactor), m_wakeTick(UINT64_MAX), m_generation(0) {}
+	/// <summary>
+	/// Schedule wakeup when the next tick with work is earlier than the scheduled one
+	/// </summary>
+	void arm()
 	{
-		// Should not hold this lock too long
-		std::lock_guard<std::recursive_mutex> guard(m_timerMutex);
-		timers = m_timers;
+		const auto next = m_wheel->nextExpireTick();
+		auto wake = m_wakeTick.load();
+		while (next < wake)
+		{
+			if (m_wakeTick.compare_exchange_weak(wake, next))
+			{
+				schedule(next);
+				return;
+			}
+		}
 	}
-
-	if (timers.find(timerIdPtr) == timers.end())
+	virtual int handle_timeout(const ACE_Time_Value &current_time, const void *act = 0) override
 	{
-		LOG_WAR << fname << "unrecognized Timer Id <" << *timerIdPtr << ">.";
-		// Remove this wrong timer
-		return -1;
+		m_wheel->advance();
+		// superseded by an earlier wakeup
+		if (reinterpret_cast<std::uintptr_t>(act) != m_generation.load())
+			return 0;
+		// a timer added before this reset is seen by arm() below, one added after schedules itself
+		m_wakeTick = UINT64_MAX;
+		arm();
+		return 0;
 	}
-	else
+
+private:
+	void schedule(uint64_t wakeTick)
 	{
-		auto timerDef = timers.find(timerIdPtr)->second;
-		timerDef->m_handler(*timerIdPtr);
-		if (timerDef->m_callOnce)
+		const static char fname[] = "TimerWheelTicker::schedule() ";
+		const auto generation = ++m_generation;
+		const auto nowTick = m_wheel->nowTick();
+		ACE_Time_Value delay;
+		delay.msec(static_cast<long>(wakeTick > nowTick ? (wakeTick - nowTick) * m_wheel->tickMillisecond() : 0));
+		if (m_reactor->schedule_timer(this, reinterpret_cast<const void *>(generation), delay) < 0)
 		{
-			LOG_DBG << fname << "one-time timer removed <" << *timerIdPtr << ">.";
-			std::lock_guard<std::recursive_mutex> guard(m_timerMutex);
-			m_timers.erase(timerIdPtr);
+			m_wakeTick = UINT64_MAX;
+			LOG_ERR << fname << "schedule tick timer failed with error: " << std::strerror(errno);
 		}
 	}
-	return 0;
+
+private:
+	std::shared_ptr<TimerWheel> m_wheel;
+	ACE_Reactor *m_reactor;
+	// tick of the latest scheduled wakeup, UINT64_MAX for none
+	std::atomic<uint64_t> m_wakeTick;
+	// only the latest scheduled wakeup re-arms
+	std::atomic<std::uintptr_t> m_generation;
+};
+
+TimerHandler::TimerHandler()
+	: m_reactor(ACE_Reactor::instance())
+{
+}
+
+TimerHandler::~TimerHandler()
+{
 }
 
 int TimerHandler::registerTimer(long int delayMillisecond, std::size_t intervalSeconds, const std::function<void(int)> &handler, const std::string &from)
 {
 	const static char fname[] = "TimerHandler::registerTimer() ";
 
-	bool callOnce = false;
-	ACE_Time_Value delay;
-	delay.msec(delayMillisecond);
-	ACE_Time_Value interval(intervalSeconds);
-	if (intervalSeconds == 0)
+	// hold this object until timer is cancelled or one-time timer triggered
+	auto self = this->shared_from_this();
+	const bool callOnce = (intervalSeconds == 0);
+	int timerId = 0;
 	{
-		interval = ACE_Time_Value::zero;
-		callOnce = true;
+		// hold lock to make sure timer id recorded before triggered
+		std::lock_guard<std::recursive_mutex> guard(m_timerMutex);
+		timerId = timerWheel()->add(delayMillisecond, 1000L * intervalSeconds, [self, handler, callOnce](int timerId) {
+			TimerDispatcher::instance()->dispatch(self.get(), [self, handler, callOnce, timerId]() {
+				if (self->checkTimer(timerId, callOnce))
+					handler(timerId);
+			});
+		});
+		m_timerIds.insert(timerId);
 	}
-
-	int *timerIdPtr = new int(0);
-	(*timerIdPtr) = m_reactor->schedule_timer(this, (void *)timerIdPtr, delay, interval);
-	std::lock_guard<std::recursive_mutex> guard(m_timerMutex);
-	assert(m_timers.find(timerIdPtr) == m_timers.end());
-	m_timers[timerIdPtr] = std::make_shared<TimerDefinition>(timerIdPtr, handler, this->shared_from_this(), callOnce);
-	LOG_DBG << fname << from << " register timer <" << *timerIdPtr << "> delay seconds <" << (delayMillisecond / 1000) << "> interval seconds <" << intervalSeconds << ">.";
-	return *timerIdPtr;
+	// schedule on reactor without timer lock, reactor thread may register timer of this object
+	armTicker(m_reactor);
+	LOG_DBG << fname << from << " register timer <" << timerId << "> delay seconds <" << (delayMillisecond / 1000) << "> interval seconds <" << intervalSeconds << ">.";
+	return timerId;
 }
 
 bool TimerHandler::cancelTimer(int &timerId)
@@ -77,19 +117,11 @@ bool TimerHandler::cancelTimer(int &timerId)
 
 	if (0 == timerId)
 		return false;
-	auto cancled = m_reactor->cancel_timer(timerId);
-	LOG_DBG << fname << "Timer <" << timerId << "> cancled <" << cancled << ">.";
-
 	std::lock_guard<std::recursive_mutex> guard(m_timerMutex);
-	auto it = std::find_if(m_timers.begin(), m_timers.end(),
-						   [timerId](std::map<const int *, std::shared_ptr<TimerDefinition>>::value_type const &pair) {
-							   return timerId == *(pair.first);
-						   });
-	if (it != m_timers.end())
-	{
-		m_timers.erase(it);
-		LOG_DBG << fname << "Timer removed <" << timerId << ">.";
-	}
+	// timer may already be triggered and waiting for dispatch
+	auto cancled = (m_timerIds.erase(timerId) > 0);
+	timerWheel()->cancel(timerId);
+	LOG_DBG << fname << "Timer <" << timerId << "> cancled <" << cancled << ">.";
 	timerId = 0;
 	return cancled;
 }
@@ -116,7 +148,32 @@ int TimerHandler::endReactorEvent(ACE_Reactor *reactor)
 	return reactor->end_reactor_event_loop();
 }
 
-TimerHandler::TimerDefinition::TimerDefinition(int *timerId, std::function<void(int)> handler, const std::shared_ptr<TimerHandler> object, bool callOnce)
-	: m_timerId(timerId), m_handler(handler), m_timerObject(object), m_callOnce(callOnce)
+bool TimerHandler::checkTimer(int timerId, bool callOnce)
+{
+	std::lock_guard<std::recursive_mutex> guard(m_timerMutex);
+	if (m_timerIds.count(timerId) == 0)
+		return false;
+	if (callOnce)
+		m_timerIds.erase(timerId);
+	return true;
+}
+
+std::shared_ptr<TimerWheel> &TimerHandler::timerWheel()
+{
+	static auto wheel = std::make_shared<TimerWheel>(TIMER_WHEEL_TICK_MILLISECONDS);
+	return wheel;
+}
+
+void TimerHandler::armTicker(ACE_Reactor *reactor)
 {
+	const static char fname[] = "TimerHandler::armTicker() ";
+
+	// the first reactor drives the wheel
+	static std::once_flag tickerFlag;
+	static std::unique_ptr<TimerWheelTicker> ticker;
+	std::call_once(tickerFlag, [reactor]() {
+		ticker.reset(new TimerWheelTicker(timerWheel(), reactor));
+		LOG_INF << fname << "timing wheel started with tick <" << TIMER_WHEEL_TICK_MILLISECONDS << "> milliseconds";
+	});
+	ticker->arm();
 }
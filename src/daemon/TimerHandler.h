@@ -1,40 +1,24 @@
 #pragma once
 
 #include <functional>
-#include <map>
 #include <memory>
 #include <mutex>
+#include <set>
 #include <string>
 
 #include <ace/Event_Handler.h>
 #include <ace/Reactor.h>
 
+class TimerWheel;
 //////////////////////////////////////////////////////////////////////////
 /// Timer Event base class
 /// The class which use timer event should implement from this class.
+/// All timers are managed by one hierarchical timing wheel, the wheel
+/// is driven by ACE_Reactor tick timer while it has pending timers, expired timers are executed
+/// by TimerDispatcher thread pool, timers of one object are serialized.
 //////////////////////////////////////////////////////////////////////////
 class TimerHandler : public ACE_Event_Handler, public std::enable_shared_from_this<TimerHandler>
 {
-private:
-	struct TimerDefinition
-	{
-		// timerId will be deleted in TimerDefinition de-construction
-		TimerDefinition(int *timerId, std::function<void(int)> handler, const std::shared_ptr<TimerHandler> object, bool callOnce);
-		const std::shared_ptr<int> m_timerId;
-		std::function<void(int)> m_handler;
-		const std::shared_ptr<TimerHandler> m_timerObject;
-		const bool m_callOnce;
-	};
-
-	/**
-	* Timer expire call back function, override from ACE
-	* Called when timer expires.  @a current_time represents the current
-	* time that the Event_Handler was selected for timeout
-	* dispatching and @a act is the asynchronous completion token that
-	* was passed in when <schedule_timer> was invoked.
-	*/
-	virtual int handle_timeout(const ACE_Time_Value &current_time, const void *act = 0) override final;
-
 public:
 	TimerHandler();
 	virtual ~TimerHandler();
@@ -64,8 +48,23 @@ public:
 	static int endReactorEvent(ACE_Reactor *reactor);
 
 private:
-	// key: timer ID point, must unique, value: function point
-	std::map<const int *, std::shared_ptr<TimerDefinition>> m_timers;
+	/// <summary>
+	/// Global timing wheel
+	/// </summary>
+	static std::shared_ptr<TimerWheel> &timerWheel();
+	/// <summary>
+	/// Schedule reactor wakeup at the next tick with work of the wheel,
+	/// no wakeup when the wheel becomes empty
+	/// </summary>
+	static void armTicker(ACE_Reactor *reactor);
+	/// <summary>
+	/// Check timer is not cancelled before execute, one-time timer is removed
+	/// </summary>
+	bool checkTimer(int timerId, bool callOnce);
+
+private:
+	// registered timer IDs
+	std::set<int> m_timerIds;
 
 protected:
 	// this reactor can be init as none-default one
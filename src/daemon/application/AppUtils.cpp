@@ -1,11 +1,20 @@
 #include "AppUtils.h"
 #include <ace/OS.h>
+#include <algorithm>
+#include <cstring>
+#include <dirent.h>
 #include <fstream>
+#include <limits>
+#include <map>
 #include <memory>
+#include <random>
+#include <sys/stat.h>
+#include <zlib.h>
 
 #include "../../common/Utility.h"
 #include "../../common/os/linux.hpp"
 #include "../Configuration.h"
+#include "LogArchiver.h"
 
 ShellAppFileGen::ShellAppFileGen(const std::string &name, const std::string &cmd, const std::string &workDir)
 {
@@ -41,25 +50,243 @@ ShellAppFileGen::~ShellAppFileGen()
 	Utility::removeFile(m_fileName);
 }
 
-AppLogFile::AppLogFile(const std::string &appName, int index)
-	: m_fileName(appName), m_index(index)
+// bytes between two line index checkpoints, also the read block size
+constexpr std::uint64_t LINE_INDEX_INTERVAL = 4 * 1024;
+// read and compress block size
+constexpr std::size_t LOG_FILE_BLOCK_SIZE = 64 * 1024;
+#define LOG_FILE_GZIP_SUFFIX ".gz"
+
+namespace
+{
+	// sequential reader of plain or gzip file, offset is counted on uncompressed content
+	class LogFileStream
+	{
+	public:
+		explicit LogFileStream(const std::string &file)
+			: m_gzip(AppLogFile::isCompressed(file)), m_gzFile(nullptr)
+		{
+			if (m_gzip)
+				m_gzFile = ::gzopen(file.c_str(), "rb");
+			else
+				m_stream.open(file, std::ios::in | std::ios::binary);
+		}
+		~LogFileStream()
+		{
+			if (m_gzFile)
+				::gzclose(m_gzFile);
+		}
+		bool good() const { return m_gzip ? m_gzFile != nullptr : m_stream.is_open(); }
+		// gzip seek is done by decompress from the start
+		bool seek(std::uint64_t offset)
+		{
+			if (m_gzip)
+				return ::gzseek(m_gzFile, offset, SEEK_SET) >= 0;
+			m_stream.seekg(offset, std::ios::beg);
+			return m_stream.good();
+		}
+		std::size_t read(char *buffer, std::size_t size)
+		{
+			if (m_gzip)
+			{
+				auto count = ::gzread(m_gzFile, buffer, size);
+				return count > 0 ? count : 0;
+			}
+			m_stream.read(buffer, size);
+			return m_stream.gcount();
+		}
+
+	private:
+		const bool m_gzip;
+		gzFile m_gzFile;
+		std::ifstream m_stream;
+	};
+
+	// rotated files of a base name in its directory (base.N and base.N.gz), key is sequence N.
+	// a sequence has both plain and gzip file when compress was interrupted, the gzip one is kept
+	std::map<int, std::string> listRotatedFiles(const std::string &baseFileName, std::vector<std::string> &duplicates)
+	{
+		std::map<int, std::string> result;
+		const auto slash = baseFileName.rfind('/');
+		const auto dirName = slash == std::string::npos ? std::string(".") : baseFileName.substr(0, slash + 1);
+		const auto prefix = (slash == std::string::npos ? baseFileName : baseFileName.substr(slash + 1)) + ".";
+		DIR *dir = ::opendir(dirName.c_str());
+		if (dir == nullptr)
+			return result;
+		struct dirent *entry = nullptr;
+		while ((entry = ::readdir(dir)) != nullptr)
+		{
+			const std::string name = entry->d_name;
+			if (name.compare(0, prefix.length(), prefix) != 0)
+				continue;
+			auto sequence = name.substr(prefix.length());
+			const bool compressed = AppLogFile::isCompressed(sequence);
+			if (compressed)
+				sequence = sequence.substr(0, sequence.length() - std::strlen(LOG_FILE_GZIP_SUFFIX));
+			if (sequence.empty() || sequence.length() > 9 || sequence.find_first_not_of("0123456789") != std::string::npos)
+				continue;
+			const auto file = slash == std::string::npos ? name : dirName + name;
+			const int index = std::stoi(sequence);
+			auto iter = result.find(index);
+			if (iter == result.end())
+			{
+				result[index] = file;
+			}
+			else if (compressed)
+			{
+				duplicates.push_back(iter->second);
+				iter->second = file;
+			}
+			else
+			{
+				duplicates.push_back(file);
+			}
+		}
+		::closedir(dir);
+		return result;
+	}
+} // namespace
+
+LineIndex::LineIndex()
+{
+	reset();
+}
+
+void LineIndex::reset()
+{
+	m_checkpoints.clear();
+	m_checkpoints.push_back(std::make_pair(0, 0));
+	m_indexedSize = 0;
+	m_inode = 0;
+	m_newLines = 0;
+	m_endWithNewLine = true;
+	m_complete = false;
+}
+
+std::uint64_t LineIndex::lineOffset(const std::string &file, std::uint64_t line)
+{
+	std::lock_guard<std::mutex> guard(m_mutex);
+	update(file);
+	return locate(file, line);
+}
+
+std::uint64_t LineIndex::tailOffset(const std::string &file, std::uint64_t lines)
+{
+	std::lock_guard<std::mutex> guard(m_mutex);
+	update(file);
+	const auto total = totalLines();
+	return locate(file, lines >= total ? 0 : total - lines);
+}
+
+std::uint64_t LineIndex::totalLines() const
+{
+	return m_newLines + (m_endWithNewLine ? 0 : 1);
+}
+
+void LineIndex::update(const std::string &file)
+{
+	const static char fname[] = "LineIndex::update() ";
+
+	struct stat st;
+	if (::stat(file.c_str(), &st) != 0)
+	{
+		reset();
+		return;
+	}
+	// compressed file is a new inode, offsets are the same but index again from compressed content
+	const bool compressed = AppLogFile::isCompressed(file);
+	const std::uint64_t fileSize = st.st_size;
+	if (st.st_ino != m_inode || (!compressed && fileSize < m_indexedSize))
+	{
+		reset();
+		m_inode = st.st_ino;
+	}
+	if (compressed ? m_complete : fileSize == m_indexedSize)
+		return;
+
+	LogFileStream stream(file);
+	if (!stream.good() || !stream.seek(m_indexedSize))
+	{
+		LOG_WAR << fname << "can not read file <" << file << ">";
+		return;
+	}
+	char buffer[LINE_INDEX_INTERVAL];
+	std::size_t size = 0;
+	while ((size = stream.read(buffer, sizeof(buffer))) > 0)
+	{
+		for (const char *pos = buffer, *end = buffer + size; (pos = static_cast<const char *>(std::memchr(pos, '\n', end - pos))) != nullptr; pos++)
+		{
+			m_newLines++;
+			const std::uint64_t lineBegin = m_indexedSize + (pos - buffer) + 1;
+			if (lineBegin - m_checkpoints.back().second >= LINE_INDEX_INTERVAL)
+				m_checkpoints.push_back(std::make_pair(m_newLines, lineBegin));
+		}
+		m_endWithNewLine = (buffer[size - 1] == '\n');
+		m_indexedSize += size;
+	}
+	m_complete = compressed;
+}
+
+std::uint64_t LineIndex::locate(const std::string &file, std::uint64_t line) const
+{
+	if (line >= totalLines())
+		return m_indexedSize;
+
+	// last checkpoint not after the line, then scan forward
+	auto checkpoint = std::upper_bound(m_checkpoints.begin(), m_checkpoints.end(), std::make_pair(line, std::numeric_limits<std::uint64_t>::max())) - 1;
+	auto currentLine = checkpoint->first;
+	auto offset = checkpoint->second;
+	if (currentLine == line)
+		return offset;
+
+	LogFileStream stream(file);
+	if (!stream.good() || !stream.seek(offset))
+		return m_indexedSize;
+	char buffer[LINE_INDEX_INTERVAL];
+	std::size_t size = 0;
+	while (offset < m_indexedSize && (size = stream.read(buffer, sizeof(buffer))) > 0)
+	{
+		for (const char *pos = buffer, *end = buffer + size; (pos = static_cast<const char *>(std::memchr(pos, '\n', end - pos))) != nullptr; pos++)
+		{
+			if (++currentLine == line)
+				return offset + (pos - buffer) + 1;
+		}
+		offset += size;
+	}
+	return m_indexedSize;
+}
+
+AppLogFile::AppLogFile(const std::string &baseFileName, int sequence, bool compressed)
+	: m_baseFileName(baseFileName), m_sequence(sequence), m_compressed(compressed), m_owned(true)
 {
 }
 
 AppLogFile::~AppLogFile()
 {
-	Utility::removeFile(getFileName());
+	if (owned())
+		Utility::removeFile(getFileName());
 }
 
-void AppLogFile::increaseIndex()
+void AppLogFile::setOwned(bool owned)
 {
-	const static char fname[] = "AppLogFile::increaseIndex() ";
+	std::lock_guard<std::mutex> guard(m_mutex);
+	m_owned = owned;
+}
 
-	auto oldFile = getFileName();
-	m_index++;
-	auto newFile = getFileName();
-	if (Utility::isFileExist(newFile))
-		Utility::removeFile(newFile);
+bool AppLogFile::owned() const
+{
+	std::lock_guard<std::mutex> guard(m_mutex);
+	return m_owned;
+}
+
+void AppLogFile::archive(int sequence)
+{
+	const static char fname[] = "AppLogFile::archive() ";
+
+	std::lock_guard<std::mutex> guard(m_mutex);
+	auto oldFile = m_baseFileName;
+	auto newFile = Utility::stringFormat("%s.%d", m_baseFileName.c_str(), sequence);
+	m_sequence = sequence;
+	// rename replace the target if exist
 	if (Utility::isFileExist(oldFile) && 0 != ACE_OS::rename(oldFile.c_str(), newFile.c_str()))
 	{
 		LOG_ERR << fname << "Rename file <" << oldFile << "> failed with error: " << std::strerror(errno);
@@ -70,64 +297,350 @@ void AppLogFile::increaseIndex()
 	}
 }
 
-int AppLogFile::index()
+bool AppLogFile::compress()
 {
-	return m_index;
+	const static char fname[] = "AppLogFile::compress() ";
+
+	std::string file;
+	{
+		std::lock_guard<std::mutex> guard(m_mutex);
+		if (m_compressed || m_sequence == 0)
+			return false;
+		file = Utility::stringFormat("%s.%d", m_baseFileName.c_str(), m_sequence);
+	}
+	if (!Utility::isFileExist(file))
+		return false;
+
+	const auto gzipFile = file + LOG_FILE_GZIP_SUFFIX;
+	const auto tmpFile = gzipFile + ".tmp";
+	std::ifstream input(file, std::ios::in | std::ios::binary);
+	gzFile output = ::gzopen(tmpFile.c_str(), "wb6");
+	if (!input.is_open() || output == nullptr)
+	{
+		LOG_WAR << fname << "Failed to open <" << file << "> for compress with error: " << std::strerror(errno);
+		if (output)
+			::gzclose(output);
+		Utility::removeFile(tmpFile);
+		return false;
+	}
+	std::unique_ptr<char[]> buffer(new char[LOG_FILE_BLOCK_SIZE]);
+	bool success = true;
+	while (success)
+	{
+		input.read(buffer.get(), LOG_FILE_BLOCK_SIZE);
+		const auto size = input.gcount();
+		if (size <= 0)
+			break;
+		success = ::gzwrite(output, buffer.get(), size) == size;
+	}
+	success = (::gzclose(output) == Z_OK) && success;
+	if (!success || 0 != ACE_OS::rename(tmpFile.c_str(), gzipFile.c_str()))
+	{
+		LOG_WAR << fname << "Failed to compress <" << file << "> with error: " << std::strerror(errno);
+		Utility::removeFile(tmpFile);
+		return false;
+	}
+	{
+		std::lock_guard<std::mutex> guard(m_mutex);
+		m_compressed = true;
+	}
+	Utility::removeFile(file);
+	LOG_DBG << fname << "file <" << gzipFile << "> compressed";
+	return true;
 }
 
 const std::string AppLogFile::getFileName() const
 {
-	if (m_index)
+	std::lock_guard<std::mutex> guard(m_mutex);
+	if (m_sequence)
 	{
-		return Utility::stringFormat("%s.%d", m_fileName.c_str(), m_index);
+		return Utility::stringFormat("%s.%d%s", m_baseFileName.c_str(), m_sequence, m_compressed ? LOG_FILE_GZIP_SUFFIX : "");
 	}
 	else
 	{
-		return m_fileName;
+		return m_baseFileName;
+	}
+}
+
+bool AppLogFile::compressed() const
+{
+	std::lock_guard<std::mutex> guard(m_mutex);
+	return m_compressed;
+}
+
+std::string AppLogFile::read(const std::string &file, std::uint64_t &offset, std::size_t length)
+{
+	const static char fname[] = "AppLogFile::read() ";
+
+	LogFileStream stream(file);
+	if (!stream.good())
+	{
+		LOG_ERR << fname << "can not open file <" << file << ">";
+		return std::string();
 	}
+	std::string result;
+	if (stream.seek(offset))
+	{
+		std::unique_ptr<char[]> buffer(new char[LOG_FILE_BLOCK_SIZE]);
+		std::size_t size = 0;
+		while ((length == 0 || result.length() < length) &&
+			   (size = stream.read(buffer.get(), length ? std::min(LOG_FILE_BLOCK_SIZE, length - result.length()) : LOG_FILE_BLOCK_SIZE)) > 0)
+		{
+			result.append(buffer.get(), size);
+		}
+	}
+	offset += result.length();
+	return result;
+}
+
+bool AppLogFile::isCompressed(const std::string &file)
+{
+	const std::string suffix = LOG_FILE_GZIP_SUFFIX;
+	return file.length() > suffix.length() && file.compare(file.length() - suffix.length(), suffix.length(), suffix) == 0;
 }
 
+std::mutex LogFileQueue::m_latestMutex;
+std::map<std::string, const LogFileQueue *> LogFileQueue::m_latestQueues;
+
 LogFileQueue::LogFileQueue(const std::string &baseFileName, int queueSize)
-	: baseFileName(baseFileName), m_queueSize(queueSize + 1)
+	: baseFileName(baseFileName), m_queueSize(queueSize + 1), m_sequence(0)
 {
+	const static char fname[] = "LogFileQueue::LogFileQueue() ";
+
+	{
+		std::lock_guard<std::mutex> guard(m_latestMutex);
+		m_latestQueues[baseFileName] = this;
+	}
+	// rotated files left by previous run are adopted as history (counted by disk budget and removed by rotation),
+	// sequence continues from the latest one
+	std::vector<std::string> duplicates;
+	const auto rotatedFiles = listRotatedFiles(baseFileName, duplicates);
+	for (const auto &file : duplicates)
+		Utility::removeFile(file);
+	if (rotatedFiles.empty())
+		return;
+	m_sequence = rotatedFiles.rbegin()->first;
+	for (auto iter = rotatedFiles.rbegin(); iter != rotatedFiles.rend(); ++iter)
+	{
+		if ((int)m_fileQueue.size() < m_queueSize - 1)
+		{
+			m_fileQueue.push_back(std::make_shared<AppLogFile>(baseFileName, iter->first, AppLogFile::isCompressed(iter->second)));
+			m_fileQueue.back()->setOwned(false);
+		}
+		else
+		{
+			Utility::removeFile(iter->second);
+		}
+	}
+	// current file is the front, it is rotated by the first enqueue, content of previous run is adopted as well
+	m_fileQueue.push_front(std::make_shared<AppLogFile>(baseFileName));
+	if (Utility::isFileExist(baseFileName))
+		m_fileQueue.front()->setOwned(false);
+	LOG_INF << fname << "adopted <" << m_fileQueue.size() - 1 << "> rotated files of <" << baseFileName << ">, sequence <" << m_sequence << ">";
 }
 
 LogFileQueue::~LogFileQueue()
 {
-	// double check and remove file
-	for (int i = 0; i < m_queueSize; i++)
+	bool replaced = true;
+	{
+		std::lock_guard<std::mutex> guard(m_latestMutex);
+		auto iter = m_latestQueues.find(baseFileName);
+		if (iter != m_latestQueues.end() && iter->second == this)
+		{
+			m_latestQueues.erase(iter);
+			replaced = false;
+		}
+	}
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	// files are adopted by the newer queue, keep all of them
+	if (replaced)
 	{
-		AppLogFile autoDeleteFile(baseFileName, i);
+		for (const auto &file : m_fileQueue)
+			file->setOwned(false);
 	}
+	// owned files are removed by AppLogFile destructor (unless still referenced by LogArchiver)
+	m_fileQueue.clear();
 }
 
 void LogFileQueue::enqueue()
 {
-	// rename all with reverse order
-	for (auto it = m_fileQueue.rbegin(); it != m_fileQueue.rend(); it++)
+	std::shared_ptr<AppLogFile> rotated;
 	{
-		(*it)->increaseIndex();
+		std::lock_guard<std::recursive_mutex> guard(m_mutex);
+		rotated = rotateLocked();
+	}
+	LogArchiver::instance()->rotated(rotated);
+}
+
+bool LogFileQueue::rotate(std::weak_ptr<AppLogFile> &current)
+{
+	std::shared_ptr<AppLogFile> rotated;
+	{
+		std::lock_guard<std::recursive_mutex> guard(m_mutex);
+		if (m_fileQueue.empty() || m_fileQueue.front() != current.lock())
+		{
+			return false;
+		}
+		rotated = rotateLocked();
+		current = m_fileQueue.front();
+	}
+	LogArchiver::instance()->rotated(rotated);
+	return true;
+}
+
+std::shared_ptr<AppLogFile> LogFileQueue::rotateLocked()
+{
+	// only the current file is renamed, history files keep their sequence names
+	std::shared_ptr<AppLogFile> rotated;
+	if (!m_fileQueue.empty())
+	{
+		rotated = m_fileQueue.front();
+		rotated->archive(++m_sequence);
 	}
 	// pop last
 	if (this->size() >= m_queueSize)
 	{
+		m_fileQueue.back()->setOwned(true);
 		m_fileQueue.pop_back();
 	}
 	// insert top
-	auto file = std::make_shared<AppLogFile>(baseFileName);
-	m_fileQueue.insert(m_fileQueue.begin(), file);
+	m_fileQueue.push_front(std::make_shared<AppLogFile>(baseFileName));
+	return m_queueSize > 1 ? rotated : nullptr;
+}
+
+std::shared_ptr<AppLogFile> LogFileQueue::current()
+{
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	return m_fileQueue.empty() ? nullptr : m_fileQueue.front();
 }
 
 int LogFileQueue::size()
 {
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
 	return m_fileQueue.size();
 }
 
-const std::string LogFileQueue::getFileName(int index)
+std::shared_ptr<AppLogFile> LogFileQueue::getFile(int index)
 {
-	if (index <= size() - 1)
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	if (index >= 0 && index <= size() - 1)
 	{
-		return m_fileQueue[index]->getFileName();
+		return m_fileQueue[index];
 	}
 	throw std::invalid_argument(Utility::stringFormat("no such index <%d> of stdout file exist", index));
 }
+
+const std::string LogFileQueue::getFileName(int index)
+{
+	return getFile(index)->getFileName();
+}
+
+bool LogFileQueue::isCompressed(int index)
+{
+	return getFile(index)->compressed();
+}
+
+std::string LogFileQueue::read(int index, std::uint64_t &offset, std::size_t length)
+{
+	return AppLogFile::read(getFileName(index), offset, length);
+}
+
+std::uint64_t LogFileQueue::getLineOffset(int index, std::uint64_t line)
+{
+	auto file = getFile(index);
+	return file->lineIndex().lineOffset(file->getFileName(), line);
+}
+
+std::uint64_t LogFileQueue::getTailOffset(int index, std::uint64_t lines)
+{
+	auto file = getFile(index);
+	return file->lineIndex().tailOffset(file->getFileName(), lines);
+}
+
+std::vector<std::shared_ptr<AppLogFile>> LogFileQueue::getHistoryFiles()
+{
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	return std::vector<std::shared_ptr<AppLogFile>>(m_fileQueue.size() > 1 ? m_fileQueue.begin() + 1 : m_fileQueue.end(), m_fileQueue.end());
+}
+
+void LogFileQueue::remove(const std::shared_ptr<AppLogFile> &file)
+{
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	// current file is never removed
+	auto iter = std::find(m_fileQueue.begin(), m_fileQueue.end(), file);
+	if (iter != m_fileQueue.end() && iter != m_fileQueue.begin())
+	{
+		file->setOwned(true);
+		m_fileQueue.erase(iter);
+	}
+}
+
+RestartTokenBucket::RestartTokenBucket()
+	: m_tokens(-1), m_lastRefill(std::chrono::steady_clock::now())
+{
+}
+
+std::shared_ptr<RestartTokenBucket> &RestartTokenBucket::instance()
+{
+	static auto singleton = std::make_shared<RestartTokenBucket>();
+	return singleton;
+}
+
+bool RestartTokenBucket::acquire(int ratePerSecond, int burst)
+{
+	if (ratePerSecond <= 0)
+		return true;
+
+	std::lock_guard<std::mutex> guard(m_mutex);
+	const auto now = std::chrono::steady_clock::now();
+	// start full
+	if (m_tokens < 0)
+		m_tokens = burst;
+	m_tokens = std::min<double>(burst, m_tokens + std::chrono::duration<double>(now - m_lastRefill).count() * ratePerSecond);
+	m_lastRefill = now;
+	if (m_tokens < 1)
+		return false;
+	m_tokens -= 1;
+	return true;
+}
+
+RestartWindow::RestartWindow()
+{
+}
+
+bool RestartWindow::allow(const std::chrono::system_clock::time_point &now, std::chrono::seconds window, size_t maxStarts, std::chrono::system_clock::time_point &retryTime)
+{
+	while (m_starts.size() && now - m_starts.front() >= window)
+		m_starts.pop_front();
+	if (maxStarts > 0 && m_starts.size() >= maxStarts)
+	{
+		// window or max may be decreased by hot update, wait for enough restarts to leave
+		retryTime = m_starts[m_starts.size() - maxStarts] + window;
+		return false;
+	}
+	return true;
+}
+
+void RestartWindow::record(const std::chrono::system_clock::time_point &now)
+{
+	m_starts.push_back(now);
+}
+
+size_t RestartWindow::size() const
+{
+	return m_starts.size();
+}
+
+std::chrono::milliseconds restartBackoff(int continueFails, int baseSeconds, int maxSeconds)
+{
+	if (continueFails <= 0)
+		return std::chrono::milliseconds(0);
+
+	// avoid overflow, 2^20 seconds is far beyond any max
+	const auto exponent = std::min(continueFails - 1, 20);
+	const auto delayMs = std::min<long long>(1000LL * baseSeconds << exponent, 1000LL * maxSeconds);
+	// jitter spread restarts of apps crashed at the same time
+	static thread_local std::mt19937 generator(std::random_device{}());
+	std::uniform_int_distribution<long long> distribution(delayMs / 2, delayMs);
+	return std::chrono::milliseconds(distribution(generator));
+}
@@ -1,6 +1,10 @@
 #pragma once
 
+#include <chrono>
+#include <deque>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -21,40 +25,196 @@ private:
 };
 
 /// <summary>
-/// One application log file
+/// Sparse line offset index of a growing file, one checkpoint (line number, offset) every 4KB,
+/// content appended since last query is indexed incrementally, a file truncated or replaced is re-indexed.
+/// Line number is 0 based, offset is counted on uncompressed content.
+/// </summary>
+class LineIndex
+{
+public:
+	LineIndex();
+	/// <summary>
+	/// Offset of the line, file size for line beyond the end
+	/// </summary>
+	std::uint64_t lineOffset(const std::string &file, std::uint64_t line);
+	/// <summary>
+	/// Offset of the last N lines, an unterminated last line is counted
+	/// </summary>
+	std::uint64_t tailOffset(const std::string &file, std::uint64_t lines);
+
+private:
+	void update(const std::string &file);
+	void reset();
+	std::uint64_t totalLines() const;
+	std::uint64_t locate(const std::string &file, std::uint64_t line) const;
+
+private:
+	std::mutex m_mutex;
+	// checkpoint: <line number, offset of the line>
+	std::vector<std::pair<std::uint64_t, std::uint64_t>> m_checkpoints;
+	std::uint64_t m_indexedSize;
+	std::uint64_t m_inode;
+	// number of '\n' in indexed content
+	std::uint64_t m_newLines;
+	bool m_endWithNewLine;
+	// compressed file is immutable, indexed once
+	bool m_complete;
+};
+
+/// <summary>
+/// One application log file, the current one use the base name,
+/// a rotated one use base name with sequence suffix and can be gzip compressed.
 /// </summary>
 struct AppLogFile
 {
 public:
-	explicit AppLogFile(const std::string &appName, int index = 0);
+	explicit AppLogFile(const std::string &baseFileName, int sequence = 0, bool compressed = false);
 	virtual ~AppLogFile();
-	void increaseIndex();
-	int index();
+	/// <summary>
+	/// Rename the current file to rotated name with sequence
+	/// </summary>
+	void archive(int sequence);
+	/// <summary>
+	/// Compress rotated file to .gz, the plain file is removed
+	/// </summary>
+	/// <returns>true for compressed</returns>
+	bool compress();
 	const std::string getFileName() const;
+	bool compressed() const;
+	/// <summary>
+	/// Owned file is removed when this object is destructed, a file adopted from previous run or
+	/// handed over to a newer queue is not owned, a file dropped from queue (rotation or disk budget) is owned again.
+	/// </summary>
+	void setOwned(bool owned);
+	bool owned() const;
+	// line index follows the file when renamed
+	LineIndex &lineIndex() { return m_lineIndex; }
+
+	/// <summary>
+	/// Read at most length bytes from offset (0 for to the end), offset is moved to the next position,
+	/// gzip file is decompressed
+	/// </summary>
+	static std::string read(const std::string &file, std::uint64_t &offset, std::size_t length);
+	static bool isCompressed(const std::string &file);
 
 private:
-	std::string m_fileName;
-	int m_index;
+	mutable std::mutex m_mutex;
+	const std::string m_baseFileName;
+	int m_sequence;
+	bool m_compressed;
+	bool m_owned;
+	LineIndex m_lineIndex;
 };
 
 /// <summary>
-/// Manage stdout log files for an application
+/// Manage stdout log files for an application,
+/// index 0 is the current file, rotation is one rename and the oldest file is removed when full.
+/// Rotated files (base.N, base.N.gz) left by previous run are adopted on construction,
+/// only files created by this queue are removed on destruction, adopted files are kept.
+/// A queue replaced by a newer one of the same base file (application re-registered) removes nothing,
+/// the newer queue adopts all of them.
 /// </summary>
 class LogFileQueue
 {
 public:
 	explicit LogFileQueue(const std::string &baseFileName, int queueSize);
 	virtual ~LogFileQueue();
+	/// <summary>
+	/// Rotate the current file to history and start a new current file
+	/// </summary>
 	void enqueue();
+	/// <summary>
+	/// Rotate only when current file is still the expected one (not rotated by others),
+	/// used by running process capture, current is updated to the new file.
+	/// </summary>
+	/// <returns>false for current file was changed</returns>
+	bool rotate(std::weak_ptr<AppLogFile> &current);
+	std::shared_ptr<AppLogFile> current();
 	int size();
 	const std::string getFileName(int index);
+	bool isCompressed(int index);
+	std::string read(int index, std::uint64_t &offset, std::size_t length);
+	// offset of a line (0 based) in file of index
+	std::uint64_t getLineOffset(int index, std::uint64_t line);
+	// offset of the last N lines in file of index
+	std::uint64_t getTailOffset(int index, std::uint64_t lines);
+
+	// rotated files (index > 0)
+	std::vector<std::shared_ptr<AppLogFile>> getHistoryFiles();
+	// remove a rotated file from queue (file deleted)
+	void remove(const std::shared_ptr<AppLogFile> &file);
 
 private:
-	std::vector<std::shared_ptr<AppLogFile>> m_fileQueue;
+	std::shared_ptr<AppLogFile> rotateLocked();
+	std::shared_ptr<AppLogFile> getFile(int index);
+
+private:
+	std::recursive_mutex m_mutex;
+	std::deque<std::shared_ptr<AppLogFile>> m_fileQueue;
 	const std::string baseFileName;
 	const int m_queueSize;
+	int m_sequence;
+	// latest queue of each base file name
+	static std::mutex m_latestMutex;
+	static std::map<std::string, const LogFileQueue *> m_latestQueues;
+};
+
+/// <summary>
+/// Host wide restart rate limit for crashed applications,
+/// token bucket refilled by RestartRateLimit per second up to RestartBurst tokens.
+/// </summary>
+class RestartTokenBucket
+{
+public:
+	RestartTokenBucket();
+	static std::shared_ptr<RestartTokenBucket> &instance();
+	/// <summary>
+	/// Take one token for a restart
+	/// </summary>
+	/// <param name="ratePerSecond">refill rate, 0 for unlimited</param>
+	/// <param name="burst">bucket capacity</param>
+	/// <returns>false when no token, restart should be retried later</returns>
+	bool acquire(int ratePerSecond, int burst);
+
+private:
+	std::mutex m_mutex;
+	double m_tokens;
+	std::chrono::steady_clock::time_point m_lastRefill;
 };
 
+/// <summary>
+/// Restart budget of an application in a sliding window,
+/// only restarts after failures are recorded so that
+/// at most maxStarts such restarts happen in any window.
+/// Window and max are passed per check (RestartWindowSeconds, RestartWindowMax), hot update take effect at once.
+/// </summary>
+class RestartWindow
+{
+public:
+	RestartWindow();
+	/// <summary>
+	/// Check whether one more restart fits into the window
+	/// </summary>
+	/// <param name="now">current time, expired restarts are dropped</param>
+	/// <param name="window">window length</param>
+	/// <param name="maxStarts">restarts allowed in a window, 0 for unlimited</param>
+	/// <param name="retryTime">when budget exhausted, the time one restart leaves the window</param>
+	/// <returns>false when budget exhausted</returns>
+	bool allow(const std::chrono::system_clock::time_point &now, std::chrono::seconds window, size_t maxStarts, std::chrono::system_clock::time_point &retryTime);
+	void record(const std::chrono::system_clock::time_point &now);
+	size_t size() const;
+
+private:
+	std::deque<std::chrono::system_clock::time_point> m_starts;
+};
+
+/// <summary>
+/// Restart delay after continuous failures, exponential with equal jitter:
+/// random in [delay/2, delay], delay = min(base * 2^(fails-1), max)
+/// </summary>
+/// <returns>0 for no failure</returns>
+std::chrono::milliseconds restartBackoff(int continueFails, int baseSeconds, int maxSeconds);
+
 /// <summary>
 /// Application status
 /// </summary>
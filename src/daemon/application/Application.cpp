@@ -1,26 +1,36 @@
 #include <algorithm>
 #include <assert.h>
+#include <csignal>
 
 #include "../../common/DateTime.h"
 #include "../../common/Utility.h"
 #include "../../prom_exporter/counter.h"
 #include "../../prom_exporter/gauge.h"
+#include "../../prom_exporter/histogram.h"
 #include "../Configuration.h"
 #include "../DailyLimitation.h"
 #include "../ResourceCollection.h"
 #include "../ResourceLimitation.h"
 #include "../process/AppProcess.h"
+#include "../process/ContainerStats.h"
+#include "../process/DockerImageManager.h"
 #include "../process/DockerProcess.h"
+#include "../process/LaunchPlan.h"
+#include "../process/LinuxCgroup.h"
 #include "../process/MonitoredProcess.h"
+#include "../process/OutputCapture.h"
 #include "../rest/PrometheusRest.h"
 #include "../security/User.h"
 #include "Application.h"
+#include "LogArchiver.h"
 
 Application::Application()
 	: m_status(STATUS::ENABLED), m_ownerPermission(0), m_shellApp(false), m_stdoutCacheNum(0),
-	  m_endTimerId(0), m_health(true), m_appId(Utility::createUUID()),
+	  m_endTimerId(0), m_health(true), m_healthCheckInterval(0), m_healthCheckTimeout(0), m_healthCheckHttpStatus(0),
+	  m_stopSignal(DEFAULT_APP_STOP_SIGNAL), m_stopTimeout(DEFAULT_APP_STOP_TIMEOUT), m_appId(Utility::createUUID()),
 	  m_version(0), m_process(new AppProcess()), m_pid(ACE_INVALID_PID),
-	  m_suicideTimerId(0), m_metricStartCount(nullptr), m_metricMemory(nullptr), m_continueFails(0)
+	  m_suicideTimerId(0),
+	  m_metricStartCount(nullptr), m_metricMemory(nullptr), m_continueFails(0)
 {
 	const static char fname[] = "Application::Application() ";
 	LOG_DBG << fname << "Entered.";
@@ -60,6 +70,9 @@ bool Application::operator==(const std::shared_ptr<Application> &app)
 			this->m_workdir == app->m_workdir &&
 			this->m_stdoutFile == app->m_stdoutFile &&
 			this->m_healthCheckCmd == app->m_healthCheckCmd &&
+			this->m_healthCheckInterval == app->m_healthCheckInterval &&
+			this->m_healthCheckTimeout == app->m_healthCheckTimeout &&
+			this->m_healthCheckHttpStatus == app->m_healthCheckHttpStatus &&
 			this->m_startTime == app->m_startTime &&
 			this->m_endTime == app->m_endTime &&
 			this->m_status == app->m_status);
@@ -96,6 +109,7 @@ void Application::FromJson(std::shared_ptr<Application> &app, const web::json::v
 	app->m_stdoutFile = Utility::stringFormat("appmesh.%s.out", app->m_name.c_str());
 	app->m_stdoutCacheNum = GET_JSON_INT_VALUE(jsonObj, JSON_KEY_APP_stdout_cache_num);
 	app->m_stdoutFileQueue = std::make_shared<LogFileQueue>(app->m_stdoutFile, app->m_stdoutCacheNum);
+	LogArchiver::instance()->watch(app->m_stdoutFileQueue);
 	if (app->m_commandLine.length() >= MAX_COMMAND_LINE_LENGTH)
 		throw std::invalid_argument("command line length should less than 2048");
 	app->m_commandLineInit = Utility::stdStringTrim(GET_JSON_STR_VALUE(jsonObj, JSON_KEY_APP_init_command));
@@ -103,6 +117,17 @@ void Application::FromJson(std::shared_ptr<Application> &app, const web::json::v
 	app->m_healthCheckCmd = Utility::stdStringTrim(GET_JSON_STR_VALUE(jsonObj, JSON_KEY_APP_health_check_cmd));
 	if (app->m_healthCheckCmd.length() >= MAX_COMMAND_LINE_LENGTH)
 		throw std::invalid_argument("health check length should less than 2048");
+	app->m_healthCheckInterval = GET_JSON_INT_VALUE(jsonObj, JSON_KEY_APP_health_check_interval);
+	app->m_healthCheckTimeout = GET_JSON_INT_VALUE(jsonObj, JSON_KEY_APP_health_check_timeout);
+	app->m_healthCheckHttpStatus = GET_JSON_INT_VALUE(jsonObj, JSON_KEY_APP_health_check_http_status);
+	if (app->m_healthCheckInterval < 0 || app->m_healthCheckTimeout < 0)
+		throw std::invalid_argument("health check interval and timeout should not be negative");
+	if (HAS_JSON_FIELD(jsonObj, JSON_KEY_APP_stop_signal))
+		app->m_stopSignal = GET_JSON_INT_VALUE(jsonObj, JSON_KEY_APP_stop_signal);
+	if (HAS_JSON_FIELD(jsonObj, JSON_KEY_APP_stop_timeout))
+		app->m_stopTimeout = GET_JSON_INT_VALUE(jsonObj, JSON_KEY_APP_stop_timeout);
+	if (app->m_stopSignal <= 0 || app->m_stopSignal >= NSIG || app->m_stopTimeout < 0)
+		throw std::invalid_argument("stop signal should be a valid signal number and stop timeout should not be negative");
 	app->m_workdir = Utility::stdStringTrim(GET_JSON_STR_VALUE(jsonObj, JSON_KEY_APP_working_dir));
 	if (HAS_JSON_FIELD(jsonObj, JSON_KEY_APP_status))
 	{
@@ -154,6 +179,11 @@ void Application::FromJson(std::shared_ptr<Application> &app, const web::json::v
 	{
 		app->m_regTime = DateTime::parseISO8601DateTime(GET_JSON_STR_VALUE(jsonObj, JSON_KEY_APP_REG_TIME), "");
 	}
+	// compile launch plan with app definition, shell mode command is generated at first start
+	if (!app->m_shellApp && app->m_dockerImage.empty() && Configuration::instance())
+	{
+		app->m_launchPlan = LaunchPlan::compile(app->m_commandLine, app->getExecUser(), app->m_workdir, app->m_envMap);
+	}
 }
 
 void Application::refreshPid()
@@ -162,25 +192,34 @@ void Application::refreshPid()
 	// Try to get return code.
 	if (m_process != nullptr)
 	{
+		bool exited = false;
 		if (m_process->running())
 		{
 			m_pid = m_process->getpid();
-			ACE_Time_Value tv;
-			tv.msec(10);
-			int ret = m_process->wait(tv);
+			// exit status is collected by ProcessReaper, no need block here
+			int ret = m_process->waitExit(ACE_Time_Value::zero);
 			if (ret > 0)
 			{
-				m_return = std::make_shared<int>(m_process->return_value());
+				exited = true;
+				m_return = std::make_shared<int>(m_process->returnValue());
 				m_pid = ACE_INVALID_PID;
 				setLastError(Utility::stringFormat("exited with return code: %d, error: %s", *m_return, m_process->startError().c_str()));
 			}
 		}
 		else if (m_pid > 0)
 		{
-			m_return = std::make_shared<int>(m_process->return_value());
+			// make sure exit status published by ProcessReaper
+			m_process->waitExit(ACE_Time_Value::zero);
+			exited = true;
+			m_return = std::make_shared<int>(m_process->returnValue());
 			m_pid = ACE_INVALID_PID;
 			setLastError(Utility::stringFormat("exited with return code: %d, error: %s", *m_return, m_process->startError().c_str()));
 		}
+		if (exited)
+			m_procExitTime = std::chrono::system_clock::now();
+		// stopped by stop policy
+		if (exited && m_metricStopDuration && m_process->stopTime().time_since_epoch().count())
+			m_metricStopDuration->metric().Observe(std::chrono::duration<double>(std::chrono::system_clock::now() - m_process->stopTime()).count());
 		checkAndUpdateHealth();
 	}
 
@@ -188,8 +227,133 @@ void Application::refreshPid()
 	{
 		if (m_metricMemory)
 			m_metricMemory->metric().Set(ResourceCollection::instance()->getRssMemory(m_pid));
+		if (m_metricCgroupMemory)
+			m_metricCgroupMemory->metric().Set(std::max(m_process->cgroupMemoryUsage(), 0LL));
+		if (m_metricCgroupCpu)
+			m_metricCgroupCpu->setTotal(m_process->cgroupCpuUsage() / 1e9);
 		if (m_metricAppPid)
 			m_metricAppPid->metric().Set(m_pid);
+		if (m_metricContinueFails)
+			m_metricContinueFails->metric().Set(m_continueFails);
+		if (m_metricRestartBackoff)
+			m_metricRestartBackoff->metric().Set(std::max(std::chrono::duration<double>(m_nextRestartTime - std::chrono::system_clock::now()).count(), 0.0));
+		updateContainerMetrics();
+	}
+}
+
+bool Application::restartAllowed()
+{
+	const static char fname[] = "Application::restartAllowed() ";
+
+	std::lock_guard<std::recursive_mutex> guard(m_appMutex);
+	const auto now = std::chrono::system_clock::now();
+	// first start
+	if (!m_procExitTime.time_since_epoch().count())
+		return true;
+
+	// evaluate the last exit once, quick exit is a failure, stop by stop policy is not
+	if (m_nextRestartTime < m_procExitTime)
+	{
+		const bool stopped = m_process->stopTime().time_since_epoch().count() > 0;
+		if (!stopped && m_procExitTime - m_procStartTime < std::chrono::seconds(DEFAULT_RESTART_STABLE_SECONDS))
+			m_continueFails++;
+		else
+			m_continueFails = 0;
+		m_nextRestartTime = m_procExitTime + restartBackoff(m_continueFails, DEFAULT_RESTART_BACKOFF_SECONDS, DEFAULT_RESTART_BACKOFF_MAX_SECONDS);
+		if (m_continueFails > 0)
+			LOG_WAR << fname << "Application <" << m_name << "> exited <" << m_continueFails << "> times continuously, restart after " << DateTime::formatISO8601Time(m_nextRestartTime);
+	}
+	if (now < m_nextRestartTime)
+		return false;
+
+	// restart budget of window, only restart after failure is counted (not manual start or restart after stable run)
+	const bool failed = m_continueFails > 0;
+	const auto window = std::chrono::seconds(Configuration::instance()->getRestartWindowSeconds());
+	if (failed && !m_restartWindow.allow(now, window, Configuration::instance()->getRestartWindowMax(), m_nextRestartTime))
+	{
+		LOG_WAR << fname << "Application <" << m_name << "> restarted <" << m_restartWindow.size() << "> times after failure in <" << window.count() << "> seconds, restart after " << DateTime::formatISO8601Time(m_nextRestartTime);
+		return false;
+	}
+	// host wide rate, retry next schedule
+	if (!RestartTokenBucket::instance()->acquire(Configuration::instance()->getRestartRateLimit(), Configuration::instance()->getRestartBurst()))
+	{
+		LOG_DBG << fname << "Application <" << m_name << "> restart is limited by host restart rate";
+		return false;
+	}
+	if (failed)
+		m_restartWindow.record(now);
+	return true;
+}
+
+void Application::stopProcess()
+{
+	std::lock_guard<std::recursive_mutex> guard(m_appMutex);
+	if (m_process->running())
+		m_process->stop(m_stopSignal, m_stopTimeout);
+}
+
+void Application::updateContainerMetrics()
+{
+	auto prom = PrometheusRest::instance();
+	auto stats = m_process->containerStats();
+	auto containerId = stats ? m_process->containerId() : std::string();
+	if (containerId != m_metricContainerId)
+	{
+		m_metricContainer.clear();
+		m_metricContainerTotal.clear();
+		m_metricContainerId = containerId;
+		if (prom && containerId.length())
+		{
+			const std::map<std::string, std::string> labels = {{"application", getName()}, {"id", m_appId}, {"container_id", containerId}};
+			const std::map<std::string, std::string> gauges = {
+				{PROM_METRIC_NAME_appmesh_container_memory_bytes, PROM_METRIC_HELP_appmesh_container_memory_bytes},
+				{PROM_METRIC_NAME_appmesh_container_memory_cache_bytes, PROM_METRIC_HELP_appmesh_container_memory_cache_bytes}};
+			// cumulative since container start
+			const std::map<std::string, std::string> counters = {
+				{PROM_METRIC_NAME_appmesh_container_cpu_seconds, PROM_METRIC_HELP_appmesh_container_cpu_seconds},
+				{PROM_METRIC_NAME_appmesh_container_block_read_bytes, PROM_METRIC_HELP_appmesh_container_block_read_bytes},
+				{PROM_METRIC_NAME_appmesh_container_block_write_bytes, PROM_METRIC_HELP_appmesh_container_block_write_bytes},
+				{PROM_METRIC_NAME_appmesh_container_network_receive_bytes, PROM_METRIC_HELP_appmesh_container_network_receive_bytes},
+				{PROM_METRIC_NAME_appmesh_container_network_transmit_bytes, PROM_METRIC_HELP_appmesh_container_network_transmit_bytes}};
+			for (const auto &metric : gauges)
+			{
+				auto gauge = prom->createPromGauge(metric.first, metric.second, labels);
+				if (gauge)
+					m_metricContainer[metric.first] = gauge;
+			}
+			for (const auto &metric : counters)
+			{
+				auto counter = prom->createPromCounter(metric.first, metric.second, labels);
+				if (counter)
+					m_metricContainerTotal[metric.first] = counter;
+			}
+		}
+	}
+	if (m_metricContainer.empty() && m_metricContainerTotal.empty())
+		return;
+
+	// one read of each statistics file per interval
+	const auto sample = stats->sample();
+	const std::map<std::string, double> values = {
+		{PROM_METRIC_NAME_appmesh_container_memory_bytes, sample.m_memoryBytes},
+		{PROM_METRIC_NAME_appmesh_container_memory_cache_bytes, sample.m_memoryCacheBytes}};
+	for (const auto &value : values)
+	{
+		auto metric = m_metricContainer.find(value.first);
+		if (metric != m_metricContainer.end() && value.second >= 0)
+			metric->second->metric().Set(value.second);
+	}
+	const std::map<std::string, double> totals = {
+		{PROM_METRIC_NAME_appmesh_container_cpu_seconds, sample.m_cpuNanoSeconds / 1e9},
+		{PROM_METRIC_NAME_appmesh_container_block_read_bytes, sample.m_blockReadBytes},
+		{PROM_METRIC_NAME_appmesh_container_block_write_bytes, sample.m_blockWriteBytes},
+		{PROM_METRIC_NAME_appmesh_container_network_receive_bytes, sample.m_networkRxBytes},
+		{PROM_METRIC_NAME_appmesh_container_network_transmit_bytes, sample.m_networkTxBytes}};
+	for (const auto &total : totals)
+	{
+		auto metric = m_metricContainerTotal.find(total.first);
+		if (metric != m_metricContainerTotal.end())
+			metric->second->setTotal(total.second);
 	}
 }
 
@@ -215,12 +379,15 @@ void Application::invoke()
 		std::lock_guard<std::recursive_mutex> guard(m_appMutex);
 		if (this->available())
 		{
-			if (!m_process->running())
+			if (!m_process->running() && !predecessorRunning() && restartAllowed())
 			{
 				LOG_INF << fname << "Starting application <" << m_name << "> with user: " << getExecUser();
 				m_process = allocProcess(false, m_dockerImage, m_name);
 				m_procStartTime = std::chrono::system_clock::now();
-				m_pid = m_process->spawnProcess(getCmdLine(), getExecUser(), m_workdir, m_envMap, m_resourceLimit, m_stdoutFile, m_metadata);
+				m_pid = spawnProcess();
+				// spawn failure is an exit for restart backoff
+				if (m_pid <= 0)
+					m_procExitTime = m_procStartTime;
 				setLastError(m_process->startError());
 				if (m_metricStartCount)
 					m_metricStartCount->metric().Increment();
@@ -229,7 +396,7 @@ void Application::invoke()
 		else if (m_process->running())
 		{
 			LOG_INF << fname << "Application <" << m_name << "> was not in start time";
-			m_process->killgroup();
+			stopProcess();
 			setInvalidError();
 		}
 	}
@@ -241,6 +408,13 @@ void Application::invoke()
 	refreshPid();
 }
 
+void Application::onProcessExitEvent()
+{
+	// collect return code first, otherwise the zombie process still be treated as running
+	refreshPid();
+	invoke();
+}
+
 void Application::invokeNow(int timerId)
 {
 	Application::invoke();
@@ -258,7 +432,7 @@ void Application::disable()
 		LOG_INF << fname << "Application <" << m_name << "> disabled.";
 	}
 	if (m_process != nullptr)
-		m_process->killgroup();
+		stopProcess();
 	if (m_endTimerId)
 		this->cancelTimer(m_endTimerId);
 }
@@ -318,7 +492,9 @@ std::string Application::runApp(int timeoutSeconds)
 
 	LOG_INF << fname << "Running application <" << m_name << ">.";
 	m_procStartTime = std::chrono::system_clock::now();
-	m_pid = m_process->spawnProcess(getCmdLine(), getExecUser(), m_workdir, m_envMap, m_resourceLimit, m_stdoutFile, m_metadata);
+	// run once app name is a new uuid for each run, do not keep cgroup instance for reuse
+	getResourceLimit()->m_reuseIndex = false;
+	m_pid = spawnProcess();
 	setLastError(m_process->startError());
 	if (m_metricStartCount)
 		m_metricStartCount->metric().Increment();
@@ -381,16 +557,56 @@ const std::string &Application::getCmdLine() const
 	return m_commandLine;
 }
 
-std::string Application::getAsyncRunOutput(const std::string &processUuid, int &exitCode, bool &finished)
+int Application::spawnProcess()
+{
+	std::lock_guard<std::recursive_mutex> guard(m_appMutex);
+	if (m_dockerImage.length())
+	{
+		// raw definition, container user and work dir default are from image
+		const auto user = m_owner ? m_owner->getExecUser() : std::string();
+		return m_process->spawnProcess(getCmdLine(), user, m_workdir, m_envMap, getResourceLimit(), m_stdoutFile, m_metadata);
+	}
+	return m_process->spawnProcess(getLaunchPlan(), getResourceLimit(), m_stdoutFile, m_metadata);
+}
+
+std::shared_ptr<LaunchPlan> Application::getLaunchPlan()
+{
+	std::lock_guard<std::recursive_mutex> guard(m_appMutex);
+	const auto &cmd = getCmdLine();
+	const auto user = getExecUser();
+	if (m_launchPlan == nullptr || !m_launchPlan->match(cmd, user, m_workdir))
+	{
+		m_launchPlan = LaunchPlan::compile(cmd, user, m_workdir, m_envMap);
+	}
+	return m_launchPlan;
+}
+
+std::shared_ptr<ResourceLimitation> Application::getResourceLimit()
+{
+	std::lock_guard<std::recursive_mutex> guard(m_appMutex);
+	if (m_resourceLimit != nullptr)
+		return m_resourceLimit;
+	if (m_accountingLimit == nullptr)
+	{
+		m_accountingLimit = std::make_shared<ResourceLimitation>();
+		m_accountingLimit->m_name = m_name;
+	}
+	return m_accountingLimit;
+}
+
+std::string Application::getAsyncRunOutput(const std::string &processUuid, int &exitCode, bool &finished, bool wait)
 {
 	const static char fname[] = "Application::getAsyncRunOutput() ";
 	finished = false;
 	if (m_process != nullptr && m_process->getuuid() == processUuid)
 	{
-		auto output = m_process->fetchOutputMsg();
+		auto output = m_process->fetchOutputMsg(wait);
 		if (output.length() == 0 && !m_process->running())
 		{
-			exitCode = m_process->return_value();
+			// pipe close is notified by OutputCapture, report finished after all output read
+			if (!wait && !m_process->outputDrained())
+				return std::string();
+			exitCode = m_process->returnValue();
 			finished = true;
 			LOG_DBG << fname << "process:" << processUuid << " finished with exit code: " << exitCode;
 			return std::string();
@@ -404,6 +620,14 @@ std::string Application::getAsyncRunOutput(const std::string &processUuid, int &
 	}
 }
 
+std::shared_ptr<OutputBuffer> Application::getAsyncRunOutputBuffer(const std::string &processUuid)
+{
+	auto process = m_process;
+	if (process != nullptr && process->getuuid() == processUuid)
+		return process->getOutputBuffer();
+	return nullptr;
+}
+
 void Application::checkAndUpdateHealth()
 {
 	if (m_healthCheckCmd.empty())
@@ -436,9 +660,114 @@ std::string Application::getOutput(bool keepHistory, int index)
 		// return m_process->getOutputMsg();
 		return m_process->fetchOutputMsg();
 	}
-	auto file = m_stdoutFileQueue->getFileName(index);
-	// TODO: limit read file buffer size, or return stream
-	return std::move(Utility::readFile(file));
+	std::uint64_t offset = 0;
+	return getOutput(index, offset, 0);
+}
+
+std::string Application::getOutput(int index, std::uint64_t &offset, std::size_t length)
+{
+	std::lock_guard<std::recursive_mutex> guard(m_appMutex);
+	auto buffer = getOutputBuffer(index, offset);
+	if (buffer)
+	{
+		return buffer->readFile(offset, length);
+	}
+	return m_stdoutFileQueue->read(index, offset, length);
+}
+
+std::string Application::getOutputFile(int index, std::uint64_t offset)
+{
+	std::lock_guard<std::recursive_mutex> guard(m_appMutex);
+	if (getOutputBuffer(index, offset) || m_stdoutFileQueue->isCompressed(index))
+	{
+		return std::string();
+	}
+	return m_stdoutFileQueue->getFileName(index);
+}
+
+std::uint64_t Application::getOutputLineOffset(int index, std::uint64_t line, bool fromEnd)
+{
+	// scanning a large file is slow, only hold app lock to get the buffer and the queue
+	std::shared_ptr<OutputBuffer> buffer;
+	std::shared_ptr<LogFileQueue> fileQueue;
+	{
+		std::lock_guard<std::recursive_mutex> guard(m_appMutex);
+		buffer = m_process != nullptr && index == 0 ? m_process->getOutputBuffer() : nullptr;
+		fileQueue = m_stdoutFileQueue;
+	}
+	if (buffer && buffer->file().empty())
+	{
+		// memory only capture, lines are counted in buffer
+		auto begin = buffer->begin();
+		auto data = buffer->tail();
+		if (fromEnd)
+		{
+			// after the Nth line break counted backward, last line break is not counted
+			std::size_t start = line ? 0 : data.length();
+			std::size_t end = (data.length() && data.back() == '\n') ? data.length() - 1 : data.length();
+			std::uint64_t count = 0;
+			for (std::size_t i = end; line && i > 0; i--)
+			{
+				if (data[i - 1] == '\n' && ++count == line)
+				{
+					start = i;
+					break;
+				}
+			}
+			return begin + start;
+		}
+		if (begin)
+		{
+			throw std::invalid_argument("line number is not available, old output was dropped from memory buffer");
+		}
+		std::size_t pos = 0;
+		for (std::uint64_t i = 0; i < line && pos < data.length(); i++)
+		{
+			pos = data.find('\n', pos);
+			pos = (pos == std::string::npos) ? data.length() : pos + 1;
+		}
+		return pos;
+	}
+	return fromEnd ? fileQueue->getTailOffset(index, line) : fileQueue->getLineOffset(index, line);
+}
+
+std::vector<std::string> Application::getOutputFiles()
+{
+	std::lock_guard<std::recursive_mutex> guard(m_appMutex);
+	std::vector<std::string> files;
+	for (int i = 0; i < m_stdoutFileQueue->size(); i++)
+	{
+		files.push_back(m_stdoutFileQueue->getFileName(i));
+	}
+	return files;
+}
+
+bool Application::getMemoryOutput(std::string &output, std::uint64_t &offset)
+{
+	std::shared_ptr<OutputBuffer> buffer;
+	{
+		std::lock_guard<std::recursive_mutex> guard(m_appMutex);
+		buffer = m_process != nullptr ? m_process->getOutputBuffer() : nullptr;
+	}
+	if (!buffer || !buffer->file().empty())
+	{
+		return false;
+	}
+	// read from the oldest data, offset is moved to the end
+	offset = 0;
+	output = buffer->read(offset);
+	offset -= output.length();
+	return true;
+}
+
+std::shared_ptr<OutputBuffer> Application::getOutputBuffer(int index, std::uint64_t offset) const
+{
+	auto buffer = m_process != nullptr && index == 0 ? m_process->getOutputBuffer() : nullptr;
+	if (buffer && (buffer->file().empty() || buffer->contains(offset)))
+	{
+		return buffer;
+	}
+	return nullptr;
 }
 
 void Application::initMetrics(std::shared_ptr<PrometheusRest> prom)
@@ -448,6 +777,15 @@ void Application::initMetrics(std::shared_ptr<PrometheusRest> prom)
 	m_metricStartCount = nullptr;
 	m_metricAppPid = nullptr;
 	m_metricMemory = nullptr;
+	m_metricCgroupMemory = nullptr;
+	m_metricCgroupCpu = nullptr;
+	m_metricHealthCheckDuration = nullptr;
+	m_metricStopDuration = nullptr;
+	m_metricContinueFails = nullptr;
+	m_metricRestartBackoff = nullptr;
+	m_metricContainer.clear();
+	m_metricContainerTotal.clear();
+	m_metricContainerId.clear();
 
 	// update
 	if (prom)
@@ -462,9 +800,51 @@ void Application::initMetrics(std::shared_ptr<PrometheusRest> prom)
 		m_metricMemory = prom->createPromGauge(
 			PROM_METRIC_NAME_appmesh_prom_process_memory_gauge, PROM_METRIC_HELP_appmesh_prom_process_memory_gauge,
 			{{"application", getName()}, {"id", m_appId}});
+		m_metricCgroupMemory = prom->createPromGauge(
+			PROM_METRIC_NAME_appmesh_prom_process_cgroup_memory_gauge, PROM_METRIC_HELP_appmesh_prom_process_cgroup_memory_gauge,
+			{{"application", getName()}, {"id", m_appId}});
+		m_metricCgroupCpu = prom->createPromCounter(
+			PROM_METRIC_NAME_appmesh_prom_process_cgroup_cpu_seconds, PROM_METRIC_HELP_appmesh_prom_process_cgroup_cpu_seconds,
+			{{"application", getName()}, {"id", m_appId}});
+		if (m_healthCheckCmd.length())
+		{
+			m_metricHealthCheckDuration = prom->createPromHistogram(
+				PROM_METRIC_NAME_appmesh_health_check_duration_seconds, PROM_METRIC_HELP_appmesh_health_check_duration_seconds,
+				{{"application", getName()}, {"id", m_appId}},
+				{0.005, 0.01, 0.05, 0.1, 0.5, 1, 2, 5, 10, 30});
+		}
+		m_metricStopDuration = prom->createPromHistogram(
+			PROM_METRIC_NAME_appmesh_app_stop_duration_seconds, PROM_METRIC_HELP_appmesh_app_stop_duration_seconds,
+			{{"application", getName()}, {"id", m_appId}},
+			{0.01, 0.05, 0.1, 0.5, 1, 2, 5, 10, 30, 60});
+		m_metricContinueFails = prom->createPromGauge(
+			PROM_METRIC_NAME_appmesh_app_restart_continue_fails, PROM_METRIC_HELP_appmesh_app_restart_continue_fails,
+			{{"application", getName()}, {"id", m_appId}});
+		m_metricRestartBackoff = prom->createPromGauge(
+			PROM_METRIC_NAME_appmesh_app_restart_backoff_seconds, PROM_METRIC_HELP_appmesh_app_restart_backoff_seconds,
+			{{"application", getName()}, {"id", m_appId}});
 	}
 }
 
+int Application::getHealthCheckInterval() const
+{
+	// default follow schedule interval
+	return m_healthCheckInterval > 0 ? m_healthCheckInterval : Configuration::instance()->getScheduleInterval();
+}
+
+int Application::getHealthCheckTimeout() const
+{
+	return m_healthCheckTimeout > 0 ? m_healthCheckTimeout : DEFAULT_HEALTH_CHECK_TIMEOUT;
+}
+
+void Application::setHealthCheckResult(bool health, double costSeconds)
+{
+	setHealth(health);
+	std::lock_guard<std::recursive_mutex> guard(m_appMutex);
+	if (m_metricHealthCheckDuration)
+		m_metricHealthCheckDuration->metric().Observe(costSeconds);
+}
+
 int Application::getVersion()
 {
 	std::lock_guard<std::recursive_mutex> guard(m_appMutex);
@@ -502,6 +882,16 @@ web::json::value Application::AsJson(bool returnRuntimeInfo)
 		result[GET_STRING_T(JSON_KEY_APP_fini_command)] = web::json::value::string(GET_STRING_T(m_commandLineFini));
 	if (m_healthCheckCmd.length())
 		result[GET_STRING_T(JSON_KEY_APP_health_check_cmd)] = web::json::value::string(GET_STRING_T(m_healthCheckCmd));
+	if (m_healthCheckInterval)
+		result[JSON_KEY_APP_health_check_interval] = web::json::value::number(m_healthCheckInterval);
+	if (m_healthCheckTimeout)
+		result[JSON_KEY_APP_health_check_timeout] = web::json::value::number(m_healthCheckTimeout);
+	if (m_healthCheckHttpStatus)
+		result[JSON_KEY_APP_health_check_http_status] = web::json::value::number(m_healthCheckHttpStatus);
+	if (m_stopSignal != DEFAULT_APP_STOP_SIGNAL)
+		result[JSON_KEY_APP_stop_signal] = web::json::value::number(m_stopSignal);
+	if (m_stopTimeout != DEFAULT_APP_STOP_TIMEOUT)
+		result[JSON_KEY_APP_stop_timeout] = web::json::value::number(m_stopTimeout);
 	if (m_workdir.length())
 		result[JSON_KEY_APP_working_dir] = web::json::value::string(GET_STRING_T(m_workdir));
 	result[JSON_KEY_APP_status] = web::json::value::number(static_cast<int>(m_status));
@@ -517,12 +907,33 @@ web::json::value Application::AsJson(bool returnRuntimeInfo)
 			result[JSON_KEY_APP_return] = web::json::value::number(*m_return);
 		if (m_pid > 0)
 			result[JSON_KEY_APP_memory] = web::json::value::number(ResourceCollection::instance()->getRssMemory(m_pid));
+		// cgroup accounting include exited grandchildren CPU time
+		auto cgroupMemory = m_process->cgroupMemoryUsage();
+		if (cgroupMemory >= 0)
+			result[JSON_KEY_APP_cgroup_memory] = web::json::value::number(cgroupMemory);
+		auto cgroupCpu = m_process->cgroupCpuUsage();
+		if (cgroupCpu >= 0)
+			result[JSON_KEY_APP_cgroup_cpu] = web::json::value::number(cgroupCpu / 1e9);
 		if (std::chrono::time_point_cast<std::chrono::hours>(m_procStartTime).time_since_epoch().count() > 24) // avoid print 1970-01-01 08:00:00
 			result[JSON_KEY_APP_last_start] = web::json::value::string(DateTime::formatISO8601Time(m_procStartTime));
 		if (!m_process->containerId().empty())
 		{
 			result[JSON_KEY_APP_container_id] = web::json::value::string(GET_STRING_T(m_process->containerId()));
 		}
+		if (m_dockerImage.length())
+		{
+			auto imagePull = DockerImageManager::instance()->status(m_dockerImage);
+			if (!imagePull.is_null())
+				result[JSON_KEY_APP_docker_image_pull] = imagePull;
+		}
+		if (m_continueFails > 0 || m_nextRestartTime > std::chrono::system_clock::now())
+		{
+			auto backoff = web::json::value::object();
+			backoff[JSON_KEY_RESTART_BACKOFF_continue_fails] = web::json::value::number(m_continueFails);
+			backoff[JSON_KEY_RESTART_BACKOFF_next_restart] = web::json::value::string(DateTime::formatISO8601Time(m_nextRestartTime));
+			backoff[JSON_KEY_RESTART_BACKOFF_window_restarts] = web::json::value::number(static_cast<int>(m_restartWindow.size()));
+			result[JSON_KEY_APP_restart_backoff] = backoff;
+		}
 		result[JSON_KEY_APP_health] = web::json::value::number(this->getHealth());
 		if (m_stdoutFileQueue->size())
 			result[JSON_KEY_APP_stdout_cache_num] = web::json::value::number(m_stdoutFileQueue->size());
@@ -621,6 +1032,13 @@ std::shared_ptr<AppProcess> Application::allocProcess(bool monitorProcess, const
 		{
 			process.reset(new AppProcess());
 		}
+		// rotate only the file this process started with, stop when restarted by a new process
+		std::weak_ptr<LogFileQueue> queue = m_stdoutFileQueue;
+		std::weak_ptr<AppLogFile> current = m_stdoutFileQueue->current();
+		process->setOutputCapture(Configuration::instance()->getStdoutCaptureMode() != "file", [queue, current]() mutable -> bool {
+			auto fileQueue = queue.lock();
+			return fileQueue && fileQueue->rotate(current);
+		});
 	}
 	return process;
 }
@@ -665,6 +1083,7 @@ void Application::destroy()
 		std::lock_guard<std::recursive_mutex> guard(m_appMutex);
 		this->disable();
 		this->m_status = STATUS::NOTAVIALABLE;
+		LinuxCgroup::removeApp(m_name);
 		if (m_commandLineFini.length())
 		{
 			this->registerTimer(0, 0, std::bind(&Application::onFinishEvent, this, std::placeholders::_1), __FUNCTION__);
@@ -677,6 +1096,34 @@ void Application::destroy()
 	}
 }
 
+std::shared_ptr<AppProcess> Application::stoppingProcess()
+{
+	std::lock_guard<std::recursive_mutex> guard(m_appMutex);
+	if (m_process != nullptr && m_process->running())
+		return m_process;
+	return nullptr;
+}
+
+void Application::waitPredecessor(const std::shared_ptr<AppProcess> &process)
+{
+	std::lock_guard<std::recursive_mutex> guard(m_appMutex);
+	m_predecessor = process;
+}
+
+bool Application::predecessorRunning()
+{
+	const static char fname[] = "Application::predecessorRunning() ";
+
+	std::lock_guard<std::recursive_mutex> guard(m_appMutex);
+	if (m_predecessor != nullptr && m_predecessor->running())
+	{
+		LOG_DBG << fname << "Application <" << m_name << "> wait previous process <" << m_predecessor->getpid() << "> exit";
+		return true;
+	}
+	m_predecessor = nullptr;
+	return false;
+}
+
 void Application::onSuicideEvent(int timerId)
 {
 	const static char fname[] = "Application::onSuicideEvent() ";
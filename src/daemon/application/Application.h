@@ -1,10 +1,12 @@
 #pragma once
 #include <atomic>
 #include <chrono>
+#include <deque>
 #include <map>
 #include <memory>
 #include <mutex>
 #include <string>
+#include <vector>
 
 #include <cpprest/json.h>
 
@@ -14,6 +16,9 @@
 class User;
 class CounterMetric;
 class GaugeMetric;
+class HistogramMetric;
+class LaunchPlan;
+class OutputBuffer;
 class PrometheusRest;
 class AppProcess;
 class DailyLimitation;
@@ -40,9 +45,15 @@ public:
 
 	// Invoke by scheduler
 	virtual void invoke();
+	// Invoke by child exit event
+	void onProcessExitEvent();
 	virtual void disable();
 	virtual void enable();
 	void destroy();
+	// process still in stop grace period after disable(), nullptr for exited
+	std::shared_ptr<AppProcess> stoppingProcess();
+	// replacement of a same name app, do not start process until the previous one exit
+	void waitPredecessor(const std::shared_ptr<AppProcess> &process);
 	void onSuicideEvent(int timerId = 0);
 	void onFinishEvent(int timerId = 0);
 	void onEndEvent(int timerId = 0);
@@ -50,16 +61,40 @@ public:
 
 	std::string runAsyncrize(int timeoutSeconds) noexcept(false);
 	std::string runSyncrize(int timeoutSeconds, void *asyncHttpRequest) noexcept(false);
-	std::string getAsyncRunOutput(const std::string &processUuid, int &exitCode, bool &finished) noexcept(false);
+	/// <summary>
+	/// Output of async run process since last fetch
+	/// </summary>
+	/// <param name="wait">wait captured pipe drained for exited process, false for not finished until drained</param>
+	std::string getAsyncRunOutput(const std::string &processUuid, int &exitCode, bool &finished, bool wait = true) noexcept(false);
+	/// <summary>
+	/// Captured output buffer of async run process, nullptr for stdout not captured
+	/// </summary>
+	std::shared_ptr<OutputBuffer> getAsyncRunOutputBuffer(const std::string &processUuid);
 
 	// health: 0-health, 1-unhealthy
 	void setHealth(bool health) { m_health = health; }
 	const std::string &getHealthCheck() { return m_healthCheckCmd; }
+	int getHealthCheckInterval() const;
+	int getHealthCheckTimeout() const;
+	int getHealthCheckHttpStatus() const { return m_healthCheckHttpStatus; }
+	void setHealthCheckResult(bool health, double costSeconds);
+	int getStopSignal() const { return m_stopSignal; }
+	int getStopTimeout() const { return m_stopTimeout; }
 	int getHealth() { return 1 - m_health; }
 	pid_t getpid() const;
 
 	// get normal stdout for running app
 	std::string getOutput(bool keepHistory, int index = 0);
+	// get stdout by byte range (length 0 for to the end), offset is moved to the position for next read
+	std::string getOutput(int index, std::uint64_t &offset, std::size_t length);
+	// stdout file to read the range from offset, empty when the range is served from memory
+	std::string getOutputFile(int index, std::uint64_t offset);
+	// byte offset of a stdout line (0 based), or of the last N lines when fromEnd
+	std::uint64_t getOutputLineOffset(int index, std::uint64_t line, bool fromEnd);
+	// stdout file names, current one first then rotated ones
+	std::vector<std::string> getOutputFiles();
+	// current output of memory only capture, offset is set to the offset of the first byte, false for file capture
+	bool getMemoryOutput(std::string &output, std::uint64_t &offset);
 
 	void initMetrics(std::shared_ptr<PrometheusRest> prom);
 	int getVersion();
@@ -86,6 +121,22 @@ protected:
 	void handleEndTimer();
 	const std::string getExecUser() const;
 	const std::string &getCmdLine() const;
+	// resource limitation for spawn, app without limitation get an empty one for cgroup accounting
+	std::shared_ptr<ResourceLimitation> getResourceLimit();
+	// launch plan of current command, compiled once and reused until command, user or account files change
+	std::shared_ptr<LaunchPlan> getLaunchPlan();
+	// spawn m_process, docker command run in image and is not compiled to host launch plan
+	int spawnProcess();
+	// captured stdout buffer when the range from offset is in memory (or memory only capture), file may be behind the pipe
+	std::shared_ptr<OutputBuffer> getOutputBuffer(int index, std::uint64_t offset) const;
+	// crash loop backoff, restart budget of window and host wide restart rate
+	bool restartAllowed();
+	// process of replaced same name app is still in stop grace period, do not start new one
+	bool predecessorRunning();
+	// stop process by stop policy without wait, exit is handled by onProcessExitEvent()
+	void stopProcess();
+	// sample docker container statistics to metrics, metrics are re-created when container changed
+	void updateContainerMetrics();
 
 protected:
 	mutable std::recursive_mutex m_appMutex;
@@ -115,21 +166,48 @@ protected:
 	int m_endTimerId;
 	bool m_health;
 	std::string m_healthCheckCmd;
+	// seconds, 0 means use default value
+	int m_healthCheckInterval;
+	int m_healthCheckTimeout;
+	// expected status for http:// probe, 0 means 2xx and 3xx
+	int m_healthCheckHttpStatus;
+	// stop policy: signal first, SIGKILL after timeout seconds
+	int m_stopSignal;
+	int m_stopTimeout;
 	const std::string m_appId;
 	unsigned int m_version;
 	std::shared_ptr<AppProcess> m_process;
+	// process of replaced app in stop grace period, share ports, files and cgroup name with this app
+	std::shared_ptr<AppProcess> m_predecessor;
 	int m_pid;
 	int m_suicideTimerId;
 	std::shared_ptr<DailyLimitation> m_dailyLimit;
 	std::shared_ptr<ResourceLimitation> m_resourceLimit;
+	std::shared_ptr<ResourceLimitation> m_accountingLimit;
 	std::map<std::string, std::string> m_envMap;
+	std::shared_ptr<LaunchPlan> m_launchPlan;
 	std::string m_dockerImage;
 	std::chrono::system_clock::time_point m_procStartTime;
+	std::chrono::system_clock::time_point m_procExitTime;
+	// restart backoff, evaluated once for each exit
+	std::chrono::system_clock::time_point m_nextRestartTime;
+	// restarts after failures of the last RestartWindowSeconds
+	RestartWindow m_restartWindow;
 
 	// Prometheus
 	std::shared_ptr<CounterMetric> m_metricStartCount;
 	std::shared_ptr<GaugeMetric> m_metricMemory;
+	std::shared_ptr<GaugeMetric> m_metricCgroupMemory;
+	std::shared_ptr<CounterMetric> m_metricCgroupCpu;
 	std::shared_ptr<GaugeMetric> m_metricAppPid;
+	std::shared_ptr<HistogramMetric> m_metricHealthCheckDuration;
+	std::shared_ptr<HistogramMetric> m_metricStopDuration;
+	std::shared_ptr<GaugeMetric> m_metricContinueFails;
+	std::shared_ptr<GaugeMetric> m_metricRestartBackoff;
+	// key: metric name, labelled with m_metricContainerId
+	std::map<std::string, std::shared_ptr<GaugeMetric>> m_metricContainer;
+	std::map<std::string, std::shared_ptr<CounterMetric>> m_metricContainerTotal;
+	std::string m_metricContainerId;
 	std::atomic<int> m_continueFails;
 
 	// error
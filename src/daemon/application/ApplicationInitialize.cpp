@@ -85,7 +85,7 @@ void ApplicationInitialize::invoke()
 	LOG_DBG << fname << "Entered.";
 
 	refreshPid();
-	if (!m_executed)
+	if (!m_executed && !predecessorRunning())
 	{
 		std::lock_guard<std::recursive_mutex> guard(m_appMutex);
 		m_executed = true;
@@ -94,7 +94,7 @@ void ApplicationInitialize::invoke()
 			LOG_INF << fname << "Starting initializing for application <" << m_name << ">.";
 			m_process = allocProcess(0, "", m_name);
 			m_procStartTime = std::chrono::system_clock::now();
-			m_pid = m_process->spawnProcess(getCmdLine(), getExecUser(), m_workdir, m_envMap, m_resourceLimit, m_stdoutFile, m_metadata);
+			m_pid = spawnProcess();
 			setLastError(m_process->startError());
 		}
 		else
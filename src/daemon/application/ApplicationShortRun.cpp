@@ -39,12 +39,10 @@ void ApplicationShortRun::refreshPid()
 	std::lock_guard<std::recursive_mutex> guard(m_appMutex);
 	if (nullptr != m_bufferProcess && m_bufferProcess->running())
 	{
-		ACE_Time_Value tv;
-		tv.msec(10);
-		int ret = m_bufferProcess->wait(tv);
+		int ret = m_bufferProcess->waitExit(ACE_Time_Value::zero);
 		if (ret > 0)
 		{
-			m_return = std::make_shared<int>(m_bufferProcess->return_value());
+			m_return = std::make_shared<int>(m_bufferProcess->returnValue());
 		}
 	}
 }
@@ -82,7 +80,7 @@ void ApplicationShortRun::invoke()
 		if (!this->available() && m_process->running())
 		{
 			LOG_INF << fname << "Application <" << m_name << "> was not in daily start time";
-			m_process->killgroup();
+			stopProcess();
 			setInvalidError();
 		}
 	}
@@ -108,6 +106,9 @@ void ApplicationShortRun::invokeNow(int timerId)
 		return;
 	}
 	std::lock_guard<std::recursive_mutex> guard(m_appMutex);
+	// replaced app process still in stop grace period, launch at next interval
+	if (predecessorRunning())
+		return;
 	// clean old process
 	if (m_process->running())
 	{
@@ -130,7 +131,7 @@ void ApplicationShortRun::invokeNow(int timerId)
 		// Spawn new process
 		m_process = allocProcess(0, m_dockerImage, m_name);
 		m_procStartTime = std::chrono::system_clock::now();
-		m_pid = m_process->spawnProcess(getCmdLine(), getExecUser(), m_workdir, m_envMap, m_resourceLimit, m_stdoutFile, m_metadata);
+		m_pid = spawnProcess();
 		setLastError(m_process->startError());
 		m_nextLaunchTime = std::make_unique<std::chrono::system_clock::time_point>(std::chrono::system_clock::now() + std::chrono::seconds(this->getStartInterval()));
 	}
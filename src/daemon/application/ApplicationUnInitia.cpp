@@ -87,7 +87,7 @@ void ApplicationUnInitia::invoke()
 	LOG_DBG << fname << "Entered.";
 
 	refreshPid();
-	if (!m_executed)
+	if (!m_executed && !predecessorRunning())
 	{
 		std::lock_guard<std::recursive_mutex> guard(m_appMutex);
 		m_executed = true;
@@ -96,7 +96,7 @@ void ApplicationUnInitia::invoke()
 			LOG_INF << fname << "Starting un-initializing for application <" << m_name << ">.";
 			m_process = allocProcess(0, "", m_name);
 			m_procStartTime = std::chrono::system_clock::now();
-			m_pid = m_process->spawnProcess(getCmdLine(), getExecUser(), m_workdir, m_envMap, m_resourceLimit, m_stdoutFile, m_metadata);
+			m_pid = spawnProcess();
 			setLastError(m_process->startError());
 		}
 		else
@@ -0,0 +1,143 @@
+#include <algorithm>
+#include <functional>
+#include <sys/stat.h>
+
+#include "../../common/Utility.h"
+#include "../Configuration.h"
+#include "AppUtils.h"
+#include "LogArchiver.h"
+
+// disk budget is also checked periodically, compressed file may be removed by others
+constexpr int LOG_ARCHIVE_CHECK_INTERVAL_SECONDS = 60;
+
+LogArchiver::LogArchiver()
+	: m_budgetCheck(false), m_running(false)
+{
+}
+
+LogArchiver::~LogArchiver()
+{
+	{
+		std::lock_guard<std::mutex> guard(m_mutex);
+		m_running = false;
+		m_cond.notify_all();
+	}
+	if (m_thread)
+		m_thread->join();
+}
+
+std::shared_ptr<LogArchiver> &LogArchiver::instance()
+{
+	static auto singleton = std::make_shared<LogArchiver>();
+	return singleton;
+}
+
+void LogArchiver::watch(const std::shared_ptr<LogFileQueue> &queue)
+{
+	std::lock_guard<std::mutex> guard(m_queueMutex);
+	// clean removed applications
+	m_queues.erase(std::remove_if(m_queues.begin(), m_queues.end(), [](const std::weak_ptr<LogFileQueue> &q) { return q.expired(); }), m_queues.end());
+	m_queues.push_back(queue);
+}
+
+void LogArchiver::rotated(const std::shared_ptr<AppLogFile> &file)
+{
+	const bool compress = file && Configuration::instance()->getStdoutCompress();
+	const bool budget = Configuration::instance()->getStdoutDiskBudget() > 0;
+	if (!compress && !budget)
+		return;
+
+	std::lock_guard<std::mutex> guard(m_mutex);
+	// worker thread is started with the first rotation
+	if (!m_running)
+	{
+		m_running = true;
+		m_thread = std::make_unique<std::thread>(std::bind(&LogArchiver::run, this));
+	}
+	if (compress)
+		m_pending.push_back(file);
+	m_budgetCheck = m_budgetCheck || budget;
+	m_cond.notify_all();
+}
+
+void LogArchiver::run()
+{
+	const static char fname[] = "LogArchiver::run() ";
+	LOG_INF << fname << "Entered";
+
+	while (true)
+	{
+		std::weak_ptr<AppLogFile> pending;
+		bool budgetCheck = false;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_cond.wait_for(lock, std::chrono::seconds(LOG_ARCHIVE_CHECK_INTERVAL_SECONDS), [this] { return !m_running || !m_pending.empty() || m_budgetCheck; });
+			if (!m_running)
+				break;
+			if (!m_pending.empty())
+			{
+				pending = m_pending.front();
+				m_pending.pop_front();
+			}
+			// budget is checked after all pending files are compressed
+			budgetCheck = m_pending.empty();
+			m_budgetCheck = m_budgetCheck && !budgetCheck;
+		}
+		// file may be removed from queue before compress
+		if (auto file = pending.lock())
+			file->compress();
+		if (budgetCheck)
+			enforceBudget();
+	}
+	LOG_INF << fname << "Exited";
+}
+
+void LogArchiver::enforceBudget()
+{
+	const static char fname[] = "LogArchiver::enforceBudget() ";
+
+	const auto budget = Configuration::instance()->getStdoutDiskBudget();
+	if (budget == 0)
+		return;
+
+	struct HistoryFile
+	{
+		std::shared_ptr<LogFileQueue> queue;
+		std::shared_ptr<AppLogFile> file;
+		std::uint64_t size;
+		std::int64_t mtime;
+	};
+	std::vector<HistoryFile> files;
+	std::uint64_t total = 0;
+	{
+		std::lock_guard<std::mutex> guard(m_queueMutex);
+		for (const auto &weakQueue : m_queues)
+		{
+			auto queue = weakQueue.lock();
+			if (queue == nullptr)
+				continue;
+			for (const auto &file : queue->getHistoryFiles())
+			{
+				struct stat st;
+				if (::stat(file->getFileName().c_str(), &st) == 0)
+				{
+					files.push_back(HistoryFile{queue, file, static_cast<std::uint64_t>(st.st_size), static_cast<std::int64_t>(st.st_mtime)});
+					total += st.st_size;
+				}
+			}
+		}
+	}
+	if (total <= budget)
+		return;
+
+	// remove oldest first
+	std::sort(files.begin(), files.end(), [](const HistoryFile &a, const HistoryFile &b) { return a.mtime < b.mtime; });
+	for (const auto &history : files)
+	{
+		if (total <= budget)
+			break;
+		LOG_INF << fname << "Remove <" << history.file->getFileName() << "> for disk budget <" << budget << ">, total <" << total << ">";
+		history.queue->remove(history.file);
+		total -= history.size;
+	}
+}
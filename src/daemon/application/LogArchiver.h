@@ -0,0 +1,49 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct AppLogFile;
+class LogFileQueue;
+
+/// <summary>
+/// Background worker of rotated stdout files:
+///  1. gzip compress rotated files when StdoutCompress is enabled
+///  2. keep total size of rotated files of all applications under StdoutDiskBudgetMB,
+///     the oldest rotated file is removed first, current files are not counted.
+/// </summary>
+class LogArchiver
+{
+public:
+	LogArchiver();
+	virtual ~LogArchiver();
+	static std::shared_ptr<LogArchiver> &instance();
+
+	/// <summary>
+	/// Register stdout file queue of an application for disk budget
+	/// </summary>
+	void watch(const std::shared_ptr<LogFileQueue> &queue);
+	/// <summary>
+	/// A file is rotated to history, compress and check disk budget in background
+	/// </summary>
+	void rotated(const std::shared_ptr<AppLogFile> &file);
+
+private:
+	void run();
+	void enforceBudget();
+
+private:
+	std::mutex m_mutex;
+	std::condition_variable m_cond;
+	std::deque<std::weak_ptr<AppLogFile>> m_pending;
+	bool m_budgetCheck;
+	bool m_running;
+	std::unique_ptr<std::thread> m_thread;
+
+	std::mutex m_queueMutex;
+	std::vector<std::weak_ptr<LogFileQueue>> m_queues;
+};
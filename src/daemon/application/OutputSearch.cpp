@@ -0,0 +1,199 @@
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include "../../common/Utility.h"
+#include "AppUtils.h"
+#include "OutputSearch.h"
+
+// substring search window and decompress block size, deadline is checked between windows
+constexpr std::size_t SEARCH_WINDOW_SIZE = 16 * 1024 * 1024;
+// regex search check deadline every N lines
+constexpr std::size_t SEARCH_CHECK_LINES = 4096;
+// matched line longer than this is cut
+constexpr std::size_t SEARCH_LINE_MAX = 4096;
+
+OutputSearch::OutputSearch(const std::string &pattern, bool regex, std::size_t maxCount, const std::chrono::milliseconds &timeout)
+	: m_pattern(pattern), m_maxCount(maxCount), m_deadline(std::chrono::steady_clock::now() + timeout), m_count(0), m_truncated(false)
+{
+	if (pattern.empty())
+	{
+		throw std::invalid_argument("search pattern is empty");
+	}
+	if (regex)
+	{
+		// boost::regex_error is std::runtime_error, report to client as bad request
+		m_regex = std::make_unique<boost::regex>(pattern, boost::regex::ECMAScript | boost::regex::optimize);
+	}
+}
+
+bool OutputSearch::scan(const std::string &file, int index, const std::function<void(const OutputMatch &)> &callback)
+{
+	const static char fname[] = "OutputSearch::scan() ";
+
+	if (m_truncated)
+		return false;
+	if (AppLogFile::isCompressed(file))
+		return scanCompressed(file, index, callback);
+
+	int fd = ::open(file.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+	{
+		// not exist (memory only capture or not started)
+		LOG_DBG << fname << "skip file <" << file << "> : " << std::strerror(errno);
+		return true;
+	}
+	struct stat st;
+	if (::fstat(fd, &st) != 0 || st.st_size == 0)
+	{
+		::close(fd);
+		return true;
+	}
+	// file may keep growing, only the size at open is scanned
+	const std::size_t size = st.st_size;
+	void *data = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if (data == MAP_FAILED)
+	{
+		LOG_WAR << fname << "mmap file <" << file << "> failed with error: " << std::strerror(errno);
+		return true;
+	}
+	::madvise(data, size, MADV_SEQUENTIAL);
+
+	const char *begin = static_cast<const char *>(data);
+	bool next = scanLines(begin, begin + size, 0, index, callback);
+	::munmap(data, size);
+	LOG_DBG << fname << "scanned <" << file << "> size <" << size << "> matched <" << m_count << ">";
+	return next;
+}
+
+bool OutputSearch::scanMemory(const std::string &content, std::uint64_t offset, int index, const std::function<void(const OutputMatch &)> &callback)
+{
+	if (m_truncated)
+		return false;
+	return scanLines(content.data(), content.data() + content.length(), offset, index, callback);
+}
+
+bool OutputSearch::scanCompressed(const std::string &file, int index, const std::function<void(const OutputMatch &)> &callback)
+{
+	const static char fname[] = "OutputSearch::scanCompressed() ";
+
+	gzFile input = ::gzopen(file.c_str(), "rb");
+	if (input == nullptr)
+	{
+		LOG_DBG << fname << "skip file <" << file << "> : " << std::strerror(errno);
+		return true;
+	}
+	// block keep the unterminated last line for next read
+	std::unique_ptr<char[]> block(new char[SEARCH_WINDOW_SIZE]);
+	std::size_t size = 0;
+	std::uint64_t offset = 0;
+	bool next = true;
+	while (next)
+	{
+		auto count = ::gzread(input, block.get() + size, SEARCH_WINDOW_SIZE - size);
+		if (count > 0)
+			size += count;
+		const bool eof = (count <= 0);
+		const char *begin = block.get();
+		const char *end = begin + size;
+		if (!eof)
+		{
+			auto lastLineEnd = static_cast<const char *>(::memrchr(begin, '\n', size));
+			// a line longer than block is scanned as is
+			end = lastLineEnd ? lastLineEnd + 1 : end;
+		}
+		next = scanLines(begin, end, offset, index, callback);
+		offset += end - begin;
+		size -= end - begin;
+		std::memmove(block.get(), end, size);
+		if (eof)
+			break;
+	}
+	::gzclose(input);
+	LOG_DBG << fname << "scanned <" << file << "> size <" << offset << "> matched <" << m_count << ">";
+	return next;
+}
+
+bool OutputSearch::scanLines(const char *begin, const char *end, std::uint64_t offset, int index, const std::function<void(const OutputMatch &)> &callback)
+{
+	return m_regex ? scanRegex(begin, end, offset, index, callback) : scanSubstring(begin, end, offset, index, callback);
+}
+
+bool OutputSearch::scanSubstring(const char *begin, const char *end, std::uint64_t offset, int index, const std::function<void(const OutputMatch &)> &callback)
+{
+	const char *pos = begin;
+	while (pos < end)
+	{
+		// limit each memmem() to a window, a match across windows is covered by the overlap
+		const char *windowEnd = std::min<const char *>(end, pos + SEARCH_WINDOW_SIZE + m_pattern.length() - 1);
+		auto found = static_cast<const char *>(::memmem(pos, windowEnd - pos, m_pattern.data(), m_pattern.length()));
+		if (found == nullptr)
+		{
+			if (windowEnd == end)
+				break;
+			pos = windowEnd - (m_pattern.length() - 1);
+			if (expired())
+				return false;
+			continue;
+		}
+		auto lineEnd = static_cast<const char *>(std::memchr(found, '\n', end - found));
+		lineEnd = lineEnd ? lineEnd : end;
+		auto lineBegin = found;
+		while (lineBegin > begin && *(lineBegin - 1) != '\n')
+			lineBegin--;
+		if (!report(lineBegin, lineEnd, offset + (lineBegin - begin), index, callback))
+			return false;
+		pos = lineEnd + 1;
+	}
+	return !expired();
+}
+
+bool OutputSearch::scanRegex(const char *begin, const char *end, std::uint64_t offset, int index, const std::function<void(const OutputMatch &)> &callback)
+{
+	std::size_t lines = 0;
+	for (const char *lineBegin = begin; lineBegin < end;)
+	{
+		auto lineEnd = static_cast<const char *>(std::memchr(lineBegin, '\n', end - lineBegin));
+		lineEnd = lineEnd ? lineEnd : end;
+		if (boost::regex_search(lineBegin, lineEnd, *m_regex))
+		{
+			if (!report(lineBegin, lineEnd, offset + (lineBegin - begin), index, callback))
+				return false;
+		}
+		if (++lines % SEARCH_CHECK_LINES == 0 && expired())
+			return false;
+		lineBegin = lineEnd + 1;
+	}
+	return !expired();
+}
+
+bool OutputSearch::report(const char *begin, const char *end, std::uint64_t offset, int index, const std::function<void(const OutputMatch &)> &callback)
+{
+	// only a match beyond max count means the result is truncated
+	if (m_count >= m_maxCount)
+	{
+		m_truncated = true;
+		return false;
+	}
+	OutputMatch match;
+	match.m_index = index;
+	match.m_offset = offset;
+	match.m_line.assign(begin, std::min<std::size_t>(end - begin, SEARCH_LINE_MAX));
+	callback(match);
+	m_count++;
+	return true;
+}
+
+bool OutputSearch::expired()
+{
+	if (std::chrono::steady_clock::now() >= m_deadline)
+	{
+		m_truncated = true;
+	}
+	return m_truncated;
+}
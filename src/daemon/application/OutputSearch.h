@@ -0,0 +1,71 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+
+#include <boost/regex.hpp>
+
+/// <summary>
+/// One matched line of stdout file
+/// </summary>
+struct OutputMatch
+{
+	int m_index;			// stdout file index, 0 is the current one
+	std::uint64_t m_offset; // offset of the line begin in file
+	std::string m_line;		// line content without line break, long line is cut
+};
+
+/// <summary>
+/// Scan stdout files by substring or regex over mmap'd content (gzip file is decompressed by block),
+/// stop when matched line count or scan time reach the limit.
+/// </summary>
+class OutputSearch
+{
+public:
+	/// <summary>
+	/// Constructor
+	/// </summary>
+	/// <param name="pattern">substring or regex (ECMAScript)</param>
+	/// <param name="regex">pattern is regex</param>
+	/// <param name="maxCount">max matched lines</param>
+	/// <param name="timeout">max scan time of all files</param>
+	OutputSearch(const std::string &pattern, bool regex, std::size_t maxCount, const std::chrono::milliseconds &timeout);
+
+	/// <summary>
+	/// Scan one file, matched lines are passed to callback in file order
+	/// </summary>
+	/// <returns>false when count or time limit reached, rest files should not be scanned</returns>
+	bool scan(const std::string &file, int index, const std::function<void(const OutputMatch &)> &callback);
+	/// <summary>
+	/// Scan output kept in memory (memory only capture), offset is the offset of the first byte
+	/// </summary>
+	/// <returns>false when count or time limit reached</returns>
+	bool scanMemory(const std::string &content, std::uint64_t offset, int index, const std::function<void(const OutputMatch &)> &callback);
+
+	std::size_t count() const { return m_count; }
+	/// <summary>
+	/// Scan stopped by time limit, or one more match was found after max count
+	/// </summary>
+	bool truncated() const { return m_truncated; }
+
+private:
+	// gzip compressed file is decompressed by block
+	bool scanCompressed(const std::string &file, int index, const std::function<void(const OutputMatch &)> &callback);
+	// scan lines in [begin, end), begin is at offset of the file
+	bool scanLines(const char *begin, const char *end, std::uint64_t offset, int index, const std::function<void(const OutputMatch &)> &callback);
+	bool scanSubstring(const char *begin, const char *end, std::uint64_t offset, int index, const std::function<void(const OutputMatch &)> &callback);
+	bool scanRegex(const char *begin, const char *end, std::uint64_t offset, int index, const std::function<void(const OutputMatch &)> &callback);
+	// report line [begin, end) at offset, return false for a match beyond max count
+	bool report(const char *begin, const char *end, std::uint64_t offset, int index, const std::function<void(const OutputMatch &)> &callback);
+	bool expired();
+
+private:
+	const std::string m_pattern;
+	std::unique_ptr<boost::regex> m_regex;
+	const std::size_t m_maxCount;
+	const std::chrono::steady_clock::time_point m_deadline;
+	std::size_t m_count;
+	bool m_truncated;
+};
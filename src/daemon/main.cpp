@@ -14,13 +14,18 @@
 #include "../common/PerfLog.h"
 #include "../common/Utility.h"
 #include "../common/os/linux.hpp"
+#include "ChildSignalHandler.h"
 #include "Configuration.h"
 #include "HealthCheckTask.h"
+#include "HealthProbe.h"
 #include "PersistManager.h"
 #include "ResourceCollection.h"
+#include "TimerDispatcher.h"
 #include "TimerHandler.h"
 #include "application/Application.h"
 #include "process/AppProcess.h"
+#include "process/ProcessReaper.h"
+#include "process/ZygoteSpawner.h"
 #include "rest/ConsulConnection.h"
 #include "rest/PrometheusRest.h"
 #include "rest/RestChildObject.h"
@@ -44,6 +49,8 @@ int main(int argc, char *argv[])
 	try
 	{
 		ACE::init();
+		// block SIGCHLD before any thread created, it will be handled by signalfd in reactor
+		ChildSignalHandler::blockSignal();
 
 		// init log
 		Utility::initLogging();
@@ -85,6 +92,12 @@ int main(int argc, char *argv[])
 		Utility::createDirectory(config->getDefaultWorkDir(), 00655);
 		ACE_OS::chdir(config->getDefaultWorkDir().c_str());
 
+		// spawn helper fork from current small address space, before any thread created
+		if (config->getProcessSpawnMode() == "zygote")
+		{
+			ZygoteSpawner::instance()->start();
+		}
+
 		// set log level
 		Utility::setLogLevel(config->getLogLevel());
 		Configuration::instance()->dump();
@@ -124,21 +137,31 @@ int main(int argc, char *argv[])
 		// reg prometheus
 		config->registerPrometheus();
 
-		// start one thread for timer (application & process event & healthcheck & consul report event)
+		// child exit event, trigger application refresh immediately
+		ChildSignalHandler::instance()->open(ACE_Reactor::instance());
+
+		// start dispatch threads for timer (application & process event & healthcheck & consul report event)
+		TimerDispatcher::instance()->start(config->getTimerThreadPoolSize());
+		// start one thread for reactor (timing wheel tick & child exit event)
 		auto timerThreadA = std::make_unique<std::thread>(std::bind(&TimerHandler::runReactorEvent, ACE_Reactor::instance()));
-		// increase thread here
-		//auto timerThreadB = std::make_unique<std::thread>(std::bind(&TimerHandler::runReactorEvent, ACE_Reactor::instance()));
+
+		// health check schedule
+		HealthCheckTask::instance()->initTimer();
 
 		// init consul
 		std::string consulSsnIdFromRecover = snap ? snap->m_consulSessionId : "";
 		ConsulConnection::instance()->initTimer(consulSsnIdFromRecover);
 
-		// monitor applications
+		// monitor applications, with child exit event enabled, this is a safety net sweep
 		while (true)
 		{
 			std::this_thread::sleep_for(std::chrono::seconds(Configuration::instance()->getScheduleInterval()));
 			PerfLog perf(fname);
 
+			// collect exited children in one pass, exit events missed by signalfd reach health check the same way
+			ProcessReaper::instance()->reap();
+			ChildSignalHandler::instance()->dispatchExited(ProcessReaper::instance()->fetchExited());
+
 			// monitor application
 			auto allApp = Configuration::instance()->getApps();
 			for (const auto &app : allApp)
@@ -147,8 +170,6 @@ int main(int argc, char *argv[])
 			}
 
 			PersistManager::instance()->persistSnapshot();
-			// health-check
-			HealthCheckTask::instance()->doHealthCheck();
 		}
 	}
 	catch (const std::exception &e)
@@ -160,6 +181,8 @@ int main(int argc, char *argv[])
 		LOG_ERR << fname << "unknown exception";
 	}
 	LOG_ERR << fname << "ERROR exited";
+	HealthProbe::stopResolver();
+	TimerDispatcher::instance()->stop();
 	ACE::fini();
 	ACE_OS::_exit(0);
 	return 0;
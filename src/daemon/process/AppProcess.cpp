@@ -1,13 +1,24 @@
+#include <csignal>
 #include <fstream>
 #include <thread>
+#include <sys/wait.h>
 
 #include "../../common/DateTime.h"
 #include "../../common/Utility.h"
 #include "../../common/os/pstree.hpp"
+#include "../ChildSignalHandler.h"
 #include "../Configuration.h"
 #include "../ResourceLimitation.h"
 #include "AppProcess.h"
+#include "LaunchPlan.h"
 #include "LinuxCgroup.h"
+#include "OutputCapture.h"
+#include "ProcessReaper.h"
+#include "VforkSpawner.h"
+#include "ZygoteSpawner.h"
+
+// wait capture pipe drained after process exit, pipe may be held by background children
+#define STDOUT_CAPTURE_DRAIN_TIMEOUT_MS 500
 
 #define CLOSE_ACE_HANDLER(handler)         \
 	do                                     \
@@ -20,7 +31,7 @@
 	} while (false)
 
 AppProcess::AppProcess()
-	: m_delayKillTimerId(0), m_stdinHandler(ACE_INVALID_HANDLE), m_stdoutHandler(ACE_INVALID_HANDLE), m_uuid(Utility::createUUID())
+	: m_delayKillTimerId(0), m_stopTimerId(0), m_stdinHandler(ACE_INVALID_HANDLE), m_stdoutHandler(ACE_INVALID_HANDLE), m_captureOutput(false), m_outputOffset(0), m_exitStatus(0), m_exited(false), m_exitTime(0), m_uuid(Utility::createUUID())
 {
 }
 
@@ -30,6 +41,10 @@ AppProcess::~AppProcess()
 	{
 		killgroup();
 	}
+	if (!m_exited && this->getpid() > 1)
+	{
+		ProcessReaper::instance()->unregisterProcess(this->getpid());
+	}
 
 	CLOSE_ACE_HANDLER(m_stdoutHandler);
 	CLOSE_ACE_HANDLER(m_stdinHandler);
@@ -58,6 +73,139 @@ pid_t AppProcess::getpid(void) const
 	return ACE_Process::getpid();
 }
 
+void AppProcess::child(pid_t parent)
+{
+	// SIGCHLD is blocked in daemon for signalfd, signal mask is inherited by exec, restore for child
+	ChildSignalHandler::unblockSignal();
+	// join cgroup before exec, all the processes forked by command are limited
+	if (m_cgroup)
+		m_cgroup->attachSelf();
+}
+
+void AppProcess::parent(pid_t child)
+{
+	const static char fname[] = "AppProcess::parent() ";
+	try
+	{
+		ProcessReaper::instance()->registerProcess(child, std::dynamic_pointer_cast<AppProcess>(this->shared_from_this()));
+	}
+	catch (const std::bad_weak_ptr &ex)
+	{
+		// not managed by shared_ptr, exit status can only be collected by wait()
+		LOG_WAR << fname << "process <" << child << "> not registered to reaper";
+	}
+	// child already joined cgroup before exec, write from parent again in case it failed in child
+	if (m_cgroup)
+		m_cgroup->attach(child);
+}
+
+pid_t AppProcess::spawn(ACE_Process_Options &option)
+{
+	const static char fname[] = "AppProcess::spawn() ";
+
+	const auto mode = Configuration::instance()->getProcessSpawnMode();
+	if (mode == "fork")
+	{
+		return ACE_Process::spawn(option);
+	}
+	pid_t pid = 0;
+	if (mode == "zygote")
+	{
+		// child hook can not run in helper, cgroup.procs fds are passed to join before exec
+		pid = ZygoteSpawner::instance()->spawn(option, m_cgroup ? m_cgroup->procsFds() : std::vector<int>());
+		if (pid == 0)
+		{
+			LOG_DBG << fname << "spawn helper not available, use vfork";
+		}
+	}
+	if (pid == 0)
+	{
+		// child hook run in vfork child, same as ACE_Process::spawn calls child() after fork
+		pid = VforkSpawner::spawn(option, [this]() { this->child(ACE_OS::getppid()); });
+	}
+	if (pid > 0)
+	{
+		this->child_id_ = pid;
+		this->parent(pid);
+	}
+	return pid;
+}
+
+pid_t AppProcess::waitExit(ACE_exitcode *status, int wait_options)
+{
+	if (!m_exited)
+	{
+		auto pid = ACE_Process::wait(status, wait_options);
+		if (pid > 0)
+		{
+			ProcessReaper::instance()->unregisterProcess(pid);
+			// exit_code() is only written by ACE_Process::wait() of this thread
+			m_exitStatus = this->exit_code();
+			m_exitTime = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+			m_exited = true;
+		}
+		if (!(pid < 0 && errno == ECHILD))
+		{
+			return pid;
+		}
+		// collected by ProcessReaper, sync with it to make sure exit status published
+		ProcessReaper::instance()->reap();
+		if (!m_exited)
+		{
+			errno = ECHILD;
+			return pid;
+		}
+	}
+	if (status)
+	{
+		*status = m_exitStatus;
+	}
+	return this->getpid();
+}
+
+pid_t AppProcess::waitExit(const ACE_Time_Value &tv, ACE_exitcode *status)
+{
+	if (!m_exited)
+	{
+		auto pid = ACE_Process::wait(tv, status);
+		if (pid > 0)
+		{
+			ProcessReaper::instance()->unregisterProcess(pid);
+			m_exitStatus = this->exit_code();
+			m_exitTime = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+			m_exited = true;
+		}
+		if (!(pid < 0 && errno == ECHILD))
+		{
+			return pid;
+		}
+		ProcessReaper::instance()->reap();
+		if (!m_exited)
+		{
+			errno = ECHILD;
+			return pid;
+		}
+	}
+	if (status)
+	{
+		*status = m_exitStatus;
+	}
+	return this->getpid();
+}
+
+int AppProcess::returnValue() const
+{
+	return WEXITSTATUS(m_exitStatus.load());
+}
+
+void AppProcess::onExit(ACE_exitcode status)
+{
+	// not write ACE_Process exit code, reaper thread is not the owner of this object
+	m_exitStatus = status;
+	m_exitTime = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	m_exited = true;
+}
+
 void AppProcess::killgroup(int timerId)
 {
 	const static char fname[] = "AppProcess::killgroup() ";
@@ -69,6 +217,7 @@ void AppProcess::killgroup(int timerId)
 		// killed before timer event, cancel timer event
 		this->cancelTimer(m_delayKillTimerId);
 	}
+	this->cancelTimer(m_stopTimerId);
 	if (m_delayKillTimerId > 0 && m_delayKillTimerId == timerId)
 	{
 		// clean timer id, trigger-ing this time.
@@ -79,12 +228,12 @@ void AppProcess::killgroup(int timerId)
 	{
 		ACE_OS::kill(-(this->getpid()), 9);
 		this->terminate();
-		if (this->wait() < 0 && errno != 10) // 10 is ECHILD:No child processes
+		if (this->waitExit() < 0 && errno != 10) // 10 is ECHILD:No child processes
 		{
 			//avoid  zombie process (Interrupted system call)
 			LOG_WAR << fname << "Wait process <" << getpid() << "> to exit failed with error : " << std::strerror(errno);
 			std::this_thread::sleep_for(std::chrono::milliseconds(100));
-			if (this->wait() < 0)
+			if (this->waitExit() < 0)
 			{
 				LOG_ERR << fname << "Retry wait process <" << getpid() << "> failed with error : " << std::strerror(errno);
 			}
@@ -96,16 +245,67 @@ void AppProcess::killgroup(int timerId)
 	}
 }
 
+void AppProcess::stop(int signal, int graceSeconds)
+{
+	const static char fname[] = "AppProcess::stop() ";
+
+	if (!this->running() || this->getpid() <= 1 || m_exited)
+		return;
+	// already stopping, keep the first deadline
+	if (m_stopTimerId > 0 && signal != SIGKILL)
+		return;
+	LOG_INF << fname << "stop process <" << getpid() << "> with signal <" << signal << "> grace seconds <" << graceSeconds << ">.";
+	this->cancelTimer(m_delayKillTimerId);
+	if (!m_stopTime.time_since_epoch().count())
+		m_stopTime = std::chrono::system_clock::now();
+	if (signal != SIGKILL)
+	{
+		ACE_OS::kill(-(this->getpid()), signal);
+		if (graceSeconds > 0)
+		{
+			m_stopTimerId = this->registerTimer(1000L * graceSeconds, 0, std::bind(&AppProcess::onStopTimeout, this, std::placeholders::_1), fname);
+			return;
+		}
+	}
+	this->cancelTimer(m_stopTimerId);
+	ACE_OS::kill(-(this->getpid()), SIGKILL);
+}
+
+void AppProcess::onStopTimeout(int timerId)
+{
+	const static char fname[] = "AppProcess::onStopTimeout() ";
+
+	m_stopTimerId = 0;
+	// pid may be reused after reaped
+	if (!m_exited && this->running() && this->getpid() > 1)
+	{
+		LOG_WAR << fname << "process <" << getpid() << "> not exit in grace period, kill";
+		ACE_OS::kill(-(this->getpid()), SIGKILL);
+	}
+}
+
 void AppProcess::setCgroup(std::shared_ptr<ResourceLimitation> &limit)
 {
 	// https://blog.csdn.net/u011547375/article/details/9851455
+	m_cgroup.reset();
 	if (limit != nullptr)
 	{
-		m_cgroup = std::make_unique<LinuxCgroup>(limit->m_memoryMb, limit->m_memoryVirtMb - limit->m_memoryMb, limit->m_cpuShares);
-		m_cgroup->setCgroup(limit->m_name, getpid(), ++(limit->m_index));
+		m_cgroup = std::make_unique<LinuxCgroup>(limit->m_memoryMb, limit->m_memoryVirtMb - limit->m_memoryMb, limit->m_cpuShares,
+												 limit->m_cpuQuotaPercent, limit->m_pidsMax, limit->m_ioMax);
+		m_cgroup->prepare(limit->m_name, limit->m_reuseIndex);
 	}
 }
 
+long long AppProcess::cgroupMemoryUsage()
+{
+	return m_cgroup ? m_cgroup->readMemoryUsage() : -1;
+}
+
+long long AppProcess::cgroupCpuUsage()
+{
+	return m_cgroup ? m_cgroup->readCpuUsage() : -1;
+}
+
 const std::string AppProcess::getuuid() const
 {
 	return m_uuid;
@@ -116,116 +316,53 @@ void AppProcess::delayKill(std::size_t timeout, const std::string &from)
 	m_delayKillTimerId = this->registerTimer(1000L * timeout, 0, std::bind(&AppProcess::killgroup, this, std::placeholders::_1), from);
 }
 
-// tuple: 1 cmdRoot, 2 parameters
-std::tuple<std::string, std::string> AppProcess::extractCommand(const std::string &cmd)
+int AppProcess::spawnProcess(std::string cmd, std::string user, std::string workDir, std::map<std::string, std::string> envMap, std::shared_ptr<ResourceLimitation> limit, const std::string &stdoutFile, const std::string &stdinFileContent)
 {
-	std::unique_ptr<char[]> buff(new char[cmd.length() + 1]);
-
-	// find the string at the first blank not in a quote, quotes are removed
-	std::size_t idxSrc = 0, idxDst = 0;
-	bool isInQuote = false;
-	while (cmd[idxSrc] != '\0')
-	{
-		if (cmd[idxSrc] == ' ' && !isInQuote)
-		{
-			break;
-		}
-		else if (cmd[idxSrc] == '\"')
-		{
-			isInQuote = isInQuote ^ true;
-		}
-		else
-		{
-			buff[idxDst++] = cmd[idxSrc];
-		}
-		idxSrc++;
-	}
-	buff[idxDst] = '\0';
-
-	// remaining string are the parameters
-	std::string params = cmd.substr(idxSrc);
-	std::string cmdroot = buff.get();
-	return std::tuple<std::string, std::string>(params, cmdroot);
+	return this->spawnProcess(LaunchPlan::compile(cmd, user, workDir, envMap), limit, stdoutFile, stdinFileContent);
 }
 
-int AppProcess::spawnProcess(std::string cmd, std::string user, std::string workDir, std::map<std::string, std::string> envMap, std::shared_ptr<ResourceLimitation> limit, const std::string &stdoutFile, const std::string &stdinFileContent)
+int AppProcess::spawnProcess(std::shared_ptr<LaunchPlan> plan, std::shared_ptr<ResourceLimitation> limit, const std::string &stdoutFile, const std::string &stdinFileContent)
 {
 	const static char fname[] = "AppProcess::spawnProcess() ";
 
 	int pid = -1;
-
-	// check command file existence & permission
-	auto cmdRoot = std::get<1>(extractCommand(cmd));
-	bool checkCmd = true;
-	if (cmdRoot.rfind('/') == std::string::npos && cmdRoot.rfind('\\') == std::string::npos)
+	const auto &cmd = plan->getCommand();
+	if (plan->error().length())
 	{
-		checkCmd = false;
-	}
-	if (checkCmd && !Utility::isFileExist(cmdRoot))
-	{
-		LOG_WAR << fname << "command file <" << cmdRoot << "> does not exist";
-		startError(Utility::stringFormat("command file <%s> does not exist", cmdRoot.c_str()));
-		return ACE_INVALID_PID;
-	}
-	if (checkCmd && ACE_OS::access(cmdRoot.c_str(), X_OK) != 0)
-	{
-		LOG_WAR << fname << "command file <" << cmdRoot << "> does not have execution permission";
-		startError(Utility::stringFormat("command file <%s> does not have execution permission", cmdRoot.c_str()));
+		startError(plan->error());
 		return ACE_INVALID_PID;
 	}
 
-	envMap[ENV_APP_MANAGER_LAUNCH_TIME] = DateTime::formatLocalTime(std::chrono::system_clock::now(), DATE_TIME_FORMAT);
-	std::size_t cmdLength = cmd.length() + ACE_Process_Options::DEFAULT_COMMAND_LINE_BUF_LEN;
-	int totalEnvSize = 0;
-	int totalEnvArgs = 0;
-	Utility::getEnvironmentSize(envMap, totalEnvSize, totalEnvArgs);
-	ACE_Process_Options option(1, cmdLength, totalEnvSize, totalEnvArgs);
-	option.command_line("%s", cmd.c_str());
-	//option.avoid_zombies(1);
-	if (user.empty())
-		user = Configuration::instance()->getDefaultExecUser();
-	if (user != "root")
-	{
-		unsigned int gid, uid;
-		if (Utility::getUid(user, uid, gid))
-		{
-			option.seteuid(uid);
-			option.setruid(uid);
-			option.setegid(gid);
-			option.setrgid(gid);
-		}
-		else
-		{
-			startError(Utility::stringFormat("user <%s> does not exist", user.c_str()));
-			return ACE_INVALID_PID;
-		}
-	}
-	option.setgroup(0); // set group id with the process id, used to kill process group
-	option.inherit_environment(true);
-	option.handle_inheritance(0);
-	if (workDir.length())
-	{
-		option.working_directory(workDir.c_str());
-	}
-	else
-	{
-		option.working_directory(Configuration::instance()->getDefaultWorkDir().c_str()); // set default working dir
-	}
-	std::for_each(envMap.begin(), envMap.end(), [&option](const std::pair<std::string, std::string> &pair) {
-		option.setenv(pair.first.c_str(), "%s", pair.second.c_str());
-		LOG_DBG << "spawnProcess with env: " << pair.first.c_str() << "=" << pair.second.c_str();
-	});
-	option.release_handles();
+	auto option = plan->createOption();
+	plan->apply(*option, DateTime::formatLocalTime(std::chrono::system_clock::now(), DATE_TIME_FORMAT));
+	option->release_handles();
 	// clean if necessary
 	CLOSE_ACE_HANDLER(m_stdoutHandler);
 	CLOSE_ACE_HANDLER(m_stdinHandler);
 	ACE_HANDLE dummy = ACE_INVALID_HANDLE;
 	m_stdoutFileName = stdoutFile;
+	{
+		std::lock_guard<std::recursive_mutex> guard(m_outFileMutex);
+		m_outputBuffer = nullptr;
+		m_outputOffset = 0;
+	}
+	// stdout capture pipe, read end is drained by OutputCapture
+	int capturePipe[2] = {ACE_INVALID_HANDLE, ACE_INVALID_HANDLE};
+	const auto captureMode = Configuration::instance()->getStdoutCaptureMode();
+	if (m_captureOutput && stdoutFile.length() && captureMode != "file" && ::pipe2(capturePipe, O_CLOEXEC) < 0)
+	{
+		LOG_WAR << fname << "Failed to create stdout pipe with error: " << std::strerror(errno);
+		capturePipe[0] = capturePipe[1] = ACE_INVALID_HANDLE;
+	}
 	if (stdoutFile.length() || stdinFileContent.length())
 	{
 		dummy = ACE_OS::open("/dev/null", O_RDWR);
 		m_stdoutHandler = m_stdinHandler = dummy;
-		if (stdoutFile.length())
+		if (capturePipe[1] != ACE_INVALID_HANDLE)
+		{
+			LOG_DBG << fname << "std_out: capture by " << captureMode;
+		}
+		else if (stdoutFile.length())
 		{
 			m_stdoutHandler = ACE_OS::open(stdoutFile.c_str(), O_CREAT | O_WRONLY | O_APPEND | O_TRUNC);
 			LOG_DBG << fname << "std_out: " << stdoutFile;
@@ -240,36 +377,73 @@ int AppProcess::spawnProcess(std::string cmd, std::string user, std::string work
 			m_stdinHandler = ACE_OS::open(m_stdinFileName.c_str(), O_RDONLY);
 			LOG_DBG << fname << "std_in: " << m_stdinFileName << " : " << stdinFileContent;
 		}
-		option.set_handles(m_stdinHandler, m_stdoutHandler, m_stdoutHandler);
-	}
-	// do not inherit LD_LIBRARY_PATH to child
-	static const std::string ldEnv = ACE_OS::getenv("LD_LIBRARY_PATH") ? ACE_OS::getenv("LD_LIBRARY_PATH") : "";
-	if (!ldEnv.empty() && !envMap.count("LD_LIBRARY_PATH"))
-	{
-		std::string env = ldEnv;
-		env = Utility::stringReplace(env, "/opt/appmesh/lib64:", "");
-		env = Utility::stringReplace(env, ":/opt/appmesh/lib64", "");
-		option.setenv("LD_LIBRARY_PATH", "%s", env.c_str());
+		if (capturePipe[1] != ACE_INVALID_HANDLE)
+		{
+			option->set_handles(m_stdinHandler, capturePipe[1], capturePipe[1]);
+			// duplicated write end must not leak to other children, only dup2 to child stdout/stderr
+			ACE_OS::fcntl(option->get_stdout(), F_SETFD, FD_CLOEXEC);
+			ACE_OS::fcntl(option->get_stderr(), F_SETFD, FD_CLOEXEC);
+			ACE_OS::close(capturePipe[1]);
+		}
+		else
+		{
+			option->set_handles(m_stdinHandler, m_stdoutHandler, m_stdoutHandler);
+		}
 	}
-	if (this->spawn(option) >= 0)
+	// cgroup is prepared before fork and joined by child before exec
+	this->setCgroup(limit);
+	if (this->spawn(*option) >= 0)
 	{
 		pid = this->getpid();
 		LOG_INF << fname << "Process <" << cmd << "> started with pid <" << pid << ">.";
-		this->setCgroup(limit);
+		if (capturePipe[0] != ACE_INVALID_HANDLE)
+		{
+			auto outputBuffer = captureMode == "pipe"
+									? OutputCapture::instance()->add(capturePipe[0], stdoutFile, Configuration::instance()->getStdoutBufferSize(), m_outputRotate)
+									: OutputCapture::instance()->add(capturePipe[0], "", Configuration::instance()->getStdoutBufferSize());
+			capturePipe[0] = ACE_INVALID_HANDLE;
+			std::lock_guard<std::recursive_mutex> guard(m_outFileMutex);
+			m_outputBuffer = outputBuffer;
+		}
 	}
 	else
 	{
+		m_cgroup.reset();
 		pid = -1;
 		LOG_ERR << fname << "Process:<" << cmd << "> start failed with error : " << std::strerror(errno);
 		startError(Utility::stringFormat("start failed with error <%s>", std::strerror(errno)));
 	}
 	if (dummy != ACE_INVALID_HANDLE)
+	{
+		// handler still refer to dummy is not owned, fd number may be reused after close
+		if (m_stdoutHandler == dummy)
+			m_stdoutHandler = ACE_INVALID_HANDLE;
+		if (m_stdinHandler == dummy)
+			m_stdinHandler = ACE_INVALID_HANDLE;
 		ACE_OS::close(dummy);
+	}
+	if (capturePipe[0] != ACE_INVALID_HANDLE)
+		ACE_OS::close(capturePipe[0]);
 	return pid;
 }
 
-const std::string AppProcess::fetchOutputMsg()
+std::shared_ptr<OutputBuffer> AppProcess::getOutputBuffer() const
 {
+	std::lock_guard<std::recursive_mutex> guard(m_outFileMutex);
+	return m_outputBuffer;
+}
+
+const std::string AppProcess::fetchOutputMsg(bool waitDrain)
+{
+	auto outputBuffer = getOutputBuffer();
+	if (outputBuffer)
+	{
+		// exited process: pipe may still have data not drained, do not wait under lock
+		if (m_exited && waitDrain)
+			outputBuffer->waitClosed(std::chrono::milliseconds(STDOUT_CAPTURE_DRAIN_TIMEOUT_MS));
+		std::lock_guard<std::recursive_mutex> guard(m_outFileMutex);
+		return outputBuffer->read(m_outputOffset);
+	}
 	std::lock_guard<std::recursive_mutex> guard(m_outFileMutex);
 	if (m_stdoutReadStream == nullptr)
 		m_stdoutReadStream = std::make_shared<std::ifstream>(m_stdoutFileName, ios::in);
@@ -282,6 +456,15 @@ const std::string AppProcess::fetchOutputMsg()
 	return std::string();
 }
 
+bool AppProcess::outputDrained() const
+{
+	auto outputBuffer = getOutputBuffer();
+	if (outputBuffer == nullptr || outputBuffer->closed())
+		return true;
+	const auto now = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	return m_exited && now - m_exitTime >= STDOUT_CAPTURE_DRAIN_TIMEOUT_MS;
+}
+
 const std::string AppProcess::fetchLine()
 {
 	char buffer[512] = {0};
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <functional>
 #include <map>
 #include <string>
 
@@ -7,7 +10,10 @@
 
 #include "../TimerHandler.h"
 
+class ContainerStats;
+class LaunchPlan;
 class LinuxCgroup;
+class OutputBuffer;
 class ResourceLimitation;
 /// <summary>
 /// Process Object, inherit from ACE_Process
@@ -27,6 +33,7 @@ public:
 	const std::string getuuid() const;
 	virtual std::string containerId() const { return std::string(); };
 	virtual void containerId(const std::string &containerId){};
+	virtual std::shared_ptr<ContainerStats> containerStats() const { return nullptr; };
 
 	/// <summary>
 	/// Attach a existing pid to AppProcess to manage
@@ -38,18 +45,59 @@ public:
 	/// </summary>
 	void detach(void);
 
+	/// <summary>
+	/// Wait process exit, exit status may be collected by ProcessReaper already,
+	/// use this instead of ACE_Process::wait() which can not see status collected by reaper
+	/// </summary>
+	pid_t waitExit(ACE_exitcode *status = 0, int wait_options = 0);
+	pid_t waitExit(const ACE_Time_Value &tv, ACE_exitcode *status = 0);
+	/// <summary>
+	/// Exit code of collected process, use this instead of ACE_Process::return_value()
+	/// which is not synchronized with ProcessReaper
+	/// </summary>
+	int returnValue() const;
+	/// <summary>
+	/// Spawn with ACE fork (or vfork backend / zygote helper by ProcessSpawnMode), override from ACE_Process
+	/// </summary>
+	/// <param name="option">process options</param>
+	/// <returns>process id</returns>
+	virtual pid_t spawn(ACE_Process_Options &option) override;
+	/// <summary>
+	/// Exit status published by ProcessReaper, called in reaper context and should not block
+	/// </summary>
+	/// <param name="status">waitpid status</param>
+	virtual void onExit(ACE_exitcode status);
+
 	/// <summary>
 	/// kill the process group
 	/// </summary>
 	/// <param name="timerId"></param>
 	virtual void killgroup(int timerId = 0);
+	/// <summary>
+	/// Graceful stop, send stop signal to the process group and return without wait,
+	/// SIGKILL the group by timer when still alive after grace period.
+	/// Exit status is collected by ProcessReaper.
+	/// </summary>
+	/// <param name="signal">stop signal, SIGKILL for immediately kill</param>
+	/// <param name="graceSeconds">seconds before escalate to SIGKILL, 0 for immediately</param>
+	virtual void stop(int signal, int graceSeconds);
 
 	/// <summary>
-	/// set resource limitation
+	/// set resource limitation, prepare cgroup before spawn, child process join it before exec
 	/// </summary>
 	/// <param name="limit"></param>
 	virtual void setCgroup(std::shared_ptr<ResourceLimitation> &limit);
 	/// <summary>
+	/// memory usage of process cgroup
+	/// </summary>
+	/// <returns>bytes, -1 for no cgroup</returns>
+	virtual long long cgroupMemoryUsage();
+	/// <summary>
+	/// cpu time of process cgroup
+	/// </summary>
+	/// <returns>nanoseconds, -1 for no cgroup</returns>
+	virtual long long cgroupCpuUsage();
+	/// <summary>
 	/// kill after a time period
 	/// </summary>
 	/// <param name="timeoutSec">seconds</param>
@@ -71,10 +119,49 @@ public:
 							 std::map<std::string, std::string> envMap, std::shared_ptr<ResourceLimitation> limit,
 							 const std::string &stdoutFile = "", const std::string &stdinFileContent = "");
 	/// <summary>
-	/// get all std out content from stdoutFile
+	/// Start process with precompiled launch plan
 	/// </summary>
+	/// <param name="plan">launch plan</param>
+	/// <param name="limit">cgroup limitation</param>
+	/// <param name="stdoutFile">std out output file</param>
+	/// <param name="stdinFileContent">std in string content</param>
+	/// <returns>process id</returns>
+	virtual int spawnProcess(std::shared_ptr<LaunchPlan> plan, std::shared_ptr<ResourceLimitation> limit,
+							 const std::string &stdoutFile = "", const std::string &stdinFileContent = "");
+	/// <summary>
+	/// First stop() request time, epoch for not stopped
+	/// </summary>
+	std::chrono::system_clock::time_point stopTime() const { return m_stopTime; }
+	/// <summary>
+	/// Time exit status was collected, epoch for not exited
+	/// </summary>
+	std::chrono::steady_clock::time_point exitTime() const { return std::chrono::steady_clock::time_point(std::chrono::milliseconds(m_exitTime)); }
+	/// <summary>
+	/// Capture stdout by pipe into ring buffer (StdoutCaptureMode "pipe" or "memory"), set before spawn
+	/// </summary>
+	/// <param name="capture">enable capture</param>
+	/// <param name="rotate">rotate output file while running ("pipe" mode), see OutputCapture::add()</param>
+	void setOutputCapture(bool capture, std::function<bool()> rotate = nullptr)
+	{
+		m_captureOutput = capture;
+		m_outputRotate = rotate;
+	}
+	/// <summary>
+	/// Captured output of current process
+	/// </summary>
+	/// <returns>nullptr when stdout is not captured</returns>
+	std::shared_ptr<OutputBuffer> getOutputBuffer() const;
+	/// <summary>
+	/// get std out content since last fetch
+	/// </summary>
+	/// <param name="waitDrain">wait captured pipe closed for exited process, false to return available data immediately</param>
 	/// <returns></returns>
-	virtual const std::string fetchOutputMsg();
+	virtual const std::string fetchOutputMsg(bool waitDrain = true);
+	/// <summary>
+	/// All captured output is in buffer: stdout not captured, pipe closed, or pipe still
+	/// held by other process after drain timeout since exit
+	/// </summary>
+	bool outputDrained() const;
 	/// <summary>
 	/// get one line from stdoutFile
 	/// </summary>
@@ -93,14 +180,29 @@ public:
 
 protected:
 	/// <summary>
-	/// Parse command line, get cmdRoot and parameters
+	/// Called in child process context after fork and before exec, override from ACE_Process
+	/// </summary>
+	/// <param name="parent">parent process id</param>
+	virtual void child(pid_t parent) override;
+	/// <summary>
+	/// Called in parent process context after fork, override from ACE_Process
+	/// </summary>
+	/// <param name="child">child process id</param>
+	virtual void parent(pid_t child) override;
+
+private:
+	/// <summary>
+	/// Stop grace period timeout, escalate to SIGKILL without wait
 	/// </summary>
-	/// <param name="cmd"></param>
-	/// <returns>tuple: 1 cmdRoot, 2 parameters</returns>
-	std::tuple<std::string, std::string> extractCommand(const std::string &cmd);
+	void onStopTimeout(int timerId);
+
+protected:
+	// first stop() request time
+	std::chrono::system_clock::time_point m_stopTime;
 
 private:
 	int m_delayKillTimerId;
+	int m_stopTimerId;
 
 	ACE_HANDLE m_stdinHandler;
 	ACE_HANDLE m_stdoutHandler;
@@ -108,7 +210,17 @@ private:
 	std::string m_stdoutFileName;
 	mutable std::recursive_mutex m_outFileMutex;
 	std::shared_ptr<std::ifstream> m_stdoutReadStream;
+	bool m_captureOutput;
+	std::function<bool()> m_outputRotate;
+	std::shared_ptr<OutputBuffer> m_outputBuffer;
+	// fetchOutputMsg() position of m_outputBuffer
+	std::uint64_t m_outputOffset;
 
+	// waitpid status, published before m_exited
+	std::atomic<int> m_exitStatus;
+	std::atomic<bool> m_exited;
+	// steady clock milliseconds when exit is collected
+	std::atomic<long long> m_exitTime;
 	std::unique_ptr<LinuxCgroup> m_cgroup;
 	std::shared_ptr<int> m_returnCode;
 	std::string m_uuid;
@@ -0,0 +1,257 @@
+#include <cstring>
+#include <fcntl.h>
+#include <mntent.h>
+#include <sstream>
+#include <unistd.h>
+#include <vector>
+
+#include <ace/OS.h>
+
+#include "../../common/Utility.h"
+#include "ContainerStats.h"
+
+// memory.stat and multi-device io files are larger than one page
+constexpr std::size_t STATS_FILE_BUFFER_SIZE = 16 * 1024;
+
+ContainerStats::ContainerStats(pid_t pid)
+	: m_cgroupV2(false), m_memoryUsageFd(-1), m_memoryStatFd(-1), m_cpuUsageFd(-1), m_blockIoFd(-1), m_netDevFd(-1)
+{
+	const static char fname[] = "ContainerStats::ContainerStats() ";
+
+	const auto &mounts = mountPoints();
+	const auto paths = parseCgroupPaths(Utility::readFile(Utility::stringFormat("/proc/%d/cgroup", pid)));
+	// container cgroup path is relative to the mount point
+	auto cgroupDir = [&mounts, &paths](const std::string &controller) -> std::string {
+		auto mount = mounts.find(controller);
+		auto path = paths.find(controller);
+		if (mount == mounts.end() || path == paths.end())
+			return std::string();
+		return mount->second + path->second;
+	};
+
+	// use v2 when memory controller is not mounted as v1, same as LinuxCgroup
+	const auto memoryDir = cgroupDir("memory");
+	const auto unifiedDir = cgroupDir("");
+	m_cgroupV2 = memoryDir.empty() && unifiedDir.length();
+	if (m_cgroupV2)
+	{
+		m_memoryUsageFd = openFile(unifiedDir + "/memory.current");
+		m_memoryStatFd = openFile(unifiedDir + "/memory.stat");
+		m_cpuUsageFd = openFile(unifiedDir + "/cpu.stat");
+		m_blockIoFd = openFile(unifiedDir + "/io.stat");
+	}
+	else if (memoryDir.length())
+	{
+		m_memoryUsageFd = openFile(memoryDir + "/memory.usage_in_bytes");
+		m_memoryStatFd = openFile(memoryDir + "/memory.stat");
+		const auto cpuacctDir = cgroupDir("cpuacct");
+		if (cpuacctDir.length())
+			m_cpuUsageFd = openFile(cpuacctDir + "/cpuacct.usage");
+		const auto blkioDir = cgroupDir("blkio");
+		if (blkioDir.length())
+			m_blockIoFd = openFile(blkioDir + "/blkio.throttle.io_service_bytes");
+	}
+	// network namespace of the container, fd keep referring to it
+	m_netDevFd = openFile(Utility::stringFormat("/proc/%d/net/dev", pid));
+	LOG_DBG << fname << "container process <" << pid << "> cgroup v2: " << m_cgroupV2 << " memory fd: " << m_memoryUsageFd << " net fd: " << m_netDevFd;
+}
+
+ContainerStats::~ContainerStats()
+{
+	for (auto fd : {m_memoryUsageFd, m_memoryStatFd, m_cpuUsageFd, m_blockIoFd, m_netDevFd})
+	{
+		if (fd >= 0)
+			ACE_OS::close(fd);
+	}
+}
+
+ContainerStats::Sample ContainerStats::sample() const
+{
+	Sample sample;
+	sample.m_cpuNanoSeconds = readCpuUsage();
+	sample.m_memoryBytes = readMemoryUsage();
+	// v1 total_cache include child groups
+	const auto memoryStat = readFile(m_memoryStatFd);
+	sample.m_memoryCacheBytes = parseKeyValue(memoryStat, m_cgroupV2 ? "file" : "total_cache");
+	sample.m_blockReadBytes = sample.m_blockWriteBytes = -1;
+	if (m_blockIoFd >= 0)
+		parseBlockIo(readFile(m_blockIoFd), m_cgroupV2, sample.m_blockReadBytes, sample.m_blockWriteBytes);
+	sample.m_networkRxBytes = sample.m_networkTxBytes = -1;
+	if (m_netDevFd >= 0)
+		parseNetDev(readFile(m_netDevFd), sample.m_networkRxBytes, sample.m_networkTxBytes);
+	return sample;
+}
+
+long long ContainerStats::readMemoryUsage() const
+{
+	const auto content = readFile(m_memoryUsageFd);
+	return content.length() ? std::strtoll(content.c_str(), nullptr, 10) : -1;
+}
+
+long long ContainerStats::readCpuUsage() const
+{
+	const auto content = readFile(m_cpuUsageFd);
+	if (content.empty())
+		return -1;
+	// cpu.stat: usage_usec 21590000
+	if (m_cgroupV2)
+	{
+		auto usage = parseKeyValue(content, "usage_usec");
+		return usage < 0 ? usage : usage * 1000;
+	}
+	return std::strtoll(content.c_str(), nullptr, 10);
+}
+
+std::map<std::string, std::string> ContainerStats::parseCgroupPaths(const std::string &content)
+{
+	// 0::/system.slice/docker-<id>.scope
+	// 4:cpu,cpuacct:/docker/<id>
+	std::map<std::string, std::string> paths;
+	std::istringstream stream(content);
+	std::string line;
+	while (std::getline(stream, line))
+	{
+		auto first = line.find(':');
+		auto second = line.find(':', first + 1);
+		if (first == std::string::npos || second == std::string::npos)
+			continue;
+		auto path = line.substr(second + 1);
+		auto controllers = line.substr(first + 1, second - first - 1);
+		if (controllers.empty())
+		{
+			paths[""] = path;
+			continue;
+		}
+		for (const auto &controller : Utility::splitString(controllers, ","))
+			paths[controller] = path;
+	}
+	return paths;
+}
+
+long long ContainerStats::parseKeyValue(const std::string &content, const std::string &key)
+{
+	std::istringstream stream(content);
+	std::string line;
+	while (std::getline(stream, line))
+	{
+		if (line.compare(0, key.length(), key) == 0 && line.length() > key.length() && line[key.length()] == ' ')
+			return std::strtoll(line.c_str() + key.length() + 1, nullptr, 10);
+	}
+	return -1;
+}
+
+void ContainerStats::parseBlockIo(const std::string &content, bool cgroupV2, long long &readBytes, long long &writeBytes)
+{
+	readBytes = writeBytes = 0;
+	std::istringstream stream(content);
+	std::string line;
+	while (std::getline(stream, line))
+	{
+		auto fields = Utility::splitString(line, " ");
+		if (fields.size() < 2)
+			continue;
+		if (cgroupV2)
+		{
+			for (const auto &field : fields)
+			{
+				if (Utility::startWith(field, "rbytes="))
+					readBytes += std::strtoll(field.c_str() + std::strlen("rbytes="), nullptr, 10);
+				else if (Utility::startWith(field, "wbytes="))
+					writeBytes += std::strtoll(field.c_str() + std::strlen("wbytes="), nullptr, 10);
+			}
+		}
+		else if (fields.size() == 3)
+		{
+			// "Total 123" line has only 2 fields
+			if (fields[1] == "Read")
+				readBytes += std::strtoll(fields[2].c_str(), nullptr, 10);
+			else if (fields[1] == "Write")
+				writeBytes += std::strtoll(fields[2].c_str(), nullptr, 10);
+		}
+	}
+}
+
+void ContainerStats::parseNetDev(const std::string &content, long long &rxBytes, long long &txBytes)
+{
+	// Inter-|   Receive                                                |  Transmit
+	//  face |bytes    packets errs drop fifo frame compressed multicast|bytes    packets errs drop fifo colls carrier compressed
+	//   eth0:    1296      16    0    0    0     0          0         0      0       0    0    0    0     0       0          0
+	rxBytes = txBytes = 0;
+	std::istringstream stream(content);
+	std::string line;
+	while (std::getline(stream, line))
+	{
+		auto colon = line.find(':');
+		if (colon == std::string::npos)
+			continue;
+		if (Utility::stdStringTrim(line.substr(0, colon)) == "lo")
+			continue;
+		std::istringstream fields(line.substr(colon + 1));
+		std::vector<long long> values;
+		long long value;
+		while (fields >> value)
+			values.push_back(value);
+		if (values.size() >= 9)
+		{
+			rxBytes += values[0];
+			txBytes += values[8];
+		}
+	}
+}
+
+const std::map<std::string, std::string> &ContainerStats::mountPoints()
+{
+	// mount -t cgroup / cgroup2, read once
+	static const std::map<std::string, std::string> mounts = []() {
+		std::map<std::string, std::string> result;
+		FILE *fp = fopen("/proc/mounts", "r");
+		if (fp == nullptr)
+			return result;
+		struct mntent *entPtr = nullptr;
+		struct mntent entObj;
+		char buffer[4094] = {0};
+		while (nullptr != (entPtr = getmntent_r(fp, &entObj, buffer, sizeof(buffer))))
+		{
+			if (std::string("cgroup2") == entObj.mnt_type)
+			{
+				result[""] = entObj.mnt_dir;
+			}
+			else if (std::string("cgroup") == entObj.mnt_type)
+			{
+				for (const auto &controller : {"memory", "cpuacct", "blkio"})
+				{
+					if (hasmntopt(&entObj, controller))
+						result[controller] = entObj.mnt_dir;
+				}
+			}
+		}
+		fclose(fp);
+		return result;
+	}();
+	return mounts;
+}
+
+int ContainerStats::openFile(const std::string &path)
+{
+	const static char fname[] = "ContainerStats::openFile() ";
+
+	int fd = ACE_OS::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+	{
+		LOG_WAR << fname << "Failed open file <" << path << ">, error :" << std::strerror(errno);
+	}
+	return fd;
+}
+
+std::string ContainerStats::readFile(int fd)
+{
+	if (fd < 0)
+		return std::string();
+
+	// statistics files are regenerated on each read from offset 0, no need re-open
+	char buffer[STATS_FILE_BUFFER_SIZE];
+	auto size = ::pread(fd, buffer, sizeof(buffer) - 1, 0);
+	if (size <= 0)
+		return std::string();
+	return std::string(buffer, size);
+}
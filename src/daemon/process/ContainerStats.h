@@ -0,0 +1,81 @@
+#pragma once
+
+#include <map>
+#include <string>
+
+#include <sys/types.h>
+
+/// <summary>
+/// Resource statistics of a docker container, read from the container cgroup (v1 or v2)
+/// and the network namespace of the container root process (/proc/<pid>/net/dev).
+/// Files are opened once when container started and read by pread for each sample,
+/// no Docker API call and no directory walk for sampling.
+/// </summary>
+class ContainerStats
+{
+public:
+	// -1 for not available
+	struct Sample
+	{
+		long long m_cpuNanoSeconds;
+		long long m_memoryBytes;
+		long long m_memoryCacheBytes;
+		long long m_blockReadBytes;
+		long long m_blockWriteBytes;
+		long long m_networkRxBytes;
+		long long m_networkTxBytes;
+	};
+
+	/// <summary>
+	/// Open statistics files of the container
+	/// </summary>
+	/// <param name="pid">container root process id on host</param>
+	explicit ContainerStats(pid_t pid);
+	virtual ~ContainerStats();
+
+	Sample sample() const;
+	/// <summary>
+	/// memory usage include page cache
+	/// </summary>
+	/// <returns>bytes, -1 for not available</returns>
+	long long readMemoryUsage() const;
+	/// <summary>
+	/// CPU time of all container processes
+	/// </summary>
+	/// <returns>nanoseconds, -1 for not available</returns>
+	long long readCpuUsage() const;
+
+	/// <summary>
+	/// Parse /proc/<pid>/cgroup, "hierarchy-ID:controller-list:cgroup-path" per line
+	/// </summary>
+	/// <returns>key: controller (empty for cgroup v2), value: cgroup path</returns>
+	static std::map<std::string, std::string> parseCgroupPaths(const std::string &content);
+	/// <summary>
+	/// Value of a "key value" line
+	/// </summary>
+	/// <returns>-1 for key not exist</returns>
+	static long long parseKeyValue(const std::string &content, const std::string &key);
+	/// <summary>
+	/// Sum block I/O bytes of all devices,
+	/// v2 io.stat: "8:0 rbytes=1 wbytes=2 rios=3 wios=4", v1 blkio.throttle.io_service_bytes: "8:0 Read 1"
+	/// </summary>
+	static void parseBlockIo(const std::string &content, bool cgroupV2, long long &readBytes, long long &writeBytes);
+	/// <summary>
+	/// Sum receive and transmit bytes of all interfaces except loopback from /proc/<pid>/net/dev
+	/// </summary>
+	static void parseNetDev(const std::string &content, long long &rxBytes, long long &txBytes);
+
+private:
+	// cgroup mount point, key: controller (empty for cgroup v2)
+	static const std::map<std::string, std::string> &mountPoints();
+	static int openFile(const std::string &path);
+	static std::string readFile(int fd);
+
+private:
+	bool m_cgroupV2;
+	int m_memoryUsageFd;
+	int m_memoryStatFd;
+	int m_cpuUsageFd;
+	int m_blockIoFd;
+	int m_netDevFd;
+};
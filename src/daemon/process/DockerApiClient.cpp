@@ -0,0 +1,512 @@
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "../../common/Utility.h"
+#include "../ResourceLimitation.h"
+#include "DockerApiClient.h"
+
+namespace
+{
+	// close socket when request finished or failed
+	struct SocketGuard
+	{
+		explicit SocketGuard(int fd) : m_fd(fd) {}
+		~SocketGuard() { ::close(m_fd); }
+		int m_fd;
+	};
+
+	// split command line by blank, quotes are removed
+	std::vector<std::string> splitCommandLine(const std::string &cmd)
+	{
+		std::vector<std::string> args;
+		std::string arg;
+		bool hasArg = false;
+		char quote = 0;
+		for (auto c : cmd)
+		{
+			if (quote)
+			{
+				if (c == quote)
+					quote = 0;
+				else
+					arg.push_back(c);
+			}
+			else if (c == '\'' || c == '\"')
+			{
+				quote = c;
+				hasArg = true;
+			}
+			else if (std::isspace(static_cast<unsigned char>(c)))
+			{
+				if (hasArg)
+					args.push_back(arg);
+				arg.clear();
+				hasArg = false;
+			}
+			else
+			{
+				arg.push_back(c);
+				hasArg = true;
+			}
+		}
+		if (hasArg)
+			args.push_back(arg);
+		return args;
+	}
+
+	web::json::value toJsonArray(const std::vector<std::string> &values)
+	{
+		auto array = web::json::value::array(values.size());
+		for (std::size_t i = 0; i < values.size(); i++)
+			array[i] = web::json::value::string(values[i]);
+		return array;
+	}
+
+	// -p [ip:]hostPort:containerPort[/proto] or containerPort[/proto]
+	void addPortBinding(const std::string &publish, web::json::value &exposedPorts, web::json::value &portBindings)
+	{
+		auto parts = Utility::splitString(publish, ":");
+		if (parts.empty())
+			return;
+		auto containerPort = parts.back();
+		if (containerPort.find('/') == std::string::npos)
+			containerPort.append("/tcp");
+		exposedPorts[containerPort] = web::json::value::object();
+		auto binding = web::json::value::object();
+		binding["HostIp"] = web::json::value::string(parts.size() > 2 ? parts[0] : "");
+		binding["HostPort"] = web::json::value::string(parts.size() > 1 ? parts[parts.size() - 2] : "");
+		if (!portBindings.has_field(containerPort))
+			portBindings[containerPort] = web::json::value::array();
+		auto &bindings = portBindings[containerPort];
+		bindings[bindings.size()] = binding;
+	}
+} // namespace
+
+DockerApiClient::DockerApiClient(const std::string &socketPath, int timeoutSeconds)
+	: m_socketPath(socketPath.empty() ? defaultSocket() : socketPath), m_timeoutSeconds(timeoutSeconds > 0 ? timeoutSeconds : DOCKER_API_TIMEOUT_SECONDS)
+{
+}
+
+std::string DockerApiClient::defaultSocket()
+{
+	const char *dockerHost = ::getenv("DOCKER_HOST");
+	if (dockerHost && Utility::startWith(dockerHost, "unix://"))
+		return std::string(dockerHost).substr(strlen("unix://"));
+	return DOCKER_SOCKET_FILE;
+}
+
+int DockerApiClient::connect() const
+{
+	int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (fd < 0)
+		throw std::runtime_error(Utility::stringFormat("create socket failed with error <%s>", std::strerror(errno)));
+	struct timeval timeout;
+	timeout.tv_sec = m_timeoutSeconds;
+	timeout.tv_usec = 0;
+	::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+	::setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+	struct sockaddr_un addr;
+	std::memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	std::strncpy(addr.sun_path, m_socketPath.c_str(), sizeof(addr.sun_path) - 1);
+	if (::connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+	{
+		auto error = errno;
+		::close(fd);
+		throw std::runtime_error(Utility::stringFormat("connect to <%s> failed with error <%s>", m_socketPath.c_str(), std::strerror(error)));
+	}
+	return fd;
+}
+
+DockerApiClient::Response DockerApiClient::request(const std::string &method, const std::string &path, const std::string &body, const std::function<bool(const std::string &)> &onData) const
+{
+	const static char fname[] = "DockerApiClient::request() ";
+	LOG_DBG << fname << method << " " << path;
+
+	SocketGuard socket(connect());
+
+	// 1. send request
+	std::string request = method + " " + path + " HTTP/1.1\r\nHost: docker\r\nConnection: close\r\n";
+	if (body.length())
+		request.append("Content-Type: application/json\r\nContent-Length: ").append(std::to_string(body.length())).append("\r\n");
+	request.append("\r\n").append(body);
+	std::size_t sent = 0;
+	while (sent < request.length())
+	{
+		auto size = ::send(socket.m_fd, request.data() + sent, request.length() - sent, MSG_NOSIGNAL);
+		if (size < 0 && errno == EINTR)
+			continue;
+		if (size <= 0)
+			throw std::runtime_error(Utility::stringFormat("send request to Docker failed with error <%s>", std::strerror(errno)));
+		sent += size;
+	}
+
+	// 2. receive, buffer hold data not consumed
+	std::string buffer;
+	auto receive = [&socket, &buffer]() -> bool {
+		char block[16 * 1024];
+		while (true)
+		{
+			auto size = ::recv(socket.m_fd, block, sizeof(block), 0);
+			if (size < 0 && errno == EINTR)
+				continue;
+			if (size < 0)
+				throw std::runtime_error(Utility::stringFormat("receive from Docker failed with error <%s>", std::strerror(errno)));
+			buffer.append(block, size);
+			return size > 0;
+		}
+	};
+
+	// 3. status line & headers
+	std::size_t headerEnd;
+	while ((headerEnd = buffer.find("\r\n\r\n")) == std::string::npos)
+	{
+		if (!receive())
+			throw std::runtime_error("Docker closed connection before response");
+	}
+	Response response;
+	response.m_status = 0;
+	auto header = buffer.substr(0, headerEnd);
+	buffer.erase(0, headerEnd + 4);
+	auto lines = Utility::splitString(header, "\r\n");
+	if (lines.empty() || lines[0].length() < 12 || !Utility::startWith(lines[0], "HTTP/"))
+		throw std::runtime_error("invalid response from Docker");
+	response.m_status = std::atoi(lines[0].c_str() + lines[0].find(' ') + 1);
+	long long contentLength = -1;
+	bool chunked = false;
+	for (std::size_t i = 1; i < lines.size(); i++)
+	{
+		auto colon = lines[i].find(':');
+		if (colon == std::string::npos)
+			continue;
+		auto key = lines[i].substr(0, colon);
+		std::transform(key.begin(), key.end(), key.begin(), ::tolower);
+		auto value = Utility::stdStringTrim(lines[i].substr(colon + 1));
+		if (key == "content-length")
+			contentLength = std::atoll(value.c_str());
+		else if (key == "transfer-encoding" && value.find("chunked") != std::string::npos)
+			chunked = true;
+	}
+
+	// 4. body, error response is always buffered
+	const bool stream = onData && (response.m_status / 100 == 2);
+	bool continueRead = true;
+	auto deliver = [&](const std::string &data) {
+		if (stream)
+			continueRead = onData(data);
+		else
+			response.m_body.append(data);
+	};
+	if (chunked)
+	{
+		while (continueRead)
+		{
+			std::size_t lineEnd;
+			while ((lineEnd = buffer.find("\r\n")) == std::string::npos)
+			{
+				if (!receive())
+					throw std::runtime_error("Docker closed connection in chunked body");
+			}
+			auto chunkSize = std::strtoull(buffer.substr(0, lineEnd).c_str(), nullptr, 16);
+			if (chunkSize == 0)
+				break;
+			while (buffer.length() < lineEnd + 2 + chunkSize + 2)
+			{
+				if (!receive())
+					throw std::runtime_error("Docker closed connection in chunked body");
+			}
+			deliver(buffer.substr(lineEnd + 2, chunkSize));
+			buffer.erase(0, lineEnd + 2 + chunkSize + 2);
+		}
+	}
+	else
+	{
+		long long received = 0;
+		while (continueRead && (contentLength < 0 || received < contentLength))
+		{
+			if (buffer.empty() && !receive())
+			{
+				// body without Content-Length end with connection close
+				if (contentLength >= 0)
+					throw std::runtime_error("Docker closed connection before end of body");
+				break;
+			}
+			if (contentLength >= 0 && received + (long long)buffer.length() > contentLength)
+				buffer.resize(contentLength - received);
+			received += buffer.length();
+			deliver(buffer);
+			buffer.clear();
+		}
+	}
+	return response;
+}
+
+void DockerApiClient::check(const Response &response, const std::string &action)
+{
+	if (response.m_status / 100 == 2)
+		return;
+	std::string message = response.m_body;
+	try
+	{
+		auto json = web::json::value::parse(response.m_body);
+		if (HAS_JSON_FIELD(json, "message"))
+			message = GET_JSON_STR_VALUE(json, "message");
+	}
+	catch (...)
+	{
+	}
+	throw std::runtime_error(Utility::stringFormat("%s failed with status <%d> error <%s>", action.c_str(), response.m_status, Utility::stdStringTrim(message).c_str()));
+}
+
+long long DockerApiClient::imageSize(const std::string &image) const
+{
+	auto response = request("GET", "/images/" + image + "/json");
+	if (response.m_status == 404)
+		return -1;
+	check(response, "inspect image " + image);
+	auto json = web::json::value::parse(response.m_body);
+	return HAS_JSON_FIELD(json, "Size") ? json.at("Size").as_number().to_int64() : 0;
+}
+
+void DockerApiClient::pullImage(const std::string &image, const std::function<bool(const web::json::value &)> &progress) const
+{
+	const static char fname[] = "DockerApiClient::pullImage() ";
+
+	// tag is after the last ':' of the last path part
+	auto fromImage = image;
+	std::string tag = "latest";
+	auto colon = image.rfind(':');
+	if (colon != std::string::npos && (image.rfind('/') == std::string::npos || colon > image.rfind('/')))
+	{
+		fromImage = image.substr(0, colon);
+		tag = image.substr(colon + 1);
+	}
+
+	// progress is one JSON message per line
+	std::string line;
+	std::string error;
+	bool cancelled = false;
+	auto response = request("POST", "/images/create?fromImage=" + encode(fromImage) + "&tag=" + encode(tag), "", [&](const std::string &data) -> bool {
+		line.append(data);
+		std::size_t lineEnd;
+		while ((lineEnd = line.find('\n')) != std::string::npos)
+		{
+			auto message = Utility::stdStringTrim(line.substr(0, lineEnd));
+			line.erase(0, lineEnd + 1);
+			if (message.empty())
+				continue;
+			auto json = web::json::value::parse(message);
+			if (HAS_JSON_FIELD(json, "error"))
+			{
+				error = GET_JSON_STR_VALUE(json, "error");
+				return false;
+			}
+			if (progress && !progress(json))
+			{
+				cancelled = true;
+				return false;
+			}
+		}
+		return true;
+	});
+	check(response, "pull image " + image);
+	if (error.length())
+		throw std::runtime_error(Utility::stringFormat("pull image %s failed with error <%s>", image.c_str(), error.c_str()));
+	if (cancelled)
+		throw std::runtime_error(Utility::stringFormat("pull image %s cancelled", image.c_str()));
+	LOG_INF << fname << "image <" << image << "> pulled";
+}
+
+std::string DockerApiClient::createContainer(const std::string &name, const web::json::value &config) const
+{
+	auto response = request("POST", "/containers/create?name=" + encode(name), config.serialize());
+	check(response, "create container " + name);
+	auto json = web::json::value::parse(response.m_body);
+	return GET_JSON_STR_VALUE(json, "Id");
+}
+
+void DockerApiClient::startContainer(const std::string &id) const
+{
+	auto response = request("POST", "/containers/" + encode(id) + "/start");
+	// 304: already started
+	if (response.m_status != 304)
+		check(response, "start container " + id);
+}
+
+pid_t DockerApiClient::containerPid(const std::string &id) const
+{
+	auto response = request("GET", "/containers/" + encode(id) + "/json");
+	check(response, "inspect container " + id);
+	auto json = web::json::value::parse(response.m_body);
+	if (HAS_JSON_FIELD(json, "State") && HAS_JSON_FIELD(json.at("State"), "Pid"))
+		return json.at("State").at("Pid").as_integer();
+	return 0;
+}
+
+bool DockerApiClient::stopContainer(const std::string &id, int signal, int graceSeconds) const
+{
+	auto response = request("POST", "/containers/" + encode(id) + "/stop?t=" + std::to_string(graceSeconds) + "&signal=" + std::to_string(signal));
+	if (response.m_status == 404)
+		return false;
+	// 304: already stopped
+	if (response.m_status != 304)
+		check(response, "stop container " + id);
+	return true;
+}
+
+bool DockerApiClient::removeContainer(const std::string &id) const
+{
+	auto response = request("DELETE", "/containers/" + encode(id) + "?force=1");
+	if (response.m_status == 404)
+		return false;
+	check(response, "remove container " + id);
+	return true;
+}
+
+std::string DockerApiClient::containerLogs(const std::string &id, long long sinceSeconds) const
+{
+	auto response = request("GET", "/containers/" + encode(id) + "/logs?stdout=1&stderr=1&since=" + std::to_string(sinceSeconds));
+	check(response, "get container logs " + id);
+	return demuxLogs(response.m_body);
+}
+
+web::json::value DockerApiClient::containerConfig(const std::string &image, const std::string &cmd, const std::map<std::string, std::string> &envMap, const std::shared_ptr<ResourceLimitation> &limit, const std::vector<std::string> &binds)
+{
+	const static char fname[] = "DockerApiClient::containerConfig() ";
+
+	auto config = web::json::value::object();
+	auto hostConfig = web::json::value::object();
+	auto exposedPorts = web::json::value::object();
+	auto portBindings = web::json::value::object();
+	std::vector<std::string> envs;
+	std::vector<std::string> volumes = binds;
+
+	config["Image"] = web::json::value::string(image);
+	auto args = splitCommandLine(cmd);
+	if (args.size())
+		config["Cmd"] = toJsonArray(args);
+	for (const auto &env : envMap)
+	{
+		if (env.first != ENV_APP_MANAGER_DOCKER_PARAMS)
+		{
+			envs.push_back(env.first + "=" + env.second);
+			continue;
+		}
+		// docker run options, value is "--opt value" or "--opt=value"
+		auto opts = splitCommandLine(env.second);
+		for (std::size_t i = 0; i < opts.size(); i++)
+		{
+			auto opt = opts[i];
+			std::string value;
+			bool inlineValue = false;
+			auto equal = opt.find('=');
+			if (Utility::startWith(opt, "--") && equal != std::string::npos)
+			{
+				value = opt.substr(equal + 1);
+				opt = opt.substr(0, equal);
+				inlineValue = true;
+			}
+			auto nextValue = [&]() -> std::string {
+				if (inlineValue)
+					return value;
+				return (i + 1 < opts.size()) ? opts[++i] : std::string();
+			};
+			if (opt == "-p" || opt == "--publish")
+				addPortBinding(nextValue(), exposedPorts, portBindings);
+			else if (opt == "-v" || opt == "--volume")
+				volumes.push_back(nextValue());
+			else if (opt == "-e" || opt == "--env")
+				envs.push_back(nextValue());
+			else if (opt == "--network" || opt == "--net")
+				hostConfig["NetworkMode"] = web::json::value::string(nextValue());
+			else if (opt == "-h" || opt == "--hostname")
+				config["Hostname"] = web::json::value::string(nextValue());
+			else if (opt == "-u" || opt == "--user")
+				config["User"] = web::json::value::string(nextValue());
+			else if (opt == "-w" || opt == "--workdir")
+				config["WorkingDir"] = web::json::value::string(nextValue());
+			else if (opt == "--privileged")
+				hostConfig["Privileged"] = web::json::value::boolean(true);
+			else
+				LOG_WAR << fname << "unsupported docker option <" << opt << "> ignored";
+		}
+	}
+	if (envs.size())
+		config["Env"] = toJsonArray(envs);
+	if (exposedPorts.size())
+	{
+		config["ExposedPorts"] = exposedPorts;
+		hostConfig["PortBindings"] = portBindings;
+	}
+	if (volumes.size())
+		hostConfig["Binds"] = toJsonArray(volumes);
+	if (limit != nullptr)
+	{
+		if (limit->m_memoryMb)
+		{
+			hostConfig["Memory"] = web::json::value::number((int64_t)limit->m_memoryMb * 1024 * 1024);
+			// memory + swap
+			if (limit->m_memoryVirtMb && limit->m_memoryVirtMb > limit->m_memoryMb)
+				hostConfig["MemorySwap"] = web::json::value::number((int64_t)limit->m_memoryVirtMb * 1024 * 1024);
+		}
+		if (limit->m_cpuShares)
+			hostConfig["CpuShares"] = web::json::value::number((int64_t)limit->m_cpuShares);
+		// 100 percent is one core, 1e9 nano CPUs
+		if (limit->m_cpuQuotaPercent)
+			hostConfig["NanoCpus"] = web::json::value::number((int64_t)limit->m_cpuQuotaPercent * 10000000);
+		if (limit->m_pidsMax)
+			hostConfig["PidsLimit"] = web::json::value::number((int64_t)limit->m_pidsMax);
+	}
+	config["HostConfig"] = hostConfig;
+	return config;
+}
+
+std::string DockerApiClient::demuxLogs(const std::string &stream)
+{
+	// frame: [stream type 0/1/2, 0, 0, 0, size uint32 big endian] + payload
+	std::string output;
+	std::size_t pos = 0;
+	while (pos + 8 <= stream.length())
+	{
+		const auto header = reinterpret_cast<const unsigned char *>(stream.data() + pos);
+		if (header[0] > 2 || header[1] || header[2] || header[3])
+			break;
+		std::size_t size = ((std::size_t)header[4] << 24) | ((std::size_t)header[5] << 16) | ((std::size_t)header[6] << 8) | header[7];
+		pos += 8;
+		output.append(stream, pos, size);
+		pos += size;
+	}
+	// tty container log is not multiplexed
+	if (pos == 0)
+		return stream;
+	if (pos < stream.length())
+		output.append(stream, pos, std::string::npos);
+	return output;
+}
+
+std::string DockerApiClient::encode(const std::string &value)
+{
+	static const char hex[] = "0123456789ABCDEF";
+	std::string result;
+	for (auto c : value)
+	{
+		if (std::isalnum(static_cast<unsigned char>(c)) || c == '-' || c == '_' || c == '.' || c == '~')
+		{
+			result.push_back(c);
+		}
+		else
+		{
+			result.push_back('%');
+			result.push_back(hex[(static_cast<unsigned char>(c) >> 4) & 0xF]);
+			result.push_back(hex[static_cast<unsigned char>(c) & 0xF]);
+		}
+	}
+	return result;
+}
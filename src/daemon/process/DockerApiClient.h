@@ -0,0 +1,102 @@
+#pragma once
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <cpprest/json.h>
+
+class ResourceLimitation;
+
+/// <summary>
+/// Docker Engine API client over unix socket, replace docker CLI processes.
+/// Socket is DOCKER_HOST (unix://<path>) or /var/run/docker.sock,
+/// one connection per request (Connection: close), response body is Content-Length, chunked or until EOF.
+/// Failures (socket error, timeout, non 2xx status) throw std::runtime_error with the Docker message.
+/// </summary>
+class DockerApiClient
+{
+public:
+	struct Response
+	{
+		int m_status;
+		std::string m_body;
+	};
+
+	/// <summary>
+	/// Constructor
+	/// </summary>
+	/// <param name="socketPath">unix socket path, empty for default</param>
+	/// <param name="timeoutSeconds">socket send/receive timeout, 0 for DOCKER_API_TIMEOUT_SECONDS</param>
+	explicit DockerApiClient(const std::string &socketPath = "", int timeoutSeconds = 0);
+	static std::string defaultSocket();
+
+	/// <summary>
+	/// Send one HTTP request
+	/// </summary>
+	/// <param name="method">HTTP method</param>
+	/// <param name="path">path with query</param>
+	/// <param name="body">JSON body, empty for no body</param>
+	/// <param name="onData">called with each body block instead of buffer in Response, return false to stop</param>
+	Response request(const std::string &method, const std::string &path, const std::string &body = "", const std::function<bool(const std::string &)> &onData = nullptr) const noexcept(false);
+
+	/// <summary>
+	/// Image size (GET /images/{name}/json)
+	/// </summary>
+	/// <returns>bytes, -1 for image not exist</returns>
+	long long imageSize(const std::string &image) const;
+	/// <summary>
+	/// Pull image (POST /images/create), blocked until finished
+	/// </summary>
+	/// <param name="progress">called with each progress JSON message, return false to cancel</param>
+	void pullImage(const std::string &image, const std::function<bool(const web::json::value &)> &progress) const;
+	/// <summary>
+	/// Create container (POST /containers/create)
+	/// </summary>
+	/// <returns>container id</returns>
+	std::string createContainer(const std::string &name, const web::json::value &config) const;
+	void startContainer(const std::string &id) const;
+	/// <summary>
+	/// Root process id of a running container (GET /containers/{id}/json)
+	/// </summary>
+	pid_t containerPid(const std::string &id) const;
+	/// <summary>
+	/// Stop container (POST /containers/{id}/stop), blocked until container exit,
+	/// Docker send SIGKILL after grace period
+	/// </summary>
+	/// <param name="signal">stop signal number</param>
+	/// <param name="graceSeconds">seconds before SIGKILL</param>
+	/// <returns>false for container not exist</returns>
+	bool stopContainer(const std::string &id, int signal, int graceSeconds) const;
+	/// <summary>
+	/// Force remove container (DELETE /containers/{id}?force=1)
+	/// </summary>
+	/// <returns>false for container not exist</returns>
+	bool removeContainer(const std::string &id) const;
+	/// <summary>
+	/// stdout and stderr since unix time (GET /containers/{id}/logs)
+	/// </summary>
+	std::string containerLogs(const std::string &id, long long sinceSeconds) const;
+
+	/// <summary>
+	/// Build container create config from app definition, same as docker run parameters:
+	/// APP_DOCKER_OPTS support -p/--publish, -v/--volume, -e/--env, --network/--net, --privileged, --hostname/-h, --user/-u, --workdir/-w
+	/// </summary>
+	static web::json::value containerConfig(const std::string &image, const std::string &cmd, const std::map<std::string, std::string> &envMap, const std::shared_ptr<ResourceLimitation> &limit, const std::vector<std::string> &binds);
+	/// <summary>
+	/// Split multiplexed log stream (8 bytes header per frame), raw stream (tty) is returned as is
+	/// </summary>
+	static std::string demuxLogs(const std::string &stream);
+	static std::string encode(const std::string &value);
+
+private:
+	int connect() const noexcept(false);
+	// throw with message from error response body
+	static void check(const Response &response, const std::string &action);
+
+private:
+	const std::string m_socketPath;
+	const int m_timeoutSeconds;
+};
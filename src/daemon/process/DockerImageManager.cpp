@@ -0,0 +1,217 @@
+#include <algorithm>
+#include <thread>
+
+#include "../../common/DateTime.h"
+#include "../../common/Utility.h"
+#include "../../prom_exporter/gauge.h"
+#include "../rest/PrometheusRest.h"
+#include "DockerApiClient.h"
+#include "DockerImageManager.h"
+
+namespace
+{
+	const char *stateName(DockerImageManager::PullState state)
+	{
+		static const char *names[] = {"queued", "pulling", "done", "failed"};
+		return names[static_cast<int>(state)];
+	}
+} // namespace
+
+double DockerImageManager::ImagePull::progress() const
+{
+	if (m_state == PullState::DONE)
+		return 100;
+	long long current = 0;
+	long long total = 0;
+	for (const auto &layer : m_layers)
+	{
+		current += layer.second.m_current;
+		total += layer.second.m_total;
+	}
+	return total > 0 ? 100.0 * current / total : 0;
+}
+
+DockerImageManager::DockerImageManager()
+	: m_threadCount(0)
+{
+}
+
+DockerImageManager::~DockerImageManager()
+{
+}
+
+std::shared_ptr<DockerImageManager> &DockerImageManager::instance()
+{
+	static auto singleton = std::make_shared<DockerImageManager>();
+	return singleton;
+}
+
+void DockerImageManager::pull(const std::string &image, int timeoutSeconds, const PullCallback &callback)
+{
+	const static char fname[] = "DockerImageManager::pull() ";
+
+	std::lock_guard<std::mutex> guard(m_mutex);
+	auto iter = m_pulls.find(image);
+	if (iter != m_pulls.end() && (iter->second->m_state == PullState::QUEUED || iter->second->m_state == PullState::PULLING))
+	{
+		// join the pull in progress
+		auto &pull = iter->second;
+		pull->m_waiters.push_back(callback);
+		pull->m_timeoutSeconds = std::max(pull->m_timeoutSeconds, timeoutSeconds);
+		LOG_INF << fname << "join pull of image <" << image << ">, waiting: " << pull->m_waiters.size();
+		return;
+	}
+
+	auto pull = std::make_shared<ImagePull>();
+	pull->m_image = image;
+	pull->m_state = PullState::QUEUED;
+	pull->m_timeoutSeconds = timeoutSeconds;
+	pull->m_waiters.push_back(callback);
+	pull->m_requestTime = std::chrono::system_clock::now();
+	if (PrometheusRest::instance())
+	{
+		pull->m_metricState = PrometheusRest::instance()->createPromGauge(
+			PROM_METRIC_NAME_appmesh_docker_image_pull_state, PROM_METRIC_HELP_appmesh_docker_image_pull_state, {{"image", image}});
+		pull->m_metricProgress = PrometheusRest::instance()->createPromGauge(
+			PROM_METRIC_NAME_appmesh_docker_image_pull_progress, PROM_METRIC_HELP_appmesh_docker_image_pull_progress, {{"image", image}});
+	}
+	updateMetrics(pull);
+	// replace finished pull record
+	m_pulls[image] = pull;
+	m_queue.push_back(pull);
+
+	// start pull thread on demand
+	if (m_threadCount < DEFAULT_DOCKER_IMG_PULL_PARALLEL)
+	{
+		m_threadCount++;
+		std::thread(&DockerImageManager::runWorker, this).detach();
+	}
+	LOG_INF << fname << "image <" << image << "> queued, pending pulls: " << m_queue.size();
+}
+
+web::json::value DockerImageManager::status(const std::string &image) const
+{
+	std::lock_guard<std::mutex> guard(m_mutex);
+	auto iter = m_pulls.find(image);
+	if (iter == m_pulls.end())
+		return web::json::value::null();
+
+	const auto &pull = iter->second;
+	auto result = web::json::value::object();
+	result[JSON_KEY_DOCKER_PULL_state] = web::json::value::string(stateName(pull->m_state));
+	result[JSON_KEY_DOCKER_PULL_progress] = web::json::value::number(pull->progress());
+	if (pull->m_status.length())
+		result[JSON_KEY_DOCKER_PULL_status] = web::json::value::string(pull->m_status);
+	if (pull->m_error.length())
+		result[JSON_KEY_DOCKER_PULL_error] = web::json::value::string(pull->m_error);
+	if (pull->m_waiters.size())
+		result[JSON_KEY_DOCKER_PULL_waiters] = web::json::value::number(pull->m_waiters.size());
+	result[JSON_KEY_DOCKER_PULL_request_time] = web::json::value::string(DateTime::formatISO8601Time(pull->m_requestTime));
+	if (pull->m_state != PullState::QUEUED)
+		result[JSON_KEY_DOCKER_PULL_start_time] = web::json::value::string(DateTime::formatISO8601Time(pull->m_startTime));
+	if (pull->m_state == PullState::DONE || pull->m_state == PullState::FAILED)
+		result[JSON_KEY_DOCKER_PULL_finish_time] = web::json::value::string(DateTime::formatISO8601Time(pull->m_finishTime));
+	return result;
+}
+
+void DockerImageManager::runWorker()
+{
+	while (true)
+	{
+		std::shared_ptr<ImagePull> pull;
+		{
+			// thread exit when no pending pull
+			std::lock_guard<std::mutex> guard(m_mutex);
+			if (m_queue.empty())
+			{
+				m_threadCount--;
+				return;
+			}
+			pull = m_queue.front();
+			m_queue.pop_front();
+			pull->m_state = PullState::PULLING;
+			pull->m_startTime = std::chrono::system_clock::now();
+			updateMetrics(pull);
+		}
+		doPull(pull);
+	}
+}
+
+void DockerImageManager::doPull(const std::shared_ptr<ImagePull> &pull)
+{
+	const static char fname[] = "DockerImageManager::doPull() ";
+	LOG_INF << fname << "pulling image <" << pull->m_image << ">";
+
+	std::string error;
+	try
+	{
+		// a pull may go quiet for long time (large layer extraction), receive timeout is the pull timeout
+		int timeoutSeconds = 0;
+		{
+			std::lock_guard<std::mutex> guard(m_mutex);
+			timeoutSeconds = pull->m_timeoutSeconds;
+		}
+		DockerApiClient client("", std::max(timeoutSeconds, DOCKER_API_TIMEOUT_SECONDS));
+		const auto start = std::chrono::steady_clock::now();
+		client.pullImage(pull->m_image, [this, &pull, &start](const web::json::value &message) -> bool {
+			// {"status":"Downloading","progressDetail":{"current":1,"total":2},"id":"layer"}
+			std::lock_guard<std::mutex> guard(m_mutex);
+			pull->m_status = GET_JSON_STR_VALUE(message, "status");
+			auto layerId = GET_JSON_STR_VALUE(message, "id");
+			if (layerId.length())
+			{
+				auto &layer = pull->m_layers[layerId];
+				if (pull->m_status == "Downloading" && HAS_JSON_FIELD(message, "progressDetail"))
+				{
+					const auto &detail = message.at("progressDetail");
+					layer.m_current = GET_JSON_NUMBER_VALUE(detail, "current");
+					layer.m_total = GET_JSON_NUMBER_VALUE(detail, "total");
+				}
+				else if (pull->m_status == "Download complete" || pull->m_status == "Pull complete")
+				{
+					layer.m_current = layer.m_total;
+				}
+			}
+			updateMetrics(pull);
+			return std::chrono::steady_clock::now() - start < std::chrono::seconds(pull->m_timeoutSeconds);
+		});
+		if (client.imageSize(pull->m_image) < 0)
+			error = Utility::stringFormat("image <%s> not exist after pull", pull->m_image.c_str());
+	}
+	catch (const std::exception &e)
+	{
+		error = e.what();
+		LOG_WAR << fname << error;
+	}
+
+	// callback without lock, waiters are not changed after finished
+	std::vector<PullCallback> waiters;
+	{
+		std::lock_guard<std::mutex> guard(m_mutex);
+		pull->m_state = error.empty() ? PullState::DONE : PullState::FAILED;
+		pull->m_error = error;
+		pull->m_finishTime = std::chrono::system_clock::now();
+		waiters.swap(pull->m_waiters);
+		updateMetrics(pull);
+	}
+	LOG_INF << fname << "image <" << pull->m_image << "> pull " << stateName(pull->m_state) << ", notify waiters: " << waiters.size();
+	for (const auto &waiter : waiters)
+	{
+		try
+		{
+			waiter(error);
+		}
+		catch (const std::exception &e)
+		{
+			LOG_WAR << fname << "pull callback failed with error: " << e.what();
+		}
+	}
+}
+
+void DockerImageManager::updateMetrics(const std::shared_ptr<ImagePull> &pull)
+{
+	if (pull->m_metricState)
+		pull->m_metricState->metric().Set(static_cast<int>(pull->m_state));
+	if (pull->m_metricProgress)
+		pull->m_metricProgress->metric().Set(pull->progress());
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <cpprest/json.h>
+
+class GaugeMetric;
+//////////////////////////////////////////////////////////////////////////
+/// Docker image pull manager
+/// Concurrent pulls of the same image are deduplicated to one pull,
+/// pulls run in a bounded number of threads (DEFAULT_DOCKER_IMG_PULL_PARALLEL),
+/// all waiters are called back as soon as the pull finished.
+//////////////////////////////////////////////////////////////////////////
+class DockerImageManager
+{
+public:
+	enum class PullState
+	{
+		QUEUED = 0,
+		PULLING,
+		DONE,
+		FAILED
+	};
+	// called in pull thread, error is empty for success
+	typedef std::function<void(const std::string &error)> PullCallback;
+
+private:
+	struct LayerProgress
+	{
+		long long m_current;
+		long long m_total;
+	};
+	struct ImagePull
+	{
+		std::string m_image;
+		PullState m_state;
+		int m_timeoutSeconds;
+		std::string m_status;
+		std::string m_error;
+		std::map<std::string, LayerProgress> m_layers;
+		std::vector<PullCallback> m_waiters;
+		std::chrono::system_clock::time_point m_requestTime;
+		std::chrono::system_clock::time_point m_startTime;
+		std::chrono::system_clock::time_point m_finishTime;
+		// Prometheus
+		std::shared_ptr<GaugeMetric> m_metricState;
+		std::shared_ptr<GaugeMetric> m_metricProgress;
+
+		double progress() const;
+	};
+
+public:
+	DockerImageManager();
+	virtual ~DockerImageManager();
+	static std::shared_ptr<DockerImageManager> &instance();
+
+	/// <summary>
+	/// Pull image in background, join the running or queued pull of the same image
+	/// </summary>
+	/// <param name="image">docker image</param>
+	/// <param name="timeoutSeconds">pull timeout, the longest one is used for joined pull</param>
+	/// <param name="callback">called when pull finished</param>
+	void pull(const std::string &image, int timeoutSeconds, const PullCallback &callback);
+	/// <summary>
+	/// Pull state and progress of an image, null for never pulled
+	/// </summary>
+	web::json::value status(const std::string &image) const;
+
+private:
+	void runWorker();
+	void doPull(const std::shared_ptr<ImagePull> &pull);
+	// update metrics under lock
+	static void updateMetrics(const std::shared_ptr<ImagePull> &pull);
+
+private:
+	// running pull threads, thread is started on demand and exit when idle
+	std::size_t m_threadCount;
+	// key: image, latest pull of each image
+	std::map<std::string, std::shared_ptr<ImagePull>> m_pulls;
+	std::deque<std::shared_ptr<ImagePull>> m_queue;
+	mutable std::mutex m_mutex;
+};
@@ -1,13 +1,19 @@
+#include <csignal>
 #include <thread>
 
 #include <ace/Barrier.h>
 
-#include "../../common/DateTime.h"
 #include "../../common/Utility.h"
-#include "../../common/os/pstree.hpp"
 #include "../ResourceLimitation.h"
+#include "../TimerDispatcher.h"
+#include "ContainerStats.h"
+#include "DockerApiClient.h"
+#include "DockerImageManager.h"
 #include "DockerProcess.h"
-#include "LinuxCgroup.h"
+#include "LaunchPlan.h"
+
+// container remove in killgroup() block caller
+constexpr int DOCKER_REMOVE_TIMEOUT_SECONDS = 3;
 
 DockerProcess::DockerProcess(const std::string &dockerImage, const std::string &appName)
 	: m_dockerImage(dockerImage),
@@ -24,207 +30,220 @@ void DockerProcess::killgroup(int timerId)
 {
 	const static char fname[] = "DockerProcess::killgroup() ";
 
-	// get and clean container id
-	std::string containerId = this->containerId();
-	this->containerId("");
+	// cancel image pull and container start in progress, get and clean container id,
+	// start thread check cancel with the same lock after container created
+	std::string containerId;
+	{
+		std::lock_guard<std::recursive_mutex> guard(m_processMutex);
+		if (m_imagePullCancel != nullptr)
+			*m_imagePullCancel = true;
+		containerId = m_containerId;
+		m_containerId.clear();
+		m_containerStats = nullptr;
+	}
 
 	// clean docker container
 	if (!containerId.empty())
 	{
-		auto cmd = Utility::stringFormat("docker rm -f %s", containerId.c_str());
-		AppProcess proc;
-		proc.spawnProcess(cmd, "root", "", {}, nullptr);
-		if (proc.wait(ACE_Time_Value(3)) <= 0)
+		try
 		{
-			LOG_ERR << fname << "cmd <" << cmd << "> killed due to timeout";
-			proc.killgroup();
+			DockerApiClient client("", DOCKER_REMOVE_TIMEOUT_SECONDS);
+			client.removeContainer(containerId);
+		}
+		catch (const std::exception &e)
+		{
+			LOG_ERR << fname << "remove container <" << containerId << "> failed: " << e.what();
 		}
 	}
 
-	if (m_imagePullProc != nullptr && m_imagePullProc->running())
-	{
-		m_imagePullProc->killgroup();
-	}
 	// detach manually
 	this->detach();
 }
 
-int DockerProcess::syncSpawnProcess(std::string cmd, std::string execUser, std::string workDir, std::map<std::string, std::string> envMap, std::shared_ptr<ResourceLimitation> limit, std::string stdoutFile)
+void DockerProcess::stop(int signal, int graceSeconds)
 {
-	const static char fname[] = "DockerProcess::syncSpawnProcess() ";
-
-	// always use root user to talk to start docker cli
-	killgroup();
-	int pid = ACE_INVALID_PID;
-	constexpr int dockerCliTimeoutSec = 5;
-	std::string containerName = m_containerName;
+	const static char fname[] = "DockerProcess::stop() ";
 
-	// 0. clean old docker container (docker container will left when host restart)
-	std::string dockerCommand = Utility::stringFormat("docker rm -f %s", containerName.c_str());
-	AppProcess proc;
-	proc.spawnProcess(dockerCommand, "root", "", {}, nullptr, stdoutFile);
-	proc.wait();
-
-	// 1. check docker image
-	dockerCommand = Utility::stringFormat("docker inspect -f '{{.Size}}' %s", m_dockerImage.c_str());
-	auto dockerProcess = std::make_shared<AppProcess>();
-	pid = dockerProcess->spawnProcess(dockerCommand, "root", "", {}, nullptr, stdoutFile);
-	dockerProcess->delayKill(dockerCliTimeoutSec, fname);
-	dockerProcess->wait();
-	auto imageSizeStr = Utility::stdStringTrim(dockerProcess->fetchLine());
-	if (!Utility::isNumber(imageSizeStr) || std::stoi(imageSizeStr) < 1)
+	std::string containerId;
 	{
-		LOG_WAR << fname << "docker image <" << m_dockerImage << "> not exist, try to pull.";
-		startError(Utility::stringFormat("docker image <%s> not exist, try to pull.", m_dockerImage.c_str()));
-
-		// pull docker image
-		int pullTimeout = 5 * 60; //set default image pull timeout to 5 minutes
-		if (envMap.count(ENV_APP_MANAGER_DOCKER_IMG_PULL_TIMEOUT) && Utility::isNumber(envMap[ENV_APP_MANAGER_DOCKER_IMG_PULL_TIMEOUT]))
-		{
-			pullTimeout = std::stoi(envMap[ENV_APP_MANAGER_DOCKER_IMG_PULL_TIMEOUT]);
-		}
-		else
-		{
-			LOG_WAR << fname << "use default APP_MANAGER_DOCKER_IMG_PULL_TIMEOUT <" << pullTimeout << ">";
-		}
-		m_imagePullProc = std::make_shared<AppProcess>();
-		m_imagePullProc->spawnProcess("docker pull " + m_dockerImage, "root", workDir, {}, nullptr, stdoutFile);
-		m_imagePullProc->delayKill(pullTimeout, fname);
-		this->attach(m_imagePullProc->getpid());
-		return this->getpid();
+		std::lock_guard<std::recursive_mutex> guard(m_processMutex);
+		// pull callback should not start container for a stopped process
+		if (m_imagePullCancel != nullptr)
+			*m_imagePullCancel = true;
+		// already stopping, keep the first deadline
+		if (m_stopTime.time_since_epoch().count() && signal != SIGKILL)
+			return;
+		if (!m_stopTime.time_since_epoch().count())
+			m_stopTime = std::chrono::system_clock::now();
+		containerId = m_containerId;
 	}
 
-	// 2. build docker start command line
-	dockerCommand = Utility::stringFormat("docker run -d --name %s ", containerName.c_str());
-	for (auto env : envMap)
-	{
-		if (env.first == ENV_APP_MANAGER_DOCKER_PARAMS)
-		{
-			// used for -p -v parameter
-			dockerCommand.append(" ");
-			dockerCommand.append(env.second);
-		}
-		else
-		{
-			bool containSpace = (env.second.find(' ') != env.second.npos);
-
-			dockerCommand += " -e ";
-			dockerCommand += env.first;
-			dockerCommand += "=";
-			if (containSpace)
-				dockerCommand.append("'");
-			dockerCommand += env.second;
-			if (containSpace)
-				dockerCommand.append("'");
-		}
-	}
-	// should match with format from ShellAppFileGen::ShellAppFileGen
-	if (Utility::startWith(cmd, "sh -l "))
+	if (containerId.empty() || signal == SIGKILL || graceSeconds <= 0)
 	{
-		auto scriptFileName = Utility::stdStringTrim(cmd.substr(strlen("sh -l")));
-		if (Utility::isFileExist(scriptFileName))
-		{
-			// mount shell mode script to container
-			dockerCommand.append(" -v ").append(scriptFileName).append(":").append(scriptFileName);
-		}
+		// image pull pending or force stop
+		killgroup();
+		return;
 	}
-	if (limit != nullptr)
-	{
-		if (limit->m_memoryMb)
+
+	LOG_INF << fname << "stop container <" << containerId << "> with signal <" << signal << "> grace seconds <" << graceSeconds << ">.";
+	// docker stop is blocked until container exit, do not block caller,
+	// run in dispatch thread serialized with timer events of this process
+	std::weak_ptr<DockerProcess> weakSelf = std::dynamic_pointer_cast<DockerProcess>(this->shared_from_this());
+	TimerDispatcher::instance()->dispatch(static_cast<TimerHandler *>(this), [weakSelf, containerId, signal, graceSeconds]() {
+		const static char fname[] = "DockerProcess::stop() ";
+		try
 		{
-			dockerCommand.append(" --memory ").append(std::to_string(limit->m_memoryMb)).append("M");
-			if (limit->m_memoryVirtMb && limit->m_memoryVirtMb > limit->m_memoryMb)
-			{
-				dockerCommand.append(" --memory-swap ").append(std::to_string(limit->m_memoryVirtMb - limit->m_memoryMb)).append("M");
-			}
+			DockerApiClient client("", graceSeconds + DOCKER_REMOVE_TIMEOUT_SECONDS);
+			client.stopContainer(containerId, signal, graceSeconds);
 		}
-		if (limit->m_cpuShares)
+		catch (const std::exception &e)
 		{
-			dockerCommand.append(" --cpu-shares ").append(std::to_string(limit->m_cpuShares));
+			LOG_WAR << fname << "stop container <" << containerId << "> failed: " << e.what();
 		}
-	}
-	// Docker container does not restrict container user
-	//if (!execUser.empty()) dockerCommand.append(" --user ").append(execUser);
-	dockerCommand += " " + m_dockerImage;
-	dockerCommand += " " + cmd;
-	LOG_DBG << fname << "dockerCommand: " << dockerCommand;
-
-	// 3. start docker container
-	bool startSuccess = false;
-	dockerProcess = std::make_shared<AppProcess>();
-	pid = dockerProcess->spawnProcess(dockerCommand, "root", "", {}, nullptr, stdoutFile);
-	dockerProcess->delayKill(dockerCliTimeoutSec, fname);
-	dockerProcess->wait();
+		// released process already removed container in destructor
+		auto self = weakSelf.lock();
+		if (self != nullptr && self->containerId() == containerId)
+			self->killgroup();
+	});
+}
 
-	std::string containerId;
-	if (dockerProcess->return_value() == 0)
-	{
-		const auto outmsg = dockerProcess->fetchLine();
-		containerId = Utility::stdStringTrim(outmsg);
-		startSuccess = (containerId.length() > 0);
-		if (!startSuccess)
-		{
-			startError(Utility::stringFormat("failed get docker container <%s> from output <%s>", dockerCommand.c_str(), outmsg.c_str()));
-		}
-	}
-	else
+int DockerProcess::syncSpawnProcess(std::string cmd, std::string execUser, std::string workDir, std::map<std::string, std::string> envMap, std::shared_ptr<ResourceLimitation> limit, std::string stdoutFile)
+{
+	killgroup();
 	{
-		const auto outmsg = dockerProcess->fetchOutputMsg();
-		LOG_WAR << fname << "started container <" << dockerCommand << "failed :" << outmsg;
-		startError(Utility::stringFormat("started docker container <%s> failed with error <%s>", dockerCommand.c_str(), outmsg.c_str()));
+		// new start, cancelled by killgroup() or stop()
+		std::lock_guard<std::recursive_mutex> guard(m_processMutex);
+		m_imagePullCancel = std::make_shared<std::atomic<bool>>(false);
 	}
-	// set container id here for future clean
-	this->containerId(containerId);
+	return startContainer(cmd, envMap, limit, true);
+}
+
+int DockerProcess::startContainer(const std::string &cmd, std::map<std::string, std::string> envMap, const std::shared_ptr<ResourceLimitation> &limit, bool pullImage)
+{
+	const static char fname[] = "DockerProcess::startContainer() ";
 
-	// 4. get docker root pid
-	if (startSuccess)
+	std::string containerName = m_containerName;
+	std::string containerId;
+	DockerApiClient client;
+	try
 	{
-		dockerCommand = Utility::stringFormat("docker inspect -f '{{.State.Pid}}' %s", containerId.c_str());
-		dockerProcess = std::make_shared<AppProcess>();
-		pid = dockerProcess->spawnProcess(dockerCommand, "root", "", {}, nullptr, stdoutFile);
-		dockerProcess->delayKill(dockerCliTimeoutSec, fname);
-		dockerProcess->wait();
-		if (dockerProcess->return_value() == 0)
+		// 0. clean old docker container (docker container will left when host restart)
+		client.removeContainer(containerName);
+
+		// 1. check docker image
+		if (client.imageSize(m_dockerImage) < 1)
 		{
-			auto pidStr = Utility::stdStringTrim(dockerProcess->fetchLine());
-			if (Utility::isNumber(pidStr))
+			if (!pullImage)
+				throw std::runtime_error(Utility::stringFormat("docker image <%s> not exist", m_dockerImage.c_str()));
+
+			LOG_WAR << fname << "docker image <" << m_dockerImage << "> not exist, try to pull.";
+			startError(Utility::stringFormat("docker image <%s> not exist, try to pull.", m_dockerImage.c_str()));
+
+			int pullTimeout = DEFAULT_DOCKER_IMG_PULL_TIMEOUT;
+			if (envMap.count(ENV_APP_MANAGER_DOCKER_IMG_PULL_TIMEOUT) && Utility::isNumber(envMap[ENV_APP_MANAGER_DOCKER_IMG_PULL_TIMEOUT]))
 			{
-				pid = std::stoi(pidStr);
-				if (pid > 1)
-				{
-					// Success
-					this->attach(pid);
-					this->containerId(containerId);
-					LOG_INF << fname << "started pid <" << pid << "> for container :" << containerId;
-					//startError("");
+				pullTimeout = std::stoi(envMap[ENV_APP_MANAGER_DOCKER_IMG_PULL_TIMEOUT]);
+			}
+			else
+			{
+				LOG_WAR << fname << "use default APP_MANAGER_DOCKER_IMG_PULL_TIMEOUT <" << pullTimeout << ">";
+			}
+
+			// the process is treated as running until pull finished, container is started in the pull callback
+			std::shared_ptr<std::atomic<bool>> cancel;
+			{
+				std::lock_guard<std::recursive_mutex> guard(m_processMutex);
+				cancel = m_imagePullCancel;
+				if (*cancel)
 					return this->getpid();
-				}
-				else
+				this->attach(1);
+			}
+			std::weak_ptr<DockerProcess> weakSelf = std::dynamic_pointer_cast<DockerProcess>(this->shared_from_this());
+			DockerImageManager::instance()->pull(m_dockerImage, pullTimeout, [weakSelf, cancel, cmd, envMap, limit](const std::string &error) {
+				auto self = weakSelf.lock();
+				if (self == nullptr || *cancel)
+					return;
+				if (error.length())
 				{
-					startError(Utility::stringFormat("failed get docker container pid <%s> from output <%s>", dockerCommand.c_str(), pidStr.c_str()));
+					// application restart it by next schedule
+					self->startError(error);
+					self->detach();
+					return;
 				}
-			}
-			else
+				// do not block pull thread, other waiters start in parallel
+				std::thread([self, cancel, cmd, envMap, limit]() {
+					if (!*cancel)
+						self->startContainer(cmd, envMap, limit, false);
+				})
+					.detach();
+			});
+			return this->getpid();
+		}
+
+		// 2. build docker container config
+		std::vector<std::string> binds;
+		// should match with format from ShellAppFileGen::ShellAppFileGen
+		if (Utility::startWith(cmd, "sh -l "))
+		{
+			auto scriptFileName = Utility::stdStringTrim(cmd.substr(strlen("sh -l")));
+			if (Utility::isFileExist(scriptFileName))
 			{
-				LOG_WAR << fname << "can not get correct container pid :" << pidStr;
-				startError(Utility::stringFormat("failed get docker container pid <%s> from output <%s>", dockerCommand.c_str(), pidStr.c_str()));
+				// mount shell mode script to container
+				binds.push_back(scriptFileName + ":" + scriptFileName);
 			}
 		}
-		else
+		// Docker container does not restrict container user
+		auto config = DockerApiClient::containerConfig(m_dockerImage, cmd, envMap, limit, binds);
+		LOG_DBG << fname << "container config: " << config.serialize();
+
+		// 3. start docker container, set container id here for future clean
+		containerId = client.createContainer(containerName, config);
+		if (!this->startNotCancelled(containerId))
+		{
+			// killgroup() run during create did not see this container
+			LOG_INF << fname << "start of container <" << containerId << "> cancelled";
+			client.removeContainer(containerId);
+			return this->getpid();
+		}
+		client.startContainer(containerId);
+
+		// 4. get docker root pid
+		auto pid = client.containerPid(containerId);
+		if (pid > 1)
 		{
-			const auto output = dockerProcess->fetchOutputMsg();
-			LOG_WAR << fname << "started container <" << dockerCommand << "failed :" << output;
-			startError(Utility::stringFormat("start docker container <%s> failed <%s>", dockerCommand.c_str(), output.c_str()));
+			std::lock_guard<std::recursive_mutex> guard(m_processMutex);
+			// container is removed by killgroup() after id set
+			if (m_containerId != containerId)
+				return this->getpid();
+			// Success
+			this->attach(pid);
+			m_containerStats = std::make_shared<ContainerStats>(pid);
+			LOG_INF << fname << "started pid <" << pid << "> for container :" << containerId;
+			return this->getpid();
 		}
+		startError(Utility::stringFormat("failed get docker container <%s> pid <%d>", containerId.c_str(), pid));
+	}
+	catch (const std::exception &e)
+	{
+		LOG_WAR << fname << "start container <" << containerName << "> failed: " << e.what();
+		startError(e.what());
 	}
 
 	// failed
 	this->containerId(containerId);
-	this->detach();
 	killgroup();
 	return this->getpid();
 }
 
+bool DockerProcess::startNotCancelled(const std::string &containerId)
+{
+	std::lock_guard<std::recursive_mutex> guard(m_processMutex);
+	if (m_imagePullCancel != nullptr && *m_imagePullCancel)
+		return false;
+	m_containerId = containerId;
+	return true;
+}
+
 pid_t DockerProcess::getpid(void) const
 {
 	if (ACE_Process::getpid() == 1)
@@ -245,6 +264,24 @@ void DockerProcess::containerId(const std::string &containerId)
 	m_containerId = containerId;
 }
 
+std::shared_ptr<ContainerStats> DockerProcess::containerStats() const
+{
+	std::lock_guard<std::recursive_mutex> guard(m_processMutex);
+	return m_containerStats;
+}
+
+long long DockerProcess::cgroupMemoryUsage()
+{
+	auto stats = containerStats();
+	return stats ? stats->readMemoryUsage() : -1;
+}
+
+long long DockerProcess::cgroupCpuUsage()
+{
+	auto stats = containerStats();
+	return stats ? stats->readCpuUsage() : -1;
+}
+
 int DockerProcess::spawnProcess(std::string cmd, std::string execUser, std::string workDir, std::map<std::string, std::string> envMap, std::shared_ptr<ResourceLimitation> limit, const std::string &stdoutFile, const std::string &stdinFileContent)
 {
 	const static char fname[] = "DockerProcess::spawnProcess() ";
@@ -272,6 +309,9 @@ int DockerProcess::spawnProcess(std::string cmd, std::string execUser, std::stri
 	param->barrier = std::make_shared<ACE_Barrier>(2);
 	param->thisProc = std::dynamic_pointer_cast<DockerProcess>(this->shared_from_this());
 
+	// TBD: Docker app should not support short running here, since short running have kill and bellow attach is not real pid
+	// attach before start thread, real pid is attached by thread
+	this->attach(1);
 	m_spawnThread = std::make_shared<std::thread>(
 		[param, stdoutFile]() {
 			const static char fname[] = "DockerProcess::m_spawnThread() ";
@@ -293,25 +333,33 @@ int DockerProcess::spawnProcess(std::string cmd, std::string execUser, std::stri
 		});
 	m_spawnThread->detach();
 	param->barrier->wait();
-	// TBD: Docker app should not support short running here, since short running have kill and bellow attach is not real pid
-	this->attach(1);
 	return 1;
 }
 
-const std::string DockerProcess::fetchOutputMsg()
+int DockerProcess::spawnProcess(std::shared_ptr<LaunchPlan> plan, std::shared_ptr<ResourceLimitation> limit, const std::string &stdoutFile, const std::string &stdinFileContent)
+{
+	// Application pass raw definition to docker process, plan fields are used when called with a plan
+	return this->spawnProcess(plan->getCommand(), plan->getUser(), plan->getWorkDir(), plan->getEnvMap(), limit, stdoutFile, stdinFileContent);
+}
+
+const std::string DockerProcess::fetchOutputMsg(bool waitDrain)
 {
+	const static char fname[] = "DockerProcess::fetchOutputMsg() ";
+
 	std::lock_guard<std::recursive_mutex> guard(m_processMutex);
 	if (m_containerId.length())
 	{
-		//auto microsecondsUTC = std::chrono::duration_cast<std::chrono::seconds>(m_lastFetchTime.time_since_epoch()).count();
-		auto timeSince = DateTime::formatRFC3339Time(m_lastFetchTime);
-		auto dockerCommand = Utility::stringFormat("docker logs --since %s %s", timeSince.c_str(), m_containerId.c_str());
-
-		auto dockerProcess = std::make_shared<AppProcess>();
-		dockerProcess->spawnProcess(dockerCommand, "root", "", {}, nullptr, m_containerId);
-		dockerProcess->wait();
-		auto msg = dockerProcess->fetchOutputMsg();
-
+		auto since = std::chrono::duration_cast<std::chrono::seconds>(m_lastFetchTime.time_since_epoch()).count();
+		std::string msg;
+		try
+		{
+			DockerApiClient client;
+			msg = client.containerLogs(m_containerId, since);
+		}
+		catch (const std::exception &e)
+		{
+			LOG_WAR << fname << e.what();
+		}
 		m_lastFetchTime = std::chrono::system_clock::now();
 		return msg;
 	}
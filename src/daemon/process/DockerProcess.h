@@ -1,5 +1,6 @@
 #pragma once
 
+#include <atomic>
 #include <chrono>
 #include <string>
 #include <thread>
@@ -8,6 +9,7 @@
 
 /// <summary>
 /// Docker Process Object
+/// Container is managed by Docker Engine API (DockerApiClient), no docker CLI process is used.
 /// </summary>
 class DockerProcess : public AppProcess
 {
@@ -22,25 +24,45 @@ public:
 
 	// override with docker behavior
 	virtual void killgroup(int timerId = 0) override;
+	/// <summary>
+	/// Cancel pending image pull, stop container by Docker Engine API in background and remove it
+	/// </summary>
+	virtual void stop(int signal, int graceSeconds) override;
 	virtual int spawnProcess(std::string cmd, std::string execUser, std::string workDir, std::map<std::string, std::string> envMap, std::shared_ptr<ResourceLimitation> limit, const std::string &stdoutFile = "", const std::string &stdinFileContent = "") override;
+	virtual int spawnProcess(std::shared_ptr<LaunchPlan> plan, std::shared_ptr<ResourceLimitation> limit, const std::string &stdoutFile = "", const std::string &stdinFileContent = "") override;
 
 	virtual pid_t getpid(void) const override;
 	virtual std::string containerId() const override;
 	virtual void containerId(const std::string &containerId) override;
+	virtual std::shared_ptr<ContainerStats> containerStats() const override;
+	/// <summary>
+	/// memory usage of container cgroup, include page cache
+	/// </summary>
+	virtual long long cgroupMemoryUsage() override;
+	/// <summary>
+	/// cpu time of container cgroup
+	/// </summary>
+	virtual long long cgroupCpuUsage() override;
 
 	// docker logs
-	virtual const std::string fetchOutputMsg() override;
+	virtual const std::string fetchOutputMsg(bool waitDrain = true) override;
 	virtual const std::string fetchLine() override;
 
 private:
 	virtual int syncSpawnProcess(std::string cmd, std::string execUser, std::string workDir, std::map<std::string, std::string> envMap, std::shared_ptr<ResourceLimitation> limit, std::string stdoutFile) noexcept(false);
+	// create and start container, missing image is pulled by DockerImageManager and process is attached to 1 until pull finished
+	int startContainer(const std::string &cmd, std::map<std::string, std::string> envMap, const std::shared_ptr<ResourceLimitation> &limit, bool pullImage);
+	// set created container id when start is not cancelled, false for cancelled
+	bool startNotCancelled(const std::string &containerId);
 
 private:
 	std::string m_dockerImage;
 	std::string m_containerId;
 	std::string m_containerName;
 	std::shared_ptr<std::thread> m_spawnThread;
-	std::shared_ptr<AppProcess> m_imagePullProc;
+	// cancel flag of current start (image pull and container create), set by killgroup() and stop()
+	std::shared_ptr<std::atomic<bool>> m_imagePullCancel;
+	std::shared_ptr<ContainerStats> m_containerStats;
 	mutable std::recursive_mutex m_processMutex;
 	std::chrono::system_clock::time_point m_lastFetchTime;
 };
@@ -0,0 +1,168 @@
+#include <sys/stat.h>
+
+#include <ace/OS.h>
+
+#include "../../common/Utility.h"
+#include "../Configuration.h"
+#include "LaunchPlan.h"
+
+namespace
+{
+	// command root is the string at the first blank not in a quote, quotes are removed
+	std::string extractCommandRoot(const std::string &cmd)
+	{
+		std::string cmdRoot;
+		bool isInQuote = false;
+		for (std::size_t idx = 0; idx < cmd.length(); idx++)
+		{
+			if (cmd[idx] == ' ' && !isInQuote)
+			{
+				break;
+			}
+			else if (cmd[idx] == '\"')
+			{
+				isInQuote = isInQuote ^ true;
+			}
+			else
+			{
+				cmdRoot.push_back(cmd[idx]);
+			}
+		}
+		return cmdRoot;
+	}
+} // namespace
+
+std::shared_ptr<LaunchPlan> LaunchPlan::compile(const std::string &cmd, const std::string &user, const std::string &workDir, const std::map<std::string, std::string> &envMap)
+{
+	const static char fname[] = "LaunchPlan::compile() ";
+
+	auto plan = std::shared_ptr<LaunchPlan>(new LaunchPlan());
+	plan->m_cmd = cmd;
+	plan->m_user = resolveUser(user);
+	plan->m_workDir = resolveWorkDir(workDir);
+	plan->m_envMap = envMap;
+	plan->m_setUser = false;
+	plan->m_uid = plan->m_gid = 0;
+	plan->m_accountVersion = accountFilesVersion();
+
+	// check command file existence & permission
+	auto cmdRoot = extractCommandRoot(cmd);
+	bool checkCmd = true;
+	if (cmdRoot.rfind('/') == std::string::npos && cmdRoot.rfind('\\') == std::string::npos)
+	{
+		checkCmd = false;
+	}
+	if (checkCmd && !Utility::isFileExist(cmdRoot))
+	{
+		LOG_WAR << fname << "command file <" << cmdRoot << "> does not exist";
+		plan->m_error = Utility::stringFormat("command file <%s> does not exist", cmdRoot.c_str());
+		return plan;
+	}
+	if (checkCmd && ACE_OS::access(cmdRoot.c_str(), X_OK) != 0)
+	{
+		LOG_WAR << fname << "command file <" << cmdRoot << "> does not have execution permission";
+		plan->m_error = Utility::stringFormat("command file <%s> does not have execution permission", cmdRoot.c_str());
+		return plan;
+	}
+
+	// user
+	if (plan->m_user != "root")
+	{
+		if (!Utility::getUid(plan->m_user, plan->m_uid, plan->m_gid))
+		{
+			plan->m_error = Utility::stringFormat("user <%s> does not exist", plan->m_user.c_str());
+			return plan;
+		}
+		plan->m_setUser = true;
+	}
+
+	// environment, launch time is set per spawn
+	auto envs = envMap;
+	envs.erase(ENV_APP_MANAGER_LAUNCH_TIME);
+	// do not inherit LD_LIBRARY_PATH to child
+	static const std::string ldEnv = ACE_OS::getenv("LD_LIBRARY_PATH") ? ACE_OS::getenv("LD_LIBRARY_PATH") : "";
+	if (!ldEnv.empty() && !envs.count("LD_LIBRARY_PATH"))
+	{
+		std::string env = ldEnv;
+		env = Utility::stringReplace(env, "/opt/appmesh/lib64:", "");
+		env = Utility::stringReplace(env, ":/opt/appmesh/lib64", "");
+		envs["LD_LIBRARY_PATH"] = env;
+	}
+	for (const auto &env : envs)
+	{
+		plan->m_env.push_back(env.first + "=" + env.second);
+		LOG_DBG << fname << "spawnProcess with env: " << plan->m_env.back();
+	}
+	for (auto &env : plan->m_env)
+	{
+		plan->m_envp.push_back(&env[0]);
+	}
+	plan->m_envp.push_back(nullptr);
+
+	// buffer size of ACE options
+	envs[ENV_APP_MANAGER_LAUNCH_TIME] = std::string(DATE_TIME_FORMAT);
+	plan->m_envSize = plan->m_envCount = 0;
+	Utility::getEnvironmentSize(envs, plan->m_envSize, plan->m_envCount);
+	plan->m_commandLength = cmd.length() + ACE_Process_Options::DEFAULT_COMMAND_LINE_BUF_LEN;
+	return plan;
+}
+
+bool LaunchPlan::match(const std::string &cmd, const std::string &user, const std::string &workDir) const
+{
+	if (m_error.length() || m_cmd != cmd || m_user != resolveUser(user) || m_workDir != resolveWorkDir(workDir))
+	{
+		return false;
+	}
+	// uid/gid lookup result may change with account files
+	return !m_setUser || m_accountVersion == accountFilesVersion();
+}
+
+std::unique_ptr<ACE_Process_Options> LaunchPlan::createOption() const
+{
+	return std::unique_ptr<ACE_Process_Options>(new ACE_Process_Options(1, m_commandLength, m_envSize, m_envCount));
+}
+
+void LaunchPlan::apply(ACE_Process_Options &option, const std::string &launchTime) const
+{
+	option.command_line("%s", m_cmd.c_str());
+	//option.avoid_zombies(1);
+	if (m_setUser)
+	{
+		option.seteuid(m_uid);
+		option.setruid(m_uid);
+		option.setegid(m_gid);
+		option.setrgid(m_gid);
+	}
+	option.setgroup(0); // set group id with the process id, used to kill process group
+	option.inherit_environment(true);
+	option.handle_inheritance(0);
+	option.working_directory(m_workDir.c_str());
+	// ACE copy the strings, the block is shared by all the spawns
+	option.setenv(const_cast<ACE_TCHAR **>(m_envp.data()));
+	option.setenv(ENV_APP_MANAGER_LAUNCH_TIME, "%s", launchTime.c_str());
+}
+
+std::string LaunchPlan::resolveUser(const std::string &user)
+{
+	return user.empty() ? Configuration::instance()->getDefaultExecUser() : user;
+}
+
+std::string LaunchPlan::resolveWorkDir(const std::string &workDir)
+{
+	return workDir.empty() ? Configuration::instance()->getDefaultWorkDir() : workDir;
+}
+
+long long LaunchPlan::accountFilesVersion()
+{
+	long long version = 0;
+	for (auto file : {"/etc/passwd", "/etc/group"})
+	{
+		struct stat st;
+		if (::stat(file, &st) == 0)
+		{
+			// file is replaced (new inode) or modified in place
+			version = version * 31 + st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec + st.st_ino;
+		}
+	}
+	return version;
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <ace/Process.h>
+
+/// <summary>
+/// Immutable launch parameters compiled once from application definition and reused by each start:
+///  1. command line and command file existence & permission check
+///  2. exec user resolved to uid/gid
+///  3. environment block (app env and LD_LIBRARY_PATH fix), only launch time is patched per spawn
+/// A plan is invalid when command, user or working dir changed, or /etc/passwd or /etc/group changed.
+/// </summary>
+class LaunchPlan
+{
+public:
+	/// <summary>
+	/// Compile launch plan, empty user and working dir use default value from Configuration
+	/// </summary>
+	/// <returns>plan, check error() for command or user failure</returns>
+	static std::shared_ptr<LaunchPlan> compile(const std::string &cmd, const std::string &user, const std::string &workDir, const std::map<std::string, std::string> &envMap);
+
+	/// <summary>
+	/// Plan is compiled from the same input and account files are not changed
+	/// </summary>
+	bool match(const std::string &cmd, const std::string &user, const std::string &workDir) const;
+
+	/// <summary>
+	/// Fill command line, user, working dir and environment to ACE options
+	/// </summary>
+	/// <param name="option">ACE options created by createOption()</param>
+	/// <param name="launchTime">value of APP_MANAGER_LAUNCH_TIME</param>
+	void apply(ACE_Process_Options &option, const std::string &launchTime) const;
+	/// <summary>
+	/// Create ACE options with pre-calculated command line and environment buffer size
+	/// </summary>
+	std::unique_ptr<ACE_Process_Options> createOption() const;
+
+	const std::string &error() const { return m_error; }
+	const std::string &getCommand() const { return m_cmd; }
+	const std::string &getUser() const { return m_user; }
+	const std::string &getWorkDir() const { return m_workDir; }
+	const std::map<std::string, std::string> &getEnvMap() const { return m_envMap; }
+
+private:
+	LaunchPlan() = default;
+	static std::string resolveUser(const std::string &user);
+	static std::string resolveWorkDir(const std::string &workDir);
+	// modification signature of /etc/passwd and /etc/group
+	static long long accountFilesVersion();
+
+private:
+	std::string m_cmd;
+	std::string m_user;
+	std::string m_workDir;
+	std::map<std::string, std::string> m_envMap;
+	std::string m_error;
+
+	bool m_setUser;
+	unsigned int m_uid;
+	unsigned int m_gid;
+	long long m_accountVersion;
+
+	// "key=value" list, m_envp point to m_env and end with nullptr
+	std::vector<std::string> m_env;
+	std::vector<char *> m_envp;
+	std::size_t m_commandLength;
+	int m_envSize;
+	int m_envCount;
+};
@@ -1,5 +1,12 @@
+#include <algorithm>
 #include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
 #include <mntent.h>
+#include <mutex>
+#include <unistd.h>
+
+#include <ace/OS.h>
 
 #include "../../common/Utility.h"
 #include "LinuxCgroup.h"
@@ -7,9 +14,19 @@
 constexpr char CGROUP_FEATURE_DIR[] = "/appmesh";
 std::string LinuxCgroup::cgroupMemRootName;
 std::string LinuxCgroup::cgroupCpuRootName;
+std::string LinuxCgroup::cgroupCpuacctRootName;
+std::string LinuxCgroup::cgroupUnifiedRootName;
+bool LinuxCgroup::cgroupV2 = false;
+std::mutex LinuxCgroup::indexMutex;
+std::map<std::string, std::set<int>> LinuxCgroup::usedIndexes;
+std::set<std::string> LinuxCgroup::removedApps;
+// cgroup v2 cpu.max period
+constexpr long long CGROUP_CPU_PERIOD_US = 100000;
 
-LinuxCgroup::LinuxCgroup(long long memLimitBytes, long long memSwapBytes, long long cpuShares)
-	: m_memLimitMb(memLimitBytes), m_memSwapMb(memSwapBytes), m_cpuShares(cpuShares), m_pid(0), cgroupEnabled(false)
+LinuxCgroup::LinuxCgroup(long long memLimitMb, long long memSwapMb, long long cpuShares, long long cpuQuotaPercent, long long pidsMax, const std::string &ioMax)
+	: m_memLimitMb(memLimitMb), m_memSwapMb(memSwapMb), m_cpuShares(cpuShares),
+	  m_cpuQuotaPercent(cpuQuotaPercent), m_pidsMax(pidsMax), m_ioMax(ioMax), m_index(0), m_reuseIndex(true),
+	  cgroupEnabled(false), accountingEnabled(false), m_memoryUsageFd(-1), m_cpuUsageFd(-1), m_cpuUsageBase(0)
 {
 	const static char fname[] = "LinuxCgroup::LinuxCgroup() ";
 
@@ -24,67 +41,352 @@ LinuxCgroup::LinuxCgroup(long long memLimitBytes, long long memSwapBytes, long l
 		m_memLimitMb = m_memSwapMb;
 		LOG_WAR << fname << "m_memLimitMb is setting to m_memSwapMb";
 	}
-	cgroupEnabled = (m_memLimitMb > 0 || m_memSwapMb > 0 || m_cpuShares > 0);
+	cgroupEnabled = (m_memLimitMb > 0 || m_memSwapMb > 0 || m_cpuShares > 0 || m_cpuQuotaPercent > 0 || m_pidsMax > 0 || m_ioMax.length());
 
-	// Only need retrieve once for all
-	static bool retrieved = false;
+	// Only need retrieve once for all, process spawn from multiple dispatch threads
+	static std::once_flag retrieved;
 	static bool swapLimitSupport = true;
-	if (cgroupEnabled && !retrieved)
-	{
-		retrieved = true;
+	static bool accountingSupport = false;
+	std::call_once(retrieved, [this]() {
 		retrieveCgroupHeirarchy();
-		// Check whether swap limit is enabled for OS, by default, Ubuntu does not enable swap limit
-		if (m_memSwapMb > 0 && !Utility::isFileExist(cgroupMemRootName + "/memory.memsw.limit_in_bytes"))
+		// hybrid mode also mount cgroup2 (without controllers), use v2 only when v1 memory hierarchy not exist
+		cgroupV2 = cgroupMemRootName.empty() && cgroupUnifiedRootName.length();
+		if (cgroupV2)
 		{
-			LOG_WAR << fname << "Your kernel does not support swap limit capabilities or the cgroup is not mounted.";
-			swapLimitSupport = false;
+			// memory.swap.max only exist when swap accounting enabled, write failure is logged
+			swapLimitSupport = true;
+			accountingSupport = (ACE_OS::access(cgroupUnifiedRootName.c_str(), W_OK) == 0);
+			// controllers must be enabled from root to parent of leaf group
+			if (accountingSupport)
+				enableControllers(cgroupUnifiedRootName);
+			cgroupUnifiedRootName += CGROUP_FEATURE_DIR;
+			if (accountingSupport && Utility::createDirectory(cgroupUnifiedRootName, 0711))
+			{
+				enableControllers(cgroupUnifiedRootName);
+			}
 		}
-		cgroupMemRootName += CGROUP_FEATURE_DIR;
-		cgroupCpuRootName += CGROUP_FEATURE_DIR;
-	}
-	if (!swapLimitSupport)
+		else
+		{
+			// Check whether swap limit is enabled for OS, by default, Ubuntu does not enable swap limit
+			swapLimitSupport = Utility::isFileExist(cgroupMemRootName + "/memory.memsw.limit_in_bytes");
+			// accounting cgroup for all processes when hierarchy is writable (run as root)
+			accountingSupport = (cgroupMemRootName.length() && cgroupCpuacctRootName.length() && ACE_OS::access(cgroupMemRootName.c_str(), W_OK) == 0);
+			cgroupMemRootName += CGROUP_FEATURE_DIR;
+			cgroupCpuRootName += CGROUP_FEATURE_DIR;
+			cgroupCpuacctRootName += CGROUP_FEATURE_DIR;
+		}
+		LOG_INF << fname << "cgroup v2: " << cgroupV2 << ", cgroup accounting enabled: " << accountingSupport;
+	});
+	if (!swapLimitSupport && m_memSwapMb > 0)
 	{
+		LOG_WAR << fname << "Your kernel does not support swap limit capabilities or the cgroup is not mounted.";
 		m_memSwapMb = 0;
 	}
+	if (!cgroupV2 && (m_pidsMax > 0 || m_ioMax.length()))
+	{
+		LOG_WAR << fname << "pids_max and io_max are only supported with cgroup v2.";
+	}
+	accountingEnabled = accountingSupport;
 }
 
 LinuxCgroup::~LinuxCgroup()
 {
-	if (cgroupEnabled)
+	for (auto fd : m_procsFds)
+		ACE_OS::close(fd);
+	if (m_memoryUsageFd >= 0)
+		ACE_OS::close(m_memoryUsageFd);
+	if (m_cpuUsageFd >= 0)
+		ACE_OS::close(m_cpuUsageFd);
+
+	if (m_index > 0)
+	{
+		// keep directory for next process of this app, charged page cache is reclaimed by kernel on demand
+		releaseIndex(m_appName, m_index, m_reuseIndex);
+	}
+}
+
+void LinuxCgroup::prepare(const std::string &appName, bool reuseIndex)
+{
+	if (!cgroupEnabled && !accountingEnabled)
+		return;
+
+	m_appName = appName;
+	m_reuseIndex = reuseIndex;
+	m_index = acquireIndex(appName);
+	if (cgroupV2)
 	{
-		std::string force_empty_file = cgroupMemoryPath + "/" + "memory.force_empty";
-		if (Utility::isDirExist(cgroupMemoryPath))
+		this->prepareV2(cgroupUnifiedRootName + "/" + appName);
+	}
+	else
+	{
+		this->prepareV1();
+	}
+	auto usage = readCpuUsage();
+	m_cpuUsageBase = usage > 0 ? usage : 0;
+}
+
+void LinuxCgroup::attachSelf() const
+{
+	// writing 0 to cgroup.procs move the writer process, permission checked with opener (root) credential
+	for (auto fd : m_procsFds)
+	{
+		if (::write(fd, "0", 1) < 0)
 		{
-			writeFile(force_empty_file, 0);
+			// no log in child process, parent attach() will retry
 		}
+	}
+}
 
-		Utility::removeDir(cgroupMemoryPath);
-		Utility::removeDir(cgroupCpuPath);
+const std::vector<int> &LinuxCgroup::procsFds() const
+{
+	return m_procsFds;
+}
+
+void LinuxCgroup::attach(int pid)
+{
+	const static char fname[] = "LinuxCgroup::attach() ";
+
+	const auto value = std::to_string(pid);
+	for (auto fd : m_procsFds)
+	{
+		if (ACE_OS::write(fd, value.c_str(), value.length()) < 0)
+		{
+			LOG_WAR << fname << "Failed to move process <" << pid << "> to cgroup of <" << m_appName << "> with error :" << std::strerror(errno);
+		}
 	}
 }
 
-void LinuxCgroup::setCgroup(const std::string &appName, int pid, int index)
+void LinuxCgroup::prepareV1()
 {
-	if (!cgroupEnabled)
-		return;
+	const auto index = std::to_string(m_index);
+	cgroupMemoryPath = cgroupMemRootName + "/" + m_appName + "/" + index;
+	cgroupCpuPath = cgroupCpuRootName + "/" + m_appName + "/" + index;
+	cgroupCpuacctPath = cgroupCpuacctRootName + "/" + m_appName + "/" + index;
 
-	m_pid = pid;
-	cgroupMemoryPath = cgroupMemRootName + "/" + appName + "/" + std::to_string(index);
-	cgroupCpuPath = cgroupCpuRootName + "/" + appName + "/" + std::to_string(index);
+	// reused directory keep limits of previous process, always write all the values
+	if ((m_memLimitMb > 0 || m_memSwapMb > 0 || accountingEnabled) && Utility::createRecursiveDirectory(cgroupMemoryPath, 0711))
+	{
+		// memory.memsw.limit_in_bytes should not less than memory.limit_in_bytes, unset first
+		const bool swapSupport = Utility::isFileExist(cgroupMemoryPath + "/memory.memsw.limit_in_bytes");
+		if (swapSupport)
+		{
+			this->setSwapMemory(cgroupMemoryPath, -1);
+		}
+		this->setPhysicalMemory(cgroupMemoryPath, m_memLimitMb > 0 ? m_memLimitMb * 1024 * 1024 : -1);
+		if (swapSupport && m_memSwapMb > 0)
+		{
+			this->setSwapMemory(cgroupMemoryPath, m_memSwapMb * 1024 * 1024);
+		}
+		this->openProcsFile(cgroupMemoryPath);
+		if (accountingEnabled)
+		{
+			m_memoryUsageFd = this->openFile(cgroupMemoryPath + "/memory.usage_in_bytes", O_RDONLY);
+		}
+	}
+
+	if ((m_cpuShares > 0 || m_cpuQuotaPercent > 0) && Utility::createRecursiveDirectory(cgroupCpuPath, 0711))
+	{
+		// 1024 is the default cpu.shares
+		this->setCpuShares(cgroupCpuPath, m_cpuShares > 0 ? m_cpuShares : 1024);
+		this->setCpuQuota(cgroupCpuPath, m_cpuQuotaPercent);
+		this->openProcsFile(cgroupCpuPath);
+	}
+
+	if (accountingEnabled && Utility::createRecursiveDirectory(cgroupCpuacctPath, 0711))
+	{
+		this->openProcsFile(cgroupCpuacctPath);
+		m_cpuUsageFd = this->openFile(cgroupCpuacctPath + "/cpuacct.usage", O_RDONLY);
+	}
+}
+
+void LinuxCgroup::prepareV2(const std::string &appPath)
+{
+	// one leaf group per process, all controllers in the same directory
+	cgroupMemoryPath = appPath + "/" + std::to_string(m_index);
+	if (!Utility::isDirExist(cgroupMemoryPath))
+	{
+		if (!Utility::createRecursiveDirectory(cgroupMemoryPath, 0711))
+		{
+			return;
+		}
+		// leaf group get controller interface files from parent subtree_control
+		enableControllers(appPath);
+	}
 
-	if (m_memLimitMb > 0 && Utility::createRecursiveDirectory(cgroupMemoryPath, 0711))
+	// reused directory keep limits of previous process, always write all the values,
+	// unset value only write when the interface file exist (controller enabled)
+	auto apply = [this](const std::string &file, const std::string &value, bool set) {
+		const auto path = cgroupMemoryPath + "/" + file;
+		if (set || Utility::isFileExist(path))
+			writeFile(path, value);
+	};
+	apply("memory.max", m_memLimitMb > 0 ? std::to_string(m_memLimitMb * 1024 * 1024) : "max", m_memLimitMb > 0);
+	apply("memory.swap.max", m_memSwapMb > 0 ? std::to_string(m_memSwapMb * 1024 * 1024) : "max", m_memSwapMb > 0);
+	// convert v1 cpu.shares [2-262144] to v2 cpu.weight [1-10000], 100 is the default weight
+	auto weight = m_cpuShares > 0 ? 1 + ((std::max(2LL, std::min(m_cpuShares, 262144LL)) - 2) * 9999) / 262142 : 100;
+	apply("cpu.weight", std::to_string(weight), m_cpuShares > 0);
+	apply("cpu.max", (m_cpuQuotaPercent > 0 ? std::to_string(m_cpuQuotaPercent * CGROUP_CPU_PERIOD_US / 100) : "max") + " " + std::to_string(CGROUP_CPU_PERIOD_US), m_cpuQuotaPercent > 0);
+	apply("pids.max", m_pidsMax > 0 ? std::to_string(m_pidsMax) : "max", m_pidsMax > 0);
+	// io.max accept one device per write, reset devices limited by previous process
+	if (Utility::isFileExist(cgroupMemoryPath + "/io.max"))
 	{
-		this->setPhysicalMemory(cgroupMemoryPath, m_memLimitMb * 1024 * 1024);
+		for (const auto &line : Utility::splitString(Utility::readFile(cgroupMemoryPath + "/io.max"), "\n"))
+		{
+			auto device = Utility::splitString(line, " ");
+			if (device.size() && device[0].length())
+				apply("io.max", device[0] + " rbps=max wbps=max riops=max wiops=max", true);
+		}
+	}
+	for (const auto &device : Utility::splitString(m_ioMax, ";"))
+	{
+		auto line = Utility::stdStringTrim(device);
+		if (line.length())
+			apply("io.max", line, true);
 	}
 
-	if (m_memSwapMb > 0 && Utility::createRecursiveDirectory(cgroupMemoryPath, 0711))
+	// cgroup.procs move the whole process (all threads) with one write
+	this->openProcsFile(cgroupMemoryPath);
+	if (accountingEnabled)
 	{
-		this->setSwapMemory(cgroupMemoryPath, m_memSwapMb * 1024 * 1024);
+		m_memoryUsageFd = this->openFile(cgroupMemoryPath + "/memory.current", O_RDONLY);
+		m_cpuUsageFd = this->openFile(cgroupMemoryPath + "/cpu.stat", O_RDONLY);
 	}
+}
 
-	if (m_cpuShares > 0 && Utility::createRecursiveDirectory(cgroupCpuPath, 0711))
+void LinuxCgroup::enableControllers(const std::string &cgroupPath)
+{
+	// enable the controllers this group can distribute to children
+	// write one by one, one controller missing should not block others
+	const auto controllers = Utility::splitString(Utility::readFile(cgroupPath + "/cgroup.controllers"), " ");
+	for (const auto &controller : {"memory", "cpu", "io", "pids"})
 	{
-		this->setCpuShares(cgroupCpuPath, m_cpuShares);
+		for (const auto &available : controllers)
+		{
+			if (Utility::stdStringTrim(available) == controller)
+			{
+				writeFile(cgroupPath + "/cgroup.subtree_control", std::string("+") + controller);
+				break;
+			}
+		}
+	}
+}
+
+long long LinuxCgroup::readMemoryUsage()
+{
+	return readFile(m_memoryUsageFd);
+}
+
+long long LinuxCgroup::readCpuUsage()
+{
+	// cpu.stat: usage_usec 21590000
+	long long usage = cgroupV2 ? readFile(m_cpuUsageFd, "usage_usec") : readFile(m_cpuUsageFd);
+	if (usage < 0)
+		return usage;
+	if (cgroupV2)
+		usage *= 1000;
+	return std::max(0LL, usage - m_cpuUsageBase);
+}
+
+int LinuxCgroup::acquireIndex(const std::string &appName)
+{
+	const static char fname[] = "LinuxCgroup::acquireIndex() ";
+
+	std::lock_guard<std::mutex> guard(indexMutex);
+	// app is added again with the same name, keep its directories
+	removedApps.erase(appName);
+	auto &used = usedIndexes[appName];
+	for (int index = 1;; index++)
+	{
+		if (used.count(index))
+			continue;
+		// processes escaped from process group may still live in a released directory, do not share with them,
+		// the index is not marked used, so it is checked again and reused once those processes exit
+		bool occupied = false;
+		for (const auto &root : rootPaths())
+		{
+			const auto procs = root + "/" + appName + "/" + std::to_string(index) + "/cgroup.procs";
+			if (Utility::isFileExist(procs) && Utility::stdStringTrim(Utility::readFile(procs)).length())
+			{
+				occupied = true;
+				break;
+			}
+		}
+		if (!occupied)
+		{
+			used.insert(index);
+			return index;
+		}
+		LOG_WAR << fname << "cgroup <" << appName << "/" << index << "> is still used by other process, skip it";
+	}
+}
+
+void LinuxCgroup::releaseIndex(const std::string &appName, int index, bool reuse)
+{
+	std::lock_guard<std::mutex> guard(indexMutex);
+	auto &used = usedIndexes[appName];
+	used.erase(index);
+	if (!reuse)
+	{
+		for (const auto &root : rootPaths())
+			Utility::removeDir(root + "/" + appName + "/" + std::to_string(index));
+	}
+	if (used.empty() && (!reuse || removedApps.count(appName)))
+	{
+		removeAppDirs(appName);
+	}
+}
+
+void LinuxCgroup::removeApp(const std::string &appName)
+{
+	std::lock_guard<std::mutex> guard(indexMutex);
+	auto used = usedIndexes.find(appName);
+	if (used != usedIndexes.end() && used->second.size())
+	{
+		// running process remove directories when release its index
+		removedApps.insert(appName);
+		return;
+	}
+	removeAppDirs(appName);
+}
+
+std::vector<std::string> LinuxCgroup::rootPaths()
+{
+	std::vector<std::string> roots;
+	for (const auto &root : cgroupV2 ? std::vector<std::string>{cgroupUnifiedRootName} : std::vector<std::string>{cgroupMemRootName, cgroupCpuRootName, cgroupCpuacctRootName})
+	{
+		// not retrieved or hierarchy not mounted
+		if (root.length() > std::strlen(CGROUP_FEATURE_DIR))
+			roots.push_back(root);
+	}
+	return roots;
+}
+
+void LinuxCgroup::removeAppDirs(const std::string &appName)
+{
+	const static char fname[] = "LinuxCgroup::removeAppDirs() ";
+
+	usedIndexes.erase(appName);
+	removedApps.erase(appName);
+	for (const auto &root : rootPaths())
+	{
+		const auto appPath = root + "/" + appName;
+		DIR *dir = ::opendir(appPath.c_str());
+		if (dir == nullptr)
+			continue;
+		// instance directories, cgroup interface files can not be removed and go with rmdir
+		std::vector<std::string> indexPaths;
+		struct dirent *entry;
+		while ((entry = ::readdir(dir)) != nullptr)
+		{
+			if (entry->d_type == DT_DIR && entry->d_name[0] != '.')
+				indexPaths.push_back(appPath + "/" + entry->d_name);
+		}
+		::closedir(dir);
+		// rmdir fail for instance directory still used by escaped processes, keep them
+		for (const auto &path : indexPaths)
+			Utility::removeDir(path);
+		if (!Utility::removeDir(appPath))
+			LOG_WAR << fname << "cgroup of <" << appName << "> is still used by other process";
 	}
 }
 
@@ -105,6 +407,13 @@ void LinuxCgroup::retrieveCgroupHeirarchy()
 	char buffer[4094] = {0};
 	while (nullptr != (entPtr = getmntent_r(fp, &entObj, buffer, sizeof(buffer))))
 	{
+		if (std::string("cgroup2") == entObj.mnt_type)
+		{
+			// cgroup2 on /sys/fs/cgroup type cgroup2 (rw,nosuid,nodev,noexec,relatime,nsdelegate)
+			cgroupUnifiedRootName = entObj.mnt_dir;
+			LOG_DBG << fname << "Get unified hierarchy dir : " << cgroupUnifiedRootName;
+			continue;
+		}
 		if (std::string("cgroup") != entObj.mnt_type)
 		{
 			// Ignore none cgroup mount point
@@ -118,6 +427,14 @@ void LinuxCgroup::retrieveCgroupHeirarchy()
 			LOG_DBG << fname << "Get memory hierarchy dir : " << cgroupMemRootName;
 		}
 
+		if (hasmntopt(&entObj, "cpuacct") && hasmntopt(&entObj, "rw") && hasmntopt(&entObj, "relatime"))
+		{
+			// cgroup on /sys/fs/cgroup/cpu,cpuacct type cgroup (rw,nosuid,nodev,noexec,relatime,cpu,cpuacct)
+			// keep the full dir here, cpu and cpuacct may be mounted together
+			cgroupCpuacctRootName = entObj.mnt_dir;
+			LOG_DBG << fname << "Get cpuacct hierarchy dir : " << cgroupCpuacctRootName;
+		}
+
 		if (hasmntopt(&entObj, "cpu") && hasmntopt(&entObj, "rw") && hasmntopt(&entObj, "relatime"))
 		{
 			// get the CPU hierarchy mount point.
@@ -141,27 +458,93 @@ void LinuxCgroup::setPhysicalMemory(const std::string &cgroupPath, long long mem
 {
 	std::string specifiedHeirarchy = cgroupPath + "/" + "memory.limit_in_bytes";
 	writeFile(specifiedHeirarchy, memLimitBytes);
-
-	std::string tasksHeirarchy = cgroupPath + "/" + "tasks";
-	writeFile(tasksHeirarchy, m_pid);
 }
 
 void LinuxCgroup::setSwapMemory(const std::string &cgroupPath, long long memSwapBytes)
 {
 	std::string specifiedHeirarchy = cgroupPath + "/" + "memory.memsw.limit_in_bytes";
 	writeFile(specifiedHeirarchy, memSwapBytes);
-
-	std::string tasksHeirarchy = cgroupPath + "/" + "tasks";
-	writeFile(tasksHeirarchy, m_pid);
 }
 
 void LinuxCgroup::setCpuShares(const std::string &cgroupPath, long long cpuShares)
 {
 	std::string specifiedHeirarchy = cgroupPath + "/" + "cpu.shares";
 	writeFile(specifiedHeirarchy, cpuShares);
+}
+
+void LinuxCgroup::setCpuQuota(const std::string &cgroupPath, long long cpuQuotaPercent)
+{
+	// -1 means no quota
+	writeFile(cgroupPath + "/" + "cpu.cfs_period_us", CGROUP_CPU_PERIOD_US);
+	writeFile(cgroupPath + "/" + "cpu.cfs_quota_us", cpuQuotaPercent > 0 ? cpuQuotaPercent * CGROUP_CPU_PERIOD_US / 100 : -1);
+}
+
+void LinuxCgroup::openProcsFile(const std::string &cgroupPath)
+{
+	auto fd = this->openFile(cgroupPath + "/" + "cgroup.procs", O_WRONLY);
+	if (fd >= 0)
+		m_procsFds.push_back(fd);
+}
+
+int LinuxCgroup::openFile(const std::string &path, int flags)
+{
+	const static char fname[] = "LinuxCgroup::openFile() ";
+
+	// O_CLOEXEC: fd is inherited by fork and closed by exec
+	int fd = ACE_OS::open(path.c_str(), flags | O_CLOEXEC);
+	if (fd < 0)
+	{
+		LOG_WAR << fname << "Failed open file <" << path << ">, error :" << std::strerror(errno);
+	}
+	return fd;
+}
+
+long long LinuxCgroup::readFile(int fd, const char *key)
+{
+	if (fd < 0)
+		return -1;
+
+	// cgroup files are regenerated on each read from offset 0, no need re-open
+	char buffer[512] = {0};
+	auto size = ::pread(fd, buffer, sizeof(buffer) - 1, 0);
+	if (size <= 0)
+		return -1;
+	buffer[size] = '\0';
+	if (key == nullptr)
+		return std::strtoll(buffer, nullptr, 10);
+
+	// flat keyed file, "key value" per line
+	const auto keyLen = std::strlen(key);
+	for (char *line = buffer; line && *line; line = std::strchr(line, '\n') ? std::strchr(line, '\n') + 1 : nullptr)
+	{
+		if (std::strncmp(line, key, keyLen) == 0 && line[keyLen] == ' ')
+			return std::strtoll(line + keyLen + 1, nullptr, 10);
+	}
+	return -1;
+}
 
-	std::string tasksHeirarchy = cgroupPath + "/" + "tasks";
-	writeFile(tasksHeirarchy, m_pid);
+bool LinuxCgroup::writeFile(const std::string &cgroupPath, const std::string &value)
+{
+	const static char fname[] = "LinuxCgroup::writeFile() ";
+
+	// cgroup report write error from write(), not from open()
+	int fd = ACE_OS::open(cgroupPath.c_str(), O_WRONLY | O_CLOEXEC);
+	if (fd < 0)
+	{
+		LOG_ERR << fname << "Failed open file <" << cgroupPath << ">, error :" << std::strerror(errno);
+		return false;
+	}
+	bool result = (ACE_OS::write(fd, value.c_str(), value.length()) == static_cast<ssize_t>(value.length()));
+	if (result)
+	{
+		LOG_DBG << fname << "Write <" << value << "> to file <" << cgroupPath << "> success.";
+	}
+	else
+	{
+		LOG_ERR << fname << "Write <" << value << "> to file <" << cgroupPath << "> failed with error :" << std::strerror(errno);
+	}
+	ACE_OS::close(fd);
+	return result;
 }
 
 void LinuxCgroup::writeFile(const std::string &cgroupPath, long long value)
@@ -1,34 +1,118 @@
 #pragma once
 
+#include <map>
+#include <mutex>
+#include <set>
 #include <string>
+#include <vector>
 
-/// </summary>
+/// <summary>
 /// Linux Cgroup operate interface
+/// support cgroup v1 (memory/cpu/cpuacct hierarchy) and v2 (unified hierarchy)
 /// </summary>
 class LinuxCgroup
 {
 public:
-	explicit LinuxCgroup(long long memLimitBytes, long long memSwapBytes, long long cpuShares);
+	explicit LinuxCgroup(long long memLimitMb, long long memSwapMb, long long cpuShares,
+						 long long cpuQuotaPercent = 0, long long pidsMax = 0, const std::string &ioMax = "");
 	virtual ~LinuxCgroup();
-	void setCgroup(const std::string &appName, int pid, int index);
+
+	/// <summary>
+	/// Prepare cgroup before spawn: take a free instance directory of the app (created once and reused),
+	/// apply limits and open cgroup.procs for attachSelf()
+	/// </summary>
+	/// <param name="appName">application name</param>
+	/// <param name="reuseIndex">keep instance directory for next process, false for run once application</param>
+	void prepare(const std::string &appName, bool reuseIndex = true);
+	/// <summary>
+	/// Move calling process into the prepared cgroup, called in child process after fork and before exec.
+	/// Only write() to fds opened by prepare(), no allocation and no lock.
+	/// </summary>
+	void attachSelf() const;
+	/// <summary>
+	/// cgroup.procs fds opened by prepare(), passed to spawn helper process to join before exec
+	/// </summary>
+	const std::vector<int> &procsFds() const;
+	/// <summary>
+	/// Move process into the prepared cgroup from parent process,
+	/// no change when child already moved itself by attachSelf()
+	/// </summary>
+	/// <param name="pid">process id</param>
+	void attach(int pid);
+
+	/// <summary>
+	/// Memory usage of all processes in cgroup, read from memory.usage_in_bytes
+	/// </summary>
+	/// <returns>bytes, -1 for not available</returns>
+	long long readMemoryUsage();
+	/// <summary>
+	/// CPU time consumed by all processes in cgroup (include exited ones), read from cpuacct.usage
+	/// </summary>
+	/// <returns>nanoseconds, -1 for not available</returns>
+	long long readCpuUsage();
+
+	/// <summary>
+	/// Remove cgroup directories of a removed application, deferred until the last process release its index,
+	/// cancelled when an application with the same name prepare again
+	/// </summary>
+	/// <param name="appName">application name</param>
+	static void removeApp(const std::string &appName);
 
 private:
 	void retrieveCgroupHeirarchy();
+	void prepareV1();
+	void prepareV2(const std::string &appPath);
+	void enableControllers(const std::string &cgroupPath);
+	void setCpuQuota(const std::string &cgroupPath, long long cpuQuotaPercent);
+	void openProcsFile(const std::string &cgroupPath);
+	int openFile(const std::string &path, int flags);
+	long long readFile(int fd, const char *key = nullptr);
 	void setPhysicalMemory(const std::string &cgroupPath, long long memLimitBytes);
 	void setSwapMemory(const std::string &cgroupPath, long long memSwapBytes);
 	void setCpuShares(const std::string &cgroupPath, long long cpuShares);
 	void writeFile(const std::string &cgroupPath, long long value);
+	bool writeFile(const std::string &cgroupPath, const std::string &value);
+
+	// instance directory index, released index is reused by next process of the same app
+	static int acquireIndex(const std::string &appName);
+	static void releaseIndex(const std::string &appName, int index, bool reuse);
+	// hierarchy roots of app directories, called with indexMutex locked
+	static std::vector<std::string> rootPaths();
+	static void removeAppDirs(const std::string &appName);
 
 private:
 	long long m_memLimitMb;
 	long long m_memSwapMb;
 	long long m_cpuShares;
+	long long m_cpuQuotaPercent;
+	long long m_pidsMax;
+	std::string m_ioMax;
 
-	int m_pid;
+	std::string m_appName;
+	int m_index;
+	bool m_reuseIndex;
 	std::string cgroupMemoryPath;
 	std::string cgroupCpuPath;
+	std::string cgroupCpuacctPath;
 	bool cgroupEnabled;
+	bool accountingEnabled;
+	// cgroup.procs opened by parent before fork, child write "0" to join
+	std::vector<int> m_procsFds;
+	// cached fd for accounting files, read by pread without re-open
+	int m_memoryUsageFd;
+	int m_cpuUsageFd;
+	// cpu usage is accumulated in a reused directory, count from prepare()
+	long long m_cpuUsageBase;
 
 	static std::string cgroupMemRootName;
 	static std::string cgroupCpuRootName;
+	static std::string cgroupCpuacctRootName;
+	// cgroup v2 unified hierarchy, used when no v1 memory hierarchy mounted
+	static std::string cgroupUnifiedRootName;
+	static bool cgroupV2;
+
+	static std::mutex indexMutex;
+	static std::map<std::string, std::set<int>> usedIndexes;
+	// removed apps wait for index release before directory removal
+	static std::set<std::string> removedApps;
 };
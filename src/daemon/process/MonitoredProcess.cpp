@@ -1,9 +1,7 @@
-#include <fstream>
-#include <thread>
-
-#include <ace/Process.h>
+#include <cstring>
 
 #include "../../common/Utility.h"
+#include "../TimerDispatcher.h"
 #include "../rest/HttpRequest.h"
 #include "MonitoredProcess.h"
 
@@ -20,51 +18,40 @@ MonitoredProcess::~MonitoredProcess()
 		std::unique_ptr<HttpRequest> response(static_cast<HttpRequest *>(m_httpRequest));
 		m_httpRequest = nullptr;
 	}
-	if (m_thread != nullptr)
-		m_thread->join();
 
 	LOG_DBG << fname << "Process <" << this->getpid() << "> released";
 }
 
-pid_t MonitoredProcess::spawn(ACE_Process_Options &option)
+void MonitoredProcess::onExit(ACE_exitcode status)
 {
-	auto rt = AppProcess::spawn(option);
-
-	// Start thread to read stdout/stderr stream
-	m_thread = std::make_unique<std::thread>(std::bind(&MonitoredProcess::runPipeReaderThread, this));
+	const static char fname[] = "MonitoredProcess::onExit() ";
 
-	return rt;
-}
-
-void MonitoredProcess::waitThread(int timerId)
-{
-	if (nullptr != m_thread)
+	AppProcess::onExit(status);
+	try
 	{
-		// crash will happen if thread join itself
-		m_thread->join();
-		m_thread = nullptr;
+		// hold self point to avoid release before reply, serialized with timers of this object
+		auto self = std::dynamic_pointer_cast<MonitoredProcess>(this->shared_from_this());
+		TimerDispatcher::instance()->dispatch(static_cast<TimerHandler *>(self.get()), [self]() { self->replyRequest(); });
+	}
+	catch (const std::bad_weak_ptr &ex)
+	{
+		LOG_WAR << fname << "process <" << this->getpid() << "> is not managed by shared_ptr, reply directly";
+		replyRequest();
 	}
 }
 
-void MonitoredProcess::runPipeReaderThread()
+void MonitoredProcess::replyRequest()
 {
-	const static char fname[] = "MonitoredProcess::runPipeReaderThread() ";
-	LOG_DBG << fname << "Entered";
-
-	// hold self point to avoid release
-	auto self = this->shared_from_this();
-
-	/// @brief if no wait, there will be no exit_code
-	this->wait();
+	const static char fname[] = "MonitoredProcess::replyRequest() ";
 
-	///////////////////////////////////////////////////////////////////////
 	if (m_httpRequest)
 	{
 		try
 		{
 			web::http::http_response resp(web::http::status_codes::OK);
 			const auto body = this->fetchOutputMsg();
-			resp.headers().add(HTTP_HEADER_KEY_exit_code, this->return_value());
+			resp.headers().add(HTTP_HEADER_KEY_exit_code, this->returnValue());
+			resp.set_body(body);
 			std::unique_ptr<HttpRequest> response(static_cast<HttpRequest *>(m_httpRequest));
 			m_httpRequest = nullptr;
 			if (nullptr != response)
@@ -77,7 +64,5 @@ void MonitoredProcess::runPipeReaderThread()
 			LOG_ERR << fname << "message reply failed, maybe the http connection broken with error: " << std::strerror(errno);
 		}
 	}
-	///////////////////////////////////////////////////////////////////////
-	LOG_DBG << fname << "Exited";
-	this->registerTimer(0, 0, std::bind(&MonitoredProcess::waitThread, this, std::placeholders::_1), fname);
+	LOG_DBG << fname << "process <" << this->getpid() << "> replied";
 }
@@ -1,15 +1,14 @@
 #pragma once
 
 #include <memory>
-#include <mutex>
 #include <string>
-#include <thread>
 
 #include "AppProcess.h"
 
-class ACE_Process_Options;
 /// <summary>
 /// Monitor process and reply http request when finished
+/// No thread is used per process: exit is published by ProcessReaper (SIGCHLD signalfd),
+/// stdout is captured by OutputCapture or file, the reply is sent by TimerDispatcher thread.
 /// <summary>
 class MonitoredProcess : public AppProcess
 {
@@ -17,15 +16,16 @@ public:
 	explicit MonitoredProcess();
 	virtual ~MonitoredProcess();
 
-	// overwrite ACE_Process spawn method
-	virtual pid_t spawn(ACE_Process_Options &options);
 	void setAsyncHttpRequest(void *httpRequest) { m_httpRequest = httpRequest; }
+	/// <summary>
+	/// Process exited, dispatch reply to TimerDispatcher
+	/// </summary>
+	/// <param name="status">waitpid status</param>
+	virtual void onExit(ACE_exitcode status) override;
 
 protected:
-	virtual void waitThread(int timerId = 0);
-	void runPipeReaderThread();
+	void replyRequest();
 
 private:
 	void *m_httpRequest;
-	std::unique_ptr<std::thread> m_thread;
 };
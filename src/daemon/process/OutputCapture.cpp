@@ -0,0 +1,405 @@
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <functional>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+#include "../../common/Utility.h"
+#include "../Configuration.h"
+#include "OutputCapture.h"
+
+// read size per read() call and max reads per ready event, other pipes are served between
+constexpr std::size_t OUTPUT_READ_SIZE = 64 * 1024;
+constexpr int OUTPUT_READ_PER_EVENT = 4;
+// file write is batched by size and by time
+constexpr std::size_t OUTPUT_FLUSH_SIZE = 64 * 1024;
+constexpr int OUTPUT_FLUSH_INTERVAL_MS = 500;
+constexpr int OUTPUT_MAX_EVENTS = 64;
+
+////////////////////////////////////////////////////////////////////////////////
+// OutputBuffer
+////////////////////////////////////////////////////////////////////////////////
+OutputBuffer::OutputBuffer(std::size_t capacity, const std::string &file)
+	: m_data(std::max<std::size_t>(capacity, 1)), m_total(0), m_fileStart(0), m_closed(false), m_file(file)
+{
+}
+
+void OutputBuffer::append(const char *data, std::size_t size)
+{
+	std::lock_guard<std::mutex> guard(m_mutex);
+	const auto capacity = m_data.size();
+	m_total += size;
+	// only the last capacity bytes are kept
+	if (size > capacity)
+	{
+		data += size - capacity;
+		size = capacity;
+	}
+	auto pos = (m_total - size) % capacity;
+	auto first = std::min(size, capacity - pos);
+	std::memcpy(m_data.data() + pos, data, first);
+	std::memcpy(m_data.data(), data + first, size - first);
+}
+
+std::uint64_t OutputBuffer::oldest() const
+{
+	const auto capacity = m_data.size();
+	return m_total > capacity ? m_total - capacity : 0;
+}
+
+std::string OutputBuffer::readRange(std::uint64_t &begin, std::size_t maxSize) const
+{
+	const auto capacity = m_data.size();
+	begin = std::max(begin, oldest());
+	if (begin >= m_total)
+		return std::string();
+	auto size = m_total - begin;
+	if (maxSize && size > maxSize)
+		size = maxSize;
+	std::string result;
+	result.reserve(size);
+	auto pos = begin % capacity;
+	auto first = std::min<std::uint64_t>(size, capacity - pos);
+	result.append(m_data.data() + pos, first);
+	result.append(m_data.data(), size - first);
+	return result;
+}
+
+std::string OutputBuffer::read(std::uint64_t &offset, std::size_t maxSize) const
+{
+	std::lock_guard<std::mutex> guard(m_mutex);
+	auto result = readRange(offset, maxSize);
+	offset = std::min<std::uint64_t>(offset + result.length(), m_total);
+	return result;
+}
+
+std::string OutputBuffer::tail() const
+{
+	std::lock_guard<std::mutex> guard(m_mutex);
+	std::uint64_t begin = 0;
+	return readRange(begin, 0);
+}
+
+std::uint64_t OutputBuffer::begin() const
+{
+	std::lock_guard<std::mutex> guard(m_mutex);
+	return oldest();
+}
+
+std::uint64_t OutputBuffer::size() const
+{
+	std::lock_guard<std::mutex> guard(m_mutex);
+	return m_total;
+}
+
+std::string OutputBuffer::readFile(std::uint64_t &fileOffset, std::size_t maxSize) const
+{
+	std::lock_guard<std::mutex> guard(m_mutex);
+	std::uint64_t offset = fileOffset + m_fileStart;
+	auto result = readRange(offset, maxSize);
+	fileOffset = std::min<std::uint64_t>(offset + result.length(), m_total) - m_fileStart;
+	return result;
+}
+
+bool OutputBuffer::contains(std::uint64_t fileOffset) const
+{
+	std::lock_guard<std::mutex> guard(m_mutex);
+	return fileOffset + m_fileStart >= oldest();
+}
+
+void OutputBuffer::startFile()
+{
+	std::lock_guard<std::mutex> guard(m_mutex);
+	m_fileStart = m_total;
+}
+
+bool OutputBuffer::wrapped() const
+{
+	std::lock_guard<std::mutex> guard(m_mutex);
+	return m_total > m_data.size();
+}
+
+void OutputBuffer::close()
+{
+	std::lock_guard<std::mutex> guard(m_mutex);
+	m_closed = true;
+	m_cond.notify_all();
+}
+
+bool OutputBuffer::closed() const
+{
+	std::lock_guard<std::mutex> guard(m_mutex);
+	return m_closed;
+}
+
+bool OutputBuffer::waitClosed(const std::chrono::milliseconds &timeout) const
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	return m_cond.wait_for(lock, timeout, [this] { return m_closed; });
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// OutputCapture
+////////////////////////////////////////////////////////////////////////////////
+OutputCapture::OutputCapture()
+	: m_epoll(-1), m_running(false), m_rotateSize(0), m_rotateInterval(0)
+{
+}
+
+OutputCapture::~OutputCapture()
+{
+	{
+		std::lock_guard<std::mutex> guard(m_mutex);
+		m_running = false;
+	}
+	if (m_thread)
+		m_thread->join();
+	for (auto &source : m_sources)
+	{
+		flush(*source.second);
+		if (source.second->fileFd >= 0)
+			::close(source.second->fileFd);
+		::close(source.first);
+	}
+	if (m_epoll >= 0)
+		::close(m_epoll);
+}
+
+std::shared_ptr<OutputCapture> &OutputCapture::instance()
+{
+	static auto singleton = std::make_shared<OutputCapture>();
+	return singleton;
+}
+
+std::shared_ptr<OutputBuffer> OutputCapture::add(int fd, const std::string &file, std::size_t bufferSize, std::function<bool()> rotate)
+{
+	const static char fname[] = "OutputCapture::add() ";
+
+	std::lock_guard<std::mutex> guard(m_mutex);
+	// reader thread is started with the first pipe
+	if (m_epoll < 0)
+	{
+		m_epoll = ::epoll_create1(EPOLL_CLOEXEC);
+		if (m_epoll < 0)
+		{
+			LOG_ERR << fname << "epoll_create1 failed with error: " << std::strerror(errno);
+			::close(fd);
+			return nullptr;
+		}
+		m_running = true;
+		m_thread = std::make_unique<std::thread>(std::bind(&OutputCapture::run, this));
+	}
+
+	auto source = std::make_shared<Source>();
+	source->fd = fd;
+	source->fileFd = -1;
+	source->buffer = std::make_shared<OutputBuffer>(bufferSize, file);
+	source->rotate = rotate;
+	source->fileSize = 0;
+	source->fileTime = std::chrono::steady_clock::now();
+	if (file.length())
+	{
+		source->fileFd = ::open(file.c_str(), O_CREAT | O_WRONLY | O_APPEND | O_TRUNC | O_CLOEXEC, 0644);
+		if (source->fileFd < 0)
+		{
+			LOG_WAR << fname << "Failed to open <" << file << "> with error: " << std::strerror(errno);
+		}
+	}
+	::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+	struct epoll_event event;
+	std::memset(&event, 0, sizeof(event));
+	event.events = EPOLLIN;
+	event.data.fd = fd;
+	if (::epoll_ctl(m_epoll, EPOLL_CTL_ADD, fd, &event) < 0)
+	{
+		LOG_ERR << fname << "epoll_ctl failed with error: " << std::strerror(errno);
+		if (source->fileFd >= 0)
+			::close(source->fileFd);
+		::close(fd);
+		return nullptr;
+	}
+	m_sources[fd] = source;
+	return source->buffer;
+}
+
+void OutputCapture::setListener(const std::function<void(const OutputBuffer *)> &listener)
+{
+	std::lock_guard<std::mutex> guard(m_mutex);
+	m_listener = listener;
+}
+
+void OutputCapture::run()
+{
+	const static char fname[] = "OutputCapture::run() ";
+	LOG_INF << fname << "Entered";
+
+	struct epoll_event events[OUTPUT_MAX_EVENTS];
+	auto lastFlush = std::chrono::steady_clock::now();
+	m_rotateSize = Configuration::instance()->getStdoutRotateSize();
+	m_rotateInterval = std::chrono::seconds(Configuration::instance()->getStdoutRotateInterval());
+	while (true)
+	{
+		{
+			std::lock_guard<std::mutex> guard(m_mutex);
+			if (!m_running)
+				break;
+		}
+		int count = ::epoll_wait(m_epoll, events, OUTPUT_MAX_EVENTS, OUTPUT_FLUSH_INTERVAL_MS);
+		if (count < 0 && errno != EINTR)
+		{
+			LOG_ERR << fname << "epoll_wait failed with error: " << std::strerror(errno);
+			break;
+		}
+		std::vector<const OutputBuffer *> updated;
+		for (int i = 0; i < count; i++)
+		{
+			std::shared_ptr<Source> source;
+			{
+				std::lock_guard<std::mutex> guard(m_mutex);
+				auto iter = m_sources.find(events[i].data.fd);
+				if (iter == m_sources.end())
+					continue;
+				source = iter->second;
+			}
+			// EPOLLHUP is reported with remaining data, read until EOF
+			if (!drain(*source))
+			{
+				remove(source->fd);
+			}
+			updated.push_back(source->buffer.get());
+		}
+		if (updated.size())
+		{
+			std::function<void(const OutputBuffer *)> listener;
+			{
+				std::lock_guard<std::mutex> guard(m_mutex);
+				listener = m_listener;
+			}
+			if (listener)
+			{
+				for (auto buffer : updated)
+					listener(buffer);
+			}
+		}
+
+		// batched file write
+		const auto now = std::chrono::steady_clock::now();
+		if (now - lastFlush >= std::chrono::milliseconds(OUTPUT_FLUSH_INTERVAL_MS))
+		{
+			std::vector<std::shared_ptr<Source>> sources;
+			{
+				std::lock_guard<std::mutex> guard(m_mutex);
+				for (auto &source : m_sources)
+					sources.push_back(source.second);
+			}
+			// sources are only changed by this thread except add(), write without lock
+			m_rotateSize = Configuration::instance()->getStdoutRotateSize();
+			m_rotateInterval = std::chrono::seconds(Configuration::instance()->getStdoutRotateInterval());
+			for (auto &source : sources)
+			{
+				flush(*source);
+				if (source->rotate && source->fileSize && m_rotateInterval.count() && now - source->fileTime >= m_rotateInterval)
+					rotate(*source);
+			}
+			lastFlush = now;
+		}
+	}
+	LOG_INF << fname << "Exited";
+}
+
+bool OutputCapture::drain(Source &source)
+{
+	char buffer[OUTPUT_READ_SIZE];
+	for (int i = 0; i < OUTPUT_READ_PER_EVENT; i++)
+	{
+		auto size = ::read(source.fd, buffer, sizeof(buffer));
+		if (size > 0)
+		{
+			source.buffer->append(buffer, size);
+			if (source.fileFd >= 0)
+			{
+				source.pending.append(buffer, size);
+				if (source.pending.size() >= OUTPUT_FLUSH_SIZE)
+					flush(source);
+			}
+			continue;
+		}
+		if (size < 0 && (errno == EAGAIN || errno == EINTR))
+			return true;
+		// EOF or error
+		return false;
+	}
+	return true;
+}
+
+void OutputCapture::flush(Source &source)
+{
+	const static char fname[] = "OutputCapture::flush() ";
+
+	std::size_t written = 0;
+	while (written < source.pending.size())
+	{
+		auto size = ::write(source.fileFd, source.pending.data() + written, source.pending.size() - written);
+		if (size < 0 && errno == EINTR)
+			continue;
+		if (size <= 0)
+		{
+			LOG_WAR << fname << "Failed to write <" << source.buffer->file() << "> with error: " << std::strerror(errno);
+			break;
+		}
+		written += size;
+	}
+	source.fileSize += written;
+	source.pending.clear();
+	if (source.rotate && m_rotateSize && source.fileSize >= m_rotateSize)
+		rotate(source);
+}
+
+void OutputCapture::rotate(Source &source)
+{
+	const static char fname[] = "OutputCapture::rotate() ";
+
+	const auto &file = source.buffer->file();
+	// current file is renamed by owner, the child keep writing to pipe and not aware
+	if (!source.rotate())
+	{
+		// a new process started with the file, keep writing to the renamed one
+		LOG_INF << fname << "<" << file << "> is taken by another process, stop rotate";
+		source.rotate = nullptr;
+		return;
+	}
+	if (source.fileFd >= 0)
+		::close(source.fileFd);
+	source.buffer->startFile();
+	source.fileFd = ::open(file.c_str(), O_CREAT | O_WRONLY | O_APPEND | O_TRUNC | O_CLOEXEC, 0644);
+	if (source.fileFd < 0)
+	{
+		LOG_WAR << fname << "Failed to open <" << file << "> with error: " << std::strerror(errno);
+	}
+	source.fileSize = 0;
+	source.fileTime = std::chrono::steady_clock::now();
+	LOG_DBG << fname << "<" << file << "> rotated";
+}
+
+void OutputCapture::remove(int fd)
+{
+	std::shared_ptr<Source> source;
+	{
+		std::lock_guard<std::mutex> guard(m_mutex);
+		auto iter = m_sources.find(fd);
+		if (iter == m_sources.end())
+			return;
+		source = iter->second;
+		m_sources.erase(iter);
+	}
+	::epoll_ctl(m_epoll, EPOLL_CTL_DEL, fd, nullptr);
+	// no rotate for the last data, keep it in current file
+	source->rotate = nullptr;
+	flush(*source);
+	if (source->fileFd >= 0)
+		::close(source->fileFd);
+	::close(fd);
+	source->buffer->close();
+}
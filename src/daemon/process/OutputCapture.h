@@ -0,0 +1,143 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/// <summary>
+/// Fixed size ring buffer of process stdout
+/// Offset is counted from the first byte written, data older than capacity is dropped.
+/// </summary>
+class OutputBuffer
+{
+public:
+	/// <summary>
+	/// Constructor
+	/// </summary>
+	/// <param name="capacity">ring buffer size in bytes</param>
+	/// <param name="file">file the output is also written to, empty for memory only</param>
+	OutputBuffer(std::size_t capacity, const std::string &file);
+
+	void append(const char *data, std::size_t size);
+	/// <summary>
+	/// Read data from offset to the end (or at most maxSize bytes), offset is moved to the next position.
+	/// Offset older than buffer start read from the oldest data.
+	/// </summary>
+	std::string read(std::uint64_t &offset, std::size_t maxSize = 0) const;
+	/// <summary>
+	/// All data in buffer
+	/// </summary>
+	std::string tail() const;
+	/// <summary>
+	/// Total bytes written since created
+	/// </summary>
+	std::uint64_t size() const;
+	/// <summary>
+	/// Offset of the oldest data still in buffer
+	/// </summary>
+	std::uint64_t begin() const;
+	/// <summary>
+	/// Read by offset of current output file (file is rotated), offset is moved to the next position
+	/// </summary>
+	std::string readFile(std::uint64_t &fileOffset, std::size_t maxSize) const;
+	/// <summary>
+	/// Data at offset of current output file is still in buffer
+	/// </summary>
+	bool contains(std::uint64_t fileOffset) const;
+	/// <summary>
+	/// Output file is rotated, new file start from current position
+	/// </summary>
+	void startFile();
+	/// <summary>
+	/// Some data was dropped from buffer
+	/// </summary>
+	bool wrapped() const;
+	const std::string &file() const { return m_file; }
+
+	/// <summary>
+	/// Writer side closed (all processes hold the pipe exited)
+	/// </summary>
+	void close();
+	bool closed() const;
+	/// <summary>
+	/// Wait writer side closed
+	/// </summary>
+	/// <returns>true for closed</returns>
+	bool waitClosed(const std::chrono::milliseconds &timeout) const;
+
+private:
+	std::uint64_t oldest() const;
+	std::string readRange(std::uint64_t &begin, std::size_t maxSize) const;
+
+private:
+	mutable std::mutex m_mutex;
+	mutable std::condition_variable m_cond;
+	std::vector<char> m_data;
+	std::uint64_t m_total;
+	// buffer offset of the first byte of current output file
+	std::uint64_t m_fileStart;
+	bool m_closed;
+	const std::string m_file;
+};
+
+/// <summary>
+/// Drain stdout pipes of all processes by one epoll thread,
+/// data is kept in per-process ring buffer, disk write is batched when file is set.
+/// </summary>
+class OutputCapture
+{
+public:
+	OutputCapture();
+	virtual ~OutputCapture();
+	static std::shared_ptr<OutputCapture> &instance();
+
+	/// <summary>
+	/// Register read end of a pipe, the fd is owned and closed by OutputCapture
+	/// </summary>
+	/// <param name="fd">pipe read end</param>
+	/// <param name="file">output file (truncated), empty for memory only</param>
+	/// <param name="bufferSize">ring buffer size in bytes</param>
+	/// <param name="rotate">rename current output file when StdoutRotateSizeMB or StdoutRotateIntervalSeconds reached, file is reopened after return, false to stop rotate</param>
+	/// <returns>output buffer, nullptr for failure</returns>
+	std::shared_ptr<OutputBuffer> add(int fd, const std::string &file, std::size_t bufferSize, std::function<bool()> rotate = nullptr);
+	/// <summary>
+	/// Set listener called by reader thread with the buffer which new data or EOF is read, should not block
+	/// </summary>
+	void setListener(const std::function<void(const OutputBuffer *)> &listener);
+
+private:
+	struct Source
+	{
+		int fd;
+		int fileFd;
+		std::shared_ptr<OutputBuffer> buffer;
+		// data not written to file yet
+		std::string pending;
+		std::function<bool()> rotate;
+		std::uint64_t fileSize;
+		std::chrono::steady_clock::time_point fileTime;
+	};
+	void run();
+	// read available data, return false for EOF or error
+	bool drain(Source &source);
+	void flush(Source &source);
+	void rotate(Source &source);
+	void remove(int fd);
+
+private:
+	std::mutex m_mutex;
+	std::unordered_map<int, std::shared_ptr<Source>> m_sources;
+	int m_epoll;
+	bool m_running;
+	std::unique_ptr<std::thread> m_thread;
+	std::function<void(const OutputBuffer *)> m_listener;
+	// rotate limits refreshed by reader thread
+	std::uint64_t m_rotateSize;
+	std::chrono::seconds m_rotateInterval;
+};
@@ -0,0 +1,98 @@
+#include <cstring>
+#include <sys/wait.h>
+#include <vector>
+
+#include "../../common/Utility.h"
+#include "AppProcess.h"
+#include "ProcessReaper.h"
+
+ProcessReaper::ProcessReaper()
+{
+}
+
+ProcessReaper::~ProcessReaper()
+{
+}
+
+std::shared_ptr<ProcessReaper> &ProcessReaper::instance()
+{
+	static auto singleton = std::make_shared<ProcessReaper>();
+	return singleton;
+}
+
+void ProcessReaper::registerProcess(pid_t pid, const std::shared_ptr<AppProcess> &process)
+{
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	// child may exit before register (fork return later than child exit), its SIGCHLD is already handled
+	int status = 0;
+	if (!collect(pid, status))
+		m_processes[pid] = process;
+	else if (status >= 0)
+		publish(pid, status, process);
+}
+
+void ProcessReaper::unregisterProcess(pid_t pid)
+{
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	m_processes.erase(pid);
+}
+
+int ProcessReaper::reap()
+{
+	// hold lock during whole pass, so that exit code is published before any other caller continue
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	int count = 0;
+	// onExit() callback may register or unregister processes, iterate a copy
+	const std::vector<std::pair<pid_t, std::weak_ptr<AppProcess>>> processes(m_processes.begin(), m_processes.end());
+	for (const auto &process : processes)
+	{
+		int status = 0;
+		if (!collect(process.first, status))
+			continue;
+		m_processes.erase(process.first);
+		if (status >= 0)
+		{
+			publish(process.first, status, process.second.lock());
+			++count;
+		}
+	}
+	return count;
+}
+
+bool ProcessReaper::collect(pid_t pid, int &status)
+{
+	const static char fname[] = "ProcessReaper::collect() ";
+
+	pid_t ret;
+	while ((ret = ::waitpid(pid, &status, WNOHANG)) < 0 && errno == EINTR)
+		;
+	if (ret == 0)
+		return false;
+	if (ret < 0)
+	{
+		// collected by owner wait
+		LOG_DBG << fname << "process <" << pid << "> is not a child: " << std::strerror(errno);
+		status = -1;
+	}
+	return true;
+}
+
+void ProcessReaper::publish(pid_t pid, int status, const std::shared_ptr<AppProcess> &process)
+{
+	const static char fname[] = "ProcessReaper::publish() ";
+
+	m_exitedPids.insert(pid);
+	if (process)
+	{
+		process->onExit(status);
+		LOG_DBG << fname << "process <" << pid << "> exited with status <" << status << ">";
+	}
+}
+
+std::set<pid_t> ProcessReaper::fetchExited()
+{
+	std::lock_guard<std::recursive_mutex> guard(m_mutex);
+	std::set<pid_t> exited;
+	exited.swap(m_exitedPids);
+	return exited;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <set>
+#include <unordered_map>
+
+class AppProcess;
+/// <summary>
+/// Central child process reaper
+/// Collect exited registered children with waitpid(pid, WNOHANG) in one pass and
+/// publish exit code to the owner AppProcess through pid index.
+/// Children not registered (spawned by other paths) are left to their own wait.
+/// </summary>
+class ProcessReaper
+{
+public:
+	ProcessReaper();
+	virtual ~ProcessReaper();
+	static std::shared_ptr<ProcessReaper> &instance();
+
+	/// <summary>
+	/// Register a spawned child process, collected at once when already exited
+	/// </summary>
+	/// <param name="pid">process id</param>
+	/// <param name="process">owner process object</param>
+	void registerProcess(pid_t pid, const std::shared_ptr<AppProcess> &process);
+	/// <summary>
+	/// Remove a child process which was collected by owner
+	/// </summary>
+	/// <param name="pid">process id</param>
+	void unregisterProcess(pid_t pid);
+
+	/// <summary>
+	/// Collect exited registered children, called per SIGCHLD and per schedule tick
+	/// </summary>
+	/// <returns>number of collected children</returns>
+	int reap();
+	/// <summary>
+	/// Get and clear exited process id list since last fetch
+	/// </summary>
+	std::set<pid_t> fetchExited();
+
+private:
+	// waitpid() one registered child, true for exited, status is -1 when already collected by owner
+	bool collect(pid_t pid, int &status);
+	// record exited pid and publish exit status to owner
+	void publish(pid_t pid, int status, const std::shared_ptr<AppProcess> &process);
+
+private:
+	std::recursive_mutex m_mutex;
+	// key: pid, value: owner process
+	std::unordered_map<pid_t, std::weak_ptr<AppProcess>> m_processes;
+	std::set<pid_t> m_exitedPids;
+};
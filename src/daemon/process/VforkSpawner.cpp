@@ -0,0 +1,184 @@
+#include <csignal>
+#include <cstring>
+#include <sched.h>
+#include <set>
+#include <string>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+#include "../../common/Utility.h"
+#include "VforkSpawner.h"
+
+extern char **environ;
+
+// child run on this stack until exec, execvpe use some stack for PATH search
+constexpr std::size_t VFORK_STACK_SIZE = 256 * 1024;
+
+namespace
+{
+	struct VforkContext
+	{
+		char *const *argv;
+		char *const *envp;
+		const char *workDir;
+		pid_t processGroup;
+		uid_t ruid;
+		uid_t euid;
+		gid_t rgid;
+		gid_t egid;
+		ACE_HANDLE stdinHandle;
+		ACE_HANDLE stdoutHandle;
+		ACE_HANDLE stderrHandle;
+		sigset_t signalMask;
+		const std::function<void()> *childHook;
+		// child report error before exec, parent is suspended until child exec or exit
+		volatile int error;
+	};
+
+	[[noreturn]] void vforkChildFail(VforkContext *ctx)
+	{
+		ctx->error = errno ? errno : EINVAL;
+		::_exit(127);
+	}
+
+	int vforkChild(void *arg)
+	{
+		auto ctx = static_cast<VforkContext *>(arg);
+
+		// signal handlers of daemon must not run in child sharing the same memory, reset before unblock
+		for (int sig = 1; sig < _NSIG; sig++)
+		{
+			struct sigaction action;
+			if (::sigaction(sig, nullptr, &action) == 0 && action.sa_handler != SIG_DFL && action.sa_handler != SIG_IGN)
+			{
+				std::memset(&action, 0, sizeof(action));
+				action.sa_handler = SIG_DFL;
+				::sigaction(sig, &action, nullptr);
+			}
+		}
+		::sigprocmask(SIG_SETMASK, &ctx->signalMask, nullptr);
+
+		if (ctx->processGroup != ACE_INVALID_PID && ::setpgid(0, ctx->processGroup) < 0)
+			vforkChildFail(ctx);
+		if (*ctx->childHook)
+			(*ctx->childHook)();
+		// glibc setregid/setreuid broadcast setxid to all threads of the daemon (shared memory here) and may deadlock,
+		// raw syscall only change this task
+		if ((ctx->rgid != (gid_t)-1 || ctx->egid != (gid_t)-1) && ::syscall(SYS_setresgid, ctx->rgid, ctx->egid, (gid_t)-1) < 0)
+			vforkChildFail(ctx);
+		if ((ctx->ruid != (uid_t)-1 || ctx->euid != (uid_t)-1) && ::syscall(SYS_setresuid, ctx->ruid, ctx->euid, (uid_t)-1) < 0)
+			vforkChildFail(ctx);
+		// ACE only report chdir failure and continue with daemon working directory
+		if (ctx->workDir && *ctx->workDir)
+			(void)::chdir(ctx->workDir);
+		if (ctx->stdinHandle != ACE_INVALID_HANDLE && ::dup2(ctx->stdinHandle, STDIN_FILENO) < 0)
+			vforkChildFail(ctx);
+		if (ctx->stdoutHandle != ACE_INVALID_HANDLE && ::dup2(ctx->stdoutHandle, STDOUT_FILENO) < 0)
+			vforkChildFail(ctx);
+		if (ctx->stderrHandle != ACE_INVALID_HANDLE && ::dup2(ctx->stderrHandle, STDERR_FILENO) < 0)
+			vforkChildFail(ctx);
+		// close the original handles as ACE does, stdout and stderr may share one handle
+		if (ctx->stdinHandle > STDERR_FILENO)
+			::close(ctx->stdinHandle);
+		if (ctx->stdoutHandle > STDERR_FILENO && ctx->stdoutHandle != ctx->stdinHandle)
+			::close(ctx->stdoutHandle);
+		if (ctx->stderrHandle > STDERR_FILENO && ctx->stderrHandle != ctx->stdinHandle && ctx->stderrHandle != ctx->stdoutHandle)
+			::close(ctx->stderrHandle);
+
+		::execvpe(ctx->argv[0], ctx->argv, ctx->envp);
+		vforkChildFail(ctx);
+	}
+} // namespace
+
+std::vector<char *> VforkSpawner::environment(ACE_Process_Options &option)
+{
+	// environment: inherit from daemon, overwrite by option
+	std::vector<char *> envp;
+	std::set<std::string> overrideKeys;
+	auto overrides = option.env_argv();
+	for (std::size_t i = 0; overrides && overrides[i]; i++)
+	{
+		const std::string env = overrides[i];
+		overrideKeys.insert(env.substr(0, env.find('=')));
+	}
+	if (option.inherit_environment())
+	{
+		for (char **env = environ; env && *env; env++)
+		{
+			const char *equal = std::strchr(*env, '=');
+			if (equal && overrideKeys.count(std::string(*env, equal - *env)))
+				continue;
+			envp.push_back(*env);
+		}
+	}
+	for (std::size_t i = 0; overrides && overrides[i]; i++)
+	{
+		envp.push_back(overrides[i]);
+	}
+	envp.push_back(nullptr);
+	return envp;
+}
+
+pid_t VforkSpawner::spawn(ACE_Process_Options &option, const std::function<void()> &childHook)
+{
+	const static char fname[] = "VforkSpawner::spawn() ";
+
+	auto argv = option.command_line_argv();
+	if (argv == nullptr || argv[0] == nullptr)
+	{
+		errno = EINVAL;
+		return ACE_INVALID_PID;
+	}
+
+	auto envp = environment(option);
+
+	VforkContext ctx;
+	ctx.argv = argv;
+	ctx.envp = envp.data();
+	ctx.workDir = option.working_directory();
+	ctx.processGroup = option.getgroup();
+	ctx.ruid = option.getruid();
+	ctx.euid = option.geteuid();
+	ctx.rgid = option.getrgid();
+	ctx.egid = option.getegid();
+	ctx.stdinHandle = option.get_stdin();
+	ctx.stdoutHandle = option.get_stdout();
+	ctx.stderrHandle = option.get_stderr();
+	ctx.childHook = &childHook;
+	ctx.error = 0;
+
+	void *stack = ::mmap(nullptr, VFORK_STACK_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK, -1, 0);
+	if (stack == MAP_FAILED)
+	{
+		LOG_ERR << fname << "Failed to allocate stack with error: " << std::strerror(errno);
+		return ACE_INVALID_PID;
+	}
+	// block all signals during clone, child restore the mask after reset handlers
+	sigset_t allSignals;
+	::sigfillset(&allSignals);
+	::pthread_sigmask(SIG_SETMASK, &allSignals, &ctx.signalMask);
+	// CLONE_VFORK: return after child exec or exit
+	pid_t pid = ::clone(vforkChild, static_cast<char *>(stack) + VFORK_STACK_SIZE, CLONE_VM | CLONE_VFORK | SIGCHLD, &ctx);
+	const int cloneError = errno;
+	::pthread_sigmask(SIG_SETMASK, &ctx.signalMask, nullptr);
+	::munmap(stack, VFORK_STACK_SIZE);
+
+	if (pid < 0)
+	{
+		LOG_ERR << fname << "clone failed with error: " << std::strerror(cloneError);
+		errno = cloneError;
+		return ACE_INVALID_PID;
+	}
+	if (ctx.error)
+	{
+		// child already exit and is not registered to ProcessReaper, collect it here
+		::waitpid(pid, nullptr, 0);
+		LOG_WAR << fname << "Process <" << argv[0] << "> failed to exec with error: " << std::strerror(ctx.error);
+		errno = ctx.error;
+		return ACE_INVALID_PID;
+	}
+	return pid;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+
+#include <ace/Process.h>
+
+/// <summary>
+/// Spawn process by clone(CLONE_VM|CLONE_VFORK), child share memory with daemon until exec,
+/// no page table copy, spawn cost does not grow with daemon RSS.
+/// Support the same ACE_Process_Options as ACE_Process::spawn use in AppProcess:
+///  1. setuid/setgid (raw syscall, not glibc setxid broadcast)
+///  2. process group
+///  3. working directory
+///  4. environment (inherit and override)
+///  5. stdin/stdout/stderr handles
+/// </summary>
+class VforkSpawner
+{
+public:
+	/// <summary>
+	/// Spawn process with ACE options
+	/// </summary>
+	/// <param name="option">ACE process options</param>
+	/// <param name="childHook">called in child before setuid and exec, must only use async-signal-safe functions</param>
+	/// <returns>process id, -1 for failure with errno set (include exec failure in child)</returns>
+	static pid_t spawn(ACE_Process_Options &option, const std::function<void()> &childHook);
+	/// <summary>
+	/// Build child environment: daemon environment (when inherit) overwritten by option env
+	/// </summary>
+	/// <param name="option">ACE process options</param>
+	/// <returns>null terminated env list, strings are owned by environ and option</returns>
+	static std::vector<char *> environment(ACE_Process_Options &option);
+};
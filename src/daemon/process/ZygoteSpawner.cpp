@@ -0,0 +1,543 @@
+#include <csignal>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "../../common/Utility.h"
+#include "VforkSpawner.h"
+#include "ZygoteSpawner.h"
+
+// request include command line and full environment, SOCK_SEQPACKET message must fit socket send buffer
+constexpr std::size_t ZYGOTE_MAX_REQUEST = 256 * 1024;
+// stdin/stdout/stderr and cgroup.procs of each hierarchy
+constexpr std::size_t ZYGOTE_MAX_FDS = 16;
+// helper child run on this stack until exec (copy-on-write, not shared with helper)
+constexpr std::size_t ZYGOTE_STACK_SIZE = 256 * 1024;
+
+namespace
+{
+	// fixed header, followed by null terminated strings: working dir, argv[argc], envp[envc]
+	struct ZygoteRequest
+	{
+		uint32_t size;
+		uint32_t argc;
+		uint32_t envc;
+		pid_t processGroup;
+		uid_t ruid;
+		uid_t euid;
+		gid_t rgid;
+		gid_t egid;
+		// index of passed fds, -1 for not set
+		int32_t stdinIndex;
+		int32_t stdoutIndex;
+		int32_t stderrIndex;
+		// cgroup.procs fds are passed after std handles
+		uint32_t procsFdCount;
+	};
+
+	struct ZygoteResponse
+	{
+		pid_t pid;
+		int32_t error;
+	};
+
+	// parsed request in helper, pointers refer to receive buffer and passed fds
+	struct ZygoteChild
+	{
+		std::vector<char *> argv;
+		std::vector<char *> envp;
+		const char *workDir;
+		pid_t processGroup;
+		uid_t ruid;
+		uid_t euid;
+		gid_t rgid;
+		gid_t egid;
+		int stdinHandle;
+		int stdoutHandle;
+		int stderrHandle;
+		std::vector<int> procsFds;
+		// CLOEXEC pipe, child write errno before exit, EOF means exec succeed
+		int errorPipe;
+		// child wait one byte before setup, EOF means helper failed to report pid to daemon
+		int goPipe;
+		int goPipeWrite;
+	};
+
+	[[noreturn]] void zygoteChildFail(ZygoteChild *ctx)
+	{
+		int error = errno ? errno : EINVAL;
+		while (::write(ctx->errorPipe, &error, sizeof(error)) < 0 && errno == EINTR)
+			;
+		::_exit(127);
+	}
+
+	int zygoteChild(void *arg)
+	{
+		auto ctx = static_cast<ZygoteChild *>(arg);
+
+		// exit without exec when daemon does not know this pid, nobody would own it
+		::close(ctx->goPipeWrite);
+		char go;
+		ssize_t ret;
+		while ((ret = ::read(ctx->goPipe, &go, sizeof(go))) < 0 && errno == EINTR)
+			;
+		if (ret != sizeof(go))
+			::_exit(127);
+
+		if (ctx->processGroup != ACE_INVALID_PID && ::setpgid(0, ctx->processGroup) < 0)
+			zygoteChildFail(ctx);
+		// join cgroup before exec, same as AppProcess::child()
+		for (auto fd : ctx->procsFds)
+		{
+			if (::write(fd, "0", 1) < 0)
+				zygoteChildFail(ctx);
+		}
+		// same order with ACE_Process::spawn
+		if ((ctx->rgid != (gid_t)-1 || ctx->egid != (gid_t)-1) && ::setregid(ctx->rgid, ctx->egid) < 0)
+			zygoteChildFail(ctx);
+		if ((ctx->ruid != (uid_t)-1 || ctx->euid != (uid_t)-1) && ::setreuid(ctx->ruid, ctx->euid) < 0)
+			zygoteChildFail(ctx);
+		if (ctx->workDir && *ctx->workDir && ::chdir(ctx->workDir) < 0)
+			zygoteChildFail(ctx);
+		if (ctx->stdinHandle >= 0 && ::dup2(ctx->stdinHandle, STDIN_FILENO) < 0)
+			zygoteChildFail(ctx);
+		if (ctx->stdoutHandle >= 0 && ::dup2(ctx->stdoutHandle, STDOUT_FILENO) < 0)
+			zygoteChildFail(ctx);
+		if (ctx->stderrHandle >= 0 && ::dup2(ctx->stderrHandle, STDERR_FILENO) < 0)
+			zygoteChildFail(ctx);
+
+		::execvpe(ctx->argv[0], ctx->argv.data(), ctx->envp.data());
+		zygoteChildFail(ctx);
+	}
+
+	// read count null terminated strings from [pos, end)
+	bool parseStrings(char *&pos, char *end, uint32_t count, std::vector<char *> &result)
+	{
+		for (uint32_t i = 0; i < count; i++)
+		{
+			auto terminator = static_cast<char *>(std::memchr(pos, '\0', end - pos));
+			if (terminator == nullptr)
+				return false;
+			result.push_back(pos);
+			pos = terminator + 1;
+		}
+		result.push_back(nullptr);
+		return true;
+	}
+
+	int passedFd(const std::vector<int> &fds, int32_t index)
+	{
+		return (index >= 0 && static_cast<std::size_t>(index) < fds.size()) ? fds[index] : -1;
+	}
+
+	// return false when daemon is gone
+	bool sendResponse(int socket, const ZygoteResponse &response)
+	{
+		while (::send(socket, &response, sizeof(response), MSG_NOSIGNAL) < 0)
+		{
+			if (errno != EINTR)
+				return false;
+		}
+		return true;
+	}
+
+	// run in daemon, errno is set for failure
+	bool receiveResponse(int socket, ZygoteResponse &response)
+	{
+		ssize_t ret;
+		while ((ret = ::recv(socket, &response, sizeof(response), 0)) < 0 && errno == EINTR)
+			;
+		if (ret >= 0 && ret != sizeof(response))
+			errno = ECONNRESET;
+		return ret == sizeof(response);
+	}
+
+	// run in helper process: validate request, clone child and wait exec result.
+	// a cloned child is reported twice: pid before child continue, then exec result
+	bool handleRequest(int socket, char *buffer, std::size_t size, const std::vector<int> &fds, char *stack)
+	{
+		ZygoteResponse response{ACE_INVALID_PID, EINVAL};
+		if (size < sizeof(ZygoteRequest))
+			return sendResponse(socket, response);
+		ZygoteRequest request;
+		std::memcpy(&request, buffer, sizeof(request));
+		if (request.size != size || request.argc == 0 || request.procsFdCount > fds.size())
+			return sendResponse(socket, response);
+
+		ZygoteChild ctx;
+		char *pos = buffer + sizeof(request);
+		char *end = buffer + size;
+		std::vector<char *> workDir;
+		if (!parseStrings(pos, end, 1, workDir) || !parseStrings(pos, end, request.argc, ctx.argv) || !parseStrings(pos, end, request.envc, ctx.envp))
+			return sendResponse(socket, response);
+		ctx.workDir = workDir[0];
+		ctx.processGroup = request.processGroup;
+		ctx.ruid = request.ruid;
+		ctx.euid = request.euid;
+		ctx.rgid = request.rgid;
+		ctx.egid = request.egid;
+		ctx.stdinHandle = passedFd(fds, request.stdinIndex);
+		ctx.stdoutHandle = passedFd(fds, request.stdoutIndex);
+		ctx.stderrHandle = passedFd(fds, request.stderrIndex);
+		ctx.procsFds.assign(fds.end() - request.procsFdCount, fds.end());
+
+		int errorPipe[2];
+		int goPipe[2];
+		if (::pipe2(errorPipe, O_CLOEXEC) < 0)
+		{
+			response.error = errno;
+			return sendResponse(socket, response);
+		}
+		if (::pipe2(goPipe, O_CLOEXEC) < 0)
+		{
+			response.error = errno;
+			::close(errorPipe[0]);
+			::close(errorPipe[1]);
+			return sendResponse(socket, response);
+		}
+		ctx.errorPipe = errorPipe[1];
+		ctx.goPipe = goPipe[0];
+		ctx.goPipeWrite = goPipe[1];
+		// CLONE_PARENT: child belong to daemon, daemon receive SIGCHLD and collect exit status
+		pid_t pid = ::clone(zygoteChild, stack + ZYGOTE_STACK_SIZE, CLONE_PARENT | SIGCHLD, &ctx);
+		const int cloneError = errno;
+		::close(errorPipe[1]);
+		::close(goPipe[0]);
+		if (pid < 0)
+		{
+			::close(errorPipe[0]);
+			::close(goPipe[1]);
+			response.error = cloneError;
+			return sendResponse(socket, response);
+		}
+		// daemon know the pid before child continue, it kill the child when exec result is not received
+		response.pid = pid;
+		response.error = 0;
+		if (!sendResponse(socket, response))
+		{
+			// closing go pipe without data make child exit
+			::close(goPipe[1]);
+			::close(errorPipe[0]);
+			return false;
+		}
+		const char go = 0;
+		while (::write(goPipe[1], &go, sizeof(go)) < 0 && errno == EINTR)
+			;
+		::close(goPipe[1]);
+
+		int childError = 0;
+		ssize_t ret;
+		while ((ret = ::read(errorPipe[0], &childError, sizeof(childError))) < 0 && errno == EINTR)
+			;
+		::close(errorPipe[0]);
+		// child already exit for error, exit status is collected by daemon
+		response.error = (ret == sizeof(childError)) ? childError : 0;
+		return sendResponse(socket, response);
+	}
+
+	// close all fds inherited from daemon except stdio and the socket, they are not needed by helper
+	void closeInheritedFds(int keep)
+	{
+		std::vector<int> fds;
+		DIR *dir = ::opendir("/proc/self/fd");
+		if (dir == nullptr)
+			return;
+		struct dirent *entry;
+		while ((entry = ::readdir(dir)) != nullptr)
+		{
+			if (entry->d_name[0] < '0' || entry->d_name[0] > '9')
+				continue;
+			int fd = std::atoi(entry->d_name);
+			if (fd > STDERR_FILENO && fd != keep && fd != ::dirfd(dir))
+				fds.push_back(fd);
+		}
+		::closedir(dir);
+		for (auto fd : fds)
+			::close(fd);
+	}
+} // namespace
+
+ZygoteSpawner::ZygoteSpawner()
+	: m_socket(-1), m_pid(ACE_INVALID_PID)
+{
+}
+
+ZygoteSpawner::~ZygoteSpawner()
+{
+	stop();
+}
+
+std::shared_ptr<ZygoteSpawner> &ZygoteSpawner::instance()
+{
+	static auto singleton = std::make_shared<ZygoteSpawner>();
+	return singleton;
+}
+
+bool ZygoteSpawner::start()
+{
+	const static char fname[] = "ZygoteSpawner::start() ";
+
+	std::lock_guard<std::mutex> guard(m_mutex);
+	if (m_socket >= 0)
+		return true;
+
+	int sockets[2];
+	if (::socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sockets) < 0)
+	{
+		LOG_ERR << fname << "socketpair failed with error: " << std::strerror(errno);
+		return false;
+	}
+	int bufferSize = ZYGOTE_MAX_REQUEST;
+	::setsockopt(sockets[0], SOL_SOCKET, SO_SNDBUF, &bufferSize, sizeof(bufferSize));
+
+	// helper check this after PR_SET_PDEATHSIG, daemon may exit before it is set
+	const pid_t parent = ::getpid();
+	pid_t pid = ::fork();
+	if (pid < 0)
+	{
+		LOG_ERR << fname << "fork failed with error: " << std::strerror(errno);
+		::close(sockets[0]);
+		::close(sockets[1]);
+		return false;
+	}
+	if (pid == 0)
+	{
+		::close(sockets[0]);
+		serve(sockets[1], parent);
+	}
+	::close(sockets[1]);
+	m_socket = sockets[0];
+	m_pid = pid;
+	LOG_INF << fname << "spawn helper process <" << m_pid << "> started";
+	return true;
+}
+
+void ZygoteSpawner::stop()
+{
+	std::lock_guard<std::mutex> guard(m_mutex);
+	// helper exit when socket is closed
+	disconnect();
+}
+
+bool ZygoteSpawner::running() const
+{
+	std::lock_guard<std::mutex> guard(m_mutex);
+	return m_socket >= 0;
+}
+
+pid_t ZygoteSpawner::getpid() const
+{
+	std::lock_guard<std::mutex> guard(m_mutex);
+	return m_pid;
+}
+
+void ZygoteSpawner::disconnect()
+{
+	if (m_socket >= 0)
+	{
+		::close(m_socket);
+		m_socket = -1;
+		// helper is collected here, ProcessReaper only wait registered application processes
+		if (m_pid > 0)
+		{
+			::kill(m_pid, SIGKILL);
+			::waitpid(m_pid, nullptr, 0);
+		}
+		m_pid = ACE_INVALID_PID;
+	}
+}
+
+pid_t ZygoteSpawner::spawn(ACE_Process_Options &option, const std::vector<int> &cgroupProcsFds)
+{
+	const static char fname[] = "ZygoteSpawner::spawn() ";
+
+	auto argv = option.command_line_argv();
+	if (argv == nullptr || argv[0] == nullptr)
+	{
+		errno = EINVAL;
+		return ACE_INVALID_PID;
+	}
+
+	// serialize request
+	ZygoteRequest request;
+	std::memset(&request, 0, sizeof(request));
+	request.processGroup = option.getgroup();
+	request.ruid = option.getruid();
+	request.euid = option.geteuid();
+	request.rgid = option.getrgid();
+	request.egid = option.getegid();
+	std::vector<int> fds;
+	auto addHandle = [&fds](ACE_HANDLE handle) {
+		if (handle == ACE_INVALID_HANDLE)
+			return -1;
+		fds.push_back(handle);
+		return static_cast<int>(fds.size() - 1);
+	};
+	request.stdinIndex = addHandle(option.get_stdin());
+	request.stdoutIndex = addHandle(option.get_stdout());
+	request.stderrIndex = addHandle(option.get_stderr());
+	fds.insert(fds.end(), cgroupProcsFds.begin(), cgroupProcsFds.end());
+	request.procsFdCount = cgroupProcsFds.size();
+
+	std::string payload(sizeof(request), '\0');
+	auto workDir = option.working_directory();
+	payload.append(workDir ? workDir : "").push_back('\0');
+	for (; argv[request.argc]; request.argc++)
+		payload.append(argv[request.argc]).push_back('\0');
+	auto envp = VforkSpawner::environment(option);
+	for (; envp[request.envc]; request.envc++)
+		payload.append(envp[request.envc]).push_back('\0');
+	request.size = payload.size();
+	std::memcpy(&payload[0], &request, sizeof(request));
+	if (payload.size() > ZYGOTE_MAX_REQUEST || fds.size() > ZYGOTE_MAX_FDS)
+	{
+		LOG_WAR << fname << "request size <" << payload.size() << "> exceed spawn helper limit";
+		return 0;
+	}
+
+	struct iovec iov;
+	iov.iov_base = &payload[0];
+	iov.iov_len = payload.size();
+	char control[CMSG_SPACE(sizeof(int) * ZYGOTE_MAX_FDS)];
+	std::memset(control, 0, sizeof(control));
+	struct msghdr msg;
+	std::memset(&msg, 0, sizeof(msg));
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	if (fds.size())
+	{
+		msg.msg_control = control;
+		msg.msg_controllen = CMSG_SPACE(sizeof(int) * fds.size());
+		auto cmsg = CMSG_FIRSTHDR(&msg);
+		cmsg->cmsg_level = SOL_SOCKET;
+		cmsg->cmsg_type = SCM_RIGHTS;
+		cmsg->cmsg_len = CMSG_LEN(sizeof(int) * fds.size());
+		std::memcpy(CMSG_DATA(cmsg), fds.data(), sizeof(int) * fds.size());
+	}
+
+	// helper is single-threaded, one request at a time
+	std::lock_guard<std::mutex> guard(m_mutex);
+	if (m_socket < 0)
+		return 0;
+	ssize_t ret;
+	while ((ret = ::sendmsg(m_socket, &msg, MSG_NOSIGNAL)) < 0 && errno == EINTR)
+		;
+	if (ret < 0)
+	{
+		LOG_ERR << fname << "send request to spawn helper <" << m_pid << "> failed with error: " << std::strerror(errno);
+		if (errno != EMSGSIZE)
+			disconnect();
+		return 0;
+	}
+	ZygoteResponse response;
+	if (!receiveResponse(m_socket, response))
+	{
+		// request may be handled already, do not spawn again.
+		// child is not cloned or it exit without exec when helper failed to report pid
+		LOG_ERR << fname << "spawn helper <" << m_pid << "> not respond with error: " << std::strerror(errno);
+		disconnect();
+		errno = ECOMM;
+		return ACE_INVALID_PID;
+	}
+	const pid_t pid = response.pid;
+	if (pid > 0 && !receiveResponse(m_socket, response))
+	{
+		// child is daemon's child (CLONE_PARENT), kill and collect it since nobody own it
+		LOG_ERR << fname << "spawn helper <" << m_pid << "> not report exec result of <" << pid << "> with error: " << std::strerror(errno);
+		::kill(pid, SIGKILL);
+		::waitpid(pid, nullptr, 0);
+		disconnect();
+		errno = ECOMM;
+		return ACE_INVALID_PID;
+	}
+	if (pid <= 0 || response.error)
+	{
+		// child exit without exec and is not registered to ProcessReaper
+		if (pid > 0)
+			::waitpid(pid, nullptr, 0);
+		LOG_WAR << fname << "Process <" << argv[0] << "> failed to spawn with error: " << std::strerror(response.error);
+		errno = response.error;
+		return ACE_INVALID_PID;
+	}
+	return pid;
+}
+
+
+void ZygoteSpawner::serve(int socket, pid_t parent)
+{
+	// helper exit together with daemon, daemon exit before prctl() does not trigger the signal
+	::prctl(PR_SET_PDEATHSIG, SIGKILL);
+	if (::getppid() != parent)
+		::_exit(EXIT_FAILURE);
+	::prctl(PR_SET_NAME, "appmesh-zygote");
+	// daemon signal handlers must not run in helper, ignored signals (SIGPIPE) are kept for child same as fork
+	for (int sig = 1; sig < _NSIG; sig++)
+	{
+		struct sigaction action;
+		if (::sigaction(sig, nullptr, &action) == 0 && action.sa_handler != SIG_DFL && action.sa_handler != SIG_IGN)
+		{
+			std::memset(&action, 0, sizeof(action));
+			action.sa_handler = SIG_DFL;
+			::sigaction(sig, &action, nullptr);
+		}
+	}
+	// SIGCHLD is blocked in daemon for signalfd, child inherit an empty mask from helper
+	sigset_t emptySignals;
+	::sigemptyset(&emptySignals);
+	::sigprocmask(SIG_SETMASK, &emptySignals, nullptr);
+	closeInheritedFds(socket);
+
+	std::vector<char> buffer(ZYGOTE_MAX_REQUEST);
+	void *stack = ::mmap(nullptr, ZYGOTE_STACK_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK, -1, 0);
+	if (stack == MAP_FAILED)
+		::_exit(EXIT_FAILURE);
+	while (true)
+	{
+		struct iovec iov;
+		iov.iov_base = buffer.data();
+		iov.iov_len = buffer.size();
+		char control[CMSG_SPACE(sizeof(int) * ZYGOTE_MAX_FDS)];
+		struct msghdr msg;
+		std::memset(&msg, 0, sizeof(msg));
+		msg.msg_iov = &iov;
+		msg.msg_iovlen = 1;
+		msg.msg_control = control;
+		msg.msg_controllen = sizeof(control);
+		// passed fds are closed in child by exec
+		ssize_t size = ::recvmsg(socket, &msg, MSG_CMSG_CLOEXEC);
+		if (size < 0 && errno == EINTR)
+			continue;
+		if (size <= 0)
+		{
+			// daemon closed the socket
+			::_exit(EXIT_SUCCESS);
+		}
+
+		std::vector<int> fds;
+		for (auto cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg))
+		{
+			if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS)
+			{
+				auto count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+				auto data = reinterpret_cast<int *>(CMSG_DATA(cmsg));
+				fds.insert(fds.end(), data, data + count);
+			}
+		}
+		bool delivered;
+		if (msg.msg_flags & (MSG_TRUNC | MSG_CTRUNC))
+			delivered = sendResponse(socket, ZygoteResponse{ACE_INVALID_PID, EMSGSIZE});
+		else
+			delivered = handleRequest(socket, buffer.data(), size, fds, static_cast<char *>(stack));
+		for (auto fd : fds)
+			::close(fd);
+		if (!delivered)
+			::_exit(EXIT_FAILURE);
+	}
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <ace/Process.h>
+
+/// <summary>
+/// Pre-forked spawner helper (zygote) for high rate launch.
+/// The helper is forked from daemon at boot when address space is still small and no thread is created,
+/// it is single-threaded and serve spawn requests from daemon over a unix socket (SOCK_SEQPACKET):
+///  1. request: command line, env, uid/gid, process group, working directory
+///  2. stdin/stdout/stderr and cgroup.procs fds are passed by SCM_RIGHTS
+///  3. reply: process id before child continue, then errno of exec (exec failure is reported by a CLOEXEC pipe),
+///     child exit without exec when its pid is not delivered and daemon kill it when exec result is lost
+/// Process is created with clone(CLONE_PARENT), so it is a child of daemon (not helper),
+/// exit status is collected by ProcessReaper the same as other spawn modes,
+/// helper itself and children failed to exec are collected by ZygoteSpawner.
+/// </summary>
+class ZygoteSpawner
+{
+public:
+	ZygoteSpawner();
+	virtual ~ZygoteSpawner();
+	static std::shared_ptr<ZygoteSpawner> &instance();
+
+	/// <summary>
+	/// Fork the helper process, must be called before any thread is created
+	/// </summary>
+	/// <returns>true for helper started</returns>
+	bool start();
+	/// <summary>
+	/// Stop helper process, helper also exit when daemon close the socket or exit
+	/// </summary>
+	void stop();
+	/// <summary>
+	/// Helper is started and connection is available
+	/// </summary>
+	bool running() const;
+
+	/// <summary>
+	/// Spawn process by helper with ACE options
+	/// </summary>
+	/// <param name="option">ACE process options</param>
+	/// <param name="cgroupProcsFds">cgroup.procs fds, child write "0" to join before exec</param>
+	/// <returns>process id, -1 for spawn failure with errno set,
+	///  0 for request can not be delivered to helper (caller should spawn by itself)</returns>
+	pid_t spawn(ACE_Process_Options &option, const std::vector<int> &cgroupProcsFds);
+
+	/// <summary>
+	/// Helper process id
+	/// </summary>
+	pid_t getpid() const;
+
+private:
+	[[noreturn]] static void serve(int socket, pid_t parent);
+	void disconnect();
+
+private:
+	mutable std::mutex m_mutex;
+	int m_socket;
+	pid_t m_pid;
+};
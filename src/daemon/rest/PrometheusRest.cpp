@@ -3,6 +3,7 @@
 
 #include "../../common/Utility.h"
 #include "../../prom_exporter/counter.h"
+#include "../../prom_exporter/histogram.h"
 #include "../../prom_exporter/registry.h"
 #include "../../prom_exporter/text_serializer.h"
 #include "../Configuration.h"
@@ -123,6 +124,13 @@ std::shared_ptr<GaugeMetric> PrometheusRest::createPromGauge(const std::string &
 	return std::make_shared<GaugeMetric>(m_promRegistry, metricName, metricHelp, labels);
 }
 
+std::shared_ptr<HistogramMetric> PrometheusRest::createPromHistogram(const std::string &metricName, const std::string &metricHelp, const std::map<std::string, std::string> &labels, const std::vector<double> &buckets)
+{
+	if (!m_promEnabled)
+		return nullptr;
+	return std::make_shared<HistogramMetric>(m_promRegistry, metricName, metricHelp, labels, buckets);
+}
+
 void PrometheusRest::handleRest(const HttpRequest &message, const std::map<std::string, std::function<void(const HttpRequest &)>> &restFunctions)
 {
 	if (message.m_method == web::http::methods::GET)
@@ -168,7 +176,7 @@ void PrometheusRest::apiMetrics(const HttpRequest &message)
 }
 
 CounterMetric::CounterMetric(std::shared_ptr<prometheus::Registry> registry, const std::string &name, const std::string &help, std::map<std::string, std::string> label)
-	: m_metric(nullptr), m_family(nullptr), m_promRegistry(registry), m_name(name), m_help(help), m_label(label)
+	: m_metric(nullptr), m_total(0), m_family(nullptr), m_promRegistry(registry), m_name(name), m_help(help), m_label(label)
 {
 	const static char fname[] = "CounterMetric::CounterMetric() ";
 	std::map<std::string, std::string> commonLabels = {{"host", MY_HOST_NAME}, {"pid", std::to_string(ResourceCollection::instance()->getPid())}};
@@ -196,6 +204,16 @@ prometheus::Counter &CounterMetric::metric()
 	return *m_metric;
 }
 
+void CounterMetric::setTotal(double total)
+{
+	if (total < 0)
+		return;
+	const double increase = (total >= m_total) ? (total - m_total) : total;
+	m_total = total;
+	if (increase > 0)
+		m_metric->Increment(increase);
+}
+
 GaugeMetric::GaugeMetric(std::shared_ptr<prometheus::Registry> registry, const std::string &name, const std::string &help, std::map<std::string, std::string> label)
 	: m_metric(nullptr), m_family(nullptr), m_promRegistry(registry), m_name(name), m_help(help), m_label(label)
 {
@@ -225,3 +243,33 @@ prometheus::Gauge &GaugeMetric::metric()
 {
 	return *m_metric;
 }
+
+HistogramMetric::HistogramMetric(std::shared_ptr<prometheus::Registry> registry, const std::string &name, const std::string &help, std::map<std::string, std::string> label, const std::vector<double> &buckets)
+	: m_metric(nullptr), m_family(nullptr), m_promRegistry(registry), m_name(name), m_help(help), m_label(label)
+{
+	const static char fname[] = "HistogramMetric::HistogramMetric() ";
+
+	std::map<std::string, std::string> commonLabels = {{"host", MY_HOST_NAME}, {"pid", std::to_string(ResourceCollection::instance()->getPid())}};
+	commonLabels.insert(label.begin(), label.end());
+
+	auto &family = prometheus::BuildHistogram()
+					   .Name(m_name)
+					   .Help(help)
+					   .Register(*m_promRegistry);
+	m_family = &family;
+	m_metric = &((family.Add(commonLabels, buckets)));
+
+	LOG_DBG << fname << "metric " << m_name << " added";
+}
+
+HistogramMetric::~HistogramMetric()
+{
+	const static char fname[] = "HistogramMetric::~HistogramMetric() ";
+	m_family->Remove(m_metric);
+	LOG_DBG << fname << "metric " << m_name << " removed";
+}
+
+prometheus::Histogram &HistogramMetric::metric()
+{
+	return *m_metric;
+}
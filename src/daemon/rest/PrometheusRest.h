@@ -13,6 +13,7 @@ namespace prometheus
 {
 	class Counter;
 	class Gauge;
+	class Histogram;
 	class Registry;
 }; // namespace prometheus
 
@@ -37,9 +38,15 @@ public:
 	virtual ~CounterMetric();
 
 	prometheus::Counter &metric();
+	/// <summary>
+	/// Export a cumulative total read from kernel (cgroup cpu, io, network),
+	/// increase by the delta of last total, a total smaller than last one means the source restart from 0
+	/// </summary>
+	void setTotal(double total);
 
 private:
 	prometheus::Counter *m_metric;
+	double m_total;
 	prometheus::Family<prometheus::Counter> *m_family;
 	std::shared_ptr<prometheus::Registry> m_promRegistry;
 
@@ -71,6 +78,30 @@ private:
 	const std::map<std::string, std::string> m_label;
 };
 
+/// <summary>
+/// Metric Wrapper for reg/unreg metric automaticaly
+/// </summary>
+class HistogramMetric
+{
+public:
+	explicit HistogramMetric(std::shared_ptr<prometheus::Registry> registry,
+							 const std::string &name, const std::string &help,
+							 std::map<std::string, std::string> label,
+							 const std::vector<double> &buckets);
+
+	virtual ~HistogramMetric();
+
+	prometheus::Histogram &metric();
+
+private:
+	prometheus::Histogram *m_metric;
+	prometheus::Family<prometheus::Histogram> *m_family;
+	std::shared_ptr<prometheus::Registry> m_promRegistry;
+	const std::string m_name;
+	const std::string m_help;
+	const std::map<std::string, std::string> m_label;
+};
+
 /// <summary>
 /// Prometheus Exporter REST service
 /// </summary>
@@ -96,6 +127,15 @@ public:
 	/// <param name="labels"></param>
 	/// <returns>return null if exporter was not enabled</returns>
 	std::shared_ptr<GaugeMetric> createPromGauge(const std::string &metricName, const std::string &metricHelp, const std::map<std::string, std::string> &labels) noexcept(false);
+	/// <summary>
+	/// Create a Histogram Metric
+	/// </summary>
+	/// <param name="metricName"></param>
+	/// <param name="metricHelp"></param>
+	/// <param name="labels"></param>
+	/// <param name="buckets">bucket boundaries</param>
+	/// <returns>return null if exporter was not enabled</returns>
+	std::shared_ptr<HistogramMetric> createPromHistogram(const std::string &metricName, const std::string &metricHelp, const std::map<std::string, std::string> &labels, const std::vector<double> &buckets) noexcept(false);
 
 	/// <summary>
 	/// Collect all metrics
@@ -180,3 +220,44 @@ public:
 // Application process memory usage
 #define PROM_METRIC_NAME_appmesh_prom_process_memory_gauge "appmesh_prom_process_memory_gauge"
 #define PROM_METRIC_HELP_appmesh_prom_process_memory_gauge "application process memory bytes"
+
+#define PROM_METRIC_NAME_appmesh_prom_process_cgroup_memory_gauge "appmesh_prom_process_cgroup_memory_gauge"
+#define PROM_METRIC_HELP_appmesh_prom_process_cgroup_memory_gauge "application cgroup memory usage bytes"
+
+#define PROM_METRIC_NAME_appmesh_prom_process_cgroup_cpu_seconds "appmesh_prom_process_cgroup_cpu_seconds_total"
+#define PROM_METRIC_HELP_appmesh_prom_process_cgroup_cpu_seconds "application cgroup cpu usage seconds"
+// Timer dispatch pending task number
+#define PROM_METRIC_NAME_appmesh_timer_dispatch_queue_depth "appmesh_timer_dispatch_queue_depth"
+#define PROM_METRIC_HELP_appmesh_timer_dispatch_queue_depth "timer event pending dispatch number"
+// Timer dispatch lag
+#define PROM_METRIC_NAME_appmesh_timer_dispatch_lag_milliseconds "appmesh_timer_dispatch_lag_milliseconds"
+#define PROM_METRIC_HELP_appmesh_timer_dispatch_lag_milliseconds "timer event latest dispatch lag milliseconds"
+// Application health check duration
+#define PROM_METRIC_NAME_appmesh_health_check_duration_seconds "appmesh_health_check_duration_seconds"
+#define PROM_METRIC_HELP_appmesh_health_check_duration_seconds "application health check duration seconds"
+#define PROM_METRIC_NAME_appmesh_app_stop_duration_seconds "appmesh_app_stop_duration_seconds"
+#define PROM_METRIC_HELP_appmesh_app_stop_duration_seconds "application process stop duration seconds from stop signal to exit"
+#define PROM_METRIC_NAME_appmesh_app_restart_continue_fails "appmesh_app_restart_continue_fails"
+#define PROM_METRIC_HELP_appmesh_app_restart_continue_fails "application continuous quick exit number for restart backoff"
+#define PROM_METRIC_NAME_appmesh_app_restart_backoff_seconds "appmesh_app_restart_backoff_seconds"
+#define PROM_METRIC_HELP_appmesh_app_restart_backoff_seconds "application seconds to wait before next restart"
+// Docker image pull
+#define PROM_METRIC_NAME_appmesh_docker_image_pull_state "appmesh_docker_image_pull_state"
+#define PROM_METRIC_HELP_appmesh_docker_image_pull_state "docker image pull state, 0-queued 1-pulling 2-done 3-failed"
+#define PROM_METRIC_NAME_appmesh_docker_image_pull_progress "appmesh_docker_image_pull_progress"
+#define PROM_METRIC_HELP_appmesh_docker_image_pull_progress "docker image pull download percent"
+// Docker container resource usage, labelled by container id
+#define PROM_METRIC_NAME_appmesh_container_cpu_seconds "appmesh_container_cpu_seconds_total"
+#define PROM_METRIC_HELP_appmesh_container_cpu_seconds "container cgroup cpu usage seconds"
+#define PROM_METRIC_NAME_appmesh_container_memory_bytes "appmesh_container_memory_bytes"
+#define PROM_METRIC_HELP_appmesh_container_memory_bytes "container cgroup memory usage bytes include page cache"
+#define PROM_METRIC_NAME_appmesh_container_memory_cache_bytes "appmesh_container_memory_cache_bytes"
+#define PROM_METRIC_HELP_appmesh_container_memory_cache_bytes "container cgroup page cache bytes"
+#define PROM_METRIC_NAME_appmesh_container_block_read_bytes "appmesh_container_block_read_bytes_total"
+#define PROM_METRIC_HELP_appmesh_container_block_read_bytes "container block device read bytes"
+#define PROM_METRIC_NAME_appmesh_container_block_write_bytes "appmesh_container_block_write_bytes_total"
+#define PROM_METRIC_HELP_appmesh_container_block_write_bytes "container block device write bytes"
+#define PROM_METRIC_NAME_appmesh_container_network_receive_bytes "appmesh_container_network_receive_bytes_total"
+#define PROM_METRIC_HELP_appmesh_container_network_receive_bytes "container network receive bytes"
+#define PROM_METRIC_NAME_appmesh_container_network_transmit_bytes "appmesh_container_network_transmit_bytes_total"
+#define PROM_METRIC_HELP_appmesh_container_network_transmit_bytes "container network transmit bytes"
@@ -11,11 +11,13 @@
 #include "../Label.h"
 #include "../ResourceCollection.h"
 #include "../application/Application.h"
+#include "../application/OutputSearch.h"
 #include "../security/User.h"
 #include "ConsulConnection.h"
 #include "HttpRequest.h"
 #include "PrometheusRest.h"
 #include "RestHandler.h"
+#include "RunOutputWaiter.h"
 
 RestHandler::RestHandler(bool forward2TcpServer) : PrometheusRest(forward2TcpServer)
 {
@@ -26,6 +28,7 @@ RestHandler::RestHandler(bool forward2TcpServer) : PrometheusRest(forward2TcpSer
 	// 2. View Application
 	bindRestMethod(web::http::methods::GET, R"(/appmesh/app/([^/\*]+))", std::bind(&RestHandler::apiGetApp, this, std::placeholders::_1));
 	bindRestMethod(web::http::methods::GET, R"(/appmesh/app/([^/\*]+)/output)", std::bind(&RestHandler::apiGetAppOutput, this, std::placeholders::_1));
+	bindRestMethod(web::http::methods::GET, R"(/appmesh/app/([^/\*]+)/output/search)", std::bind(&RestHandler::apiSearchAppOutput, this, std::placeholders::_1));
 	bindRestMethod(web::http::methods::GET, "/appmesh/applications", std::bind(&RestHandler::apiGetApps, this, std::placeholders::_1));
 	bindRestMethod(web::http::methods::GET, "/appmesh/resources", std::bind(&RestHandler::apiGetResources, this, std::placeholders::_1));
 
@@ -827,23 +830,18 @@ void RestHandler::apiRunAsyncOut(const HttpRequest &message)
 	if (querymap.find(U(HTTP_QUERY_KEY_process_uuid)) != querymap.end())
 	{
 		auto uuid = GET_STD_STRING(querymap.find(U(HTTP_QUERY_KEY_process_uuid))->second);
+		int wait = getHttpQueryValue(message, HTTP_QUERY_KEY_output_wait, 0, 1, MAX_RUN_OUTPUT_WAIT_SECONDS);
 
-		int exitCode = 0;
-		bool finished = false;
 		auto appObj = Configuration::instance()->getApp(app);
-		std::string body = appObj->getAsyncRunOutput(uuid, exitCode, finished);
-		web::http::http_response resp(status_codes::OK);
-		if (finished)
+		if (wait > 0)
 		{
-			resp.set_status_code(status_codes::Created);
-			resp.headers().add(HTTP_HEADER_KEY_exit_code, exitCode);
-			// remove temp app immediately
-			if (!appObj->isWorkingState())
-				Configuration::instance()->removeApp(app);
+			// long-poll: reply when output available or process exit
+			RunOutputWaiter::instance()->wait(message, appObj, uuid, wait);
+		}
+		else
+		{
+			RunOutputWaiter::reply(message, appObj, uuid, true);
 		}
-
-		LOG_DBG << fname << "Use process uuid :" << uuid << " ExitCode:" << exitCode;
-		message.reply(resp, body);
 	}
 	else
 	{
@@ -864,12 +862,147 @@ void RestHandler::apiGetAppOutput(const HttpRequest &message)
 
 	bool keepHis = getHttpQueryValue(message, HTTP_QUERY_KEY_keep_history, false, 0, 0);
 	int index = getHttpQueryValue(message, HTTP_QUERY_KEY_stdout_index, 0, 0, 0);
+	auto querymap = web::uri::split_query(web::http::uri::decode(message.m_query));
+	// non-negative integer, invalid value is replied with BadRequest
+	auto queryNumber = [&querymap](const std::string &key) -> std::uint64_t {
+		if (querymap.count(U(key)) == 0)
+			return 0;
+		const auto value = GET_STD_STRING(querymap.find(U(key))->second);
+		if (value.empty() || value.find_first_not_of("0123456789") != std::string::npos || value.length() > 19)
+			throw std::invalid_argument(Utility::stringFormat("Query parameter '%s' should be a non-negative integer", key.c_str()));
+		return std::stoull(value);
+	};
+	const bool range = querymap.count(U(HTTP_QUERY_KEY_output_offset)) || querymap.count(U(HTTP_QUERY_KEY_output_length)) ||
+					   querymap.count(U(HTTP_QUERY_KEY_output_tail)) || querymap.count(U(HTTP_QUERY_KEY_output_from_line));
+
+	checkAppAccessPermission(message, appName, false);
+	auto appObj = Configuration::instance()->getApp(appName);
+
+	if (!range && !keepHis && index == 0)
+	{
+		// content since last fetch
+		auto output = appObj->getOutput(keepHis, index);
+		LOG_DBG << fname; // << output;
+		message.reply(status_codes::OK, output);
+		return;
+	}
+
+	// byte range, OutputOffset header tells where to continue
+	// tail and from_line are resolved to start offset by line index
+	std::uint64_t offset = queryNumber(HTTP_QUERY_KEY_output_offset);
+	std::size_t length = queryNumber(HTTP_QUERY_KEY_output_length);
+	if (querymap.count(U(HTTP_QUERY_KEY_output_tail)))
+		offset = appObj->getOutputLineOffset(index, queryNumber(HTTP_QUERY_KEY_output_tail), true);
+	else if (querymap.count(U(HTTP_QUERY_KEY_output_from_line)))
+		offset = appObj->getOutputLineOffset(index, queryNumber(HTTP_QUERY_KEY_output_from_line), false);
+	LOG_DBG << fname << "offset=" << offset << " length=" << length;
+
+	auto file = appObj->getOutputFile(index, offset);
+	if (!message.m_reply2child && file.length())
+	{
+		// serve file directly by stream, forwarded request only support string body
+		concurrency::streams::fstream::open_istream(file, std::ios::in | std::ios::binary)
+			.then([=](concurrency::streams::istream fileStream) {
+				fileStream.seek(0, std::ios::end);
+				auto fileSize = static_cast<std::uint64_t>(fileStream.tell());
+				auto begin = std::min(offset, fileSize);
+				auto size = fileSize - begin;
+				if (length && size > length)
+					size = length;
+				fileStream.seek(begin, std::ios::beg);
+
+				web::http::http_response resp(status_codes::OK);
+				resp.set_body(fileStream, static_cast<std::size_t>(size), "text/plain; charset=utf-8");
+				resp.headers().add(HTTP_HEADER_KEY_output_offset, begin + size);
+				// reply is finished when the whole body is sent
+				message.reply(resp);
+				return fileStream;
+			})
+			.then([=](pplx::task<concurrency::streams::istream> t) {
+				concurrency::streams::istream fileStream;
+				try
+				{
+					fileStream = t.get();
+				}
+				catch (...)
+				{
+					message.reply(status_codes::InternalError);
+					return;
+				}
+				// close stream only after body is sent
+				fileStream.close();
+			});
+		return;
+	}
+
+	auto output = appObj->getOutput(index, offset, length);
+	web::http::http_response resp(status_codes::OK);
+	resp.set_body(output);
+	resp.headers().add(HTTP_HEADER_KEY_output_offset, offset);
+	message.reply(resp, output);
+}
+
+void RestHandler::apiSearchAppOutput(const HttpRequest &message)
+{
+	const static char fname[] = "RestHandler::apiSearchAppOutput() ";
+	permissionCheck(message, PERMISSION_KEY_view_app_output);
+	auto path = GET_STD_STRING(http::uri::decode(message.m_relative_uri));
+
+	// /appmesh/app/$app-name/output/search?pattern=error&regex=0&max_count=1000&timeout=5
+	std::string app = path.substr(strlen("/appmesh/app/"));
+	auto appName = app.substr(0, app.find_first_of('/'));
+
+	auto querymap = web::uri::split_query(web::http::uri::decode(message.m_query));
+	if (querymap.find(U(HTTP_QUERY_KEY_search_pattern)) == querymap.end())
+	{
+		throw std::invalid_argument("Query parameter 'pattern' is required to search output");
+	}
+	auto pattern = GET_STD_STRING(querymap.find(U(HTTP_QUERY_KEY_search_pattern))->second);
+	bool regex = getHttpQueryValue(message, HTTP_QUERY_KEY_search_regex, false, 0, 0);
+	int maxCount = getHttpQueryValue(message, HTTP_QUERY_KEY_search_max_count, DEFAULT_OUTPUT_SEARCH_MAX_COUNT, 1, 100000);
+	int timeout = getHttpQueryValue(message, HTTP_QUERY_KEY_timeout, DEFAULT_OUTPUT_SEARCH_TIMEOUT_SECONDS, 1, 300);
 
 	checkAppAccessPermission(message, appName, false);
+	auto appObj = Configuration::instance()->getApp(appName);
+	auto files = appObj->getOutputFiles();
+	int onlyIndex = -1;
+	if (querymap.find(U(HTTP_QUERY_KEY_stdout_index)) != querymap.end())
+	{
+		onlyIndex = getHttpQueryValue(message, HTTP_QUERY_KEY_stdout_index, 0, 0, 0);
+	}
+
+	// one json object per line: {"index":0,"offset":123,"line":"..."}
+	std::string body;
+	OutputSearch search(pattern, regex, maxCount, std::chrono::seconds(timeout));
+	auto collect = [&body](const OutputMatch &match) {
+		web::json::value result = web::json::value::object();
+		result[U("index")] = web::json::value::number(match.m_index);
+		result[U("offset")] = web::json::value::number(match.m_offset);
+		result[U("line")] = web::json::value::string(match.m_line);
+		body.append(GET_STD_STRING(result.serialize())).append("\n");
+	};
+	for (std::size_t i = 0; i < files.size(); i++)
+	{
+		if (onlyIndex >= 0 && onlyIndex != static_cast<int>(i))
+			continue;
+		// current output of memory only capture is not in file
+		std::string memory;
+		std::uint64_t memoryOffset = 0;
+		if (i == 0 && appObj->getMemoryOutput(memory, memoryOffset))
+		{
+			if (!search.scanMemory(memory, memoryOffset, i, collect))
+				break;
+			continue;
+		}
+		if (!search.scan(files[i], i, collect))
+			break;
+	}
+	LOG_DBG << fname << "pattern <" << pattern << "> matched <" << search.count() << "> truncated <" << search.truncated() << ">";
 
-	auto output = Configuration::instance()->getApp(appName)->getOutput(keepHis, index);
-	LOG_DBG << fname; // << output;
-	message.reply(status_codes::OK, output);
+	web::http::http_response resp(status_codes::OK);
+	resp.set_body(body, "application/x-ndjson");
+	resp.headers().add(HTTP_HEADER_KEY_search_truncated, search.truncated() ? "true" : "false");
+	message.reply(resp, body);
 }
 
 void RestHandler::apiGetApps(const HttpRequest &message)
@@ -31,6 +31,7 @@ protected:
 	void apiRunSync(const HttpRequest &message);
 	void apiRunAsyncOut(const HttpRequest &message);
 	void apiGetAppOutput(const HttpRequest &message);
+	void apiSearchAppOutput(const HttpRequest &message);
 	void apiGetApps(const HttpRequest &message);
 	void apiGetResources(const HttpRequest &message);
 	void apiRegApp(const HttpRequest &message);
@@ -0,0 +1,175 @@
+#include <functional>
+
+#include "../../common/Utility.h"
+#include "../Configuration.h"
+#include "../application/Application.h"
+#include "../process/OutputCapture.h"
+#include "RunOutputWaiter.h"
+
+// stdout written to file directly and capture drain timeout are not notified, waiters are also checked by this interval
+constexpr int RUN_OUTPUT_CHECK_INTERVAL_MS = 200;
+
+namespace
+{
+	// reply error in waiter thread, connection may already be closed by client
+	void replyError(const HttpRequest &message, const std::string &error)
+	{
+		try
+		{
+			message.reply(web::http::status_codes::BadRequest, error);
+		}
+		catch (...)
+		{
+		}
+	}
+} // namespace
+
+RunOutputWaiter::RunOutputWaiter()
+	: m_notified(false), m_running(false)
+{
+}
+
+RunOutputWaiter::~RunOutputWaiter()
+{
+	{
+		std::lock_guard<std::mutex> guard(m_mutex);
+		m_running = false;
+		m_cond.notify_all();
+	}
+	if (m_thread)
+		m_thread->join();
+}
+
+std::shared_ptr<RunOutputWaiter> &RunOutputWaiter::instance()
+{
+	static auto singleton = std::make_shared<RunOutputWaiter>();
+	return singleton;
+}
+
+void RunOutputWaiter::wait(const HttpRequest &message, const std::shared_ptr<Application> &app, const std::string &processUuid, int waitSeconds)
+{
+	const static char fname[] = "RunOutputWaiter::wait() ";
+
+	if (reply(message, app, processUuid, false, false))
+		return;
+
+	Waiter waiter;
+	waiter.m_request = std::make_shared<HttpRequest>(message);
+	waiter.m_app = app;
+	waiter.m_processUuid = processUuid;
+	waiter.m_deadline = std::chrono::steady_clock::now() + std::chrono::seconds(waitSeconds);
+	waiter.m_buffer = app->getAsyncRunOutputBuffer(processUuid).get();
+	// output may come before added, check again
+	waiter.m_check = true;
+
+	std::lock_guard<std::mutex> guard(m_mutex);
+	// waiter thread is started with the first held request
+	if (!m_running)
+	{
+		m_running = true;
+		std::weak_ptr<RunOutputWaiter> weakWaiter = instance();
+		OutputCapture::instance()->setListener([weakWaiter](const OutputBuffer *buffer) {
+			if (auto runOutputWaiter = weakWaiter.lock())
+				runOutputWaiter->notify(buffer);
+		});
+		m_thread = std::make_unique<std::thread>(std::bind(&RunOutputWaiter::run, this));
+	}
+	m_waiters.push_back(waiter);
+	m_notified = true;
+	m_cond.notify_all();
+	LOG_DBG << fname << "hold request for process <" << processUuid << "> " << waitSeconds << " seconds, waiting: " << m_waiters.size();
+}
+
+void RunOutputWaiter::notify(const OutputBuffer *buffer)
+{
+	std::lock_guard<std::mutex> guard(m_mutex);
+	m_notifiedBuffers.insert(buffer);
+	m_notified = true;
+	m_cond.notify_all();
+}
+
+bool RunOutputWaiter::reply(const HttpRequest &message, const std::shared_ptr<Application> &app, const std::string &processUuid, bool force, bool wait)
+{
+	const static char fname[] = "RunOutputWaiter::reply() ";
+
+	int exitCode = 0;
+	bool finished = false;
+	std::string body = app->getAsyncRunOutput(processUuid, exitCode, finished, wait);
+	if (body.empty() && !finished && !force)
+		return false;
+
+	web::http::http_response resp(status_codes::OK);
+	if (finished)
+	{
+		resp.set_status_code(status_codes::Created);
+		resp.headers().add(HTTP_HEADER_KEY_exit_code, exitCode);
+		// remove temp app immediately
+		if (!app->isWorkingState())
+			Configuration::instance()->removeApp(app->getName());
+	}
+
+	LOG_DBG << fname << "Use process uuid :" << processUuid << " ExitCode:" << exitCode;
+	resp.set_body(body);
+	message.reply(resp, body);
+	return true;
+}
+
+void RunOutputWaiter::run()
+{
+	const static char fname[] = "RunOutputWaiter::run() ";
+	LOG_INF << fname << "Entered";
+
+	auto lastCheck = std::chrono::steady_clock::now();
+	while (true)
+	{
+		std::list<Waiter> waiters;
+		std::set<const OutputBuffer *> notifiedBuffers;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_cond.wait_for(lock, std::chrono::milliseconds(RUN_OUTPUT_CHECK_INTERVAL_MS), [this] { return !m_running || m_notified; });
+			if (!m_running)
+				break;
+			m_notified = false;
+			waiters.swap(m_waiters);
+			notifiedBuffers.swap(m_notifiedBuffers);
+		}
+
+		// reply without lock, new waiters can be added
+		const auto now = std::chrono::steady_clock::now();
+		const bool checkAll = now - lastCheck >= std::chrono::milliseconds(RUN_OUTPUT_CHECK_INTERVAL_MS);
+		if (checkAll)
+			lastCheck = now;
+		for (auto it = waiters.begin(); it != waiters.end();)
+		{
+			// notified output is only checked for the waiters of its own buffer
+			const bool timeout = now >= it->m_deadline;
+			if (!checkAll && !it->m_check && !timeout && notifiedBuffers.count(it->m_buffer) == 0)
+			{
+				++it;
+				continue;
+			}
+			it->m_check = false;
+			bool replied = true;
+			try
+			{
+				// do not wait pipe drained here, pipe close is notified
+				replied = reply(*it->m_request, it->m_app, it->m_processUuid, timeout, false);
+			}
+			catch (const std::exception &e)
+			{
+				LOG_WAR << fname << "reply process <" << it->m_processUuid << "> output failed with error: " << e.what();
+				replyError(*it->m_request, e.what());
+			}
+			catch (...)
+			{
+				LOG_WAR << fname << "reply process <" << it->m_processUuid << "> output failed";
+				replyError(*it->m_request, "unknow exception");
+			}
+			it = replied ? waiters.erase(it) : std::next(it);
+		}
+
+		std::lock_guard<std::mutex> guard(m_mutex);
+		m_waiters.splice(m_waiters.end(), waiters);
+	}
+	LOG_INF << fname << "Exited";
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+
+#include "HttpRequest.h"
+
+class Application;
+class OutputBuffer;
+
+/// <summary>
+/// Long-poll of async run output:
+/// the request is held on server (no REST thread is occupied) until new output is available,
+/// the process exited or wait timeout, then replied by the waiter thread.
+/// Waiters are woken by OutputCapture for captured stdout of their own process and checked periodically for file stdout.
+/// Output is fetched without wait in waiter thread, one slow process does not delay other waiters.
+/// </summary>
+class RunOutputWaiter
+{
+	struct Waiter
+	{
+		std::shared_ptr<HttpRequest> m_request;
+		std::shared_ptr<Application> m_app;
+		std::string m_processUuid;
+		std::chrono::steady_clock::time_point m_deadline;
+		// captured output of the process, only used to match notify, nullptr for file stdout
+		const OutputBuffer *m_buffer;
+		// check output in next round
+		bool m_check;
+	};
+
+public:
+	RunOutputWaiter();
+	virtual ~RunOutputWaiter();
+	static std::shared_ptr<RunOutputWaiter> &instance();
+
+	/// <summary>
+	/// Reply output immediately when available, otherwise hold the request
+	/// </summary>
+	/// <param name="message">request of /appmesh/app/$app-name/run/output</param>
+	/// <param name="app">run application</param>
+	/// <param name="processUuid">run process uuid</param>
+	/// <param name="waitSeconds">max seconds to hold the request</param>
+	void wait(const HttpRequest &message, const std::shared_ptr<Application> &app, const std::string &processUuid, int waitSeconds);
+	/// <summary>
+	/// New output is available in buffer, wake up waiter thread for the waiters of the buffer
+	/// </summary>
+	void notify(const OutputBuffer *buffer);
+
+	/// <summary>
+	/// Reply current output, ExitCode header is added and temp application is removed when process finished
+	/// </summary>
+	/// <param name="force">reply empty output</param>
+	/// <param name="wait">wait captured pipe drained for exited process</param>
+	/// <returns>false for no output and process still running, not replied</returns>
+	static bool reply(const HttpRequest &message, const std::shared_ptr<Application> &app, const std::string &processUuid, bool force, bool wait = true) noexcept(false);
+
+private:
+	void run();
+
+private:
+	std::mutex m_mutex;
+	std::condition_variable m_cond;
+	std::list<Waiter> m_waiters;
+	std::set<const OutputBuffer *> m_notifiedBuffers;
+	bool m_notified;
+	bool m_running;
+	std::unique_ptr<std::thread> m_thread;
+};
@@ -1,7 +1,7 @@
 #!/usr/bin/python3
 import base64
+import json
 import os
-import time
 from enum import Enum
 from http import HTTPStatus
 from urllib import parse
@@ -77,6 +77,50 @@ class AppMeshClient:
         )
         return (resp.status_code == HTTPStatus.OK), resp.text
 
+    def get_app_output_range(
+        self, app_name, offset=0, length=0, stdout_index=0, tail=None, from_line=None
+    ):
+        # get application output from byte offset (length 0 for to the end),
+        # tail (last N lines) or from_line (0 based) replace offset,
+        # return the position to continue as the third value
+        query = {
+            "stdout_index": str(stdout_index),
+            "offset": str(offset),
+            "length": str(length),
+        }
+        if tail is not None:
+            query["tail"] = str(tail)
+        elif from_line is not None:
+            query["from_line"] = str(from_line)
+        resp = self.__request_http(
+            Method.GET, path="/appmesh/app/{0}/output".format(app_name), query=query
+        )
+        next_offset = int(resp.headers.get("OutputOffset", offset))
+        return (resp.status_code == HTTPStatus.OK), resp.text, next_offset
+
+    def search_app_output(
+        self, app_name, pattern, regex=False, max_count=1000, timeout=5, stdout_index=None
+    ):
+        # search current and rotated output files on server side,
+        # return list of {"index", "offset", "line"} and whether result is truncated
+        query = {
+            "pattern": pattern,
+            "regex": "1" if regex else "0",
+            "max_count": str(max_count),
+            "timeout": str(timeout),
+        }
+        if stdout_index is not None:
+            query["stdout_index"] = str(stdout_index)
+        resp = self.__request_http(
+            Method.GET,
+            path="/appmesh/app/{0}/output/search".format(app_name),
+            query=query,
+        )
+        if resp.status_code != HTTPStatus.OK:
+            return False, resp.text, False
+        matches = [json.loads(line) for line in resp.text.splitlines() if line]
+        return True, matches, resp.headers.get("SearchTruncated") == "true"
+
     def get_apps(self):
         # get all applications
         resp = self.__request_http(Method.GET, path="/appmesh/applications")
@@ -119,7 +163,7 @@ class AppMeshClient:
     def reg_app(self, app_json):
         # register an application
         resp = self.__request_http(
-            Method.PUT, path="/appmesh/app/{0}".format(app_json["name"])
+            Method.PUT, path="/appmesh/app/{0}".format(app_json["name"]), body=app_json
         )
         if resp.status_code == HTTPStatus.OK:
             return True, resp.json()
@@ -246,8 +290,11 @@ class AppMeshClient:
                 while len(process_uuid) > 0:
                     # /app/testapp/run/output?process_uuid=UUID
                     path = "/appmesh/app/{0}/run/output".format(app_name)
+                    # server hold the request until new output or process exit
                     resp = self.__request_http(
-                        Method.GET, path=path, query={"process_uuid": process_uuid}
+                        Method.GET,
+                        path=path,
+                        query={"process_uuid": process_uuid, "wait": "30"},
                     )
                     if resp.text is not None:
                         print(resp.text, end="")
@@ -255,7 +302,6 @@ class AppMeshClient:
                         resp.status_code != HTTPStatus.OK
                     ):
                         break
-                    time.sleep(0.5)
         else:
             print(resp.text)
 
@@ -0,0 +1,99 @@
+// Docker container start benchmark: the same API sequence as DockerProcess::syncSpawnProcess
+// (remove old container, inspect image, create, start, inspect pid) then remove, sequential and from concurrent threads
+// Usage: benchmark_docker [container starts] [image] [docker socket], default 200 "busybox" and an in-process fake Docker server
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <ace/Init_ACE.h>
+#include <ace/OS.h>
+
+#include "../../../src/common/Utility.h"
+#include "../../../src/daemon/process/DockerApiClient.h"
+#include "../../docker/FakeDockerServer.h"
+
+struct BenchResult
+{
+	int starts;
+	double elapsedMs;
+	int failed;
+};
+
+// one container start & remove, return false for failure
+static bool startContainer(const DockerApiClient &client, const std::string &image, const std::string &name)
+{
+	try
+	{
+		client.removeContainer(name);
+		if (client.imageSize(image) < 0)
+			client.pullImage(image, nullptr);
+		auto id = client.createContainer(name, DockerApiClient::containerConfig(image, "sleep 60", {}, nullptr, {}));
+		client.startContainer(id);
+		auto pid = client.containerPid(id);
+		client.removeContainer(id);
+		return pid > 0;
+	}
+	catch (const std::exception &e)
+	{
+		std::cerr << name << ": " << e.what() << std::endl;
+		return false;
+	}
+}
+
+static BenchResult run(const DockerApiClient &client, const std::string &image, int count, int threadCount)
+{
+	BenchResult result;
+	std::atomic<int> next(0);
+	std::atomic<int> failed(0);
+	auto start = std::chrono::steady_clock::now();
+	std::vector<std::thread> threads;
+	for (int t = 0; t < threadCount; t++)
+	{
+		threads.emplace_back([&]() {
+			int index;
+			while ((index = next++) < count)
+				failed += !startContainer(client, image, "appmesh-benchmark-" + std::to_string(index));
+		});
+	}
+	for (auto &thread : threads)
+		thread.join();
+	result.starts = count;
+	result.elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	result.failed = failed;
+	return result;
+}
+
+static void print(int threads, const BenchResult &result)
+{
+	std::cout << threads << "\t" << result.starts << "\t" << result.elapsedMs << "\t" << (result.starts * 1000.0 / result.elapsedMs) << "\t" << result.failed << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+	ACE::init();
+	int count = argc > 1 ? std::stoi(argv[1]) : 200;
+	std::string image = argc > 2 ? argv[2] : "busybox";
+	std::string socketPath = argc > 3 ? argv[3] : "";
+
+	std::unique_ptr<FakeDockerServer> fakeServer;
+	if (socketPath.empty())
+	{
+		socketPath = "/tmp/appmesh_benchmark_docker.sock";
+		fakeServer.reset(new FakeDockerServer(socketPath));
+		fakeServer->addImage(image + ":latest", 1024 * 1024);
+	}
+	DockerApiClient client(socketPath, 60);
+
+	std::cout << "starts=" << count << " image=" << image << " socket=" << socketPath << (fakeServer ? " (fake)" : "") << std::endl;
+	std::cout << "threads\tstarts\telapsed_ms\tstarts_per_sec\tfailed" << std::endl;
+	for (int threads : {1, 4, 16})
+		print(threads, run(client, image, count, threads));
+
+	fakeServer.reset();
+	ACE::fini();
+	return 0;
+}
@@ -0,0 +1,140 @@
+// Health check benchmark: native tcp:// probe vs exec probe (fork + exec + wait)
+// Usage: benchmark_probe [seconds] [exec command], default 3 seconds and /bin/true
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <ace/Init_ACE.h>
+#include <ace/OS.h>
+#include <ace/Process.h>
+#include <ace/Reactor.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include "../../../src/daemon/HealthProbe.h"
+
+// probes started together in one round
+#define PROBE_BATCH_SIZE 64
+
+// accept and close connections, return listen port
+static int startListener()
+{
+	int listenFd = ::socket(AF_INET, SOCK_STREAM, 0);
+	int on = 1;
+	::setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+	struct sockaddr_in addr;
+	std::memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	addr.sin_port = 0;
+	::bind(listenFd, (struct sockaddr *)&addr, sizeof(addr));
+	::listen(listenFd, 1024);
+	socklen_t length = sizeof(addr);
+	::getsockname(listenFd, (struct sockaddr *)&addr, &length);
+	std::thread([listenFd]() {
+		while (true)
+		{
+			int fd = ::accept(listenFd, nullptr, nullptr);
+			if (fd >= 0)
+				ACE_OS::close(fd);
+		}
+	}).detach();
+	return ntohs(addr.sin_port);
+}
+
+static double benchNative(const std::string &url, int seconds)
+{
+	std::mutex mutex;
+	std::condition_variable condition;
+	std::size_t finished = 0;
+	std::size_t total = 0;
+	std::size_t failed = 0;
+	auto start = std::chrono::steady_clock::now();
+	auto end = start + std::chrono::seconds(seconds);
+	while (std::chrono::steady_clock::now() < end)
+	{
+		std::vector<std::shared_ptr<HealthProbe>> probes;
+		{
+			std::lock_guard<std::mutex> guard(mutex);
+			finished = 0;
+		}
+		for (int i = 0; i < PROBE_BATCH_SIZE; i++)
+		{
+			auto probe = std::make_shared<HealthProbe>(url, 0, [&](const HealthProbe *, bool success) {
+				std::lock_guard<std::mutex> guard(mutex);
+				finished++;
+				if (!success)
+					failed++;
+				condition.notify_one();
+			});
+			if (!probe->start(ACE_Reactor::instance()))
+			{
+				std::lock_guard<std::mutex> guard(mutex);
+				finished++;
+				failed++;
+			}
+			probes.push_back(probe);
+		}
+		std::unique_lock<std::mutex> lock(mutex);
+		condition.wait(lock, [&]() { return finished == PROBE_BATCH_SIZE; });
+		total += PROBE_BATCH_SIZE;
+	}
+	auto cost = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	if (failed)
+		std::cout << "native probe failed: " << failed << std::endl;
+	return total / cost;
+}
+
+static double benchExec(const std::string &cmd, int seconds)
+{
+	std::size_t total = 0;
+	auto start = std::chrono::steady_clock::now();
+	auto end = start + std::chrono::seconds(seconds);
+	while (std::chrono::steady_clock::now() < end)
+	{
+		std::vector<std::unique_ptr<ACE_Process>> processes;
+		for (int i = 0; i < PROBE_BATCH_SIZE; i++)
+		{
+			ACE_Process_Options option;
+			option.command_line("%s", cmd.c_str());
+			std::unique_ptr<ACE_Process> process(new ACE_Process());
+			process->spawn(option);
+			processes.push_back(std::move(process));
+		}
+		for (auto &process : processes)
+		{
+			process->wait();
+		}
+		total += PROBE_BATCH_SIZE;
+	}
+	auto cost = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	return total / cost;
+}
+
+int main(int argc, char *argv[])
+{
+	ACE::init();
+	int seconds = argc > 1 ? std::stoi(argv[1]) : 3;
+	std::string execCmd = argc > 2 ? argv[2] : "/bin/true";
+
+	auto port = startListener();
+	std::thread reactorThread([]() {
+		ACE_Reactor::instance()->owner(ACE_OS::thr_self());
+		ACE_Reactor::instance()->run_reactor_event_loop();
+	});
+
+	auto url = "tcp://127.0.0.1:" + std::to_string(port);
+	std::cout << "native\t" << url << "\t" << benchNative(url, seconds) << " probes/s" << std::endl;
+	std::cout << "exec\t" << execCmd << "\t" << benchExec(execCmd, seconds) << " probes/s" << std::endl;
+
+	ACE_Reactor::instance()->end_reactor_event_loop();
+	reactorThread.join();
+	ACE::fini();
+	return 0;
+}
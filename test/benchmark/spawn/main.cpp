@@ -0,0 +1,142 @@
+// Spawn benchmark: ACE_Process::spawn (fork), VforkSpawner (clone CLONE_VM|CLONE_VFORK) and ZygoteSpawner
+// (helper forked before daemon memory grows).
+// latency: average spawn() cost at several daemon RSS sizes, fork cost grows with page table size, vfork and zygote do not.
+// throughput: concurrent spawning threads at the largest RSS, report spawns per second and p50/p99 latency.
+// Usage: benchmark_spawn [spawn count] [threads] [command], default 200 4 /bin/true
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <ace/Init_ACE.h>
+#include <ace/OS.h>
+#include <ace/Process.h>
+
+#include "../../../src/daemon/process/VforkSpawner.h"
+#include "../../../src/daemon/process/ZygoteSpawner.h"
+
+// daemon RSS to simulate, MByte
+static const std::vector<std::size_t> RSS_SIZE_MB = {0, 128, 512, 2048};
+
+struct BenchResult
+{
+	double average;
+	double spawnsPerSecond;
+	double p50;
+	double p99;
+	int failed;
+};
+
+// spawn + wait from each thread, latency is the spawn() call (microseconds)
+template <typename SPAWN>
+static BenchResult bench(int count, int threads, const std::string &cmd, SPAWN spawnFunc)
+{
+	std::vector<double> latency;
+	std::mutex mutex;
+	int failed = 0;
+	auto start = std::chrono::steady_clock::now();
+	std::vector<std::thread> workers;
+	for (int t = 0; t < threads; t++)
+	{
+		workers.emplace_back([&, t]() {
+			std::vector<double> local;
+			int localFailed = 0;
+			for (int i = t; i < count; i += threads)
+			{
+				ACE_Process_Options option;
+				option.command_line("%s", cmd.c_str());
+				option.setgroup(0);
+				auto begin = std::chrono::steady_clock::now();
+				pid_t pid = spawnFunc(option);
+				local.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - begin).count());
+				if (pid > 0)
+					ACE_OS::waitpid(pid, nullptr, 0);
+				else
+					localFailed++;
+			}
+			std::lock_guard<std::mutex> guard(mutex);
+			latency.insert(latency.end(), local.begin(), local.end());
+			failed += localFailed;
+		});
+	}
+	for (auto &worker : workers)
+		worker.join();
+	auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	std::sort(latency.begin(), latency.end());
+	BenchResult result;
+	double total = 0;
+	for (auto value : latency)
+		total += value;
+	result.average = total / latency.size();
+	result.spawnsPerSecond = count / seconds;
+	result.p50 = latency[latency.size() * 50 / 100];
+	result.p99 = latency[std::min(latency.size() - 1, latency.size() * 99 / 100)];
+	result.failed = failed;
+	return result;
+}
+
+static pid_t forkSpawn(ACE_Process_Options &option)
+{
+	ACE_Process process;
+	return process.spawn(option);
+}
+
+static pid_t vforkSpawn(ACE_Process_Options &option)
+{
+	return VforkSpawner::spawn(option, []() {});
+}
+
+static pid_t zygoteSpawn(ACE_Process_Options &option)
+{
+	return ZygoteSpawner::instance()->spawn(option, {});
+}
+
+static void print(const std::string &name, const BenchResult &result)
+{
+	std::cout << name << "\t" << result.spawnsPerSecond << "\t" << result.p50 << "\t" << result.p99 << "\t" << result.failed << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+	ACE::init();
+	int count = argc > 1 ? std::stoi(argv[1]) : 200;
+	int threads = argc > 2 ? std::stoi(argv[2]) : 4;
+	std::string cmd = argc > 3 ? argv[3] : "/bin/true";
+
+	// helper is forked before memory grow, same as daemon boot
+	if (!ZygoteSpawner::instance()->start())
+	{
+		std::cerr << "failed to start spawn helper" << std::endl;
+		return 1;
+	}
+
+	std::cout << "rss_mb\tace_fork_us\tvfork_us\tzygote_us" << std::endl;
+	std::vector<char> memory;
+	for (auto sizeMb : RSS_SIZE_MB)
+	{
+		// touch all pages, make them resident
+		memory.resize(sizeMb * 1024 * 1024);
+		std::memset(memory.data(), 1, memory.size());
+
+		auto aceCost = bench(count, 1, cmd, forkSpawn).average;
+		auto vforkCost = bench(count, 1, cmd, vforkSpawn).average;
+		auto zygoteCost = bench(count, 1, cmd, zygoteSpawn).average;
+		std::cout << sizeMb << "\t" << aceCost << "\t" << vforkCost << "\t" << zygoteCost << std::endl;
+	}
+
+	std::cout << std::endl
+			  << "rss_mb=" << RSS_SIZE_MB.back() << " threads=" << threads << " count=" << count << std::endl;
+	std::cout << "mode\tspawn_per_sec\tp50_us\tp99_us\tfailed" << std::endl;
+	print("fork", bench(count, threads, cmd, forkSpawn));
+	print("vfork", bench(count, threads, cmd, vforkSpawn));
+	print("zygote", bench(count, threads, cmd, zygoteSpawn));
+
+	ZygoteSpawner::instance()->stop();
+	ACE::fini();
+	return 0;
+}
@@ -0,0 +1,202 @@
+// Sync run benchmark on the daemon classes, stdout captured by OutputCapture (StdoutCaptureMode=memory) in both modes:
+// thread_per_run: one thread per run blocks in AppProcess::waitExit() then reads output (old sync run)
+// event_loop: MonitoredProcess exit is published by ChildSignalHandler (SIGCHLD signalfd on reactor) -> ProcessReaper,
+//             output is read in TimerDispatcher thread (same path as sync run reply)
+// Usage: benchmark_syncrun [concurrent runs] [command], default 1000 and "/bin/sh -c "echo syncrun; sleep 1""
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <thread>
+#include <vector>
+
+#include <ace/Init_ACE.h>
+#include <ace/OS.h>
+#include <ace/Reactor.h>
+#include <log4cpp/Category.hh>
+#include <log4cpp/Priority.hh>
+
+#include "../../../src/common/Utility.h"
+#include "../../../src/daemon/ChildSignalHandler.h"
+#include "../../../src/daemon/Configuration.h"
+#include "../../../src/daemon/TimerDispatcher.h"
+#include "../../../src/daemon/TimerHandler.h"
+#include "../../../src/daemon/process/MonitoredProcess.h"
+
+// wait all runs finished
+static const std::chrono::seconds BENCH_TIMEOUT(120);
+
+struct BenchResult
+{
+	long threads;
+	long vmSizeKb;
+	long vmRssKb;
+	double elapsedMs;
+	int failed;
+};
+
+// finished run counter
+class Completion
+{
+public:
+	Completion() : m_count(0) {}
+	void done()
+	{
+		std::lock_guard<std::mutex> guard(m_mutex);
+		m_count++;
+		m_cond.notify_all();
+	}
+	bool wait(int count)
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		return m_cond.wait_for(lock, BENCH_TIMEOUT, [this, count]() { return m_count >= count; });
+	}
+
+private:
+	std::mutex m_mutex;
+	std::condition_variable m_cond;
+	int m_count;
+};
+
+// MonitoredProcess without http request, output is read after the (empty) reply in the same dispatcher context
+class BenchProcess : public MonitoredProcess
+{
+public:
+	explicit BenchProcess(Completion &completion) : m_completion(completion), m_exitCode(-1) {}
+	virtual void onExit(ACE_exitcode status) override
+	{
+		MonitoredProcess::onExit(status);
+		auto self = std::dynamic_pointer_cast<BenchProcess>(this->shared_from_this());
+		TimerDispatcher::instance()->dispatch(static_cast<TimerHandler *>(self.get()), [self]() { self->finish(); });
+	}
+	void finish()
+	{
+		m_output = this->fetchOutputMsg();
+		m_exitCode = this->returnValue();
+		m_completion.done();
+	}
+	bool failed() const { return m_output.empty() || m_exitCode != 0; }
+
+private:
+	Completion &m_completion;
+	std::string m_output;
+	int m_exitCode;
+};
+
+// value of "key:" in /proc/self/status
+static long procStatus(const std::string &key)
+{
+	std::ifstream status("/proc/self/status");
+	std::string line;
+	while (std::getline(status, line))
+	{
+		if (line.compare(0, key.length() + 1, key + ":") == 0)
+			return std::stol(line.substr(key.length() + 1));
+	}
+	return -1;
+}
+
+// spawn all runs with stdout captured to memory buffer, the file name only enables capture
+static std::vector<std::shared_ptr<BenchProcess>> spawnAll(int count, const std::string &cmd, Completion &completion)
+{
+	std::vector<std::shared_ptr<BenchProcess>> processes;
+	for (int i = 0; i < count; i++)
+	{
+		auto process = std::make_shared<BenchProcess>(completion);
+		process->setOutputCapture(true);
+		process->spawnProcess(cmd, "", "", {}, nullptr, Utility::stringFormat("/tmp/appmesh_bench_syncrun_%d.out", i));
+		processes.push_back(process);
+	}
+	return processes;
+}
+
+static BenchResult threadPerRun(int count, const std::string &cmd)
+{
+	BenchResult result;
+	Completion completion;
+	auto start = std::chrono::steady_clock::now();
+	auto processes = spawnAll(count, cmd, completion);
+	std::vector<std::thread> threads;
+	for (auto &process : processes)
+	{
+		threads.emplace_back([process]() {
+			if (process->getpid() > 0)
+				process->waitExit();
+			process->finish();
+		});
+	}
+	result.threads = procStatus("Threads");
+	result.vmSizeKb = procStatus("VmSize");
+	result.vmRssKb = procStatus("VmRSS");
+	for (auto &thread : threads)
+		thread.join();
+	result.elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	result.failed = 0;
+	for (const auto &process : processes)
+		result.failed += process->failed();
+	return result;
+}
+
+static BenchResult eventLoop(int count, const std::string &cmd)
+{
+	BenchResult result;
+	Completion completion;
+	auto start = std::chrono::steady_clock::now();
+	auto processes = spawnAll(count, cmd, completion);
+	result.threads = procStatus("Threads");
+	result.vmSizeKb = procStatus("VmSize");
+	result.vmRssKb = procStatus("VmRSS");
+	completion.wait(count);
+	result.elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	result.failed = 0;
+	for (const auto &process : processes)
+		result.failed += process->failed();
+	return result;
+}
+
+static void print(const std::string &name, const BenchResult &result)
+{
+	std::cout << name << "\t" << result.threads << "\t" << result.vmSizeKb / 1024 << "\t" << result.vmRssKb / 1024 << "\t" << result.elapsedMs << "\t" << result.failed << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+	// block SIGCHLD before any thread created, same as daemon
+	ChildSignalHandler::blockSignal();
+	ACE::init();
+	log4cpp::Category::getRoot().setPriority(log4cpp::Priority::WARN);
+	int count = argc > 1 ? std::stoi(argv[1]) : 1000;
+	std::string cmd = argc > 2 ? argv[2] : "/bin/sh -c \"echo syncrun; sleep 1\"";
+
+	// one pipe per run
+	struct rlimit limit;
+	if (::getrlimit(RLIMIT_NOFILE, &limit) == 0)
+	{
+		limit.rlim_cur = limit.rlim_max;
+		::setrlimit(RLIMIT_NOFILE, &limit);
+	}
+	Configuration::instance(Configuration::FromJson("{\"StdoutCaptureMode\": \"memory\", \"ProcessSpawnMode\": \"vfork\"}"));
+
+	std::cout << "runs=" << count << " command=" << cmd << std::endl;
+	std::cout << "mode\tthreads\tvm_mb\trss_mb\telapsed_ms\tfailed" << std::endl;
+	// exit is collected by waitExit() of each thread, no reaper event
+	print("thread_per_run", threadPerRun(count, cmd));
+
+	// daemon event path: signalfd on reactor thread, reply in dispatch threads
+	TimerDispatcher::instance()->start(DEFAULT_TIMER_THREAD_POOL_SIZE);
+	ChildSignalHandler::instance()->open(ACE_Reactor::instance());
+	std::thread reactor(std::bind(&TimerHandler::runReactorEvent, ACE_Reactor::instance()));
+	print("event_loop", eventLoop(count, cmd));
+
+	TimerHandler::endReactorEvent(ACE_Reactor::instance());
+	reactor.join();
+	TimerDispatcher::instance()->stop();
+	ACE::fini();
+	return 0;
+}
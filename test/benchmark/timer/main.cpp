@@ -0,0 +1,142 @@
+// Timer backend microbenchmark: TimerWheel vs ACE_Reactor timer queue
+// Usage: benchmark_timer [timer_count ...], default 10000 100000 1000000
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <ace/Event_Handler.h>
+#include <ace/Init_ACE.h>
+#include <ace/OS.h>
+#include <ace/Reactor.h>
+#include <ace/Timer_Queue.h>
+
+#include "../../../src/common/TimerWheel.h"
+
+// timer delay range
+#define MAX_DELAY_MILLISECONDS (3600 * 1000)
+
+class CountHandler : public ACE_Event_Handler
+{
+public:
+	CountHandler() : m_count(0) {}
+	virtual int handle_timeout(const ACE_Time_Value &current_time, const void *act = 0) override
+	{
+		m_count++;
+		return 0;
+	}
+	std::size_t m_count;
+};
+
+struct BenchResult
+{
+	double m_insert;
+	double m_cancel;
+	double m_fire;
+	std::size_t m_fired;
+};
+
+static double elapsedMs(const std::chrono::steady_clock::time_point &start)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static BenchResult benchReactor(const std::vector<long> &delays)
+{
+	BenchResult result;
+	CountHandler handler;
+	ACE_Reactor reactor;
+	std::vector<long> ids(delays.size());
+
+	auto start = std::chrono::steady_clock::now();
+	for (std::size_t i = 0; i < delays.size(); i++)
+	{
+		ACE_Time_Value delay;
+		delay.msec(delays[i]);
+		ids[i] = reactor.schedule_timer(&handler, nullptr, delay);
+	}
+	result.m_insert = elapsedMs(start);
+
+	// cancel half
+	start = std::chrono::steady_clock::now();
+	for (std::size_t i = 0; i < ids.size(); i += 2)
+	{
+		reactor.cancel_timer(ids[i]);
+	}
+	result.m_cancel = elapsedMs(start);
+
+	// expire all left timers
+	start = std::chrono::steady_clock::now();
+	ACE_Time_Value end = reactor.timer_queue()->gettimeofday();
+	end += ACE_Time_Value(MAX_DELAY_MILLISECONDS / 1000 + 1);
+	reactor.timer_queue()->expire(end);
+	result.m_fire = elapsedMs(start);
+	result.m_fired = handler.m_count;
+	return result;
+}
+
+static BenchResult benchWheel(const std::vector<long> &delays)
+{
+	BenchResult result;
+	std::size_t count = 0;
+	TimerWheel wheel(10);
+	std::vector<int> ids(delays.size());
+
+	auto start = std::chrono::steady_clock::now();
+	for (std::size_t i = 0; i < delays.size(); i++)
+	{
+		ids[i] = wheel.add(delays[i], 0, [&count](int) { count++; });
+	}
+	result.m_insert = elapsedMs(start);
+
+	// cancel half
+	start = std::chrono::steady_clock::now();
+	for (std::size_t i = 0; i < ids.size(); i += 2)
+	{
+		wheel.cancel(ids[i]);
+	}
+	result.m_cancel = elapsedMs(start);
+
+	// expire all left timers
+	start = std::chrono::steady_clock::now();
+	wheel.advanceTo(wheel.nowTick() + MAX_DELAY_MILLISECONDS / wheel.tickMillisecond() + 1);
+	result.m_fire = elapsedMs(start);
+	result.m_fired = count;
+	return result;
+}
+
+static void print(const std::string &backend, std::size_t timers, const BenchResult &result)
+{
+	std::cout << backend << "\ttimers=" << timers
+			  << "\tinsert=" << result.m_insert << "ms"
+			  << "\tcancel(1/2)=" << result.m_cancel << "ms"
+			  << "\tfire=" << result.m_fire << "ms"
+			  << "\tfired=" << result.m_fired << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+	ACE::init();
+	std::vector<std::size_t> counts = {10000, 100000, 1000000};
+	if (argc > 1)
+	{
+		counts.clear();
+		for (int i = 1; i < argc; i++)
+			counts.push_back(std::stoul(argv[i]));
+	}
+
+	std::mt19937 generator(20200101);
+	std::uniform_int_distribution<long> distribution(0, MAX_DELAY_MILLISECONDS);
+	for (auto timers : counts)
+	{
+		std::vector<long> delays(timers);
+		for (auto &delay : delays)
+			delay = distribution(generator);
+
+		print("ace_reactor", timers, benchReactor(delays));
+		print("timer_wheel", timers, benchWheel(delays));
+	}
+	ACE::fini();
+	return 0;
+}
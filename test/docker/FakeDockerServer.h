@@ -0,0 +1,341 @@
+#pragma once
+
+// In-memory Docker Engine API on a unix socket for DockerApiClient test and benchmark,
+// implements the endpoints used by DockerProcess: image inspect/pull, container create/start/stop/inspect/remove/logs
+#include <atomic>
+#include <chrono>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <poll.h>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include <cpprest/json.h>
+
+class FakeDockerServer
+{
+public:
+    struct Container
+    {
+        std::string m_id;
+        std::string m_name;
+        std::string m_image;
+        web::json::value m_config;
+        bool m_running;
+    };
+
+    explicit FakeDockerServer(const std::string &socketPath)
+        : m_socketPath(socketPath), m_running(true), m_requests(0), m_pulls(0), m_pullDelayMs(0), m_containerIndex(0)
+    {
+        ::unlink(m_socketPath.c_str());
+        m_listenFd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        struct sockaddr_un addr;
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        std::strncpy(addr.sun_path, m_socketPath.c_str(), sizeof(addr.sun_path) - 1);
+        if (::bind(m_listenFd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || ::listen(m_listenFd, 128) < 0)
+            throw std::runtime_error(std::string("fake docker listen failed: ") + std::strerror(errno));
+        m_thread = std::thread(&FakeDockerServer::run, this);
+    }
+
+    ~FakeDockerServer()
+    {
+        m_running = false;
+        m_thread.join();
+        ::close(m_listenFd);
+        ::unlink(m_socketPath.c_str());
+    }
+
+    const std::string &socketPath() const { return m_socketPath; }
+    long requests() const { return m_requests; }
+    long pulls() const { return m_pulls; }
+    // slow down image pull to simulate download
+    void pullDelay(int milliseconds) { m_pullDelayMs = milliseconds; }
+
+    void addImage(const std::string &image, long long size)
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        m_images[image] = size;
+    }
+    bool hasImage(const std::string &image)
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        return m_images.count(image) > 0;
+    }
+    // query of each container stop request: t=x&signal=y
+    std::vector<std::string> stops()
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        return m_stops;
+    }
+    std::size_t containerCount()
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        return m_containers.size();
+    }
+    // container by id or name, m_id is empty for not exist
+    Container container(const std::string &idOrName)
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        auto iter = find(idOrName);
+        return iter == m_containers.end() ? Container{"", "", "", web::json::value(), false} : iter->second;
+    }
+
+private:
+    struct Reply
+    {
+        int m_status;
+        std::string m_body;
+        bool m_chunked;
+    };
+
+    void run()
+    {
+        while (m_running)
+        {
+            struct pollfd pfd = {m_listenFd, POLLIN, 0};
+            if (::poll(&pfd, 1, 100) <= 0)
+                continue;
+            int fd = ::accept4(m_listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+            if (fd >= 0)
+            {
+                handle(fd);
+                ::close(fd);
+            }
+        }
+    }
+
+    // one request per connection, client always send Connection: close
+    void handle(int fd)
+    {
+        std::string buffer;
+        char block[4096];
+        std::size_t headerEnd;
+        while ((headerEnd = buffer.find("\r\n\r\n")) == std::string::npos)
+        {
+            auto size = ::recv(fd, block, sizeof(block), 0);
+            if (size <= 0)
+                return;
+            buffer.append(block, size);
+        }
+        std::size_t contentLength = 0;
+        auto lengthPos = buffer.find("Content-Length: ");
+        if (lengthPos != std::string::npos && lengthPos < headerEnd)
+            contentLength = std::strtoul(buffer.c_str() + lengthPos + std::strlen("Content-Length: "), nullptr, 10);
+        while (buffer.length() < headerEnd + 4 + contentLength)
+        {
+            auto size = ::recv(fd, block, sizeof(block), 0);
+            if (size <= 0)
+                return;
+            buffer.append(block, size);
+        }
+        auto requestLine = buffer.substr(0, buffer.find("\r\n"));
+        auto method = requestLine.substr(0, requestLine.find(' '));
+        auto target = requestLine.substr(method.length() + 1, requestLine.rfind(' ') - method.length() - 1);
+        auto body = buffer.substr(headerEnd + 4, contentLength);
+        m_requests++;
+        if (method == "POST" && target.find("/images/create") == 0)
+        {
+            m_pulls++;
+            std::this_thread::sleep_for(std::chrono::milliseconds(m_pullDelayMs));
+        }
+
+        auto reply = route(method, target, body);
+        std::string response = "HTTP/1.1 " + std::to_string(reply.m_status) + " Fake\r\nConnection: close\r\n";
+        if (reply.m_chunked)
+        {
+            response.append("Content-Type: application/json\r\nTransfer-Encoding: chunked\r\n\r\n");
+            // one chunk per progress line, same as docker pull
+            std::size_t pos = 0;
+            while (pos < reply.m_body.length())
+            {
+                auto lineEnd = reply.m_body.find('\n', pos);
+                auto line = reply.m_body.substr(pos, lineEnd - pos + 1);
+                pos = lineEnd + 1;
+                char size[16];
+                std::snprintf(size, sizeof(size), "%zx\r\n", line.length());
+                response.append(size).append(line).append("\r\n");
+            }
+            // image "truncated": connection closed before the last chunk
+            if (query(target, "fromImage") != "truncated")
+                response.append("0\r\n\r\n");
+        }
+        else
+        {
+            response.append("Content-Length: ").append(std::to_string(reply.m_body.length())).append("\r\n\r\n").append(reply.m_body);
+        }
+        std::size_t sent = 0;
+        while (sent < response.length())
+        {
+            auto size = ::send(fd, response.data() + sent, response.length() - sent, MSG_NOSIGNAL);
+            if (size <= 0)
+                return;
+            sent += size;
+        }
+    }
+
+    static std::string decode(const std::string &value)
+    {
+        std::string result;
+        for (std::size_t i = 0; i < value.length(); i++)
+        {
+            if (value[i] == '%' && i + 2 < value.length())
+            {
+                result.push_back((char)std::strtol(value.substr(i + 1, 2).c_str(), nullptr, 16));
+                i += 2;
+            }
+            else
+            {
+                result.push_back(value[i]);
+            }
+        }
+        return result;
+    }
+
+    static std::string query(const std::string &target, const std::string &key)
+    {
+        auto pos = target.find(key + "=");
+        if (pos == std::string::npos)
+            return "";
+        pos += key.length() + 1;
+        return decode(target.substr(pos, target.find('&', pos) - pos));
+    }
+
+    static Reply error(int status, const std::string &message)
+    {
+        auto json = web::json::value::object();
+        json["message"] = web::json::value::string(message);
+        return Reply{status, json.serialize(), false};
+    }
+
+    static std::string frame(char stream, const std::string &payload)
+    {
+        std::string header(8, '\0');
+        header[0] = stream;
+        header[4] = (char)((payload.length() >> 24) & 0xFF);
+        header[5] = (char)((payload.length() >> 16) & 0xFF);
+        header[6] = (char)((payload.length() >> 8) & 0xFF);
+        header[7] = (char)(payload.length() & 0xFF);
+        return header + payload;
+    }
+
+    std::map<std::string, Container>::iterator find(const std::string &idOrName)
+    {
+        auto iter = m_containers.find(idOrName);
+        if (iter != m_containers.end())
+            return iter;
+        for (iter = m_containers.begin(); iter != m_containers.end(); ++iter)
+        {
+            if (iter->second.m_name == idOrName)
+                break;
+        }
+        return iter;
+    }
+
+    Reply route(const std::string &method, const std::string &target, const std::string &body)
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        auto path = target.substr(0, target.find('?'));
+
+        // POST /images/create?fromImage=x&tag=y
+        if (method == "POST" && path == "/images/create")
+        {
+            auto image = query(target, "fromImage") + ":" + query(target, "tag");
+            if (query(target, "fromImage") == "notfound")
+                return Reply{200, "{\"status\":\"Pulling from library/notfound\"}\n{\"error\":\"manifest unknown\"}\n", true};
+            m_images[image] = 1024 * 1024;
+            std::string progress = "{\"status\":\"Pulling from " + image + "\"}\n";
+            for (int i = 1; i <= 3; i++)
+                progress.append("{\"status\":\"Downloading\",\"id\":\"layer\",\"progressDetail\":{\"current\":" + std::to_string(i) + ",\"total\":3},\"progress\":\"" + std::to_string(i) + "/3\"}\n");
+            progress.append("{\"status\":\"Download complete\",\"id\":\"layer\"}\n");
+            progress.append("{\"status\":\"Status: Downloaded newer image for " + image + "\"}\n");
+            return Reply{200, progress, true};
+        }
+        // GET /images/{name}/json
+        if (method == "GET" && path.find("/images/") == 0 && path.rfind("/json") == path.length() - 5)
+        {
+            auto image = decode(path.substr(8, path.length() - 8 - 5));
+            auto iter = m_images.find(image);
+            if (iter == m_images.end())
+                iter = m_images.find(image + ":latest");
+            if (iter == m_images.end())
+                return error(404, "No such image: " + image);
+            return Reply{200, "{\"Id\":\"sha256:fake\",\"Size\":" + std::to_string(iter->second) + "}", false};
+        }
+        // POST /containers/create?name=x
+        if (method == "POST" && path == "/containers/create")
+        {
+            auto config = web::json::value::parse(body);
+            auto image = config.at("Image").as_string();
+            if (m_images.count(image) == 0 && m_images.count(image + ":latest") == 0)
+                return error(404, "No such image: " + image);
+            auto name = query(target, "name");
+            if (find(name) != m_containers.end())
+                return error(409, "Conflict. The container name \"/" + name + "\" is already in use");
+            auto id = "fake" + std::to_string(++m_containerIndex);
+            m_containers[id] = Container{id, name, image, config, false};
+            return Reply{201, "{\"Id\":\"" + id + "\",\"Warnings\":[]}", false};
+        }
+        if (path.find("/containers/") != 0)
+            return error(404, "page not found");
+
+        // /containers/{id}[/action]
+        auto idEnd = path.find('/', 12);
+        auto id = decode(path.substr(12, idEnd == std::string::npos ? std::string::npos : idEnd - 12));
+        auto action = idEnd == std::string::npos ? "" : path.substr(idEnd + 1);
+        auto iter = find(id);
+        if (iter == m_containers.end())
+            return error(404, "No such container: " + id);
+        auto &container = iter->second;
+        if (method == "DELETE" && action.empty())
+        {
+            m_containers.erase(iter);
+            return Reply{204, "", false};
+        }
+        if (method == "POST" && action == "start")
+        {
+            if (container.m_running)
+                return Reply{304, "", false};
+            container.m_running = true;
+            return Reply{204, "", false};
+        }
+        if (method == "POST" && action == "stop")
+        {
+            m_stops.push_back(target.substr(target.find('?') + 1));
+            if (!container.m_running)
+                return Reply{304, "", false};
+            container.m_running = false;
+            return Reply{204, "", false};
+        }
+        if (method == "GET" && action == "json")
+        {
+            // live pid of this process, DockerProcess check container process by pid
+            auto pid = container.m_running ? ::getpid() : 0;
+            return Reply{200, "{\"Id\":\"" + container.m_id + "\",\"State\":{\"Running\":" + (container.m_running ? "true" : "false") + ",\"Pid\":" + std::to_string(pid) + "}}", false};
+        }
+        if (method == "GET" && action == "logs")
+            return Reply{200, frame(1, "stdout of " + container.m_name + "\n") + frame(2, "stderr of " + container.m_name + "\n"), false};
+        return error(404, "page not found");
+    }
+
+private:
+    const std::string m_socketPath;
+    int m_listenFd;
+    std::atomic<bool> m_running;
+    std::atomic<long> m_requests;
+    std::atomic<long> m_pulls;
+    std::atomic<int> m_pullDelayMs;
+    std::mutex m_mutex;
+    std::map<std::string, long long> m_images;
+    std::map<std::string, Container> m_containers;
+    std::vector<std::string> m_stops;
+    int m_containerIndex;
+    std::thread m_thread;
+};
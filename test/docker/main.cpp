@@ -0,0 +1,310 @@
+#define CATCH_CONFIG_MAIN // This tells Catch to provide a main() - only do this in one cpp file
+#include "../catch.hpp"
+#include <iostream>
+#include <string>
+#include <memory>
+#include <map>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <csignal>
+#include <cstdlib>
+#include <functional>
+#include <ace/Init_ACE.h>
+#include <ace/OS.h>
+#include <log4cpp/Category.hh>
+#include <log4cpp/Appender.hh>
+#include <log4cpp/Priority.hh>
+#include <log4cpp/PatternLayout.hh>
+#include <log4cpp/OstreamAppender.hh>
+#include "../../src/common/Utility.h"
+#include "../../src/daemon/ResourceLimitation.h"
+#include "../../src/daemon/process/ContainerStats.h"
+#include "../../src/daemon/process/DockerApiClient.h"
+#include "../../src/daemon/process/DockerImageManager.h"
+#include "../../src/daemon/process/DockerProcess.h"
+#include "FakeDockerServer.h"
+
+void init()
+{
+    static bool initialized = false;
+    if (!initialized)
+    {
+        initialized = true;
+        ACE::init();
+        using namespace log4cpp;
+        auto consoleLayout = new PatternLayout();
+        consoleLayout->setConversionPattern("%d [%t] %p %c: %m%n");
+        auto consoleAppender = new OstreamAppender("console", &std::cout);
+        consoleAppender->setLayout(consoleLayout);
+        Category::getRoot().addAppender(consoleAppender);
+        Utility::setLogLevel("DEBUG");
+    }
+}
+
+TEST_CASE("Docker API Client Test", "[DockerApiClient]")
+{
+    init();
+
+    const std::string socketPath = "/tmp/appmesh_test_docker.sock";
+    FakeDockerServer server(socketPath);
+    DockerApiClient client(socketPath);
+
+    SECTION("image inspect and pull")
+    {
+        REQUIRE(client.imageSize("busybox") == -1);
+        server.addImage("ubuntu:20.04", 72 * 1024 * 1024);
+        REQUIRE(client.imageSize("ubuntu:20.04") == 72 * 1024 * 1024);
+
+        std::vector<std::string> progress;
+        client.pullImage("busybox", [&progress](const web::json::value &message) {
+            progress.push_back(message.at("status").as_string());
+            return true;
+        });
+        REQUIRE(progress.size() == 6);
+        REQUIRE(progress.back().find("Downloaded newer image") != std::string::npos);
+        REQUIRE(server.hasImage("busybox:latest"));
+        REQUIRE(client.imageSize("busybox") > 0);
+
+        // registry with port is not tag
+        client.pullImage("localhost:5000/app", nullptr);
+        REQUIRE(server.hasImage("localhost:5000/app:latest"));
+
+        // error message in progress stream
+        REQUIRE_THROWS_WITH(client.pullImage("notfound", nullptr), Catch::Contains("manifest unknown"));
+
+        // cancel by progress callback
+        REQUIRE_THROWS_WITH(client.pullImage("alpine:3", [](const web::json::value &) { return false; }), Catch::Contains("cancelled"));
+
+        // connection closed in chunked body is not a success
+        REQUIRE_THROWS_WITH(client.pullImage("truncated", nullptr), Catch::Contains("closed connection"));
+    }
+
+    SECTION("container life cycle")
+    {
+        server.addImage("busybox:latest", 1024);
+        auto config = DockerApiClient::containerConfig("busybox", "sh -c 'sleep 10'", {}, nullptr, {});
+        auto id = client.createContainer("app-1", config);
+        REQUIRE(id.length());
+        REQUIRE(server.containerCount() == 1);
+        REQUIRE(server.container(id).m_config.at("Cmd").size() == 3);
+        REQUIRE(server.container(id).m_config.at("Cmd")[2].as_string() == "sleep 10");
+
+        // name conflict
+        REQUIRE_THROWS_WITH(client.createContainer("app-1", config), Catch::Contains("already in use"));
+        // image not exist
+        REQUIRE_THROWS_WITH(client.createContainer("app-2", DockerApiClient::containerConfig("nginx", "", {}, nullptr, {})), Catch::Contains("No such image"));
+
+        REQUIRE(client.containerPid(id) == 0);
+        client.startContainer(id);
+        // already started
+        client.startContainer("app-1");
+        REQUIRE(client.containerPid(id) == ::getpid());
+        REQUIRE(client.containerLogs(id, 0) == "stdout of app-1\nstderr of app-1\n");
+
+        REQUIRE(client.removeContainer("app-1"));
+        REQUIRE_FALSE(client.removeContainer(id));
+        REQUIRE(server.containerCount() == 0);
+        REQUIRE_THROWS_WITH(client.containerPid(id), Catch::Contains("No such container"));
+    }
+
+    SECTION("container config from docker run options")
+    {
+        std::map<std::string, std::string> envMap = {
+            {"A", "1"},
+            {ENV_APP_MANAGER_DOCKER_PARAMS, "-p 8080:80 --publish=127.0.0.1:8443:443/tcp -v /data:/data -e B=2 --net host --privileged -u 1000 --unknown"}};
+        auto limit = std::make_shared<ResourceLimitation>();
+        limit->m_memoryMb = 100;
+        limit->m_memoryVirtMb = 200;
+        limit->m_cpuShares = 512;
+        limit->m_cpuQuotaPercent = 50;
+        limit->m_pidsMax = 64;
+        auto config = DockerApiClient::containerConfig("nginx", "", envMap, limit, {"/etc/hosts:/etc/hosts:ro"});
+
+        REQUIRE(config.at("Image").as_string() == "nginx");
+        REQUIRE_FALSE(config.has_field("Cmd"));
+        REQUIRE(config.at("Env").size() == 2);
+        REQUIRE(config.at("Env")[0].as_string() == "A=1");
+        REQUIRE(config.at("Env")[1].as_string() == "B=2");
+        REQUIRE(config.at("User").as_string() == "1000");
+        REQUIRE(config.at("ExposedPorts").has_field("80/tcp"));
+        REQUIRE(config.at("ExposedPorts").has_field("443/tcp"));
+
+        auto hostConfig = config.at("HostConfig");
+        REQUIRE(hostConfig.at("PortBindings").at("80/tcp")[0].at("HostPort").as_string() == "8080");
+        REQUIRE(hostConfig.at("PortBindings").at("443/tcp")[0].at("HostIp").as_string() == "127.0.0.1");
+        REQUIRE(hostConfig.at("Binds").size() == 2);
+        REQUIRE(hostConfig.at("NetworkMode").as_string() == "host");
+        REQUIRE(hostConfig.at("Privileged").as_bool());
+        REQUIRE(hostConfig.at("Memory").as_number().to_int64() == 100LL * 1024 * 1024);
+        REQUIRE(hostConfig.at("MemorySwap").as_number().to_int64() == 200LL * 1024 * 1024);
+        REQUIRE(hostConfig.at("CpuShares").as_integer() == 512);
+        REQUIRE(hostConfig.at("NanoCpus").as_number().to_int64() == 500000000LL);
+        REQUIRE(hostConfig.at("PidsLimit").as_integer() == 64);
+    }
+
+    SECTION("log stream demux")
+    {
+        std::string multiplexed;
+        multiplexed.append(std::string("\x01\x00\x00\x00\x00\x00\x00\x03", 8)).append("abc");
+        multiplexed.append(std::string("\x02\x00\x00\x00\x00\x00\x00\x02", 8)).append("de");
+        REQUIRE(DockerApiClient::demuxLogs(multiplexed) == "abcde");
+        // tty log is raw
+        REQUIRE(DockerApiClient::demuxLogs("plain text\n") == "plain text\n");
+        REQUIRE(DockerApiClient::encode("a b/c:1") == "a%20b%2Fc%3A1");
+    }
+
+    SECTION("container stats parse")
+    {
+        auto paths = ContainerStats::parseCgroupPaths("12:memory:/docker/abc\n4:cpu,cpuacct:/docker/abc\n0::/system.slice/docker-abc.scope\n");
+        REQUIRE(paths["memory"] == "/docker/abc");
+        REQUIRE(paths["cpuacct"] == "/docker/abc");
+        REQUIRE(paths[""] == "/system.slice/docker-abc.scope");
+
+        REQUIRE(ContainerStats::parseKeyValue("usage_usec 21590\nuser_usec 100\n", "usage_usec") == 21590);
+        REQUIRE(ContainerStats::parseKeyValue("cache 1\ntotal_cache 2\n", "total_cache") == 2);
+        REQUIRE(ContainerStats::parseKeyValue("file 1\n", "file_mapped") == -1);
+
+        long long readBytes, writeBytes;
+        ContainerStats::parseBlockIo("8:0 rbytes=100 wbytes=20 rios=1 wios=1\n8:16 rbytes=5 wbytes=1 rios=1 wios=1\n", true, readBytes, writeBytes);
+        REQUIRE(readBytes == 105);
+        REQUIRE(writeBytes == 21);
+        ContainerStats::parseBlockIo("8:0 Read 100\n8:0 Write 20\n8:0 Sync 3\n8:0 Total 120\nTotal 120\n", false, readBytes, writeBytes);
+        REQUIRE(readBytes == 100);
+        REQUIRE(writeBytes == 20);
+
+        long long rxBytes, txBytes;
+        ContainerStats::parseNetDev("Inter-|   Receive |  Transmit\n face |bytes packets|bytes packets\n"
+                                    "    lo:  500 5 0 0 0 0 0 0  500 5 0 0 0 0 0 0\n"
+                                    "  eth0: 1296 16 0 0 0 0 0 0  648 8 0 0 0 0 0 0\n",
+                                    rxBytes, txBytes);
+        REQUIRE(rxBytes == 1296);
+        REQUIRE(txBytes == 648);
+
+        // stats of this process cgroup
+        ContainerStats stats(::getpid());
+        auto sample = stats.sample();
+        REQUIRE(sample.m_networkRxBytes >= 0);
+    }
+
+    SECTION("connection failure")
+    {
+        DockerApiClient noServer("/tmp/appmesh_test_docker_not_exist.sock");
+        REQUIRE_THROWS_WITH(noServer.imageSize("busybox"), Catch::Contains("connect to"));
+    }
+}
+
+TEST_CASE("Docker Image Manager Test", "[DockerImageManager]")
+{
+    init();
+
+    // DockerImageManager use default socket
+    const std::string socketPath = "/tmp/appmesh_test_docker_pull.sock";
+    ::setenv("DOCKER_HOST", ("unix://" + socketPath).c_str(), 1);
+    FakeDockerServer server(socketPath);
+    server.pullDelay(300);
+    auto manager = DockerImageManager::instance();
+
+    auto waitFinished = [](const std::atomic<int> &finished, int expected) {
+        for (int i = 0; i < 100 && finished < expected; i++)
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        return finished == expected;
+    };
+
+    SECTION("concurrent pulls of the same image are deduplicated")
+    {
+        REQUIRE(manager->status("busybox:1").is_null());
+        std::atomic<int> finished(0);
+        std::atomic<int> failed(0);
+        for (int i = 0; i < 10; i++)
+        {
+            manager->pull("busybox:1", 60, [&finished, &failed](const std::string &error) {
+                failed += error.length() > 0;
+                finished++;
+            });
+        }
+        auto status = manager->status("busybox:1");
+        REQUIRE_FALSE(status.is_null());
+        REQUIRE(status.at(JSON_KEY_DOCKER_PULL_waiters).as_integer() == 10);
+
+        REQUIRE(waitFinished(finished, 10));
+        REQUIRE(failed == 0);
+        REQUIRE(server.pulls() == 1);
+        REQUIRE(server.hasImage("busybox:1"));
+        status = manager->status("busybox:1");
+        REQUIRE(status.at(JSON_KEY_DOCKER_PULL_state).as_string() == "done");
+        REQUIRE(status.at(JSON_KEY_DOCKER_PULL_progress).as_number().to_int64() == 100);
+        REQUIRE_FALSE(status.has_field(JSON_KEY_DOCKER_PULL_waiters));
+
+        // finished pull is not joined, pull again
+        manager->pull("busybox:1", 60, [&finished](const std::string &) { finished++; });
+        REQUIRE(waitFinished(finished, 11));
+        REQUIRE(server.pulls() == 2);
+    }
+
+    SECTION("pull failure is reported to all waiters")
+    {
+        std::atomic<int> finished(0);
+        std::atomic<int> failed(0);
+        for (int i = 0; i < 3; i++)
+        {
+            manager->pull("notfound", 60, [&finished, &failed](const std::string &error) {
+                failed += error.find("manifest unknown") != std::string::npos;
+                finished++;
+            });
+        }
+        REQUIRE(waitFinished(finished, 3));
+        REQUIRE(failed == 3);
+        auto status = manager->status("notfound");
+        REQUIRE(status.at(JSON_KEY_DOCKER_PULL_state).as_string() == "failed");
+        REQUIRE(status.at(JSON_KEY_DOCKER_PULL_error).as_string().find("manifest unknown") != std::string::npos);
+    }
+}
+
+TEST_CASE("Docker Process Stop Test", "[DockerProcess]")
+{
+    init();
+
+    const std::string socketPath = "/tmp/appmesh_test_docker_stop.sock";
+    ::setenv("DOCKER_HOST", ("unix://" + socketPath).c_str(), 1);
+    FakeDockerServer server(socketPath);
+
+    auto waitFor = [](const std::function<bool()> &condition) {
+        for (int i = 0; i < 100 && !condition(); i++)
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        return condition();
+    };
+
+    SECTION("running container is stopped with signal and grace period then removed")
+    {
+        server.addImage("busybox:latest", 1024);
+        auto process = std::make_shared<DockerProcess>("busybox", "stop_app");
+        REQUIRE(process->spawnProcess("sleep 60", "", "", {}, nullptr) == 1);
+        REQUIRE(waitFor([&process]() { return process->containerId().length() > 0; }));
+        REQUIRE(server.container("stop_app").m_running);
+
+        process->stop(SIGINT, 7);
+        REQUIRE(process->stopTime().time_since_epoch().count() > 0);
+        REQUIRE(waitFor([&server]() { return server.containerCount() == 0; }));
+        REQUIRE(server.stops().size() == 1);
+        REQUIRE(server.stops().front() == "t=7&signal=" + std::to_string(SIGINT));
+        REQUIRE(waitFor([&process]() { return process->getpid() == ACE_INVALID_PID; }));
+        REQUIRE(process->containerId().empty());
+    }
+
+    SECTION("pending image pull is cancelled and container is not created")
+    {
+        server.pullDelay(300);
+        auto process = std::make_shared<DockerProcess>("busybox:2", "pull_app");
+        process->spawnProcess("sleep 60", "", "", {}, nullptr);
+        REQUIRE(waitFor([&server]() { return server.pulls() == 1; }));
+
+        process->stop(SIGTERM, 10);
+        REQUIRE(process->getpid() == ACE_INVALID_PID);
+        REQUIRE(waitFor([&server]() { return server.hasImage("busybox:2"); }));
+        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+        REQUIRE(server.containerCount() == 0);
+        REQUIRE(server.stops().empty());
+    }
+}
@@ -0,0 +1,73 @@
+#!/usr/bin/python3
+# Measure App Mesh restart latency: time from kill a long running app process to respawn.
+# Need run on App Mesh host with permission to kill application process.
+# Usage: bench_restart_latency.py [samples]
+import os
+import signal
+import sys
+import time
+
+# path = "/opt/appmesh/sdk/"
+path = os.path.dirname(os.path.dirname(os.path.dirname(__file__)))
+sys.path.append(path + "/src/sdk/python")
+
+import appmesh_client
+
+APP_NAME = "bench_restart"
+POLL_INTERVAL_SECONDS = 0.005
+RESPAWN_TIMEOUT_SECONDS = 120
+
+
+def get_pid(client):
+    success, app = client.get_app(APP_NAME)
+    if success and "pid" in app:
+        return int(app["pid"])
+    return 0
+
+
+def wait_pid(client, old_pid):
+    # wait until a new process is running
+    deadline = time.time() + RESPAWN_TIMEOUT_SECONDS
+    while time.time() < deadline:
+        pid = get_pid(client)
+        if pid > 0 and pid != old_pid:
+            return pid
+        time.sleep(POLL_INTERVAL_SECONDS)
+    raise Exception("application not respawned in {0} seconds".format(RESPAWN_TIMEOUT_SECONDS))
+
+
+def percentile(values, pct):
+    index = min(len(values) - 1, int(round(pct / 100.0 * (len(values) - 1))))
+    return values[index]
+
+
+def main():
+    samples = int(sys.argv[1]) if len(sys.argv) > 1 else 20
+
+    client = appmesh_client.AppMeshClient()
+    client.login("admin", "Admin123")
+    client.remove_app(APP_NAME)
+    print(client.reg_app({"name": APP_NAME, "command": "sleep 3600"}))
+
+    latency = []
+    try:
+        pid = wait_pid(client, 0)
+        for _ in range(samples):
+            start = time.time()
+            os.kill(pid, signal.SIGKILL)
+            pid = wait_pid(client, pid)
+            latency.append((time.time() - start) * 1000.0)
+    finally:
+        client.remove_app(APP_NAME)
+
+    latency.sort()
+    print("restart samples: {0}".format(len(latency)))
+    print("min: {0:.1f} ms".format(latency[0]))
+    print("p50: {0:.1f} ms".format(percentile(latency, 50)))
+    print("p95: {0:.1f} ms".format(percentile(latency, 95)))
+    print("max: {0:.1f} ms".format(latency[-1]))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
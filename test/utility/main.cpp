@@ -6,6 +6,7 @@
 #include <thread>
 #include <time.h>
 #include <set>
+#include <limits>
 #include <fstream>
 #include <ace/Init_ACE.h>
 #include <ace/OS.h>
@@ -18,6 +19,10 @@
 #include <log4cpp/OstreamAppender.hh>
 #include "../../src/common/DateTime.h"
 #include "../../src/common/Utility.h"
+#include "../../src/common/os/pssnapshot.hpp"
+#include "../../src/daemon/application/AppUtils.h"
+#include "../../src/daemon/application/OutputSearch.h"
+#include <sys/wait.h>
 
 void init()
 {
@@ -124,5 +129,339 @@ TEST_CASE("Utility Test", "[Utility]")
             auto keys = Utility::splitString(envKey, "_");
         }
     }
+
+    SECTION("process snapshot test")
+    {
+        auto child = fork();
+        if (child == 0)
+        {
+            sleep(10);
+            _exit(0);
+        }
+        REQUIRE(child > 0);
+        auto snapshot = os::ProcessSnapshot::scan();
+        REQUIRE(snapshot != nullptr);
+        REQUIRE(snapshot->find(getpid()) != nullptr);
+        REQUIRE(snapshot->find(child) != nullptr);
+        REQUIRE(snapshot->find(child)->parent == getpid());
+        REQUIRE(snapshot->pids(getpid()).size() >= 2);
+        REQUIRE(snapshot->totalRSS(getpid()) > snapshot->totalRSS(child));
+        REQUIRE(snapshot->totalRSS(-1) == 0);
+        kill(child, SIGKILL);
+        waitpid(child, nullptr, 0);
+    }
     // teardown
 }
+
+TEST_CASE("Log File Queue Test", "[LogFileQueue]")
+{
+    init();
+
+    const std::string base = "/tmp/appmesh_test_queue.out";
+    auto touch = [](const std::string &file) { std::ofstream(file) << file; };
+    for (const auto &suffix : {"", ".3", ".5", ".5.gz", ".7", ".x", ".7.bak"})
+        touch(base + suffix);
+
+    SECTION("rotated files of previous run are adopted and sequence continues")
+    {
+        {
+            LogFileQueue queue(base, 2);
+            // current + the latest 2 rotated, older one is removed, plain file of compressed sequence is removed
+            REQUIRE(queue.size() == 3);
+            REQUIRE(queue.getFileName(0) == base);
+            REQUIRE(queue.getFileName(1) == base + ".7");
+            REQUIRE(queue.getFileName(2) == base + ".5.gz");
+            REQUIRE(queue.isCompressed(2));
+            REQUIRE(queue.getHistoryFiles().size() == 2);
+            REQUIRE_FALSE(Utility::isFileExist(base + ".3"));
+            REQUIRE_FALSE(Utility::isFileExist(base + ".5"));
+
+            // current file of previous run is rotated with next sequence, the oldest is removed
+            queue.enqueue();
+            REQUIRE(queue.size() == 3);
+            REQUIRE(queue.getFileName(1) == base + ".8");
+            REQUIRE(Utility::isFileExist(base + ".8"));
+            REQUIRE_FALSE(Utility::isFileExist(base + ".5.gz"));
+        }
+        // files created by the queue are removed, adopted files and other files are not touched
+        REQUIRE_FALSE(Utility::isFileExist(base));
+        REQUIRE(Utility::isFileExist(base + ".7"));
+        REQUIRE(Utility::isFileExist(base + ".8"));
+        REQUIRE(Utility::isFileExist(base + ".x"));
+        REQUIRE(Utility::isFileExist(base + ".7.bak"));
+    }
+
+    SECTION("replaced queue does not remove files adopted by the newer queue")
+    {
+        auto queue = std::make_shared<LogFileQueue>(base, 3);
+        queue->enqueue();
+        touch(base);
+        queue->enqueue();
+        REQUIRE(Utility::isFileExist(base + ".9"));
+
+        // application re-registered, the newer queue adopts all rotated files before the old one is destructed
+        LogFileQueue replacement(base, 3);
+        queue.reset();
+        REQUIRE(replacement.size() == 4);
+        REQUIRE(replacement.getFileName(1) == base + ".9");
+        REQUIRE(Utility::isFileExist(base + ".9"));
+        REQUIRE(Utility::isFileExist(base + ".8"));
+        REQUIRE(Utility::isFileExist(base + ".7"));
+    }
+
+    for (const auto &suffix : {"", ".x", ".7.bak", ".5.gz", ".7", ".8", ".9"})
+        Utility::removeFile(base + suffix);
+}
+
+TEST_CASE("Restart Backoff Test", "[Restart]")
+{
+    SECTION("no delay without failure")
+    {
+        REQUIRE(restartBackoff(0, 1, 300).count() == 0);
+        REQUIRE(restartBackoff(-1, 1, 300).count() == 0);
+    }
+
+    SECTION("jitter is in [delay/2, delay]")
+    {
+        for (int fails = 1; fails <= 8; fails++)
+        {
+            // below max 300s, delay = 2^(fails-1) seconds
+            const long long delayMs = 1000LL << (fails - 1);
+            for (int i = 0; i < 200; i++)
+            {
+                const auto backoff = restartBackoff(fails, 1, 300).count();
+                REQUIRE(backoff >= delayMs / 2);
+                REQUIRE(backoff <= delayMs);
+            }
+        }
+    }
+
+    SECTION("large failure number is clamped to max")
+    {
+        for (const int fails : {10, 21, 64, 1000, std::numeric_limits<int>::max()})
+        {
+            const auto backoff = restartBackoff(fails, 1, 300).count();
+            REQUIRE(backoff >= 150000);
+            REQUIRE(backoff <= 300000);
+        }
+        REQUIRE(restartBackoff(std::numeric_limits<int>::max(), 3600, 86400).count() <= 86400000LL);
+    }
+}
+
+TEST_CASE("Restart Token Bucket Test", "[Restart]")
+{
+    SECTION("unlimited when rate is 0")
+    {
+        RestartTokenBucket bucket;
+        for (int i = 0; i < 100; i++)
+            REQUIRE(bucket.acquire(0, 1));
+    }
+
+    SECTION("burst then refill by rate")
+    {
+        RestartTokenBucket bucket;
+        // start full
+        for (int i = 0; i < 5; i++)
+            REQUIRE(bucket.acquire(10, 5));
+        REQUIRE_FALSE(bucket.acquire(10, 5));
+
+        // 10 per second refill one token in 100ms
+        std::this_thread::sleep_for(std::chrono::milliseconds(150));
+        REQUIRE(bucket.acquire(10, 5));
+        REQUIRE_FALSE(bucket.acquire(10, 5));
+
+        // refill never exceeds burst
+        std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+        for (int i = 0; i < 5; i++)
+            REQUIRE(bucket.acquire(10, 5));
+        REQUIRE_FALSE(bucket.acquire(10, 5));
+    }
+}
+
+TEST_CASE("Restart Window Test", "[Restart]")
+{
+    const auto start = std::chrono::system_clock::now();
+    const auto window = std::chrono::seconds(600);
+    std::chrono::system_clock::time_point retryTime;
+    RestartWindow restarts;
+
+    SECTION("budget of a window")
+    {
+        restarts.record(start);
+        REQUIRE(restarts.allow(start + std::chrono::seconds(1), window, 3, retryTime));
+        restarts.record(start + std::chrono::seconds(1));
+        REQUIRE(restarts.allow(start + std::chrono::seconds(2), window, 3, retryTime));
+        restarts.record(start + std::chrono::seconds(2));
+        REQUIRE(restarts.size() == 3);
+
+        // budget exhausted until the first restart leaves the window
+        REQUIRE_FALSE(restarts.allow(start + std::chrono::seconds(3), window, 3, retryTime));
+        REQUIRE(retryTime == start + std::chrono::seconds(600));
+        REQUIRE_FALSE(restarts.allow(start + std::chrono::seconds(599), window, 3, retryTime));
+        REQUIRE(restarts.allow(start + std::chrono::seconds(600), window, 3, retryTime));
+        REQUIRE(restarts.size() == 2);
+        restarts.record(start + std::chrono::seconds(600));
+        REQUIRE_FALSE(restarts.allow(start + std::chrono::seconds(600), window, 3, retryTime));
+        REQUIRE(retryTime == start + std::chrono::seconds(601));
+
+        // all expired
+        REQUIRE(restarts.allow(start + std::chrono::seconds(1300), window, 3, retryTime));
+        REQUIRE(restarts.size() == 0);
+    }
+
+    SECTION("window and max changed by hot update")
+    {
+        for (int i = 0; i < 4; i++)
+            restarts.record(start + std::chrono::seconds(i));
+        // 0 max is unlimited
+        REQUIRE(restarts.allow(start + std::chrono::seconds(4), window, 0, retryTime));
+        // decreased max, wait until enough restarts leave the window
+        REQUIRE_FALSE(restarts.allow(start + std::chrono::seconds(4), window, 2, retryTime));
+        REQUIRE(retryTime == start + std::chrono::seconds(602));
+        // shorter window drops old restarts at once
+        REQUIRE(restarts.allow(start + std::chrono::seconds(12), std::chrono::seconds(10), 2, retryTime));
+        REQUIRE(restarts.size() == 1);
+    }
+}
+
+TEST_CASE("Line Index Test", "[LineIndex]")
+{
+    const std::string file = "/tmp/appmesh_test_line_index.out";
+    std::vector<std::uint64_t> offsets;
+    std::uint64_t size = 0;
+    auto append = [&](int from, int to, bool terminated) {
+        std::ofstream stream(file, std::ios::app);
+        for (int i = from; i < to; i++)
+        {
+            // variable line length so that checkpoints fall in the middle of lines
+            const auto line = std::to_string(i) + std::string(i % 97, 'x');
+            offsets.push_back(size);
+            stream << line;
+            size += line.length();
+            if (terminated || i + 1 < to)
+            {
+                stream << '\n';
+                size++;
+            }
+        }
+    };
+    Utility::removeFile(file);
+    append(0, 3000, true);
+    REQUIRE(size > 10 * 4096);
+
+    LineIndex index;
+    SECTION("line offset is located by checkpoint and scan")
+    {
+        for (std::uint64_t line = 0; line < offsets.size(); line++)
+            REQUIRE(index.lineOffset(file, line) == offsets[line]);
+        REQUIRE(index.lineOffset(file, offsets.size()) == size);
+        REQUIRE(index.lineOffset(file, offsets.size() + 100) == size);
+
+        REQUIRE(index.tailOffset(file, 0) == size);
+        REQUIRE(index.tailOffset(file, 1) == offsets[2999]);
+        REQUIRE(index.tailOffset(file, 1500) == offsets[1500]);
+        REQUIRE(index.tailOffset(file, 3000) == 0);
+        REQUIRE(index.tailOffset(file, 5000) == 0);
+    }
+
+    SECTION("appended content is indexed incrementally, unterminated last line is counted")
+    {
+        REQUIRE(index.tailOffset(file, 1) == offsets[2999]);
+        append(3000, 4500, false);
+        for (std::uint64_t line = 2990; line < offsets.size(); line++)
+            REQUIRE(index.lineOffset(file, line) == offsets[line]);
+        REQUIRE(index.tailOffset(file, 1) == offsets[4499]);
+        REQUIRE(index.tailOffset(file, 10) == offsets[4490]);
+        REQUIRE(index.lineOffset(file, 4500) == size);
+    }
+
+    SECTION("truncated file is re-indexed")
+    {
+        REQUIRE(index.tailOffset(file, 1) == offsets[2999]);
+        std::ofstream(file, std::ios::trunc) << "a\nb\nc";
+        REQUIRE(index.lineOffset(file, 1) == 2);
+        REQUIRE(index.tailOffset(file, 1) == 4);
+        REQUIRE(index.tailOffset(file, 5) == 0);
+        REQUIRE(index.lineOffset(file, 3) == 5);
+    }
+
+    SECTION("missing file")
+    {
+        Utility::removeFile(file);
+        REQUIRE(index.lineOffset(file, 10) == 0);
+        REQUIRE(index.tailOffset(file, 10) == 0);
+    }
+    Utility::removeFile(file);
+}
+
+TEST_CASE("Output Search Test", "[OutputSearch]")
+{
+    const std::string file = "/tmp/appmesh_test_search.out";
+    std::string content;
+    for (int i = 0; i < 100; i++)
+        content += (i % 10 == 3 ? "error code " : "info line ") + std::to_string(i) + "\n";
+    std::ofstream(file) << content;
+
+    std::vector<OutputMatch> matches;
+    auto collect = [&matches](const OutputMatch &match) { matches.push_back(match); };
+    const auto timeout = std::chrono::seconds(5);
+
+    SECTION("substring matches are reported with line offset")
+    {
+        OutputSearch search("error", false, 100, timeout);
+        REQUIRE(search.scan(file, 0, collect));
+        REQUIRE(matches.size() == 10);
+        REQUIRE(matches[0].m_line == "error code 3");
+        REQUIRE(matches[0].m_offset == content.find("error code 3"));
+        REQUIRE(matches[9].m_line == "error code 93");
+        REQUIRE_FALSE(search.truncated());
+    }
+
+    SECTION("regex matches line by line")
+    {
+        OutputSearch search("^error code [0-9]3$", true, 100, timeout);
+        REQUIRE(search.scan(file, 1, collect));
+        REQUIRE(matches.size() == 9);
+        REQUIRE(matches[0].m_line == "error code 13");
+        REQUIRE(matches[0].m_index == 1);
+    }
+
+    SECTION("exactly max count matches is not truncated")
+    {
+        OutputSearch search("error", false, 10, timeout);
+        REQUIRE(search.scan(file, 0, collect));
+        REQUIRE(search.count() == 10);
+        REQUIRE_FALSE(search.truncated());
+    }
+
+    SECTION("one more match than max count is truncated")
+    {
+        OutputSearch search("error", false, 9, timeout);
+        REQUIRE_FALSE(search.scan(file, 0, collect));
+        REQUIRE(matches.size() == 9);
+        REQUIRE(search.truncated());
+        // rest files are not scanned
+        REQUIRE_FALSE(search.scan(file, 1, collect));
+        REQUIRE(matches.size() == 9);
+    }
+
+    SECTION("memory output offset starts from the oldest data")
+    {
+        OutputSearch search("error code 93", false, 100, timeout);
+        const auto memory = content.substr(content.find("info line 90"));
+        const std::uint64_t offset = 1024 * 1024;
+        REQUIRE(search.scanMemory(memory, offset, 0, collect));
+        REQUIRE(matches.size() == 1);
+        REQUIRE(matches[0].m_offset == offset + memory.find("error code 93"));
+    }
+
+    SECTION("missing file is skipped, invalid pattern throws")
+    {
+        OutputSearch search("error", false, 100, timeout);
+        REQUIRE(search.scan(file + ".none", 0, collect));
+        REQUIRE(matches.empty());
+        REQUIRE_THROWS(OutputSearch("", false, 100, timeout));
+        REQUIRE_THROWS(OutputSearch("(unclosed", true, 100, timeout));
+    }
+    Utility::removeFile(file);
+}